@@ -19,6 +19,7 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestHash )
     REGISTER_TESTGROUP( TestLevenshteinDistance )
     REGISTER_TESTGROUP( TestMemPoolBlock )
+    REGISTER_TESTGROUP( TestMemPoolBuffer )
     REGISTER_TESTGROUP( TestMutex )
     REGISTER_TESTGROUP( TestNetwork )
     REGISTER_TESTGROUP( TestPathUtils )
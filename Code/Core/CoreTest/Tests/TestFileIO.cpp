@@ -32,7 +32,9 @@ private:
     void FileDelete() const;
     void FileCopy() const;
     void FileCopySymlink() const;
+    void FileCopyRange() const;
     void FileMove() const;
+    void FileLink() const;
     void ReadOnly() const;
     void FileTime() const;
     void LongPaths() const;
@@ -52,7 +54,9 @@ REGISTER_TESTS_BEGIN( TestFileIO )
     REGISTER_TEST( FileDelete )
     REGISTER_TEST( FileCopy )
     REGISTER_TEST( FileCopySymlink )
+    REGISTER_TEST( FileCopyRange )
     REGISTER_TEST( FileMove )
+    REGISTER_TEST( FileLink )
     REGISTER_TEST( ReadOnly )
     REGISTER_TEST( FileTime )
     REGISTER_TEST( LongPaths )
@@ -150,6 +154,55 @@ void TestFileIO::FileCopy() const
     VERIFY( FileIO::FileDelete( pathCopy.Get() ) );
 }
 
+// FileCopyRange
+//------------------------------------------------------------------------------
+void TestFileIO::FileCopyRange() const
+{
+    // generate a process unique file path
+    AStackString<> path;
+    GenerateTempFileName( path );
+
+    // generate copy file name
+    AStackString<> pathCopy( path );
+    pathCopy += ".copy";
+
+    // make sure nothing is left from previous runs
+    FileIO::FileDelete( path.Get() );
+    FileIO::FileDelete( pathCopy.Get() );
+
+    // create a file with a distinct value at each offset
+    const uint32_t numValues = ( 256 * 1024 );
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( path.Get(), FileStream::WRITE_ONLY ) == true );
+        for ( uint32_t i = 0; i < numValues; ++i )
+        {
+            TEST_ASSERT( f.Write( i ) );
+        }
+    }
+
+    // copy an unaligned range from the middle (and overwrite it with another)
+    const uint32_t ranges[][ 2 ] = { { 0, numValues }, { 12345, 100000 } };
+    for ( const auto & range : ranges )
+    {
+        TEST_ASSERT( FileIO::FileCopyRange( path, range[ 0 ] * sizeof( uint32_t ), range[ 1 ] * sizeof( uint32_t ), pathCopy ) );
+
+        FileStream f;
+        TEST_ASSERT( f.Open( pathCopy.Get(), FileStream::READ_ONLY ) == true );
+        TEST_ASSERT( f.GetFileSize() == ( range[ 1 ] * sizeof( uint32_t ) ) );
+        for ( uint32_t i = 0; i < range[ 1 ]; ++i )
+        {
+            uint32_t value = 0;
+            TEST_ASSERT( f.Read( value ) );
+            TEST_ASSERT( value == ( range[ 0 ] + i ) );
+        }
+    }
+
+    // cleanup
+    VERIFY( FileIO::FileDelete( path.Get() ) );
+    VERIFY( FileIO::FileDelete( pathCopy.Get() ) );
+}
+
 // FileCopySymlink
 //------------------------------------------------------------------------------
 void TestFileIO::FileCopySymlink() const
@@ -238,6 +291,46 @@ void TestFileIO::FileMove() const
     VERIFY( FileIO::FileDelete( pathCopy.Get() ) );
 }
 
+// FileLink
+//------------------------------------------------------------------------------
+void TestFileIO::FileLink() const
+{
+    // generate a process unique file path
+    AStackString<> path;
+    GenerateTempFileName( path );
+
+    // generate link file name
+    AStackString<> pathLink( path );
+    pathLink += ".link";
+
+    // make sure nothing is left from previous runs
+    FileIO::FileDelete( path.Get() );
+    FileIO::FileDelete( pathLink.Get() );
+
+    // create it
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( path.Get(), FileStream::WRITE_ONLY ) == true );
+        TEST_ASSERT( f.Write( (uint32_t)1234 ) );
+    }
+
+    // link it
+    TEST_ASSERT( FileIO::FileLink( path, pathLink ) );
+    TEST_ASSERT( FileIO::FileLink( path, pathLink ) == false ); // Already exists
+
+    // the link remains after the original is deleted
+    VERIFY( FileIO::FileDelete( path.Get() ) );
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( pathLink.Get(), FileStream::READ_ONLY ) == true );
+        uint32_t value = 0;
+        TEST_ASSERT( f.Read( value ) && ( value == 1234 ) );
+    }
+
+    // cleanup
+    VERIFY( FileIO::FileDelete( pathLink.Get() ) );
+}
+
 // ReadOnly
 //------------------------------------------------------------------------------
 void TestFileIO::ReadOnly() const
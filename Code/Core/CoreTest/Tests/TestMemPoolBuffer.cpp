@@ -0,0 +1,107 @@
+// TestMemPoolBuffer.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/TestGroup.h"
+
+#include "Core/Mem/MemPoolBuffer.h"
+
+// System
+#include <string.h> // for memset
+
+// TestMemPoolBuffer
+//------------------------------------------------------------------------------
+class TestMemPoolBuffer : public TestGroup
+{
+private:
+    DECLARE_TESTS
+
+    void TestUnused() const;
+    void TestAllocs() const;
+    void TestReuse() const;
+    void TestRetainLimit() const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestMemPoolBuffer )
+    REGISTER_TEST( TestUnused )
+    REGISTER_TEST( TestAllocs )
+    REGISTER_TEST( TestReuse )
+    REGISTER_TEST( TestRetainLimit )
+REGISTER_TESTS_END
+
+// TestUnused
+//------------------------------------------------------------------------------
+void TestMemPoolBuffer::TestUnused() const
+{
+    // Create a MemPoolBuffer but don't do anything with it
+    const MemPoolBuffer pool;
+}
+
+// TestAllocs
+//------------------------------------------------------------------------------
+void TestMemPoolBuffer::TestAllocs() const
+{
+    MemPoolBuffer pool;
+
+    // Sizes within, between and beyond the retained size classes
+    const size_t sizes[] = { 0, 1, 255, 256, 257, 4096, 100 * 1000, 16 * 1024 * 1024, 16 * 1024 * 1024 + 1 };
+    for ( const size_t size : sizes )
+    {
+        void * mem = pool.Alloc( size );
+        TEST_ASSERT( mem );
+        TEST_ASSERT( ( (size_t)mem % sizeof( void * ) ) == 0 );
+        memset( mem, 0xAB, size ); // Entire buffer must be usable
+        pool.Free( mem );
+    }
+
+    // Freeing nullptr is allowed
+    pool.Free( nullptr );
+}
+
+// TestReuse
+//------------------------------------------------------------------------------
+void TestMemPoolBuffer::TestReuse() const
+{
+    MemPoolBuffer pool;
+
+    // A freed buffer should be re-used for a similar size
+    void * a = pool.Alloc( 1000 );
+    pool.Free( a );
+    TEST_ASSERT( pool.GetRetainedBytes() == 1024 );
+    void * b = pool.Alloc( 1020 );
+    TEST_ASSERT( a == b );
+    TEST_ASSERT( pool.GetRetainedBytes() == 0 );
+
+    // But not for a size in a different class
+    void * c = pool.Alloc( 2000 );
+    TEST_ASSERT( c != b );
+
+    pool.Free( b );
+    pool.Free( c );
+    TEST_ASSERT( pool.GetRetainedBytes() == ( 1024 + 2048 ) );
+}
+
+// TestRetainLimit
+//------------------------------------------------------------------------------
+void TestMemPoolBuffer::TestRetainLimit() const
+{
+    MemPoolBuffer pool( 4096 );
+
+    // Only buffers fitting within the limit are retained
+    void * a = pool.Alloc( 4096 );
+    void * b = pool.Alloc( 4096 );
+    pool.Free( a );
+    pool.Free( b );
+    TEST_ASSERT( pool.GetRetainedBytes() == 4096 );
+
+    // Large buffers are never retained
+    MemPoolBuffer bigPool( 1024 * 1024 * 1024 );
+    void * c = bigPool.Alloc( 32 * 1024 * 1024 );
+    bigPool.Free( c );
+    TEST_ASSERT( bigPool.GetRetainedBytes() == 0 );
+}
+
+//------------------------------------------------------------------------------
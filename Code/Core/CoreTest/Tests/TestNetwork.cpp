@@ -18,12 +18,14 @@ private:
     DECLARE_TESTS
 
     void GetIPv4Addresses() const;
+    void GetHostIPsFromNames() const;
 };
 
 // Register Tests
 //------------------------------------------------------------------------------
 REGISTER_TESTS_BEGIN( TestNetwork )
     REGISTER_TEST( GetIPv4Addresses )
+    REGISTER_TEST( GetHostIPsFromNames )
 REGISTER_TESTS_END
 
 // GetLocalIPv4Addresses
@@ -46,4 +48,29 @@ void TestNetwork::GetIPv4Addresses() const
     }
 }
 
+// GetHostIPsFromNames
+//------------------------------------------------------------------------------
+void TestNetwork::GetHostIPsFromNames() const
+{
+    Array<AString> hostNames;
+    hostNames.EmplaceBack( "127.0.0.1" );
+    hostNames.EmplaceBack( "localhost" );
+    hostNames.EmplaceBack( "10.1.2.3" );
+    hostNames.EmplaceBack( "unresolvable.invalid" ); // .invalid is reserved, so never resolves
+
+    Array<uint32_t> ips;
+    Network::GetHostIPsFromNames( hostNames, ips, 5000 );
+    TEST_ASSERT( ips.GetSize() == hostNames.GetSize() );
+    TEST_ASSERT( ips[ 0 ] == 0x0100007f );
+    TEST_ASSERT( ips[ 1 ] != 0 );
+    TEST_ASSERT( ips[ 2 ] == 0x0302010a );
+    TEST_ASSERT( ips[ 3 ] == 0 );
+
+    // Results match resolving each name on its own
+    for ( size_t i = 0; i < hostNames.GetSize(); ++i )
+    {
+        TEST_ASSERT( Network::GetHostIPFromName( hostNames[ i ], 5000 ) == ips[ i ] );
+    }
+}
+
 //------------------------------------------------------------------------------
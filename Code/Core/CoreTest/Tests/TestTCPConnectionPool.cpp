@@ -7,6 +7,7 @@
 
 // Core
 #include "Core/Containers/UniquePtr.h"
+#include "Core/Network/Network.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Semaphore.h"
@@ -17,6 +18,7 @@
 #include "Core/Tracing/Tracing.h"
 
 #include <memory.h> // for memset
+#include <time.h> // for clock
 
 // Defines
 //------------------------------------------------------------------------------
@@ -52,6 +54,9 @@ private:
     static uint32_t TestConnectionStuckDuringSend_ThreadFunc( void * userData );
 
     void TestConnectionFailure() const;
+    void TestConnectParallel() const;
+    void TestManyConnections() const;
+    void TestSlowReceiveHandlers() const;
 };
 
 // Helper Macros
@@ -76,6 +81,9 @@ REGISTER_TESTS_BEGIN( TestTestTCPConnectionPool )
     REGISTER_TEST( TestDataTransfer )
     REGISTER_TEST( TestConnectionStuckDuringSend )
     REGISTER_TEST( TestConnectionFailure )
+    REGISTER_TEST( TestConnectParallel )
+    REGISTER_TEST( TestManyConnections )
+    REGISTER_TEST( TestSlowReceiveHandlers )
 REGISTER_TESTS_END
 
 // TestOneServerMultipleClients
@@ -342,4 +350,230 @@ void TestTestTCPConnectionPool::TestConnectionFailure() const
     client.ShutdownAllConnections();
 }
 
+// TestConnectParallel
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestConnectParallel() const
+{
+    const uint16_t testPort( TEST_PORT );
+    const uint32_t localHostIP = Network::GetHostIPFromName( AStackString<>( "127.0.0.1" ) );
+    TEST_ASSERT( localHostIP != 0 );
+
+    TCPConnectionPool server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // More candidates than needed: only maxConnections should be kept
+    {
+        TCPConnectionPool client;
+        Array< TCPConnectionPool::ConnectRequest > requests;
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            TCPConnectionPool::ConnectRequest & request = requests.EmplaceBack();
+            request.m_HostIP = localHostIP;
+            request.m_Port = testPort;
+        }
+        client.ConnectParallel( requests, 2 );
+
+        size_t numConnected = 0;
+        for ( const TCPConnectionPool::ConnectRequest & request : requests )
+        {
+            if ( request.m_Result == TCPConnectionPool::ConnectRequest::CONNECTED )
+            {
+                TEST_ASSERT( request.m_Connection );
+                ++numConnected;
+            }
+            else
+            {
+                TEST_ASSERT( request.m_Result == TCPConnectionPool::ConnectRequest::ABANDONED );
+                TEST_ASSERT( request.m_Connection == nullptr );
+            }
+        }
+        TEST_ASSERT( numConnected == 2 );
+        WAIT_UNTIL_WITH_TIMEOUT( client.GetNumConnections() == 2 );
+        client.ShutdownAllConnections();
+    }
+
+    // A mix of reachable and unreachable hosts
+    {
+        TCPConnectionPool client;
+        Array< TCPConnectionPool::ConnectRequest > requests;
+        for ( size_t i = 0; i < 2; ++i )
+        {
+            TCPConnectionPool::ConnectRequest & request = requests.EmplaceBack();
+            request.m_HostIP = localHostIP;
+            request.m_Port = (uint16_t)( testPort + i ); // Nothing listening on second port
+        }
+        client.ConnectParallel( requests, 2, 1000 );
+
+        TEST_ASSERT( requests[ 0 ].m_Result == TCPConnectionPool::ConnectRequest::CONNECTED );
+        TEST_ASSERT( requests[ 1 ].m_Result == TCPConnectionPool::ConnectRequest::FAILED );
+        TEST_ASSERT( requests[ 1 ].m_Connection == nullptr );
+        WAIT_UNTIL_WITH_TIMEOUT( client.GetNumConnections() == 1 );
+        client.ShutdownAllConnections();
+    }
+
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+    server.ShutdownAllConnections();
+}
+
+// TestManyConnections
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestManyConnections() const
+{
+    // A server which counts the messages it receives
+    class CountingServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~CountingServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void *, uint32_t, bool & ) override
+        {
+            m_NumMessages.Increment();
+        }
+        Atomic< uint32_t > m_NumMessages;
+    };
+
+    #if defined( __LINUX__ )
+        const uint32_t numConnections = 500;
+    #else
+        const uint32_t numConnections = 100; // Thread per connection on other platforms
+    #endif
+    const uint32_t numMessagesPerConnection = 200;
+    const uint16_t testPort( TEST_PORT );
+
+    CountingServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // Open all connections
+    TCPConnectionPool client;
+    Array< const ConnectionInfo * > connections( numConnections, false );
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        // Allow each connection to be retried in case of local resource exhaustion
+        const Timer t;
+        const ConnectionInfo * ci;
+        while ( ( ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort ) ) == nullptr )
+        {
+            TEST_ASSERTM( t.GetElapsed() < 5.0f, "Failed to connect. (Connection %u)", i );
+            Thread::Sleep( 50 );
+        }
+        connections.Append( ci );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == numConnections );
+
+    // Send small messages, interleaved across all connections
+    const uint64_t payload = 0x0123456789ABCDEF;
+    const Timer timer;
+    const clock_t cpuStart = clock();
+    for ( uint32_t j = 0; j < numMessagesPerConnection; ++j )
+    {
+        for ( const ConnectionInfo * ci : connections )
+        {
+            TEST_ASSERT( client.Send( ci, &payload, sizeof( payload ) ) );
+        }
+    }
+    const uint32_t numMessages = ( numConnections * numMessagesPerConnection );
+    while ( server.m_NumMessages.Load() < numMessages )
+    {
+        TEST_ASSERTM( timer.GetElapsed() < 30.0f, "Timed out. Received %u of %u messages", server.m_NumMessages.Load(), numMessages );
+        Thread::Sleep( 1 );
+    }
+    const float elapsed = timer.GetElapsed();
+    #if defined( __WINDOWS__ )
+        (void)cpuStart; // clock() measures wall time on Windows
+        OUTPUT( "Connections: %u, Messages: %u in %2.3fs (%u msg/s)\n", numConnections, numMessages, (double)elapsed, (uint32_t)( (float)numMessages / elapsed ) );
+    #else
+        const float cpuTime = (float)( clock() - cpuStart ) / (float)CLOCKS_PER_SEC;
+        OUTPUT( "Connections: %u, Messages: %u in %2.3fs (%u msg/s), CPU: %2.3fs\n", numConnections, numMessages, (double)elapsed, (uint32_t)( (float)numMessages / elapsed ), (double)cpuTime );
+    #endif
+
+    client.ShutdownAllConnections();
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+}
+
+// TestSlowReceiveHandlers
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestSlowReceiveHandlers() const
+{
+    // A server for which some messages take a long time to handle
+    class SlowServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~SlowServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & ) override
+        {
+            const uint32_t value = *static_cast< const uint32_t * >( data );
+            ASSERT( size == sizeof( value ) );
+            (void)size;
+            if ( value == kSlowMessage )
+            {
+                m_NumSlowStarted.Increment();
+                Thread::Sleep( 2000 );
+                m_NumSlowDone.Increment();
+                return;
+            }
+            if ( value == kFastMessage )
+            {
+                m_NumSlowDoneWhenFastReceived.Store( m_NumSlowDone.Load() );
+                m_FastReceived.Store( true );
+                return;
+            }
+
+            // Sequenced messages must arrive in order
+            if ( value != m_NextSequence.Load() )
+            {
+                m_SequenceError.Store( true );
+            }
+            m_NextSequence.Increment();
+        }
+        enum : uint32_t { kSlowMessage = 0xFFFFFFFF, kFastMessage = 0xFFFFFFFE };
+        Atomic< uint32_t > m_NumSlowStarted;
+        Atomic< uint32_t > m_NumSlowDone;
+        Atomic< uint32_t > m_NumSlowDoneWhenFastReceived;
+        Atomic< uint32_t > m_NextSequence;
+        Atomic< bool > m_FastReceived;
+        Atomic< bool > m_SequenceError;
+    };
+
+    // More slow connections than there are I/O threads
+    const uint32_t numSlowConnections = 8;
+    const uint16_t testPort( TEST_PORT );
+
+    SlowServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    TCPConnectionPool client;
+    Array< const ConnectionInfo * > connections( numSlowConnections + 2, false );
+    for ( uint32_t i = 0; i < ( numSlowConnections + 2 ); ++i )
+    {
+        const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+        TEST_ASSERT( ci );
+        connections.Append( ci );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == ( numSlowConnections + 2 ) );
+
+    // Occupy a handler with each slow connection
+    const uint32_t slowMessage = SlowServer::kSlowMessage;
+    for ( uint32_t i = 0; i < numSlowConnections; ++i )
+    {
+        TEST_ASSERT( client.Send( connections[ i ], &slowMessage, sizeof( slowMessage ) ) );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.m_NumSlowStarted.Load() == numSlowConnections );
+
+    // Other connections are still serviced promptly, and in order
+    const uint32_t numSequenced = 1000;
+    for ( uint32_t i = 0; i < numSequenced; ++i )
+    {
+        TEST_ASSERT( client.Send( connections[ numSlowConnections ], &i, sizeof( i ) ) );
+    }
+    const uint32_t fastMessage = SlowServer::kFastMessage;
+    TEST_ASSERT( client.Send( connections[ numSlowConnections + 1 ], &fastMessage, sizeof( fastMessage ) ) );
+    WAIT_UNTIL_WITH_TIMEOUT( server.m_FastReceived.Load() );
+    WAIT_UNTIL_WITH_TIMEOUT( server.m_NextSequence.Load() == numSequenced );
+    TEST_ASSERT( server.m_NumSlowDoneWhenFastReceived.Load() == 0 );
+    TEST_ASSERT( server.m_SequenceError.Load() == false );
+
+    client.ShutdownAllConnections();
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+    TEST_ASSERT( server.m_NumSlowDone.Load() == numSlowConnections );
+}
+
 //------------------------------------------------------------------------------
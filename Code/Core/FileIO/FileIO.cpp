@@ -40,6 +40,7 @@
 #if defined( __APPLE__ )
     #include <copyfile.h>
     #include <dlfcn.h>
+    #include <fcntl.h>
     #include <sys/time.h>
 #endif
 
@@ -320,6 +321,86 @@
 #endif
 }
 
+// FileCopyRange
+//------------------------------------------------------------------------------
+/*static*/ bool FileIO::FileCopyRange( const AString & srcFileName,
+                                       uint64_t srcOffset,
+                                       uint64_t size,
+                                       const AString & dstFileName )
+{
+    FileStream src;
+    if ( src.Open( srcFileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    return FileCopyRange( src, srcOffset, size, dstFileName );
+}
+
+// FileCopyRange
+//------------------------------------------------------------------------------
+/*static*/ bool FileIO::FileCopyRange( FileStream & src,
+                                       uint64_t srcOffset,
+                                       uint64_t size,
+                                       const AString & dstFileName )
+{
+    PROFILE_FUNCTION;
+
+    uint64_t bytesCopied = 0;
+#if defined( __LINUX__ )
+    // Ensure dest file will be writable if it exists
+    FileIO::SetReadOnly( dstFileName.Get(), false );
+
+    const int dest = open( dstFileName.Get(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if ( dest < 0 )
+    {
+        return false;
+    }
+
+    // Copy within the kernel (which can share storage where the filesystem supports
+    // it, or copy server-side for network filesystems)
+    loff_t srcPos = (loff_t)srcOffset;
+    while ( bytesCopied < size )
+    {
+        const size_t count = (size_t)Math::Min<uint64_t>( ( size - bytesCopied ), 0x40000000 );
+        const ssize_t copied = copy_file_range( src.GetHandle(), &srcPos, dest, nullptr, count, 0 );
+        if ( copied <= 0 )
+        {
+            break; // Unsupported (e.g. across filesystems on older kernels) - fall back to manual copy below
+        }
+        bytesCopied += (uint64_t)copied;
+    }
+
+    close( dest );
+
+    if ( bytesCopied == size )
+    {
+        return true;
+    }
+#endif
+
+    // Copy manually (from the start, since a partial copy above may be incomplete)
+    bytesCopied = 0;
+    FileStream dst;
+    if ( ( src.Seek( srcOffset ) == false ) ||
+         ( dst.Open( dstFileName.Get(), FileStream::WRITE_ONLY ) == false ) )
+    {
+        return false;
+    }
+    const size_t bufferSize = ( 1024 * 1024 );
+    UniquePtr< char > buffer( (char *)ALLOC( bufferSize ) );
+    while ( bytesCopied < size )
+    {
+        const size_t count = (size_t)Math::Min<uint64_t>( ( size - bytesCopied ), bufferSize );
+        if ( ( src.Read( buffer.Get(), count ) != count ) ||
+             ( dst.Write( buffer.Get(), count ) != count ) )
+        {
+            return false;
+        }
+        bytesCopied += count;
+    }
+    return true;
+}
+
 // FileMove
 //------------------------------------------------------------------------------
 /*static*/ bool FileIO::FileMove( const AString & srcFileName, const AString & dstFileName )
@@ -333,6 +414,19 @@
 #endif
 }
 
+// FileLink
+//------------------------------------------------------------------------------
+/*static*/ bool FileIO::FileLink( const AString & srcFileName, const AString & dstFileName )
+{
+#if defined( __WINDOWS__ )
+    return ( TRUE == ::CreateHardLink( dstFileName.Get(), srcFileName.Get(), nullptr ) );
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    return ( link( srcFileName.Get(), dstFileName.Get() ) == 0 );
+#else
+    #error Unknown platform
+#endif
+}
+
 // GetFiles
 //------------------------------------------------------------------------------
 /*static*/ bool FileIO::GetFiles( const AString & path,
@@ -858,7 +952,7 @@
             t[ 0 ].tv_sec = fileTime / 1000000000ULL;
             t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
             t[ 1 ] = t[ 0 ];
-            return ( (gOSXHelper_utimensat.m_FuncPtr)( 0, fileName.Get(), t, 0 ) == 0 );
+            return ( (gOSXHelper_utimensat.m_FuncPtr)( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
         }
 
         // Fallback to regular low-resolution filetime setting
@@ -872,7 +966,7 @@
         t[ 0 ].tv_sec = fileTime / 1000000000ULL;
         t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
         t[ 1 ] = t[ 0 ];
-        return ( utimensat( 0, fileName.Get(), t, 0 ) == 0 );
+        return ( utimensat( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
     #else
         #error Unknown platform
     #endif
@@ -889,13 +983,13 @@
         // Use higher precision function if available
         if ( gOSXHelper_utimensat.m_FuncPtr )
         {
-            return ( (gOSXHelper_utimensat.m_FuncPtr)( 0, fileName.Get(), nullptr, 0 ) == 0 );
+            return ( (gOSXHelper_utimensat.m_FuncPtr)( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
         }
 
         // Fallback to regular low-resolution filetime setting
         return ( utimes( fileName.Get(), nullptr ) == 0 );
     #elif defined( __LINUX__ )
-        return ( utimensat( 0, fileName.Get(), nullptr, 0 ) == 0 );
+        return ( utimensat( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
     #else
         #error Unknown platform
     #endif
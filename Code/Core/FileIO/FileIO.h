@@ -24,7 +24,10 @@ public:
     static bool FileExists( const char * fileName );
     static bool FileDelete( const char * fileName );
     static bool FileCopy( const char * srcFileName, const char * dstFileName, bool allowOverwrite = true );
+    static bool FileCopyRange( const AString & srcFileName, uint64_t srcOffset, uint64_t size, const AString & dstFileName ); // Shares storage where supported
+    static bool FileCopyRange( FileStream & src, uint64_t srcOffset, uint64_t size, const AString & dstFileName );
     static bool FileMove( const AString & srcFileName, const AString & dstFileName );
+    static bool FileLink( const AString & srcFileName, const AString & dstFileName ); // Hard link (same volume only)
     static bool DirectoryDelete( const AString & path );
 
     // directory listing
@@ -40,6 +40,8 @@ public:
     #if defined( __WINDOWS__ )
         // Set on already open file via handle (Windows only)
         bool SetLastWriteTime( uint64_t lastWriteTime );
+    #else
+        int32_t GetHandle() const { return m_Handle; }
     #endif
 
 private:
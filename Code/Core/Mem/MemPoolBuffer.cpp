@@ -0,0 +1,119 @@
+// MemPoolBuffer - Recycles variable sized buffers
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "MemPoolBuffer.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Mem/Mem.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+MemPoolBuffer::MemPoolBuffer( size_t maxRetainedBytes )
+    : m_RetainedBytes( 0 )
+    , m_MaxRetainedBytes( maxRetainedBytes )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+MemPoolBuffer::~MemPoolBuffer()
+{
+    for ( Array< void * > & freeBuffers : m_FreeBuffers )
+    {
+        for ( void * header : freeBuffers )
+        {
+            FREE( header );
+        }
+    }
+}
+
+// Alloc
+//------------------------------------------------------------------------------
+void * MemPoolBuffer::Alloc( size_t size )
+{
+    const uint32_t sizeClass = GetSizeClass( size );
+    Header * header = nullptr;
+    if ( sizeClass < kNumSizeClasses )
+    {
+        // Re-use a previously freed buffer if available
+        {
+            MutexHolder mh( m_Mutex );
+            Array< void * > & freeBuffers = m_FreeBuffers[ sizeClass ];
+            if ( freeBuffers.IsEmpty() == false )
+            {
+                header = static_cast< Header * >( freeBuffers.Top() );
+                freeBuffers.Pop();
+                m_RetainedBytes -= ( (size_t)1 << ( sizeClass + kMinSizeClassShift ) );
+            }
+        }
+        if ( header == nullptr )
+        {
+            header = static_cast< Header * >( ALLOC( sizeof( Header ) + ( (size_t)1 << ( sizeClass + kMinSizeClassShift ) ) ) );
+        }
+    }
+    else
+    {
+        header = static_cast< Header * >( ALLOC( sizeof( Header ) + size ) );
+    }
+    header->m_SizeClass = sizeClass;
+    return ( header + 1 );
+}
+
+// Free
+//------------------------------------------------------------------------------
+void MemPoolBuffer::Free( void * ptr )
+{
+    if ( ptr == nullptr )
+    {
+        return;
+    }
+
+    Header * header = ( static_cast< Header * >( ptr ) - 1 );
+    const uint32_t sizeClass = header->m_SizeClass;
+    if ( sizeClass < kNumSizeClasses )
+    {
+        const size_t bufferSize = ( (size_t)1 << ( sizeClass + kMinSizeClassShift ) );
+
+        MutexHolder mh( m_Mutex );
+        if ( ( m_RetainedBytes + bufferSize ) <= m_MaxRetainedBytes )
+        {
+            m_FreeBuffers[ sizeClass ].Append( header );
+            m_RetainedBytes += bufferSize;
+            return;
+        }
+    }
+    else
+    {
+        ASSERT( sizeClass == kNumSizeClasses ); // Corrupt or not from this pool?
+    }
+    FREE( header );
+}
+
+// GetRetainedBytes
+//------------------------------------------------------------------------------
+size_t MemPoolBuffer::GetRetainedBytes() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_RetainedBytes;
+}
+
+// GetSizeClass
+//------------------------------------------------------------------------------
+/*static*/ uint32_t MemPoolBuffer::GetSizeClass( size_t size )
+{
+    uint32_t sizeClass = 0;
+    while ( ( (size_t)1 << ( sizeClass + kMinSizeClassShift ) ) < size )
+    {
+        ++sizeClass;
+        if ( sizeClass == kNumSizeClasses )
+        {
+            break; // Too large to retain
+        }
+    }
+    return sizeClass;
+}
+
+//------------------------------------------------------------------------------
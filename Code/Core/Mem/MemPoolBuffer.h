@@ -0,0 +1,48 @@
+// MemPoolBuffer - Recycles variable sized buffers
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// MemPoolBuffer
+//------------------------------------------------------------------------------
+// Buffers are rounded up to a power of two size and retained when freed, so
+// that similarly sized buffers can be re-used. This avoids repeatedly paying
+// for large allocations (which the system allocator typically maps and unmaps
+// each time).
+class MemPoolBuffer
+{
+public:
+    explicit MemPoolBuffer( size_t maxRetainedBytes = kDefaultMaxRetainedBytes );
+    ~MemPoolBuffer();
+
+    void *  Alloc( size_t size );
+    void    Free( void * ptr );
+
+    size_t  GetRetainedBytes() const;
+
+    static const size_t     kDefaultMaxRetainedBytes    = ( 64 * 1024 * 1024 );
+    static const uint32_t   kMinSizeClassShift          = 8;    // 256 bytes
+    static const uint32_t   kMaxSizeClassShift          = 24;   // 16 MiB (larger buffers are not retained)
+    static const uint32_t   kNumSizeClasses             = ( kMaxSizeClassShift - kMinSizeClassShift + 1 );
+
+private:
+    // Stored before each buffer. Size maintains alignment of the buffer.
+    struct Header
+    {
+        uint32_t    m_SizeClass; // kNumSizeClasses for buffers which are not retained
+        uint32_t    m_Padding[ 3 ];
+    };
+    static uint32_t GetSizeClass( size_t size );
+
+    mutable Mutex   m_Mutex;
+    size_t          m_RetainedBytes;
+    size_t          m_MaxRetainedBytes;
+    Array< void * > m_FreeBuffers[ kNumSizeClasses ];
+};
+
+//------------------------------------------------------------------------------
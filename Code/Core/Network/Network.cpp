@@ -7,11 +7,14 @@
 
 // Core
 #include "Core/Containers/UniquePtr.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Network/NetworkStartupHelper.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
 
 // system
 #if defined( __WINDOWS__ )
@@ -147,84 +150,129 @@
 {
     PROFILE_FUNCTION;
 
-    // Fast path for "localhost". Although we have a fast path for detecting ip4
-    // format adresses, it can still take several ms to call
-    if ( hostName == "127.0.0.1" )
-    {
-        return 0x0100007f;
-    }
-
-    // see if string it already in ip4 format
-    PRAGMA_DISABLE_PUSH_MSVC( 4996 ) // Deprecated...
-    PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wdeprecated-declarations" ) // 'inet_addr' is deprecated: This function or variable may be unsafe...
-    const uint32_t ip = inet_addr( hostName.Get() ); // TODO:C Consider using inet_pton()
-    PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wdeprecated-declarations
-    PRAGMA_DISABLE_POP_MSVC // 4996
-    if ( ip != INADDR_NONE )
+    uint32_t ip = 0;
+    if ( GetHostIPFromNumericName( hostName, ip ) )
     {
         return ip;
     }
 
-    // Perform name resolution on another thread
+    Array< AString > hostNames;
+    hostNames.Append( hostName );
+    Array< uint32_t > ips;
+    GetHostIPsFromNames( hostNames, ips, timeoutMS );
+    return ips[ 0 ];
+}
 
-    // Data to communicate between threads
-    NameResolutionData data;
-    data.hostName = hostName;
-    data.safeToFree = false; // will be marked by other thread
+// GetHostIPsFromNames
+//------------------------------------------------------------------------------
+/*static*/ void Network::GetHostIPsFromNames( const Array< AString > & hostNames, Array< uint32_t > & outIPs, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
 
-    // Create thread to perform resolution
-    Thread thread;
-    thread.Start( NameResolutionThreadFunc, "NameResolution", &data, ( 32 * KILOBYTE ) );
+    const size_t numHosts = hostNames.GetSize();
+    outIPs.SetSize( numHosts );
 
-    // wait for name resolution with timeout
-    bool timedOut( false );
-    uint32_t returnCode( 0 );
-    uint32_t remainingTimeMS( timeoutMS );
-    const uint32_t sleepInterval( 100 ); // Check exit condition periodically - TODO:C would be better to use an event
-    for ( ;; )
+    // Perform name resolution on other threads, all at once
+
+    // Data to communicate between threads (not resized once threads are started)
+    Array< NameResolutionData > data;
+    data.SetSize( numHosts );
+    Array< Thread * > threads;
+    threads.SetSize( numHosts );
+    for ( size_t i = 0; i < numHosts; ++i )
     {
-        returnCode = thread.JoinWithTimeout( sleepInterval, timedOut ); // TODO:B Remove use of this unsafe API
+        threads[ i ] = nullptr;
+        outIPs[ i ] = 0;
+        if ( GetHostIPFromNumericName( hostNames[ i ], outIPs[ i ] ) )
+        {
+            continue;
+        }
 
-        // Are we shutting down?
-        if ( NetworkStartupHelper::IsShuttingDown() )
+        data[ i ].hostName = hostNames[ i ];
+        data[ i ].safeToFree = false; // will be marked by other thread
+
+        // Create thread to perform resolution
+        threads[ i ] = FNEW( Thread );
+        threads[ i ]->Start( NameResolutionThreadFunc, "NameResolution", &data[ i ], ( 32 * KILOBYTE ) );
+    }
+
+    // wait for name resolution, with the timeout shared by all threads
+    const Timer timer;
+    for ( size_t i = 0; i < numHosts; ++i )
+    {
+        Thread * thread = threads[ i ];
+        if ( thread == nullptr )
         {
-            returnCode = 0; // ignore whatever we may have gotten back
-            break;
+            continue;
         }
 
-        // Manage timeout
-        if ( timedOut )
+        bool timedOut( false );
+        uint32_t returnCode( 0 );
+        const uint32_t sleepInterval( 100 ); // Check exit condition periodically - TODO:C would be better to use an event
+        for ( ;; )
         {
-            if ( remainingTimeMS < sleepInterval )
+            const uint32_t elapsedMS = (uint32_t)timer.GetElapsedMS();
+            const uint32_t remainingTimeMS = ( elapsedMS < timeoutMS ) ? ( timeoutMS - elapsedMS ) : 0;
+            returnCode = thread->JoinWithTimeout( Math::Min( remainingTimeMS, sleepInterval ), timedOut ); // TODO:B Remove use of this unsafe API
+
+            // Are we shutting down?
+            if ( NetworkStartupHelper::IsShuttingDown() )
             {
-                break; // timeout hit
+                returnCode = 0; // ignore whatever we may have gotten back
+                break;
             }
 
-            remainingTimeMS -= sleepInterval;
-            continue; // keep waiting
+            // Manage timeout
+            if ( timedOut && ( remainingTimeMS > 0 ) )
+            {
+                continue; // keep waiting
+            }
+
+            break; // success, or timeout hit
+        }
+        if ( timedOut )
+        {
+            thread->Detach(); // TODO:B Remove use of this unsafe API
+            returnCode = 0; // timeout was hit
         }
 
-        break; // success!
-    }
-    if ( timedOut )
-    {
-        thread.Detach(); // TODO:B Remove use of this unsafe API
+        // handle race where timeout occurred before thread marked data as
+        // safe to delete (this could happen if system was under load and timeout was very small)
+        while ( !data[ i ].safeToFree )
+        {
+            Thread::Sleep( 1 );
+        }
+        FDELETE thread;
+
+        // result of resolution (could also have failed)
+        outIPs[ i ] = returnCode;
     }
+}
 
-    // handle race where timeout occurred before thread marked data as
-    // safe to delete (this could happen if system was under load and timeout was very small)
-    while ( !data.safeToFree )
+// GetHostIPFromNumericName
+//------------------------------------------------------------------------------
+/*static*/ bool Network::GetHostIPFromNumericName( const AString & hostName, uint32_t & outIP )
+{
+    // Fast path for "localhost". Although we have a fast path for detecting ip4
+    // format adresses, it can still take several ms to call
+    if ( hostName == "127.0.0.1" )
     {
-        Thread::Sleep( 1 );
+        outIP = 0x0100007f;
+        return true;
     }
 
-    if ( timedOut )
+    // see if string it already in ip4 format
+    PRAGMA_DISABLE_PUSH_MSVC( 4996 ) // Deprecated...
+    PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wdeprecated-declarations" ) // 'inet_addr' is deprecated: This function or variable may be unsafe...
+    const uint32_t ip = inet_addr( hostName.Get() ); // TODO:C Consider using inet_pton()
+    PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wdeprecated-declarations
+    PRAGMA_DISABLE_POP_MSVC // 4996
+    if ( ip != INADDR_NONE )
     {
-        returnCode = 0; // timeout was hit
+        outIP = ip;
+        return true;
     }
-
-    // return result of resolution (could also have failed)
-    return returnCode;
+    return false;
 }
 
 // NameResolutionThreadFunc
@@ -21,9 +21,11 @@ public:
     static void GetDomainName( AString & domainName );
     static void GetIPv4Addresses( Array<AString> & outAddresses );
     static uint32_t GetHostIPFromName( const AString & hostName, uint32_t timeoutMS = 1000 );
+    static void GetHostIPsFromNames( const Array< AString > & hostNames, Array< uint32_t > & outIPs, uint32_t timeoutMS = 1000 ); // Resolved in parallel
 
 private:
     static uint32_t NameResolutionThreadFunc( void * userData );
+    static bool GetHostIPFromNumericName( const AString & hostName, uint32_t & outIP );
 
     struct NameResolutionData
     {
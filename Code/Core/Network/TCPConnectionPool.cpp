@@ -7,7 +7,9 @@
 #include "TCPConnectionPool.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/Env/ErrorFormat.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Process/Atomic.h"
@@ -31,6 +33,10 @@
     #include <sys/socket.h>
     #include <sys/uio.h>
     #include <unistd.h>
+    #if defined( __LINUX__ )
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+    #endif
     #define INVALID_SOCKET ( -1 )
     #define SOCKET_ERROR -1
 #else
@@ -136,9 +142,18 @@ ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
     , m_ThreadQuitNotification( false )
     , m_TCPConnectionPool( ownerPool )
     , m_UserData( nullptr )
+    , m_ReceiveRateKiBPerSec( 0 )
     #ifdef DEBUG
         , m_SendSocketInUseThreadId( INVALID_THREAD_ID )
     #endif
+    #if defined( __LINUX__ )
+        , m_ReadSize( 0 )
+        , m_ReadSizeBytes( 0 )
+        , m_ReadBuffer( nullptr )
+        , m_ReadBytes( 0 )
+        , m_ReadStartTime( 0 )
+        , m_ConnectedNotified( false )
+    #endif
 {
     ASSERT( ownerPool );
 }
@@ -149,6 +164,15 @@ TCPConnectionPool::TCPConnectionPool()
     : m_ListenConnection( nullptr )
     , m_Connections( 8, true )
     , m_ShuttingDown( false )
+    #if defined( __LINUX__ )
+        , m_EpollFD( -1 )
+        , m_WakeFD( -1 )
+        , m_NumIOThreads( 0 )
+        , m_ReceiveQueue( 0, true )
+        , m_ReceiveThreads( 0, true )
+        , m_NumBusyReceiveThreads( 0 )
+        , m_StopReceiveThreads( false )
+    #endif
 {
 }
 
@@ -197,6 +221,10 @@ void TCPConnectionPool::ShutdownAllConnections()
         m_ConnectionsMutex.Lock();
     }
     m_ConnectionsMutex.Unlock();
+
+    #if defined( __LINUX__ )
+        StopIOThreads();
+    #endif
 }
 
 // GetAddressAsString
@@ -245,7 +273,9 @@ bool TCPConnectionPool::Listen( uint16_t port )
 
     // listen
     TCPDEBUG( "Listen on port %i (%x)\n", port, (uint32_t)sockfd );
-    if ( listen( sockfd, 0 ) == SOCKET_ERROR ) // no backlog
+    // Allow a backlog so that many clients connecting at once (such as when
+    // a build starts) aren't refused and forced to wait for a SYN retransmit
+    if ( listen( sockfd, SOMAXCONN ) == SOCKET_ERROR )
     {
         TCPDEBUG( "Listen FAILED %i (%x)\n", port, (uint32_t)sockfd );
         CloseSocket( sockfd );
@@ -282,41 +312,11 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
 {
     PROFILE_FUNCTION;
 
-    // create a socket
-    const TCPSocket sockfd = CreateSocket();
-    if ( sockfd == INVALID_SOCKET )
-    {
-        return nullptr; // outright failure?
-    }
-
-    // Configure socket
-    DisableSigPipe( sockfd );       // Prevent socket inheritence by child processes
-    DisableNagle( sockfd );         // Disable Nagle's algorithm
-    SetLargeBufferSizes( sockfd );  // Set large send/recv buffer sizes
-    SetNonBlocking( sockfd );       // Set non-blocking
-
-    // setup destination address
-    struct sockaddr_in destAddr;
-    memset( &destAddr, 0, sizeof( destAddr ) );
-    destAddr.sin_family = AF_INET;
-    destAddr.sin_port = htons( port );
-    destAddr.sin_addr.s_addr = hostIP;
-
     // initiate connection
-    if ( connect( sockfd, (struct sockaddr *)&destAddr, sizeof( destAddr ) ) != 0 )
+    const TCPSocket sockfd = InitiateConnect( hostIP, port );
+    if ( sockfd == INVALID_SOCKET )
     {
-        // we expect WSAEWOULDBLOCK
-        if ( !WouldBlock() )
-        {
-            // connection initiation failed
-            #ifdef TCPCONNECTION_DEBUG
-                AStackString<> host;
-                GetAddressAsString( hostIP, host );
-                TCPDEBUG( "connect() failed. Error: %s (Host: %s, Port: %u)\n", LAST_NETWORK_ERROR_STR, host.Get(), port );
-            #endif
-            CloseSocket( sockfd );
-            return nullptr;
-        }
+        return nullptr;
     }
 
     const Timer connectionTimer;
@@ -405,40 +405,277 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
 
         if ( FD_ISSET( sockfd, &write ) )
         {
-            #if defined( __APPLE__ ) || defined( __LINUX__ )
-                // On Linux a write flag set by select() doesn't mean that
-                // connect() succeeded, it only means that it is completed.
-                // To get the result we need to query SO_ERROR value via getsockopt().
-                int32_t error = 0;
-                socklen_t size = sizeof(error);
-                if ( getsockopt( sockfd, SOL_SOCKET, SO_ERROR, (char*)&error, &size ) == SOCKET_ERROR )
+            if ( CheckConnectSucceeded( sockfd, hostIP, port ) == false )
+            {
+                CloseSocket( sockfd );
+                return nullptr;
+            }
+            break; // connection success!
+        }
+
+        ASSERT( false ); // should never get here
+    }
+
+    return CreateConnectionThread( sockfd, hostIP, port, userData );
+}
+
+// ConnectParallel
+//------------------------------------------------------------------------------
+void TCPConnectionPool::ConnectParallel( Array< ConnectRequest > & requests,
+                                         uint32_t maxConnections,
+                                         uint32_t timeout )
+{
+    PROFILE_FUNCTION;
+
+    // Initiate all connections up front
+    const size_t numRequests = requests.GetSize();
+    Array< TCPSocket > sockets( numRequests, false );
+    size_t numPending = 0;
+    for ( ConnectRequest & request : requests )
+    {
+        request.m_Result = ConnectRequest::ABANDONED;
+        request.m_Connection = nullptr;
+        request.m_LatencyMS = 0.0f;
+
+        const TCPSocket sockfd = InitiateConnect( request.m_HostIP, request.m_Port );
+        if ( sockfd == INVALID_SOCKET )
+        {
+            request.m_Result = ConnectRequest::FAILED;
+        }
+        else
+        {
+            ++numPending;
+        }
+        sockets.Append( sockfd );
+    }
+
+    #if defined( __LINUX__ )
+        // Register everything pending with epoll, so completions can be collected
+        // without rebuilding the set each time we wait
+        const int epollFD = ( numPending > 0 ) ? epoll_create1( EPOLL_CLOEXEC ) : -1;
+        if ( ( numPending > 0 ) && ( epollFD == -1 ) )
+        {
+            TCPDEBUG( "epoll_create1() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+        }
+        for ( size_t i = 0; i < numRequests; ++i )
+        {
+            if ( ( epollFD != -1 ) && ( sockets[ i ] != INVALID_SOCKET ) )
+            {
+                struct epoll_event event;
+                memset( &event, 0, sizeof( event ) );
+                event.events = EPOLLOUT; // Errors and hangups are always reported
+                event.data.u64 = i;
+                VERIFY( epoll_ctl( epollFD, EPOLL_CTL_ADD, sockets[ i ], &event ) == 0 );
+            }
+        }
+    #endif
+
+    // Collect completions, accepting connections in the order they complete
+    // (i.e. lowest latency first)
+    const Timer connectionTimer;
+    uint32_t numConnections = 0;
+    Array< size_t > completed( numRequests, false );
+    while ( ( numPending > 0 ) && ( numConnections < maxConnections ) )
+    {
+        // wait for something to complete (check every 10ms)
+        completed.Clear();
+        #if defined( __LINUX__ )
+            if ( epollFD == -1 )
+            {
+                break; // Fail everything pending below
+            }
+            struct epoll_event events[ 64 ];
+            const int numEvents = epoll_wait( epollFD, events, 64, 10 );
+            for ( int i = 0; i < numEvents; ++i )
+            {
+                completed.Append( (size_t)events[ i ].data.u64 );
+            }
+        #else
+            fd_set write, err;
+            FD_ZERO( &write );
+            FD_ZERO( &err );
+            TCPSocket maxSocket = 0;
+            for ( const TCPSocket sockfd : sockets )
+            {
+                if ( sockfd != INVALID_SOCKET )
                 {
-                    #ifdef TCPCONNECTION_DEBUG
-                        AStackString<> host;
-                        GetAddressAsString( hostIP, host );
-                        TCPDEBUG( "getsockopt() failed. Error: %s (Host: %s, Port: %u)\n", LAST_NETWORK_ERROR_STR, host.Get(), port );
-                    #endif
-                    CloseSocket( sockfd );
-                    return nullptr;
+                    FDSet( sockfd, &write );
+                    FDSet( sockfd, &err );
+                    maxSocket = Math::Max( maxSocket, sockfd );
+                }
+            }
+            timeval pollingTimeout;
+            memset( &pollingTimeout, 0, sizeof( timeval ) );
+            pollingTimeout.tv_usec = 10 * 1000;
+            const int selRet = Select( maxSocket + 1, nullptr, &write, &err, &pollingTimeout );
+            if ( selRet == SOCKET_ERROR )
+            {
+                TCPDEBUG( "select() after connect() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+                break; // Fail everything pending below
+            }
+            for ( size_t i = 0; i < numRequests; ++i )
+            {
+                if ( ( sockets[ i ] != INVALID_SOCKET ) &&
+                     ( FD_ISSET( sockets[ i ], &write ) || FD_ISSET( sockets[ i ], &err ) ) )
+                {
+                    completed.Append( i );
                 }
-                if ( error != 0 )
+            }
+        #endif
+
+        for ( const size_t index : completed )
+        {
+            ConnectRequest & request = requests[ index ];
+            const TCPSocket sockfd = sockets[ index ];
+            sockets[ index ] = INVALID_SOCKET;
+            --numPending;
+
+            #if defined( __LINUX__ )
+                // Stop watching, since successful connections are handed off
+                VERIFY( epoll_ctl( epollFD, EPOLL_CTL_DEL, sockfd, nullptr ) == 0 );
+            #endif
+
+            #if !defined( __LINUX__ )
+                // On Windows, failure is signalled in the exception set
+                if ( FD_ISSET( sockfd, &err ) )
                 {
-                    #ifdef TCPCONNECTION_DEBUG
-                        AStackString<> host;
-                        GetAddressAsString( hostIP, host );
-                        TCPDEBUG( "connect() failed, SO_ERROR: %s (Host: %s, Port: %u)\n", ERROR_STR( error ), host.Get(), port );
-                    #endif
+                    request.m_Result = ConnectRequest::FAILED;
                     CloseSocket( sockfd );
-                    return nullptr;
+                    continue;
                 }
             #endif
-            break; // connection success!
+            if ( CheckConnectSucceeded( sockfd, request.m_HostIP, request.m_Port ) == false )
+            {
+                request.m_Result = ConnectRequest::FAILED;
+                CloseSocket( sockfd );
+                continue;
+            }
+
+            // Connected, but others completed sooner and used up the allowance?
+            if ( numConnections >= maxConnections )
+            {
+                CloseSocket( sockfd ); // Leave as ABANDONED
+                continue;
+            }
+
+            request.m_LatencyMS = connectionTimer.GetElapsedMS();
+            request.m_Connection = CreateConnectionThread( sockfd, request.m_HostIP, request.m_Port, request.m_UserData );
+            request.m_Result = request.m_Connection ? ConnectRequest::CONNECTED : ConnectRequest::FAILED;
+            numConnections += request.m_Connection ? 1 : 0;
         }
 
-        ASSERT( false ); // should never get here
+        // are we shutting down?
+        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            TCPDEBUG( "ConnectParallel() aborted (Shutting Down)\n" );
+            break;
+        }
+
+        // have we hit our real connection timeout?
+        if ( connectionTimer.GetElapsedMS() >= (float)timeout )
+        {
+            TCPDEBUG( "ConnectParallel() time out %u hit\n", timeout );
+            break;
+        }
     }
 
-    return CreateConnectionThread( sockfd, hostIP, port, userData );
+    // Anything still pending either timed out or is no longer needed
+    const bool timedOut = ( numConnections < maxConnections ) && ( AtomicLoadRelaxed( &m_ShuttingDown ) == false );
+    for ( size_t i = 0; i < numRequests; ++i )
+    {
+        if ( sockets[ i ] != INVALID_SOCKET )
+        {
+            CloseSocket( sockets[ i ] );
+            requests[ i ].m_Result = timedOut ? ConnectRequest::FAILED : ConnectRequest::ABANDONED;
+        }
+    }
+
+    #if defined( __LINUX__ )
+        if ( epollFD != -1 )
+        {
+            close( epollFD );
+        }
+    #endif
+}
+
+// InitiateConnect
+//------------------------------------------------------------------------------
+TCPSocket TCPConnectionPool::InitiateConnect( uint32_t hostIP, uint16_t port ) const
+{
+    // create a socket
+    const TCPSocket sockfd = CreateSocket();
+    if ( sockfd == INVALID_SOCKET )
+    {
+        return INVALID_SOCKET; // outright failure?
+    }
+
+    // Configure socket
+    DisableSigPipe( sockfd );       // Prevent socket inheritence by child processes
+    DisableNagle( sockfd );         // Disable Nagle's algorithm
+    SetLargeBufferSizes( sockfd );  // Set large send/recv buffer sizes
+    SetNonBlocking( sockfd );       // Set non-blocking
+
+    // setup destination address
+    struct sockaddr_in destAddr;
+    memset( &destAddr, 0, sizeof( destAddr ) );
+    destAddr.sin_family = AF_INET;
+    destAddr.sin_port = htons( port );
+    destAddr.sin_addr.s_addr = hostIP;
+
+    // initiate connection
+    if ( connect( sockfd, (struct sockaddr *)&destAddr, sizeof( destAddr ) ) != 0 )
+    {
+        // we expect WSAEWOULDBLOCK
+        if ( !WouldBlock() )
+        {
+            // connection initiation failed
+            #ifdef TCPCONNECTION_DEBUG
+                AStackString<> host;
+                GetAddressAsString( hostIP, host );
+                TCPDEBUG( "connect() failed. Error: %s (Host: %s, Port: %u)\n", LAST_NETWORK_ERROR_STR, host.Get(), port );
+            #endif
+            CloseSocket( sockfd );
+            return INVALID_SOCKET;
+        }
+    }
+
+    return sockfd;
+}
+
+// CheckConnectSucceeded
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::CheckConnectSucceeded( TCPSocket sockfd, uint32_t hostIP, uint16_t port ) const
+{
+    #if defined( __APPLE__ ) || defined( __LINUX__ )
+        // On Linux a write flag set by select() doesn't mean that
+        // connect() succeeded, it only means that it is completed.
+        // To get the result we need to query SO_ERROR value via getsockopt().
+        int32_t error = 0;
+        socklen_t size = sizeof(error);
+        if ( getsockopt( sockfd, SOL_SOCKET, SO_ERROR, (char*)&error, &size ) == SOCKET_ERROR )
+        {
+            #ifdef TCPCONNECTION_DEBUG
+                AStackString<> host;
+                GetAddressAsString( hostIP, host );
+                TCPDEBUG( "getsockopt() failed. Error: %s (Host: %s, Port: %u)\n", LAST_NETWORK_ERROR_STR, host.Get(), port );
+            #endif
+            return false;
+        }
+        if ( error != 0 )
+        {
+            #ifdef TCPCONNECTION_DEBUG
+                AStackString<> host;
+                GetAddressAsString( hostIP, host );
+                TCPDEBUG( "connect() failed, SO_ERROR: %s (Host: %s, Port: %u)\n", ERROR_STR( error ), host.Get(), port );
+            #endif
+            return false;
+        }
+    #else
+        (void)sockfd;
+    #endif
+    (void)hostIP;
+    (void)port;
+    return true;
 }
 
 // Disconnect
@@ -466,6 +703,11 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     if ( iter != nullptr )
     {
         ci->m_ThreadQuitNotification.Store( true );
+        #if defined( __LINUX__ )
+            // Wake the I/O thread (the socket becomes readable) so the
+            // connection is closed promptly
+            shutdown( ci->m_Socket, SHUT_RDWR );
+        #endif
         return;
     }
 
@@ -533,6 +775,39 @@ bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * da
     return SendInternal( connection, buffers, 4, timeoutMS );
 }
 
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * data, size_t size, const SendBuffer * payloadBuffers, uint32_t numPayloadBuffers, uint32_t timeoutMS )
+{
+    ASSERT( numPayloadBuffers <= ( kMaxSendBuffers - 3 ) );
+    SendBuffer buffers[ kMaxSendBuffers ]; // size + data + payloadSize + payloadBuffers
+
+    // size
+    const uint32_t sizeData = (uint32_t)size;
+    buffers[ 0 ].size = sizeof( sizeData );
+    buffers[ 0 ].data = &sizeData;
+
+    // data
+    buffers[ 1 ].size = (uint32_t)size;
+    buffers[ 1 ].data = data;
+
+    // payloadSize
+    uint32_t payloadSizeData = 0;
+    for ( uint32_t i = 0; i < numPayloadBuffers; ++i )
+    {
+        payloadSizeData += payloadBuffers[ i ].size;
+    }
+    buffers[ 2 ].size = sizeof( payloadSizeData );
+    buffers[ 2 ].data = &payloadSizeData;
+
+    // payloadBuffers
+    for ( uint32_t i = 0; i < numPayloadBuffers; ++i )
+    {
+        buffers[ 3 + i ] = payloadBuffers[ i ];
+    }
+
+    return SendInternal( connection, buffers, ( 3 + numPayloadBuffers ), timeoutMS );
+}
+
 // SendInternal
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS )
@@ -547,11 +822,11 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         return false;
     }
 
-    ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
+    ASSERT( numBuffers <= kMaxSendBuffers );
     #if defined( __WINDOWS__ )
-        WSABUF sendBuffers[ 4 ];
+        WSABUF sendBuffers[ kMaxSendBuffers ];
     #else
-        struct iovec sendBuffers[ 4 ];
+        struct iovec sendBuffers[ kMaxSendBuffers ];
     #endif
 
     // Calculate total to send
@@ -667,14 +942,14 @@ bool TCPConnectionPool::Broadcast( const void * data, size_t size )
 //------------------------------------------------------------------------------
 /*virtual*/ void * TCPConnectionPool::AllocBuffer( uint32_t size )
 {
-    return ALLOC( size );
+    return m_ReceiveBuffers.Alloc( size );
 }
 
 // FreeBuffer
 //------------------------------------------------------------------------------
 /*virtual*/ void TCPConnectionPool::FreeBuffer( void * data )
 {
-    FREE( data );
+    m_ReceiveBuffers.Free( data );
 }
 
 // HandleRead
@@ -708,6 +983,7 @@ bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
     }
 
     TCPDEBUG( "Handle read: %i (%x)\n", size, (uint32_t)( ci->m_Socket ) );
+    const int64_t readStartTime = Timer::GetNow();
 
     // get output location
     void * buffer = AllocBuffer( size );
@@ -739,6 +1015,7 @@ bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
         bytesRemaining -= (uint32_t)numBytes;
         dest += numBytes;
     }
+    RecordReceiveRate( ci, size, readStartTime );
 
     // tell user the data is in their buffer
     bool keepMemory = false;
@@ -751,6 +1028,27 @@ bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
     return true;
 }
 
+// RecordReceiveRate
+//------------------------------------------------------------------------------
+/*static*/ void TCPConnectionPool::RecordReceiveRate( ConnectionInfo * ci, uint32_t size, int64_t startTime )
+{
+    // Small messages usually arrive in one go, so say nothing about the link
+    // (and large ones already buffered by the OS overestimate it, which the
+    // moving average smooths out)
+    const uint32_t kMinSampleSize = ( 64 * 1024 );
+    if ( size < kMinSampleSize )
+    {
+        return;
+    }
+
+    const float elapsedSec = Math::Max( (float)( Timer::GetNow() - startTime ) * Timer::GetFrequencyInvFloat(), 0.0001f );
+    const float sampleKiBPerSec = ( (float)size / 1024.0f ) / elapsedSec;
+    const uint32_t previous = ci->m_ReceiveRateKiBPerSec.Load();
+    const float average = ( previous == 0 ) ? sampleKiBPerSec
+                                            : ( (float)previous + ( ( sampleKiBPerSec - (float)previous ) * 0.2f ) );
+    ci->m_ReceiveRateKiBPerSec.Store( (uint32_t)Math::Min( average, 4.0e9f ) );
+}
+
 // GetLastNetworkError
 //------------------------------------------------------------------------------
 int TCPConnectionPool::GetLastNetworkError() const
@@ -1038,12 +1336,38 @@ ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, ui
         TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
     #endif
 
-    // Spawn thread to handle socket
-    Thread thread;
-    thread.Start( &ConnectionThreadWrapperFunction, "TCPConnection", ci );
-    thread.Detach(); // TODO:B Remove use of this unsafe API
+    #if defined( __LINUX__ )
+        // Hand socket to the I/O threads. EPOLLOUT is included initially
+        // so that OnConnected is issued immediately (the socket is writable)
+        if ( ( m_EpollFD == -1 ) && ( StartIOThreads() == false ) )
+        {
+            CloseSocket( socket );
+            FDELETE ci;
+            return nullptr;
+        }
+        m_Connections.Append( ci );
 
-    m_Connections.Append( ci );
+        // A few I/O threads are enough to service many connections, since
+        // they only receive messages
+        const uint32_t maxIOThreads = Math::Clamp( Env::GetNumProcessors(), 2u, (uint32_t)kMaxIOThreads );
+        if ( ( m_NumIOThreads < m_Connections.GetSize() ) && ( m_NumIOThreads < maxIOThreads ) )
+        {
+            m_IOThreads[ m_NumIOThreads++ ].Start( &IOThreadWrapperFunction, "TCPConnection", this );
+        }
+
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+        event.events = ( EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET | EPOLLONESHOT );
+        event.data.ptr = ci;
+        VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, socket, &event ) == 0 );
+    #else
+        // Spawn thread to handle socket
+        Thread thread;
+        thread.Start( &ConnectionThreadWrapperFunction, "TCPConnection", ci );
+        thread.Detach(); // TODO:B Remove use of this unsafe API
+
+        m_Connections.Append( ci );
+    #endif
 
     return ci;
 }
@@ -1138,6 +1462,376 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
     TCPDEBUG( "connection thread exited\n" );
 }
 
+#if defined( __LINUX__ )
+// StartIOThreads
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::StartIOThreads()
+{
+    ASSERT( m_EpollFD == -1 );
+
+    // Don't start (or restart) once shutdown has begun
+    if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+    {
+        return false;
+    }
+
+    m_EpollFD = epoll_create1( EPOLL_CLOEXEC );
+    if ( m_EpollFD == -1 )
+    {
+        TCPDEBUG( "epoll_create1() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+        return false;
+    }
+
+    // The wake event is level-triggered, so once signalled all threads see it
+    m_WakeFD = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    if ( m_WakeFD == -1 )
+    {
+        TCPDEBUG( "eventfd() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+        close( m_EpollFD );
+        m_EpollFD = -1;
+        return false;
+    }
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, m_WakeFD, &event ) == 0 );
+
+    // I/O and receive threads are started as connections and messages arrive
+    return true;
+}
+
+// StopIOThreads
+//------------------------------------------------------------------------------
+void TCPConnectionPool::StopIOThreads()
+{
+    // Connections must have been closed
+    ASSERT( m_Connections.IsEmpty() );
+
+    if ( m_EpollFD == -1 )
+    {
+        return; // Never started
+    }
+
+    const uint64_t signal = 1;
+    VERIFY( write( m_WakeFD, &signal, sizeof( signal ) ) == sizeof( signal ) );
+    for ( uint32_t i = 0; i < m_NumIOThreads; ++i )
+    {
+        m_IOThreads[ i ].Join();
+    }
+    m_NumIOThreads = 0;
+
+    // No messages can be pending, since connections have been closed
+    {
+        MutexHolder mh( m_ReceiveMutex );
+        ASSERT( m_ReceiveQueue.IsEmpty() );
+        m_StopReceiveThreads = true;
+    }
+    if ( m_ReceiveThreads.IsEmpty() == false )
+    {
+        m_ReceiveSemaphore.Signal( (uint32_t)m_ReceiveThreads.GetSize() );
+    }
+    for ( Thread * thread : m_ReceiveThreads )
+    {
+        thread->Join();
+        FDELETE thread;
+    }
+    m_ReceiveThreads.Clear();
+    ASSERT( m_NumBusyReceiveThreads == 0 );
+    m_StopReceiveThreads = false;
+
+    close( m_WakeFD );
+    m_WakeFD = -1;
+    close( m_EpollFD );
+    m_EpollFD = -1;
+}
+
+// IOThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::IOThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+    PROFILE_FUNCTION;
+
+    TCPConnectionPool * pool = static_cast< TCPConnectionPool * >( data );
+    pool->IOThreadFunction();
+    return 0;
+}
+
+// IOThreadFunction
+//------------------------------------------------------------------------------
+void TCPConnectionPool::IOThreadFunction()
+{
+    for ( ;; )
+    {
+        // Take one event at a time, so a busy connection doesn't delay
+        // others which another thread could be servicing
+        struct epoll_event event;
+        const int num = epoll_wait( m_EpollFD, &event, 1, -1 );
+        if ( num <= 0 )
+        {
+            ASSERT( ( num == 0 ) || ( errno == EINTR ) );
+            continue;
+        }
+
+        ConnectionInfo * ci = static_cast< ConnectionInfo * >( event.data.ptr );
+        if ( ci == nullptr )
+        {
+            break; // Wake event - pool is shutting down
+        }
+
+        HandleIOEvent( ci );
+    }
+
+    TCPDEBUG( "I/O thread exited\n" );
+}
+
+// HandleIOEvent
+//------------------------------------------------------------------------------
+void TCPConnectionPool::HandleIOEvent( ConnectionInfo * ci )
+{
+    // Connections are registered with EPOLLONESHOT, and are only re-armed once
+    // a received message has been handled, so only one thread services a given
+    // connection at a time, preserving the ordering of callbacks a dedicated
+    // thread would provide
+    if ( ci->m_ConnectedNotified == false )
+    {
+        ci->m_ConnectedNotified = true;
+        OnConnected( ci ); // Do callback
+    }
+
+    if ( ci->m_ThreadQuitNotification.Load() == false )
+    {
+        switch ( HandleReadNonBlocking( ci ) )
+        {
+            case READ_WOULD_BLOCK:
+            {
+                RearmConnection( ci );
+                return;
+            }
+            case READ_MESSAGE:
+            {
+                // Handle message on another thread (which re-arms the connection)
+                QueueReceivedMessage( ci );
+                return;
+            }
+            case READ_FAILED:
+            {
+                break;
+            }
+        }
+    }
+
+    CloseConnection( ci );
+}
+
+// HandleReadNonBlocking
+//------------------------------------------------------------------------------
+TCPConnectionPool::ReadResult TCPConnectionPool::HandleReadNonBlocking( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // work out how many bytes there are
+    while ( ci->m_ReadSizeBytes < sizeof( ci->m_ReadSize ) )
+    {
+        const ssize_t numBytes = recv( ci->m_Socket,
+                                       reinterpret_cast< char * >( &ci->m_ReadSize ) + ci->m_ReadSizeBytes,
+                                       sizeof( ci->m_ReadSize ) - ci->m_ReadSizeBytes,
+                                       0 );
+        if ( numBytes <= 0 )
+        {
+            if ( ( numBytes < 0 ) && WouldBlock() )
+            {
+                return READ_WOULD_BLOCK;
+            }
+            TCPDEBUG( "recv() failed (A). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+            return READ_FAILED;
+        }
+        ci->m_ReadSizeBytes += (uint32_t)numBytes;
+        if ( ci->m_ReadSizeBytes < sizeof( ci->m_ReadSize ) )
+        {
+            continue;
+        }
+
+        TCPDEBUG( "Handle read: %i (%x)\n", ci->m_ReadSize, (uint32_t)( ci->m_Socket ) );
+
+        // get output location
+        ci->m_ReadBuffer = AllocBuffer( ci->m_ReadSize );
+        ASSERT( ci->m_ReadBuffer );
+        ci->m_ReadBytes = 0;
+        ci->m_ReadStartTime = Timer::GetNow();
+    }
+
+    // read data into the user supplied buffer
+    while ( ci->m_ReadBytes < ci->m_ReadSize )
+    {
+        const ssize_t numBytes = recv( ci->m_Socket,
+                                       static_cast< char * >( ci->m_ReadBuffer ) + ci->m_ReadBytes,
+                                       ci->m_ReadSize - ci->m_ReadBytes,
+                                       0 );
+        if ( numBytes <= 0 )
+        {
+            if ( ( numBytes < 0 ) && WouldBlock() )
+            {
+                return READ_WOULD_BLOCK;
+            }
+            TCPDEBUG( "recv() failed (B). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+            return READ_FAILED;
+        }
+        ci->m_ReadBytes += (uint32_t)numBytes;
+    }
+
+    RecordReceiveRate( ci, ci->m_ReadSize, ci->m_ReadStartTime );
+    return READ_MESSAGE;
+}
+
+// QueueReceivedMessage
+//------------------------------------------------------------------------------
+void TCPConnectionPool::QueueReceivedMessage( ConnectionInfo * ci )
+{
+    // OnReceive handlers can take some time (decompressing and writing results,
+    // blocking on sends to slow connections etc), so more handlers are allowed
+    // to block than there are CPUs. If there aren't enough free threads for the
+    // queued messages, start another (up to a limit).
+    {
+        MutexHolder mh( m_ReceiveMutex );
+        m_ReceiveQueue.Append( ci );
+        const size_t numFreeThreads = ( m_ReceiveThreads.GetSize() - m_NumBusyReceiveThreads );
+        const size_t maxThreads = Math::Max( Env::GetNumProcessors(), (uint32_t)kMaxReceiveThreads );
+        if ( ( m_ReceiveQueue.GetSize() > numFreeThreads ) && ( m_ReceiveThreads.GetSize() < maxThreads ) )
+        {
+            Thread * thread = FNEW( Thread );
+            thread->Start( &ReceiveThreadWrapperFunction, "TCPReceive", this );
+            m_ReceiveThreads.Append( thread );
+        }
+    }
+    m_ReceiveSemaphore.Signal();
+}
+
+// ReceiveThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::ReceiveThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+    PROFILE_FUNCTION;
+
+    TCPConnectionPool * pool = static_cast< TCPConnectionPool * >( data );
+    pool->ReceiveThreadFunction();
+    return 0;
+}
+
+// ReceiveThreadFunction
+//------------------------------------------------------------------------------
+void TCPConnectionPool::ReceiveThreadFunction()
+{
+    for ( ;; )
+    {
+        ConnectionInfo * ci = nullptr;
+        {
+            MutexHolder mh( m_ReceiveMutex );
+            if ( m_ReceiveQueue.IsEmpty() == false )
+            {
+                ci = m_ReceiveQueue[ 0 ];
+                m_ReceiveQueue.PopFront();
+                ++m_NumBusyReceiveThreads;
+            }
+            else if ( m_StopReceiveThreads )
+            {
+                break;
+            }
+        }
+
+        if ( ci )
+        {
+            HandleReceivedMessage( ci );
+
+            MutexHolder mh( m_ReceiveMutex );
+            --m_NumBusyReceiveThreads;
+            continue;
+        }
+
+        // Wait for another message (or shutdown)
+        m_ReceiveSemaphore.Wait();
+    }
+}
+
+// HandleReceivedMessage
+//------------------------------------------------------------------------------
+void TCPConnectionPool::HandleReceivedMessage( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // Message complete - reset for next one
+    void * buffer = ci->m_ReadBuffer;
+    const uint32_t size = ci->m_ReadSize;
+    ci->m_ReadBuffer = nullptr;
+    ci->m_ReadSizeBytes = 0;
+
+    // tell user the data is in their buffer
+    bool keepMemory = false;
+    OnReceive( ci, buffer, size, keepMemory );
+    if ( !keepMemory )
+    {
+        FreeBuffer( buffer );
+    }
+
+    // don't bother reading any pending data if shutting down
+    if ( ci->m_ThreadQuitNotification.Load() )
+    {
+        CloseConnection( ci );
+        return;
+    }
+
+    // Continue receiving. If more data is already pending, this reports it immediately.
+    RearmConnection( ci );
+}
+
+// RearmConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::RearmConnection( ConnectionInfo * ci )
+{
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = ( EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT );
+    event.data.ptr = ci;
+    VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_MOD, ci->m_Socket, &event ) == 0 );
+}
+
+// CloseConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseConnection( ConnectionInfo * ci )
+{
+    OnDisconnected( ci ); // Do callback
+
+    VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_DEL, ci->m_Socket, nullptr ) == 0 );
+
+    // free partially received message
+    if ( ci->m_ReadBuffer )
+    {
+        FreeBuffer( ci->m_ReadBuffer );
+        ci->m_ReadBuffer = nullptr;
+    }
+
+    {
+        // remove from connection list. The socket is closed while holding
+        // the lock so that Disconnect never operates on a closed socket
+        MutexHolder mh( m_ConnectionsMutex );
+        ConnectionInfo ** iter = m_Connections.Find( ci );
+        ASSERT( iter );
+        m_Connections.Erase( iter );
+        CloseSocket( ci->m_Socket );
+        ci->m_Socket = INVALID_SOCKET;
+        FDELETE ci;
+        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
+        }
+    }
+
+    TCPDEBUG( "connection closed\n" );
+}
+#endif
+
 // AllowSocketReuse
 //------------------------------------------------------------------------------
 void TCPConnectionPool::AllowSocketReuse( TCPSocket socket ) const
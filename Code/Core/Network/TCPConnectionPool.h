@@ -8,6 +8,7 @@
 
 #include "Core/Containers/Array.h"
 #include "Core/Env/Types.h"
+#include "Core/Mem/MemPoolBuffer.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Mutex.h"
 #include "Core/Process/Semaphore.h"
@@ -47,6 +48,9 @@ public:
     TCPConnectionPool & GetTCPConnectionPool() const { return *m_TCPConnectionPool; }
     inline uint32_t GetRemoteAddress() const { return m_RemoteAddress; }
 
+    // Effective rate at which large messages are received (0 if not yet measured)
+    inline uint32_t GetReceiveRateKiBPerSec() const { return m_ReceiveRateKiBPerSec.Load(); }
+
 private:
     friend class TCPConnectionPool;
 
@@ -56,10 +60,21 @@ private:
     mutable Atomic<bool>    m_ThreadQuitNotification;
     TCPConnectionPool *     m_TCPConnectionPool; // back pointer to parent pool
     mutable void *          m_UserData;
+    Atomic<uint32_t>        m_ReceiveRateKiBPerSec; // moving average (see RecordReceiveRate)
 
 #ifdef DEBUG
     mutable Thread::ThreadId m_SendSocketInUseThreadId; // sanity check we aren't sending from multiple threads unsafely
 #endif
+
+#if defined( __LINUX__ )
+    // Partially received message (see HandleReadNonBlocking)
+    uint32_t                m_ReadSize;
+    uint32_t                m_ReadSizeBytes;    // bytes of m_ReadSize received so far
+    void *                  m_ReadBuffer;
+    uint32_t                m_ReadBytes;        // bytes of m_ReadBuffer received so far
+    int64_t                 m_ReadStartTime;    // when m_ReadSize was received
+    bool                    m_ConnectedNotified;
+#endif
 };
 
 // TCPConnectionPool
@@ -84,6 +99,31 @@ public:
                                     uint16_t port,
                                     uint32_t timeout = kDefaultConnectionTimeoutMS,
                                     void * userData = nullptr );
+    // Connect to several hosts in parallel. Connections are accepted in the order
+    // they complete (i.e. lowest latency first) until maxConnections is reached.
+    class ConnectRequest
+    {
+    public:
+        enum Result : uint8_t
+        {
+            CONNECTED,  // m_Connection is valid
+            FAILED,     // Connection refused, timed out etc.
+            ABANDONED,  // Not needed (maxConnections reached) or shutting down
+        };
+
+        // Inputs
+        uint32_t                m_HostIP        = 0;
+        uint16_t                m_Port          = 0;
+        void *                  m_UserData      = nullptr;
+
+        // Outputs
+        Result                  m_Result        = ABANDONED;
+        const ConnectionInfo *  m_Connection    = nullptr;
+        float                   m_LatencyMS     = 0.0f;
+    };
+    void ConnectParallel( Array< ConnectRequest > & requests,
+                          uint32_t maxConnections,
+                          uint32_t timeout = kDefaultConnectionTimeoutMS );
     void Disconnect( const ConnectionInfo * ci );
     void SetShuttingDown();
 
@@ -91,6 +131,11 @@ public:
     size_t GetNumConnections() const;
 
     // transmit data
+    struct SendBuffer
+    {
+        uint32_t        size;
+        const void *    data;
+    };
     bool Send( const ConnectionInfo * connection,
                const void * data,
                size_t size,
@@ -101,6 +146,13 @@ public:
                const void * payloadData,
                size_t payloadSize,
                uint32_t timeoutMS = kDefaultSendTimeoutMS );
+    // Payload gathered from several buffers (sent without copying them together)
+    bool Send( const ConnectionInfo * connection,
+               const void * data,
+               size_t size,
+               const SendBuffer * payloadBuffers,
+               uint32_t numPayloadBuffers,
+               uint32_t timeoutMS = kDefaultSendTimeoutMS );
     bool Broadcast( const void * data, size_t size );
 
     static void GetAddressAsString( uint32_t addr, AString & address );
@@ -112,12 +164,14 @@ protected:
     virtual void OnDisconnected( const ConnectionInfo * ) {}
 
     // derived class can provide custom memory allocation if desired
+    // (by default, buffers are recycled from a pool)
     virtual void * AllocBuffer( uint32_t size );
     virtual void FreeBuffer( void * data );
 
 private:
     // helper functions
     bool        HandleRead( ConnectionInfo * ci );
+    static void RecordReceiveRate( ConnectionInfo * ci, uint32_t size, int64_t startTime );
 
     // platform specific abstraction
     int         GetLastNetworkError() const;
@@ -133,12 +187,10 @@ private:
                         int * addressSize ) const;
     TCPSocket   CreateSocket() const;
     void        FDSet( TCPSocket fd, void * set ) const;
+    TCPSocket   InitiateConnect( uint32_t hostIP, uint16_t port ) const;
+    bool        CheckConnectSucceeded( TCPSocket sockfd, uint32_t hostIP, uint16_t port ) const;
 
-    struct SendBuffer
-    {
-        uint32_t        size;
-        const void *    data;
-    };
+    enum : uint32_t { kMaxSendBuffers = 64 }; // size + data + payloadSize + payload buffers
     bool        SendInternal( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS );
 
     // thread management
@@ -149,6 +201,33 @@ private:
     static uint32_t     ConnectionThreadWrapperFunction( void * data );
     void                ConnectionThreadFunction( ConnectionInfo * ci );
 
+    #if defined( __LINUX__ )
+        // On Linux, connections are serviced by a small set of I/O threads
+        // waiting on edge-triggered epoll, instead of a thread per connection.
+        // The I/O threads only receive messages; OnReceive is called from
+        // separate receive threads, so slow handlers don't hold up I/O.
+        // Both kinds of thread are created as needed, so pools with few
+        // connections only have a few threads.
+        enum ReadResult : uint8_t
+        {
+            READ_WOULD_BLOCK,   // Wait for more data
+            READ_MESSAGE,       // A message has been received
+            READ_FAILED,        // Connection lost or closed
+        };
+        bool                StartIOThreads();
+        void                StopIOThreads();
+        static uint32_t     IOThreadWrapperFunction( void * data );
+        void                IOThreadFunction();
+        void                HandleIOEvent( ConnectionInfo * ci );
+        ReadResult          HandleReadNonBlocking( ConnectionInfo * ci );
+        void                QueueReceivedMessage( ConnectionInfo * ci );
+        static uint32_t     ReceiveThreadWrapperFunction( void * data );
+        void                ReceiveThreadFunction();
+        void                HandleReceivedMessage( ConnectionInfo * ci );
+        void                RearmConnection( ConnectionInfo * ci );
+        void                CloseConnection( ConnectionInfo * ci );
+    #endif
+
     // internal helpers
     void                AllowSocketReuse( TCPSocket socket ) const;
     void                DisableNagle( TCPSocket socket ) const;
@@ -166,6 +245,29 @@ private:
     bool                        m_ShuttingDown;
     Semaphore                   m_ShutdownSemaphore;
 
+    // received messages
+    MemPoolBuffer               m_ReceiveBuffers;
+
+    #if defined( __LINUX__ )
+        // I/O threads (one per connection, up to a limit)
+        enum : uint32_t { kMaxIOThreads = 8 };
+        enum : uint32_t { kMaxReceiveThreads = 16 }; // or one per CPU, if more
+        int                     m_EpollFD;
+        int                     m_WakeFD;           // signalled to stop I/O threads
+        uint32_t                m_NumIOThreads;
+        Thread                  m_IOThreads[ kMaxIOThreads ];
+
+        // Receive threads call OnReceive for received messages (created as
+        // needed). A connection has at most one message being handled, so
+        // there are never more of these than connections.
+        Mutex                   m_ReceiveMutex;
+        Array< ConnectionInfo * > m_ReceiveQueue;
+        Array< Thread * >       m_ReceiveThreads;
+        size_t                  m_NumBusyReceiveThreads; // handling a message
+        bool                    m_StopReceiveThreads;
+        Semaphore               m_ReceiveSemaphore;
+    #endif
+
     // object to manage network subsystem lifetime
 protected:
     NetworkStartupHelper m_EnsureNetworkStarted;
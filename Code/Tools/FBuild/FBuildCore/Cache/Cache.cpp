@@ -7,19 +7,27 @@
 
 // FBuild
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Process.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Time/Time.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+#include <memory.h>
+
 // CacheStats
 //------------------------------------------------------------------------------
 class CacheStats
@@ -40,9 +48,128 @@ public:
     }
 };
 
+// Chunked store
+//------------------------------------------------------------------------------
+// Chunk boundaries are chosen from the content (a "gear" rolling hash over the
+// bytes), so an insertion or deletion only affects the chunks around it and
+// identical runs of data in different entries produce identical chunks.
+//
+// Compressed entries are chunked after decompression (a small change early in
+// a compressed stream alters everything after it) and each chunk is then
+// compressed individually.
+namespace
+{
+    const uint32_t  kChunkManifestMagic     = 'F' | ( 'B' << 8 ) | ( 'C' << 16 ) | ( '2' << 24 );
+    const uint32_t  kChunkManifestFlagCompressorFormat = 0x1; // Entry was Compressor data, whose payload was chunked
+    const size_t    kMinChunkSize           = ( 4 * 1024 );
+    const size_t    kMaxChunkSize           = ( 64 * 1024 );
+    const uint64_t  kChunkBoundaryMask      = ( ( 16 * 1024 ) - 1ULL ) << 50; // 16KiB average (above minimum), using the high bits which span the most input
+
+    // Chunks not referenced by any entry are only removed once they are older
+    // than this, so a Trim can't remove chunks for an entry being published
+    #if defined( __WINDOWS__ )
+        const uint64_t kUnreferencedChunkAge = ( 60 * 60 * (uint64_t)10000000 );
+    #else
+        const uint64_t kUnreferencedChunkAge = ( 60 * 60 * (uint64_t)1000000000 );
+    #endif
+
+    class GearTable
+    {
+    public:
+        GearTable()
+        {
+            // splitmix64: any fixed table of well distributed values will do,
+            // but it must never change since it determines chunk boundaries
+            uint64_t state = 0x46426C645F434443ULL;
+            for ( uint64_t & value : m_Values )
+            {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+                z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+                value = z ^ ( z >> 31 );
+            }
+        }
+
+        uint64_t m_Values[ 256 ];
+    };
+
+    // Get the size of the next chunk at the start of the data
+    size_t FindChunkSize( const uint8_t * data, size_t dataSize )
+    {
+        if ( dataSize <= kMinChunkSize )
+        {
+            return dataSize;
+        }
+
+        static const GearTable sGear;
+        const size_t maxSize = Math::Min( dataSize, kMaxChunkSize );
+        uint64_t hash = 0;
+        for ( size_t i = kMinChunkSize; i < maxSize; ++i )
+        {
+            hash = ( hash << 1 ) + sGear.m_Values[ data[ i ] ];
+            if ( ( hash & kChunkBoundaryMask ) == 0 )
+            {
+                return ( i + 1 );
+            }
+        }
+        return maxSize;
+    }
+
+    // Chunks used recently (or whose time can't be checked) are kept. An entry
+    // published since the cache was scanned may reference them (publishing
+    // updates the time of reused chunks).
+    bool IsChunkRecentlyUsed( const AString & chunkFile, uint64_t currentTime )
+    {
+        const uint64_t lastWriteTime = FileIO::GetFileLastWriteTime( chunkFile );
+        return ( lastWriteTime == 0 ) || ( lastWriteTime > currentTime ) || ( ( currentTime - lastWriteTime ) <= kUnreferencedChunkAge );
+    }
+
+    Atomic< uint32_t > sTmpFileCounter;
+
+    class ChunkManifestHeader
+    {
+    public:
+        uint32_t    m_Magic;
+        uint32_t    m_NumChunks;
+        uint64_t    m_TotalSize; // Of the chunks
+        uint32_t    m_Flags;
+        uint32_t    m_Padding;
+    };
+}
+
+// ChunkRef
+//------------------------------------------------------------------------------
+class Cache::ChunkRef
+{
+public:
+    uint64_t    m_Hash; // xxHash3 of chunk content (before compression)
+    uint32_t    m_Size; // Before compression
+    uint32_t    m_Padding;
+};
+
+// ChunkFile
+//------------------------------------------------------------------------------
+class Cache::ChunkFile
+{
+public:
+    explicit ChunkFile( const FileIO::FileInfo & info )
+        : m_Name( info.m_Name )
+        , m_Size( info.m_Size )
+        , m_RefCount( 0 )
+    {}
+
+    AString     m_Name;
+    uint64_t    m_Size;
+    uint32_t    m_RefCount;
+};
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-/*explicit*/ Cache::Cache() = default;
+/*explicit*/ Cache::Cache( bool chunkedStore )
+    : m_ChunkedStore( chunkedStore )
+{
+}
 
 // DESTRUCTOR
 //------------------------------------------------------------------------------
@@ -54,13 +181,14 @@ public:
                               const AString & cachePathMountPoint,
                               bool /*cacheRead*/,
                               bool /*cacheWrite*/,
-                              bool /*cacheVerbose*/,
+                              bool cacheVerbose,
                               const AString & /*pluginDLLConfig*/ )
 {
     PROFILE_FUNCTION;
 
     m_CachePath = cachePath;
     PathUtils::EnsureTrailingSlash( m_CachePath );
+    m_Verbose = cacheVerbose;
 
     // Check cache mount point if option is enabled
     #if defined( __WINDOWS__ )
@@ -89,58 +217,28 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::Shutdown()
 {
-    // Nothing to do
+    if ( m_Verbose && m_ChunkedStore )
+    {
+        FLOG_OUTPUT( "Cache Chunks: %u stored (%" PRIu64 " KiB), %u reused (%" PRIu64 " KiB)\n",
+                     m_NumChunksStored.Load(),
+                     m_NumBytesStored.Load() / KILOBYTE,
+                     m_NumChunksReused.Load(),
+                     m_NumBytesReused.Load() / KILOBYTE );
+    }
 }
 
 // Publish
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Publish( const AString & cacheId, const void * data, size_t dataSize )
 {
-    AStackString<> fullPath;
-    GetFullPathForCacheEntry( cacheId, fullPath );
-
-    // make sure the cache output path exists
-    if ( !FileIO::EnsurePathExistsForFile( fullPath ) )
-    {
-        return false;
-    }
-
-    // open output cache (tmp) file
-    AStackString<> fullPathTmp( fullPath );
-    fullPathTmp += ".tmp";
-    FileStream cacheTmpFile;
-    if ( !cacheTmpFile.Open( fullPathTmp.Get(), FileStream::WRITE_ONLY ) )
-    {
-        return false;
-    }
-
-    // write data
-    const bool cacheTmpWriteOk = ( cacheTmpFile.Write( data, dataSize ) == dataSize );
-    cacheTmpFile.Close();
-
-    if ( !cacheTmpWriteOk )
+    if ( m_ChunkedStore )
     {
-        // failed to write to cache tmp file
-        FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup failure
-        return false;
-    }
-
-    // rename tmp file to real file
-    if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
-    {
-        // try to delete (possibly) existing file
-        FileIO::FileDelete( fullPath.Get() );
-
-        // try rename again
-        if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
-        {
-            // problem renaming file
-            FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup tmp file
-            return false;
-        }
+        return PublishChunked( cacheId, data, dataSize );
     }
 
-    return true;
+    AStackString<> fullPath;
+    GetFullPathForCacheEntry( cacheId, fullPath );
+    return WriteCacheFile( fullPath, data, dataSize );
 }
 
 // Retrieve
@@ -160,6 +258,15 @@ public:
         UniquePtr< char > mem( (char *)ALLOC( cacheFileSize ) );
         if ( cacheFile.Read( mem.Get(), cacheFileSize ) == cacheFileSize )
         {
+            // Entries in the chunked store need to be reassembled. This is
+            // done regardless of the current mode, so both can share a cache.
+            Array< ChunkRef > chunks;
+            uint32_t flags = 0;
+            if ( ParseChunkManifest( mem.Get(), cacheFileSize, chunks, flags ) )
+            {
+                return RetrieveChunked( chunks, flags, data, dataSize );
+            }
+
             dataSize = cacheFileSize;
             data = mem.Release();
             return true;
@@ -248,7 +355,14 @@ public:
     Array< FileIO::FileInfo > allFiles( 1000000 );
     uint64_t totalSize = 0;
     GetCacheFiles( showProgress, allFiles, totalSize );
-    OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
+    const uint32_t numFiles = (uint32_t)allFiles.GetSize();
+    OUTPUT( " - Before: %u Files @ %u MiB\n", numFiles, (uint32_t)( totalSize / MEGABYTE ) );
+
+    // Chunks (if the chunked store has been used) are shared between entries,
+    // so they are only deleted when no longer referenced
+    Array< ChunkFile > chunks( 0, true );
+    UnorderedMap< AString, uint32_t > chunkIndices;
+    CountChunkReferences( allFiles, chunks, chunkIndices );
 
     // Sort by age
     OldestFileTimeSorter sorter;
@@ -258,6 +372,20 @@ public:
     OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
     const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
     uint32_t numDeleted = 0;
+
+    // Unreferenced chunks are garbage regardless of the size limit
+    const uint64_t currentTime = Time::GetCurrentFileTime();
+    for ( ChunkFile & chunk : chunks )
+    {
+        if ( ( chunk.m_RefCount == 0 ) &&
+             ( IsChunkRecentlyUsed( chunk.m_Name, currentTime ) == false ) &&
+             FileIO::FileDelete( chunk.m_Name.Get() ) )
+        {
+            totalSize -= chunk.m_Size;
+            ++numDeleted;
+        }
+    }
+
     if ( limit < totalSize )
     {
         const Timer timer;
@@ -272,29 +400,38 @@ public:
         for ( const FileIO::FileInfo & info : allFiles )
         {
             // Try to delete (ok to fail if file is in use)
-            if ( FileIO::FileDelete( info.m_Name.Get() ) )
+            Array< ChunkRef > entryChunks;
+            const bool isChunked = ( chunks.IsEmpty() == false ) && ReadChunkManifest( info.m_Name, entryChunks );
+            if ( FileIO::FileDelete( info.m_Name.Get() ) == false )
             {
-                totalSize -= info.m_Size;
-                ++numDeleted;
+                continue;
+            }
+            totalSize -= info.m_Size;
+            ++numDeleted;
 
-                // Are we under the limit now?
-                if ( totalSize <= limit )
-                {
-                    break;
-                }
+            // Delete chunks no longer used by any entry
+            if ( isChunked )
+            {
+                ReleaseChunkReferences( entryChunks, chunks, chunkIndices, currentTime, totalSize, numDeleted );
+            }
 
-                // Progress
-                if ( showProgress )
+            // Are we under the limit now?
+            if ( totalSize <= limit )
+            {
+                break;
+            }
+
+            // Progress
+            if ( showProgress )
+            {
+                // Throttled to avoid perf impact
+                if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
                 {
-                    // Throttled to avoid perf impact
-                    if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
-                    {
-                        const uint64_t toDeleteBytes = originalTotalSize - limit;
-                        const uint64_t deletedBytes = originalTotalSize - totalSize;
-                        const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
-                        FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
-                        lastProgressTime = timer.GetElapsed();
-                    }
+                    const uint64_t toDeleteBytes = originalTotalSize - limit;
+                    const uint64_t deletedBytes = originalTotalSize - totalSize;
+                    const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
+                    FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
+                    lastProgressTime = timer.GetElapsed();
                 }
             }
         }
@@ -305,7 +442,54 @@ public:
         }
     }
 
-    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
+    OUTPUT( " - After: %u Files @ %u MiB\n", numFiles - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
+    return true;
+}
+
+// RetrieveToFiles
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::RetrieveToFiles( const AString & cacheId,
+                                         const Array< AString > & fileNames,
+                                         uint64_t & outDataSize )
+{
+    PROFILE_FUNCTION;
+
+    AStackString<> fullPath;
+    GetFullPathForCacheEntry( cacheId, fullPath );
+
+    // Open the entry once, reading the header and copying each file from the same handle
+    FileStream cacheFile;
+    if ( cacheFile.Open( fullPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false; // Cache miss
+    }
+
+    // Check if the entry is stored uncompressed (i.e. files are stored as-is within it)
+    // NOTE: For entries in the chunked store, this is the manifest, which is never uncompressed
+    uint8_t header[ Compressor::kMaxHeaderSize + MultiBuffer::MAX_HEADER_SIZE ];
+    outDataSize = cacheFile.GetFileSize();
+    const size_t headerSize = (size_t)Math::Min< uint64_t >( sizeof( header ), outDataSize );
+    if ( cacheFile.Read( header, headerSize ) != headerSize )
+    {
+        return false;
+    }
+    const uint32_t dataOffset = Compressor::GetUncompressedDataOffset( header, headerSize, outDataSize );
+    if ( dataOffset == 0 )
+    {
+        return false; // Compressed entry
+    }
+
+    for ( size_t i = 0; i < fileNames.GetSize(); ++i )
+    {
+        uint64_t fileOffset = 0;
+        uint64_t fileSize = 0;
+        if ( ( MultiBuffer::GetFileRange( header + dataOffset, headerSize - dataOffset, i, fileOffset, fileSize ) == false ) ||
+             ( ( dataOffset + fileOffset + fileSize ) > outDataSize ) ||
+             ( FileIO::FileCopyRange( cacheFile, dataOffset + fileOffset, fileSize, fileNames[ i ] ) == false ) )
+        {
+            return false;
+        }
+    }
     return true;
 }
 
@@ -381,4 +565,341 @@ void Cache::GetFullPathForCacheEntry( const AString & cacheId,
                                             cacheId.Get() );
 }
 
+// WriteCacheFile
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::WriteCacheFile( const AString & fullPath, const void * data, size_t dataSize )
+{
+    // make sure the cache output path exists
+    if ( !FileIO::EnsurePathExistsForFile( fullPath ) )
+    {
+        return false;
+    }
+
+    // open output cache (tmp) file
+    // (unique, since chunks can be written concurrently by different entries)
+    AStackString<> fullPathTmp;
+    fullPathTmp.Format( "%s.%u.%u.tmp", fullPath.Get(), Process::GetCurrentId(), sTmpFileCounter.Increment() );
+    FileStream cacheTmpFile;
+    if ( !cacheTmpFile.Open( fullPathTmp.Get(), FileStream::WRITE_ONLY ) )
+    {
+        return false;
+    }
+
+    // write data
+    const bool cacheTmpWriteOk = ( cacheTmpFile.Write( data, dataSize ) == dataSize );
+    cacheTmpFile.Close();
+
+    if ( !cacheTmpWriteOk )
+    {
+        // failed to write to cache tmp file
+        FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup failure
+        return false;
+    }
+
+    // rename tmp file to real file
+    if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
+    {
+        // try to delete (possibly) existing file
+        FileIO::FileDelete( fullPath.Get() );
+
+        // try rename again
+        if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
+        {
+            // problem renaming file
+            FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup tmp file
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// PublishChunked
+//------------------------------------------------------------------------------
+bool Cache::PublishChunked( const AString & cacheId, const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    // Chunk the payload of compressed entries. Entries compressed with a
+    // dictionary (which the cache doesn't have) are chunked as they are.
+    uint32_t flags = 0;
+    Compressor decompressor;
+    if ( ( dataSize > 0 ) &&
+         Compressor::IsValidData( data, dataSize ) &&
+         ( Compressor::GetDictionaryId( data, dataSize ) == 0 ) &&
+         decompressor.Decompress( data ) )
+    {
+        flags |= kChunkManifestFlagCompressorFormat;
+        data = decompressor.GetResult();
+        dataSize = decompressor.GetResultSize();
+    }
+
+    // Store any chunks not already in the cache
+    Array< ChunkRef > chunks( ( dataSize / kMinChunkSize ) + 1, true );
+    const uint8_t * pos = static_cast< const uint8_t * >( data );
+    const uint8_t * const end = ( pos + dataSize );
+    while ( pos < end )
+    {
+        const size_t chunkSize = FindChunkSize( pos, (size_t)( end - pos ) );
+        const ChunkRef chunk = { xxHash3::Calc64( pos, chunkSize ), (uint32_t)chunkSize, 0 };
+        if ( PublishChunk( chunk, pos ) == false )
+        {
+            return false;
+        }
+        chunks.Append( chunk );
+        pos += chunkSize;
+    }
+
+    // The entry itself becomes a manifest of the chunks. Since it is written
+    // last, an entry is never visible before all its chunks are.
+    static_assert( sizeof( ChunkManifestHeader ) == 24, "Manifest format must not change" );
+    static_assert( sizeof( ChunkRef ) == 16, "Manifest format must not change" );
+    ChunkManifestHeader header;
+    header.m_Magic = kChunkManifestMagic;
+    header.m_NumChunks = (uint32_t)chunks.GetSize();
+    header.m_TotalSize = dataSize;
+    header.m_Flags = flags;
+    header.m_Padding = 0;
+    MemoryStream manifest( sizeof( header ) + ( chunks.GetSize() * sizeof( ChunkRef ) ) );
+    manifest.WriteBuffer( &header, sizeof( header ) );
+    manifest.WriteBuffer( chunks.Begin(), chunks.GetSize() * sizeof( ChunkRef ) );
+
+    AStackString<> fullPath;
+    GetFullPathForCacheEntry( cacheId, fullPath );
+    return WriteCacheFile( fullPath, manifest.GetData(), manifest.GetSize() );
+}
+
+// PublishChunk
+//------------------------------------------------------------------------------
+bool Cache::PublishChunk( const ChunkRef & chunk, const void * data )
+{
+    AStackString<> fullPath;
+    GetFullPathForChunk( chunk, fullPath );
+
+    // Already stored? Update the time, so it's not considered unreferenced
+    // until the new manifest is visible to Trim
+    if ( FileIO::FileExists( fullPath.Get() ) && FileIO::SetFileLastWriteTimeToNow( fullPath ) )
+    {
+        m_NumChunksReused.Increment();
+        m_NumBytesReused.Add( chunk.m_Size );
+        return true;
+    }
+
+    Compressor c;
+    c.Compress( data, chunk.m_Size ); // Stored uncompressed if that is smaller
+    if ( WriteCacheFile( fullPath, c.GetResult(), c.GetResultSize() ) == false )
+    {
+        return false;
+    }
+    m_NumChunksStored.Increment();
+    m_NumBytesStored.Add( chunk.m_Size );
+    return true;
+}
+
+// RetrieveChunked
+//------------------------------------------------------------------------------
+bool Cache::RetrieveChunked( const Array< ChunkRef > & chunks, uint32_t flags, void * & data, size_t & dataSize ) const
+{
+    PROFILE_FUNCTION;
+
+    size_t totalSize = 0;
+    for ( const ChunkRef & chunk : chunks )
+    {
+        totalSize += chunk.m_Size;
+    }
+
+    UniquePtr< uint8_t > mem( (uint8_t *)ALLOC( totalSize ) );
+    uint8_t * pos = mem.Get();
+    for ( const ChunkRef & chunk : chunks )
+    {
+        // A missing or damaged chunk (i.e. Trimmed or corrupt) makes the whole entry unavailable
+        AStackString<> fullPath;
+        GetFullPathForChunk( chunk, fullPath );
+        FileStream chunkFile;
+        if ( chunkFile.Open( fullPath.Get(), FileStream::READ_ONLY ) == false )
+        {
+            return false;
+        }
+        const size_t chunkFileSize = (size_t)chunkFile.GetFileSize();
+        UniquePtr< uint8_t > chunkData( (uint8_t *)ALLOC( chunkFileSize ) );
+        Compressor c;
+        if ( ( chunkFile.Read( chunkData.Get(), chunkFileSize ) != chunkFileSize ) ||
+             ( Compressor::IsValidData( chunkData.Get(), chunkFileSize ) == false ) ||
+             ( Compressor::GetUncompressedSize( chunkData.Get(), chunkFileSize ) != chunk.m_Size ) ||
+             ( c.Decompress( chunkData.Get() ) == false ) ||
+             ( xxHash3::Calc64( c.GetResult(), chunk.m_Size ) != chunk.m_Hash ) )
+        {
+            return false;
+        }
+        memcpy( pos, c.GetResult(), chunk.m_Size );
+        pos += chunk.m_Size;
+    }
+
+    // Restore the format of the original entry. The payload is returned
+    // without compression, which is cheaper to retrieve than recompressing.
+    if ( flags & kChunkManifestFlagCompressorFormat )
+    {
+        Compressor c;
+        c.Compress( mem.Get(), totalSize, 0 ); // 0 = no compression
+        dataSize = c.GetResultSize();
+        data = c.ReleaseResult();
+        return true;
+    }
+
+    dataSize = totalSize;
+    data = mem.Release();
+    return true;
+}
+
+// ReadChunkManifest
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::ReadChunkManifest( const AString & fullPath, Array< ChunkRef > & outChunks )
+{
+    FileStream file;
+    if ( file.Open( fullPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+
+    // Check the header before reading the rest, since most entries are usually not manifests
+    ChunkManifestHeader header;
+    const uint64_t fileSize = file.GetFileSize();
+    if ( ( fileSize < sizeof( header ) ) ||
+         ( file.Read( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.m_Magic != kChunkManifestMagic ) ||
+         ( fileSize != ( sizeof( header ) + ( (uint64_t)header.m_NumChunks * sizeof( ChunkRef ) ) ) ) )
+    {
+        return false;
+    }
+
+    outChunks.SetSize( header.m_NumChunks );
+    const size_t chunksSize = ( header.m_NumChunks * sizeof( ChunkRef ) );
+    return ( file.Read( outChunks.Begin(), chunksSize ) == chunksSize );
+}
+
+// ParseChunkManifest
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::ParseChunkManifest( const void * data, size_t dataSize, Array< ChunkRef > & outChunks, uint32_t & outFlags )
+{
+    if ( dataSize < sizeof( ChunkManifestHeader ) )
+    {
+        return false;
+    }
+    const ChunkManifestHeader * header = static_cast< const ChunkManifestHeader * >( data );
+    if ( ( header->m_Magic != kChunkManifestMagic ) ||
+         ( dataSize != ( sizeof( ChunkManifestHeader ) + ( (uint64_t)header->m_NumChunks * sizeof( ChunkRef ) ) ) ) )
+    {
+        return false;
+    }
+
+    const ChunkRef * chunks = reinterpret_cast< const ChunkRef * >( header + 1 );
+    uint64_t totalSize = 0;
+    for ( const ChunkRef * chunk = chunks; chunk < ( chunks + header->m_NumChunks ); ++chunk )
+    {
+        totalSize += chunk->m_Size;
+    }
+    if ( totalSize != header->m_TotalSize )
+    {
+        return false;
+    }
+
+    outChunks.Append( chunks, chunks + header->m_NumChunks );
+    outFlags = header->m_Flags;
+    return true;
+}
+
+// GetFullPathForChunk
+//------------------------------------------------------------------------------
+void Cache::GetFullPathForChunk( const ChunkRef & chunk, AString & outFullPath ) const
+{
+    // format example: N:\\fbuild.cache\\AA\\BB\\<AABB............-00004000.chunk>
+    AStackString<> chunkId;
+    chunkId.Format( "%016" PRIX64 "-%08X.chunk", chunk.m_Hash, chunk.m_Size );
+    GetFullPathForCacheEntry( chunkId, outFullPath );
+}
+
+// CountChunkReferences
+//------------------------------------------------------------------------------
+void Cache::CountChunkReferences( Array< FileIO::FileInfo > & inOutEntries,
+                                  Array< ChunkFile > & outChunks,
+                                  UnorderedMap< AString, uint32_t > & outChunkIndices ) const
+{
+    // Find chunks
+    for ( const FileIO::FileInfo & info : inOutEntries )
+    {
+        if ( info.m_Name.EndsWith( ".chunk" ) )
+        {
+            outChunkIndices.Insert( info.m_Name, (uint32_t)outChunks.GetSize() );
+            outChunks.EmplaceBack( info );
+        }
+    }
+    if ( outChunks.IsEmpty() )
+    {
+        return; // Chunked store not in use
+    }
+
+    // Separate chunks from entries
+    Array< FileIO::FileInfo > entries( inOutEntries.GetSize() - outChunks.GetSize() );
+    for ( const FileIO::FileInfo & info : inOutEntries )
+    {
+        if ( info.m_Name.EndsWith( ".chunk" ) == false )
+        {
+            entries.Append( info );
+        }
+    }
+    inOutEntries.Swap( entries );
+
+    // Count references from manifests
+    for ( const FileIO::FileInfo & info : inOutEntries )
+    {
+        Array< ChunkRef > entryChunks;
+        if ( ReadChunkManifest( info.m_Name, entryChunks ) == false )
+        {
+            continue;
+        }
+        for ( const ChunkRef & chunk : entryChunks )
+        {
+            AStackString<> fullPath;
+            GetFullPathForChunk( chunk, fullPath );
+            const UnorderedMap< AString, uint32_t >::KeyValue * index = outChunkIndices.Find( fullPath );
+            if ( index )
+            {
+                ++outChunks[ index->m_Value ].m_RefCount;
+            }
+        }
+    }
+}
+
+// ReleaseChunkReferences
+//------------------------------------------------------------------------------
+void Cache::ReleaseChunkReferences( const Array< ChunkRef > & entryChunks,
+                                    Array< ChunkFile > & chunks,
+                                    UnorderedMap< AString, uint32_t > & chunkIndices,
+                                    uint64_t currentTime,
+                                    uint64_t & inOutTotalSize,
+                                    uint32_t & inOutNumDeleted ) const
+{
+    for ( const ChunkRef & entryChunk : entryChunks )
+    {
+        AStackString<> fullPath;
+        GetFullPathForChunk( entryChunk, fullPath );
+        const UnorderedMap< AString, uint32_t >::KeyValue * index = chunkIndices.Find( fullPath );
+        if ( index == nullptr )
+        {
+            continue; // Chunk was already missing
+        }
+        ChunkFile & chunk = chunks[ index->m_Value ];
+        if ( ( chunk.m_RefCount == 0 ) || ( --chunk.m_RefCount > 0 ) )
+        {
+            continue;
+        }
+        if ( ( IsChunkRecentlyUsed( chunk.m_Name, currentTime ) == false ) &&
+             FileIO::FileDelete( chunk.m_Name.Get() ) )
+        {
+            inOutTotalSize -= chunk.m_Size;
+            ++inOutNumDeleted;
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
@@ -5,7 +5,9 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "ICache.h"
+#include "Core/Containers/UnorderedMap.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Strings/AString.h"
 
 // Cache
@@ -13,7 +15,7 @@
 class Cache : public ICache
 {
 public:
-    explicit Cache();
+    explicit Cache( bool chunkedStore = false );
     virtual ~Cache() override;
 
     virtual bool Init( const AString & cachePath,
@@ -28,11 +30,44 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool RetrieveToFiles( const AString & cacheId,
+                                  const Array< AString > & fileNames,
+                                  uint64_t & outDataSize ) override;
 private:
+    class ChunkRef;
+    class ChunkFile;
+
+    // Chunked store: entries are manifests of content-defined chunks, which
+    // are stored once and shared by all entries containing them
+    bool PublishChunked( const AString & cacheId, const void * data, size_t dataSize );
+    bool PublishChunk( const ChunkRef & chunk, const void * data );
+    bool RetrieveChunked( const Array< ChunkRef > & chunks, uint32_t flags, void * & data, size_t & dataSize ) const;
+    static bool ReadChunkManifest( const AString & fullPath, Array< ChunkRef > & outChunks );
+    static bool ParseChunkManifest( const void * data, size_t dataSize, Array< ChunkRef > & outChunks, uint32_t & outFlags );
+    void GetFullPathForChunk( const ChunkRef & chunk, AString & outFullPath ) const;
+    void CountChunkReferences( Array< FileIO::FileInfo > & inOutEntries,
+                               Array< ChunkFile > & outChunks,
+                               UnorderedMap< AString, uint32_t > & outChunkIndices ) const;
+    void ReleaseChunkReferences( const Array< ChunkRef > & entryChunks,
+                                 Array< ChunkFile > & chunks,
+                                 UnorderedMap< AString, uint32_t > & chunkIndices,
+                                 uint64_t currentTime,
+                                 uint64_t & inOutTotalSize,
+                                 uint32_t & inOutNumDeleted ) const;
+
+    static bool WriteCacheFile( const AString & fullPath, const void * data, size_t dataSize );
     void GetCacheFiles( bool showProgress, Array< FileIO::FileInfo > & outInfo, uint64_t & outTotalSize ) const;
     void GetFullPathForCacheEntry( const AString & cacheId, AString & outFullPath ) const;
 
     AString m_CachePath;
+    bool    m_ChunkedStore;
+    bool    m_Verbose = false;
+
+    // Chunked store stats
+    Atomic< uint32_t >  m_NumChunksStored;
+    Atomic< uint32_t >  m_NumChunksReused;
+    Atomic< uint64_t >  m_NumBytesStored;
+    Atomic< uint64_t >  m_NumBytesReused;
 };
 
 //------------------------------------------------------------------------------
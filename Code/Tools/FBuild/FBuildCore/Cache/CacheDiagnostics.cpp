@@ -0,0 +1,346 @@
+// CacheDiagnostics - Raw components of a cache key, to help explain cache misses
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheDiagnostics.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Strings/AStackString.h"
+
+// Record format
+//------------------------------------------------------------------------------
+// Records are stored as text so they can be inspected by hand in the cache:
+//   Version <version>
+//   CacheId <cacheId>
+//   Args <args>
+//   Tool <hash> <file>
+//   Include <hash> <file>
+static const uint32_t sRecordVersion = 1;
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheDiagnostics::CacheDiagnostics()
+    : m_ToolFiles( 0, true )
+    , m_Includes( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheDiagnostics::~CacheDiagnostics() = default;
+
+// SetCacheId
+//------------------------------------------------------------------------------
+bool CacheDiagnostics::SetCacheId( const AString & cacheId )
+{
+    m_CacheId = cacheId;
+    return ICache::ParseCacheId( cacheId, m_SourceKey, m_CommandLineKey, m_ToolChainKey, m_PCHKey );
+}
+
+// SetArgs
+//------------------------------------------------------------------------------
+void CacheDiagnostics::SetArgs( const AString & args )
+{
+    // Records are line based
+    m_Args = args;
+    m_Args.Replace( '\r', ' ' );
+    m_Args.Replace( '\n', ' ' );
+}
+
+// SetToolManifest
+//------------------------------------------------------------------------------
+void CacheDiagnostics::SetToolManifest( const ToolManifest & manifest )
+{
+    const Array< ToolManifestFile > & files = manifest.GetFiles();
+    m_ToolFiles.SetCapacity( files.GetSize() );
+    for ( const ToolManifestFile & file : files )
+    {
+        m_ToolFiles.EmplaceBack( file.GetName(), file.GetHash() );
+    }
+    m_ToolFiles.Sort();
+}
+
+// AddInclude
+//------------------------------------------------------------------------------
+void CacheDiagnostics::AddInclude( const AString & fileName )
+{
+    // Hash the contents if we can. Hash is left as zero if the file can't be
+    // read, which will show up as a difference if the other side could read it.
+    uint64_t hash = 0;
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) )
+    {
+        const size_t fileSize = (size_t)f.GetFileSize();
+        UniquePtr< char > mem( (char *)ALLOC( fileSize ) );
+        if ( f.Read( mem.Get(), fileSize ) == fileSize )
+        {
+            hash = xxHash3::Calc64( mem.Get(), fileSize );
+        }
+    }
+
+    // Includes are compared across machines, so remove local root
+    AStackString<> relativeName;
+    MakeRelativeToWorkingDir( fileName, relativeName );
+    m_Includes.EmplaceBack( relativeName, hash );
+}
+
+// GetObjectKey
+//------------------------------------------------------------------------------
+/*static*/ uint64_t CacheDiagnostics::GetObjectKey( const AString & objectName )
+{
+    AStackString<> relativeName;
+    MakeRelativeToWorkingDir( objectName, relativeName );
+    #if defined( __WINDOWS__ ) || defined( __OSX__ )
+        relativeName.ToLower(); // Case insensitive file systems
+    #endif
+    return xxHash3::Calc64( relativeName );
+}
+
+// Serialize
+//------------------------------------------------------------------------------
+void CacheDiagnostics::Serialize( AString & outBuffer ) const
+{
+    outBuffer.Format( "Version %u\n", sRecordVersion );
+    outBuffer.AppendFormat( "CacheId %s\n", m_CacheId.Get() );
+    outBuffer.AppendFormat( "Args %s\n", m_Args.Get() );
+    for ( const Entry & entry : m_ToolFiles )
+    {
+        outBuffer.AppendFormat( "Tool %016" PRIX64 " %s\n", entry.m_Hash, entry.m_Name.Get() );
+    }
+    for ( const Entry & entry : m_Includes )
+    {
+        outBuffer.AppendFormat( "Include %016" PRIX64 " %s\n", entry.m_Hash, entry.m_Name.Get() );
+    }
+}
+
+// Deserialize
+//------------------------------------------------------------------------------
+bool CacheDiagnostics::Deserialize( const void * data, size_t dataSize )
+{
+    const char * pos = static_cast< const char * >( data );
+    const char * const end = pos + dataSize;
+
+    bool versionOK = false;
+    while ( pos < end )
+    {
+        // Extract line
+        const char * lineEnd = pos;
+        while ( ( lineEnd < end ) && ( *lineEnd != '\n' ) )
+        {
+            ++lineEnd;
+        }
+        AStackString<> line( pos, lineEnd );
+        pos = lineEnd + 1;
+
+        // Split into tag and value
+        const char * space = line.Find( ' ' );
+        if ( space == nullptr )
+        {
+            continue; // Ignore unknown/malformed lines
+        }
+        const AStackString<> tag( line.Get(), space );
+        const char * value = space + 1;
+
+        if ( tag == "Version" )
+        {
+            uint32_t version = 0;
+            versionOK = ( ( AString::ScanS( value, "%u", &version ) == 1 ) && ( version == sRecordVersion ) );
+            if ( versionOK == false )
+            {
+                return false;
+            }
+        }
+        else if ( tag == "CacheId" )
+        {
+            if ( SetCacheId( AStackString<>( value ) ) == false )
+            {
+                return false;
+            }
+        }
+        else if ( tag == "Args" )
+        {
+            m_Args = value;
+        }
+        else if ( ( tag == "Tool" ) || ( tag == "Include" ) )
+        {
+            uint64_t hash = 0;
+            const char * name = ( ( value + 17 ) <= line.GetEnd() ) ? ( value + 17 ) : nullptr;
+            if ( ( name == nullptr ) || ( AString::ScanS( value, "%16" PRIx64, &hash ) != 1 ) )
+            {
+                return false;
+            }
+            Array< Entry > & entries = ( tag == "Tool" ) ? m_ToolFiles : m_Includes;
+            entries.EmplaceBack( AStackString<>( name ), hash );
+        }
+    }
+
+    return ( versionOK && ( m_CacheId.IsEmpty() == false ) );
+}
+
+// Compare
+//------------------------------------------------------------------------------
+void CacheDiagnostics::Compare( const CacheDiagnostics & cached, AString & outReport ) const
+{
+    outReport.AppendFormat( " - Nearest Entry: '%s'\n", cached.m_CacheId.Get() );
+
+    // Source (preprocessed output or LightCache hash)
+    if ( m_SourceKey == cached.m_SourceKey )
+    {
+        outReport += " - Source     : Same\n";
+    }
+    else
+    {
+        outReport.AppendFormat( " - Source     : DIFFERENT (Local: %016" PRIX64 " Cached: %016" PRIX64 ")\n", m_SourceKey, cached.m_SourceKey );
+        if ( m_Includes.IsEmpty() || cached.m_Includes.IsEmpty() )
+        {
+            outReport += "   - Include information unavailable\n";
+        }
+        else
+        {
+            Array< Entry > localIncludes( m_Includes );
+            Array< Entry > cachedIncludes( cached.m_Includes );
+            localIncludes.Sort();
+            cachedIncludes.Sort();
+            CompareEntries( localIncludes, cachedIncludes, outReport );
+        }
+    }
+
+    // Command line
+    if ( m_CommandLineKey == cached.m_CommandLineKey )
+    {
+        outReport += " - Args       : Same\n";
+    }
+    else
+    {
+        outReport.AppendFormat( " - Args       : DIFFERENT (Local: %08X Cached: %08X)\n", m_CommandLineKey, cached.m_CommandLineKey );
+        CompareArgs( m_Args, cached.m_Args, outReport );
+    }
+
+    // Toolchain
+    if ( m_ToolChainKey == cached.m_ToolChainKey )
+    {
+        outReport += " - Toolchain  : Same\n";
+    }
+    else
+    {
+        outReport.AppendFormat( " - Toolchain  : DIFFERENT (Local: %016" PRIX64 " Cached: %016" PRIX64 ")\n", m_ToolChainKey, cached.m_ToolChainKey );
+        CompareEntries( m_ToolFiles, cached.m_ToolFiles, outReport );
+    }
+
+    // Precompiled header
+    if ( m_PCHKey == cached.m_PCHKey )
+    {
+        outReport += " - PCH        : Same\n";
+    }
+    else
+    {
+        outReport.AppendFormat( " - PCH        : DIFFERENT (Local: %016" PRIX64 " Cached: %016" PRIX64 ")\n", m_PCHKey, cached.m_PCHKey );
+    }
+}
+
+// MakeRelativeToWorkingDir
+//------------------------------------------------------------------------------
+/*static*/ void CacheDiagnostics::MakeRelativeToWorkingDir( const AString & path, AString & outPath )
+{
+    AStackString<> workingDir( FBuild::Get().GetOptions().GetWorkingDir() );
+    PathUtils::EnsureTrailingSlash( workingDir );
+    if ( PathUtils::PathBeginsWith( path, workingDir ) )
+    {
+        outPath = ( path.Get() + workingDir.GetLength() );
+    }
+    else
+    {
+        outPath = path;
+    }
+}
+
+// CompareEntries
+//------------------------------------------------------------------------------
+/*static*/ void CacheDiagnostics::CompareEntries( const Array< Entry > & local,
+                                                  const Array< Entry > & cached,
+                                                  AString & outReport )
+{
+    // Both lists are sorted by name
+    const Entry * localIt = local.Begin();
+    const Entry * cachedIt = cached.Begin();
+    while ( ( localIt != local.End() ) || ( cachedIt != cached.End() ) )
+    {
+        if ( ( cachedIt == cached.End() ) || ( ( localIt != local.End() ) && ( *localIt < *cachedIt ) ) )
+        {
+            outReport.AppendFormat( "   - Only Local  : %s\n", localIt->m_Name.Get() );
+            ++localIt;
+        }
+        else if ( ( localIt == local.End() ) || ( *cachedIt < *localIt ) )
+        {
+            outReport.AppendFormat( "   - Only Cached : %s\n", cachedIt->m_Name.Get() );
+            ++cachedIt;
+        }
+        else
+        {
+            if ( localIt->m_Hash != cachedIt->m_Hash )
+            {
+                outReport.AppendFormat( "   - Changed     : %s\n", localIt->m_Name.Get() );
+            }
+            ++localIt;
+            ++cachedIt;
+        }
+    }
+}
+
+// CompareArgs
+//------------------------------------------------------------------------------
+/*static*/ void CacheDiagnostics::CompareArgs( const AString & local,
+                                               const AString & cached,
+                                               AString & outReport )
+{
+    // Arg order can matter, but differences in the set of args are the
+    // most common (and most readable) explanation
+    Array< AString > localTokens;
+    Array< AString > cachedTokens;
+    local.Tokenize( localTokens );
+    cached.Tokenize( cachedTokens );
+    localTokens.Sort();
+    cachedTokens.Sort();
+
+    bool foundDifference = false;
+    const AString * localIt = localTokens.Begin();
+    const AString * cachedIt = cachedTokens.Begin();
+    while ( ( localIt != localTokens.End() ) || ( cachedIt != cachedTokens.End() ) )
+    {
+        if ( ( cachedIt == cachedTokens.End() ) || ( ( localIt != localTokens.End() ) && ( *localIt < *cachedIt ) ) )
+        {
+            outReport.AppendFormat( "   - Only Local  : %s\n", localIt->Get() );
+            foundDifference = true;
+            ++localIt;
+        }
+        else if ( ( localIt == localTokens.End() ) || ( *cachedIt < *localIt ) )
+        {
+            outReport.AppendFormat( "   - Only Cached : %s\n", cachedIt->Get() );
+            foundDifference = true;
+            ++cachedIt;
+        }
+        else
+        {
+            ++localIt;
+            ++cachedIt;
+        }
+    }
+
+    if ( foundDifference == false )
+    {
+        outReport += "   - Same args in a different order\n";
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+// CacheDiagnostics - Raw components of a cache key, to help explain cache misses
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ToolManifest;
+
+// CacheDiagnostics
+//------------------------------------------------------------------------------
+class CacheDiagnostics
+{
+public:
+    CacheDiagnostics();
+    ~CacheDiagnostics();
+
+    // Populate
+    bool SetCacheId( const AString & cacheId );
+    void SetArgs( const AString & args );
+    void SetToolManifest( const ToolManifest & manifest );
+    void AddInclude( const AString & fileName );
+
+    // Key identifying an object independently of its contents, to locate the
+    // most recently published entry for that object
+    static uint64_t GetObjectKey( const AString & objectName );
+
+    // Text serialization (stored in the cache alongside the entry it describes)
+    void Serialize( AString & outBuffer ) const;
+    bool Deserialize( const void * data, size_t dataSize );
+
+    // Describe how the components of another (cached) record differ from this one
+    void Compare( const CacheDiagnostics & cached, AString & outReport ) const;
+
+    const AString & GetCacheId() const { return m_CacheId; }
+
+private:
+    class Entry
+    {
+    public:
+        Entry() = default;
+        Entry( const AString & name, uint64_t hash ) : m_Name( name ), m_Hash( hash ) {}
+
+        bool operator < ( const Entry & other ) const { return ( m_Name < other.m_Name ); }
+
+        AString     m_Name;
+        uint64_t    m_Hash = 0;
+    };
+
+    static void MakeRelativeToWorkingDir( const AString & path, AString & outPath );
+    static void CompareEntries( const Array< Entry > & local,
+                                const Array< Entry > & cached,
+                                AString & outReport );
+    static void CompareArgs( const AString & local,
+                             const AString & cached,
+                             AString & outReport );
+
+    AString         m_CacheId;
+    uint64_t        m_SourceKey         = 0;
+    uint32_t        m_CommandLineKey    = 0;
+    uint64_t        m_ToolChainKey      = 0;
+    uint64_t        m_PCHKey            = 0;
+    AString         m_Args;
+    Array< Entry >  m_ToolFiles;
+    Array< Entry >  m_Includes;
+};
+
+//------------------------------------------------------------------------------
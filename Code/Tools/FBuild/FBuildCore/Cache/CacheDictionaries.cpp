@@ -0,0 +1,242 @@
+// CacheDictionaries - Compression dictionaries for cache entries, per toolchain
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheDictionaries.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressorDictionary.h"
+
+// Core
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// ToolChain (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+CacheDictionaries::ToolChain::ToolChain( uint64_t toolChainKey )
+    : m_ToolChainKey( toolChainKey )
+    , m_Samples( 0, true )
+{
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheDictionaries::CacheDictionaries( ICache & cache, bool verbose )
+    : m_Cache( cache )
+    , m_Verbose( verbose )
+    , m_ToolChains( 0, true )
+    , m_Dictionaries( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheDictionaries::~CacheDictionaries()
+{
+    for ( ToolChain * toolChain : m_ToolChains )
+    {
+        FDELETE toolChain;
+    }
+    for ( LoadedDictionary & loaded : m_Dictionaries )
+    {
+        FDELETE loaded.m_Dictionary;
+    }
+}
+
+// GetForCompression
+//------------------------------------------------------------------------------
+const CompressorDictionary * CacheDictionaries::GetForCompression( uint64_t toolChainKey,
+                                                                   const void * data,
+                                                                   size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+
+    ToolChain & toolChain = GetToolChain( toolChainKey );
+    if ( toolChain.m_Current || toolChain.m_Disabled )
+    {
+        return toolChain.m_Current;
+    }
+
+    // Use the dictionary most recently published for this toolchain if there is one
+    CheckIndex( toolChain );
+    if ( toolChain.m_Current )
+    {
+        return toolChain.m_Current;
+    }
+
+    // Accumulate samples until we have enough to build a dictionary
+    const size_t maxBytesFromSample = ( kMaxDictionarySize / kNumTrainingSamples );
+    CompressorDictionary::AppendSample( data, dataSize, maxBytesFromSample, toolChain.m_Samples );
+    ++toolChain.m_NumSamples;
+    if ( toolChain.m_NumSamples < kNumTrainingSamples )
+    {
+        return nullptr;
+    }
+
+    toolChain.m_Current = Train( toolChain );
+    return toolChain.m_Current;
+}
+
+// GetCurrent
+//------------------------------------------------------------------------------
+const CompressorDictionary * CacheDictionaries::GetCurrent( uint64_t toolChainKey )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+
+    ToolChain & toolChain = GetToolChain( toolChainKey );
+    if ( ( toolChain.m_Current == nullptr ) && ( toolChain.m_Disabled == false ) )
+    {
+        CheckIndex( toolChain );
+    }
+    return toolChain.m_Current;
+}
+
+// GetForDecompression
+//------------------------------------------------------------------------------
+const CompressorDictionary * CacheDictionaries::GetForDecompression( uint64_t toolChainKey, uint32_t dictionaryId )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+
+    return Load( toolChainKey, dictionaryId );
+}
+
+// GetToolChain
+//------------------------------------------------------------------------------
+CacheDictionaries::ToolChain & CacheDictionaries::GetToolChain( uint64_t toolChainKey )
+{
+    for ( ToolChain * toolChain : m_ToolChains )
+    {
+        if ( toolChain->m_ToolChainKey == toolChainKey )
+        {
+            return *toolChain;
+        }
+    }
+    m_ToolChains.Append( FNEW( ToolChain( toolChainKey ) ) );
+    return *m_ToolChains.Top();
+}
+
+// CheckIndex
+//------------------------------------------------------------------------------
+void CacheDictionaries::CheckIndex( ToolChain & toolChain )
+{
+    if ( toolChain.m_IndexChecked == false )
+    {
+        toolChain.m_IndexChecked = true;
+
+        AStackString<> indexId;
+        ICache::GetCacheDictionaryIndexId( toolChain.m_ToolChainKey, indexId );
+        void * indexData = nullptr;
+        size_t indexDataSize = 0;
+        if ( m_Cache.Retrieve( indexId, indexData, indexDataSize ) )
+        {
+            const AStackString<> index( static_cast< const char * >( indexData ),
+                                        static_cast< const char * >( indexData ) + indexDataSize );
+            m_Cache.FreeMemory( indexData, indexDataSize );
+
+            uint32_t dictionaryId = 0;
+            if ( AString::ScanS( index.Get(), "%08x", &dictionaryId ) == 1 )
+            {
+                toolChain.m_Current = Load( toolChain.m_ToolChainKey, dictionaryId );
+            }
+        }
+    }
+}
+
+// Load
+//------------------------------------------------------------------------------
+const CompressorDictionary * CacheDictionaries::Load( uint64_t toolChainKey, uint32_t dictionaryId )
+{
+    // Already loaded (or known to be unavailable)?
+    for ( const LoadedDictionary & loaded : m_Dictionaries )
+    {
+        if ( ( loaded.m_ToolChainKey == toolChainKey ) && ( loaded.m_DictionaryId == dictionaryId ) )
+        {
+            return loaded.m_Dictionary;
+        }
+    }
+
+    AStackString<> cacheId;
+    ICache::GetCacheDictionaryId( toolChainKey, dictionaryId, cacheId );
+
+    CompressorDictionary * dictionary = nullptr;
+    void * data = nullptr;
+    size_t dataSize = 0;
+    if ( m_Cache.Retrieve( cacheId, data, dataSize ) )
+    {
+        dictionary = FNEW( CompressorDictionary );
+        if ( ( dictionary->Create( data, dataSize ) == false ) ||
+             ( dictionary->GetId() != dictionaryId ) ) // Check for corruption
+        {
+            FDELETE dictionary;
+            dictionary = nullptr;
+        }
+        m_Cache.FreeMemory( data, dataSize );
+    }
+
+    if ( m_Verbose )
+    {
+        FLOG_OUTPUT( "Cache Dictionary %s: '%s'\n", dictionary ? "Loaded" : "Unavailable", cacheId.Get() );
+    }
+
+    m_Dictionaries.Append( LoadedDictionary{ toolChainKey, dictionaryId, dictionary } );
+    return dictionary;
+}
+
+// Train
+//------------------------------------------------------------------------------
+const CompressorDictionary * CacheDictionaries::Train( ToolChain & toolChain )
+{
+    PROFILE_FUNCTION;
+
+    CompressorDictionary * dictionary = FNEW( CompressorDictionary );
+    const bool created = dictionary->Create( toolChain.m_Samples.Begin(), toolChain.m_Samples.GetSize() );
+
+    // Samples are no longer needed
+    Array< uint8_t > empty;
+    toolChain.m_Samples.Swap( empty );
+
+    // Publish the dictionary itself, then make it the one used for new entries.
+    // If it can't be published, entries using it could never be retrieved.
+    AStackString<> cacheId;
+    AStackString<> indexId;
+    AStackString<> index;
+    if ( created )
+    {
+        ICache::GetCacheDictionaryId( toolChain.m_ToolChainKey, dictionary->GetId(), cacheId );
+        ICache::GetCacheDictionaryIndexId( toolChain.m_ToolChainKey, indexId );
+        index.Format( "%08X", dictionary->GetId() );
+    }
+    if ( ( created == false ) ||
+         ( m_Cache.Publish( cacheId, dictionary->GetContent(), dictionary->GetContentSize() ) == false ) ||
+         ( m_Cache.Publish( indexId, index.Get(), index.GetLength() ) == false ) )
+    {
+        if ( m_Verbose )
+        {
+            FLOG_OUTPUT( "Cache Dictionary Store Fail: '%s'\n", cacheId.Get() );
+        }
+        FDELETE dictionary;
+        toolChain.m_Disabled = true;
+        return nullptr;
+    }
+
+    if ( m_Verbose )
+    {
+        FLOG_OUTPUT( "Cache Dictionary Store: %zu bytes from %u samples '%s'\n",
+                     dictionary->GetContentSize(), toolChain.m_NumSamples, cacheId.Get() );
+    }
+
+    m_Dictionaries.Append( LoadedDictionary{ toolChain.m_ToolChainKey, dictionary->GetId(), dictionary } );
+    return dictionary;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,81 @@
+// CacheDictionaries - Compression dictionaries for cache entries, per toolchain
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CompressorDictionary;
+class ICache;
+
+// CacheDictionaries
+//------------------------------------------------------------------------------
+// Objects from the same toolchain share a lot of structure, which a dictionary
+// can capture to improve compression of (particularly small) entries.
+//
+// A dictionary is built from the first entries stored for each toolchain and
+// is published to the cache under an id derived from its contents. Entries
+// record the id of the dictionary they were compressed with, so a dictionary
+// replaced by another build remains available to decompress older entries.
+class CacheDictionaries
+{
+public:
+    explicit CacheDictionaries( ICache & cache, bool verbose );
+    ~CacheDictionaries();
+
+    // Get the dictionary to compress a new entry with. If a dictionary is not
+    // available yet (nullptr is returned), the data is retained as a sample.
+    const CompressorDictionary * GetForCompression( uint64_t toolChainKey, const void * data, size_t dataSize );
+
+    // Get the dictionary new entries are compressed with, if there is one yet
+    // (without retaining a sample). Used to compress results of remote jobs.
+    const CompressorDictionary * GetCurrent( uint64_t toolChainKey );
+
+    // Get the dictionary needed to decompress an existing entry
+    const CompressorDictionary * GetForDecompression( uint64_t toolChainKey, uint32_t dictionaryId );
+
+    // Tuning
+    static const uint32_t   kNumTrainingSamples     = 32;
+    static const size_t     kMaxDictionarySize      = ( 112 * 1024 );
+
+private:
+    class ToolChain
+    {
+    public:
+        explicit ToolChain( uint64_t toolChainKey );
+
+        uint64_t                        m_ToolChainKey;
+        bool                            m_IndexChecked  = false;
+        bool                            m_Disabled      = false;
+        const CompressorDictionary *    m_Current       = nullptr;
+        uint32_t                        m_NumSamples    = 0;
+        Array< uint8_t >                m_Samples;
+    };
+    class LoadedDictionary
+    {
+    public:
+        uint64_t                m_ToolChainKey;
+        uint32_t                m_DictionaryId;
+        CompressorDictionary *  m_Dictionary; // nullptr if not available
+    };
+
+    // Functions below must be called with m_Mutex held
+    ToolChain &                     GetToolChain( uint64_t toolChainKey );
+    void                            CheckIndex( ToolChain & toolChain );
+    const CompressorDictionary *    Load( uint64_t toolChainKey, uint32_t dictionaryId );
+    const CompressorDictionary *    Train( ToolChain & toolChain );
+
+    ICache &                    m_Cache;
+    bool                        m_Verbose;
+    Mutex                       m_Mutex;
+    Array< ToolChain * >        m_ToolChains;
+    Array< LoadedDictionary >   m_Dictionaries;
+};
+
+//------------------------------------------------------------------------------
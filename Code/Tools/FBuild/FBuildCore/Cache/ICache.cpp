@@ -27,4 +27,53 @@
                        cacheVersion );
 }
 
+// ParseCacheId
+//------------------------------------------------------------------------------
+/*static*/ bool ICache::ParseCacheId( const AString & cacheId,
+                                      uint64_t & outPreprocessedSourceKey,
+                                      uint32_t & outCommandLineKey,
+                                      uint64_t & outToolChainKey,
+                                      uint64_t & outPCHKey )
+{
+    // Inverse of GetCacheId
+    return ( AString::ScanS( cacheId.Get(),
+                             "%16" PRIx64 "_%8x_%16" PRIx64 "-%16" PRIx64,
+                             &outPreprocessedSourceKey,
+                             &outCommandLineKey,
+                             &outToolChainKey,
+                             &outPCHKey ) == 4 );
+}
+
+// GetCacheDiagnosticsId
+//------------------------------------------------------------------------------
+/*static*/ void ICache::GetCacheDiagnosticsId( const AString & cacheId, AString & outDiagnosticsId )
+{
+    // format example: 2377DE32AB045A2D_FED872A1_AB62FEAA23498AAC-32A2B04375A2D7DE.7.diag
+    outDiagnosticsId.Format( "%s.diag", cacheId.Get() );
+}
+
+// GetCacheDiagnosticsIndexId
+//------------------------------------------------------------------------------
+/*static*/ void ICache::GetCacheDiagnosticsIndexId( const uint64_t objectKey, AString & outIndexId )
+{
+    // format example: 5A2D2377DE32AB04.diagindex
+    outIndexId.Format( "%016" PRIX64 ".diagindex", objectKey );
+}
+
+// GetCacheDictionaryId
+//------------------------------------------------------------------------------
+/*static*/ void ICache::GetCacheDictionaryId( const uint64_t toolChainKey, const uint32_t dictionaryId, AString & outDictionaryId )
+{
+    // format example: AB62FEAA23498AAC_5A2D2377.dict
+    outDictionaryId.Format( "%016" PRIX64 "_%08X.dict", toolChainKey, dictionaryId );
+}
+
+// GetCacheDictionaryIndexId
+//------------------------------------------------------------------------------
+/*static*/ void ICache::GetCacheDictionaryIndexId( const uint64_t toolChainKey, AString & outIndexId )
+{
+    // format example: AB62FEAA23498AAC.dictindex
+    outIndexId.Format( "%016" PRIX64 ".dictindex", toolChainKey );
+}
+
 //------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include <Core/Containers/Array.h>
 #include <Core/Env/Types.h>
 
 // Forward Declarations
@@ -31,12 +32,32 @@ public:
     virtual bool OutputInfo( bool showProgress ) = 0;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) = 0;
 
+    // Optional: copy the files of an entry stored without compression directly
+    // into place, without retrieving it into memory. Caches not supporting this
+    // (or entries stored in a way that doesn't allow it) return false.
+    virtual bool RetrieveToFiles( const AString & /*cacheId*/,
+                                  const Array< AString > & /*fileNames*/,
+                                  uint64_t & /*outDataSize*/ ) { return false; }
+
     // Helper functions
     static void GetCacheId( const uint64_t preprocessedSourceKey,
                             const uint32_t commandLineKey,
                             const uint64_t toolChainKey,
                             const uint64_t pchKey,
                             AString & outCacheId );
+    static bool ParseCacheId( const AString & cacheId,
+                              uint64_t & outPreprocessedSourceKey,
+                              uint32_t & outCommandLineKey,
+                              uint64_t & outToolChainKey,
+                              uint64_t & outPCHKey );
+
+    // Diagnostic records stored alongside cache entries (see CacheDiagnostics)
+    static void GetCacheDiagnosticsId( const AString & cacheId, AString & outDiagnosticsId );
+    static void GetCacheDiagnosticsIndexId( const uint64_t objectKey, AString & outIndexId );
+
+    // Compression dictionaries stored in the cache (see CacheDictionaries)
+    static void GetCacheDictionaryId( const uint64_t toolChainKey, const uint32_t dictionaryId, AString & outDictionaryId );
+    static void GetCacheDictionaryIndexId( const uint64_t toolChainKey, AString & outIndexId );
 };
 
 //------------------------------------------------------------------------------
@@ -330,6 +330,20 @@ bool LightCache::Hash( ObjectNode * node,
     return true;
 }
 
+// GetIncludedFiles
+//------------------------------------------------------------------------------
+void LightCache::GetIncludedFiles( Array< AString > & outFileNames,
+                                   Array< uint64_t > & outContentHashes ) const
+{
+    outFileNames.SetCapacity( m_AllIncludedFiles.GetSize() );
+    outContentHashes.SetCapacity( m_AllIncludedFiles.GetSize() );
+    for ( const IncludedFile * file : m_AllIncludedFiles )
+    {
+        outFileNames.Append( file->m_FileName );
+        outContentHashes.Append( file->m_ContentHash );
+    }
+}
+
 // ClearCachedFiles
 //------------------------------------------------------------------------------
 /*static*/ void LightCache::ClearCachedFiles()
@@ -36,6 +36,11 @@ public:
     // Get text description of problem(s) if Hash() fails
     const AString & GetErrors() const { return m_Errors; }
 
+    // Files found by Hash() (including the source file and forced includes)
+    // and the hashes of their contents
+    void GetIncludedFiles( Array< AString > & outFileNames,
+                           Array< uint64_t > & outContentHashes ) const;
+
     static void ClearCachedFiles();
 
 protected:
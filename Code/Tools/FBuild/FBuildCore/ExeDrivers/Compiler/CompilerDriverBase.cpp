@@ -61,6 +61,16 @@ void CompilerDriverBase::Init( const ObjectNode * objectNode,
     return false;
 }
 
+// ProcessArg_CompileHeaderBundle
+//------------------------------------------------------------------------------
+/*virtual*/ bool CompilerDriverBase::ProcessArg_CompileHeaderBundle( const AString & /*token*/,
+                                                                     size_t & /*index*/,
+                                                                     const AString & /*nextToken*/,
+                                                                     Args & /*outFullArgs*/ ) const
+{
+    return false;
+}
+
 // ProcessArg_BuildTimeSubstitution
 //------------------------------------------------------------------------------
 /*virtual*/ bool CompilerDriverBase::ProcessArg_BuildTimeSubstitution( const AString & token,
@@ -172,6 +182,88 @@ void CompilerDriverBase::Init( const ObjectNode * objectNode,
     }
 }
 
+// GetSourceMappingArg
+//------------------------------------------------------------------------------
+/*static*/ void CompilerDriverBase::GetSourceMappingArg( const AString & fromPath,
+                                                         const AString & toPath,
+                                                         AString & outArg )
+{
+    // Using -ffile-prefix-map would be better since that would change not only the file paths in
+    // the DWARF debugging information but also in the __FILE__ and related predefined macros, but
+    // -ffile-prefix-map is only supported starting with GCC 8 and Clang 10. The -fdebug-prefix-map
+    // option is available starting with Clang 3.8 and all modern GCC versions.
+    outArg.Format( "\"-fdebug-prefix-map=%s=%s\"", fromPath.Get(), toPath.Get() );
+}
+
+// GetSourceMappingFromArg
+//------------------------------------------------------------------------------
+/*static*/ bool CompilerDriverBase::GetSourceMappingFromArg( const AString & token,
+                                                             const AString & fromPath,
+                                                             AString & outToPath )
+{
+    const char * pos = token.Get();
+    const char * end = token.GetEnd();
+    if ( ( token.GetLength() > 2 ) && ( *pos == '"' ) && ( end[ -1 ] == '"' ) )
+    {
+        ++pos;
+        --end;
+    }
+
+    // Check for -fdebug-prefix-map=<fromPath>=
+    const AStackString<> prefix( "-fdebug-prefix-map=" );
+    const size_t argLen = (size_t)( end - pos );
+    if ( ( argLen <= ( prefix.GetLength() + fromPath.GetLength() ) ) ||
+         ( AString::StrNCmp( pos, prefix.Get(), prefix.GetLength() ) != 0 ) )
+    {
+        return false;
+    }
+    pos += prefix.GetLength();
+    if ( ( AString::StrNCmp( pos, fromPath.Get(), fromPath.GetLength() ) != 0 ) ||
+         ( pos[ fromPath.GetLength() ] != '=' ) )
+    {
+        return false;
+    }
+    pos += ( fromPath.GetLength() + 1 );
+
+    outToPath.Assign( pos, end );
+    return true;
+}
+
+// ProcessArg_RemoteSourceMapping
+//------------------------------------------------------------------------------
+bool CompilerDriverBase::ProcessArg_RemoteSourceMapping( const AString & token,
+                                                         const char * argPrefix,
+                                                         Args & outFullArgs ) const
+{
+    // Source mapping is forwarded by the client for paths in its working dir,
+    // which is where paths in the preprocessed output refer to. Paths relative
+    // to the dir the compiler is run in on this machine (such as the compilation
+    // dir recorded in debug info) must be mapped to the same place.
+    if ( m_RemoteWorkingDir.IsEmpty() )
+    {
+        return false;
+    }
+    AStackString<> sourceMapping;
+    if ( GetSourceMappingFromArg( token, m_RemoteSourceRoot, sourceMapping ) == false )
+    {
+        return false;
+    }
+
+    AStackString<> mappingArg;
+    GetSourceMappingArg( m_RemoteWorkingDir, sourceMapping, mappingArg );
+
+    outFullArgs += token;
+    outFullArgs.AddDelimiter();
+    if ( argPrefix )
+    {
+        outFullArgs += argPrefix;
+        outFullArgs.AddDelimiter();
+    }
+    outFullArgs += mappingArg;
+    outFullArgs.AddDelimiter();
+    return true;
+}
+
 // ProcessArg_PreparePreprocessedForRemote
 //------------------------------------------------------------------------------
 /*virtual*/ bool CompilerDriverBase::ProcessArg_PreparePreprocessedForRemote( const AString & /*token*/,
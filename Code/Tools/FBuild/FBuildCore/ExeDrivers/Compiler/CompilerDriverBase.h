@@ -29,6 +29,8 @@ public:
     void SetUseSourceMapping( const AString & sourceMapping ) { m_SourceMapping = sourceMapping; }
     void SetRelativeBasePath( const AString & relativeBasePath ) { m_RelativeBasePath = relativeBasePath; }
     void SetOverrideSourceFile( const AString & overrideSourceFile ) { m_OverrideSourceFile= overrideSourceFile; }
+    void SetRemoteWorkingDir( const AString & remoteWorkingDir ) { m_RemoteWorkingDir = remoteWorkingDir; }
+    void SetHeaderBundleRoot( const AString & headerBundleRoot ) { m_HeaderBundleRoot = headerBundleRoot; }
 
     // Manipulate args if needed for various compilation modes
     virtual bool ProcessArg_PreprocessorOnly( const AString & token,
@@ -43,6 +45,10 @@ public:
     virtual bool ProcessArg_Common( const AString & token,
                                     size_t & index,
                                     Args & outFullArgs ) const;
+    virtual bool ProcessArg_CompileHeaderBundle( const AString & token,
+                                                 size_t & index,
+                                                 const AString & nextToken,
+                                                 Args & outFullArgs ) const;
 
     // Inject build-time substitutions (%1 etc)
     virtual bool ProcessArg_BuildTimeSubstitution( const AString & token,
@@ -69,12 +75,25 @@ protected:
                             const AString & token,
                             bool allowStartsWith = false );
 
+    // Source mapping
+    static void GetSourceMappingArg( const AString & fromPath,
+                                     const AString & toPath,
+                                     AString & outArg );
+    static bool GetSourceMappingFromArg( const AString & token,
+                                         const AString & fromPath,
+                                         AString & outToPath );
+    bool ProcessArg_RemoteSourceMapping( const AString & token,
+                                         const char * argPrefix,
+                                         Args & outFullArgs ) const;
+
     const ObjectNode *  m_ObjectNode                = nullptr;
     bool                m_ForceColoredDiagnostics   = false;
     AString             m_SourceMapping;
     AString             m_RelativeBasePath;
     AString             m_OverrideSourceFile;
     AString             m_RemoteSourceRoot;
+    AString             m_RemoteWorkingDir;
+    AString             m_HeaderBundleRoot;
 };
 
 //------------------------------------------------------------------------------
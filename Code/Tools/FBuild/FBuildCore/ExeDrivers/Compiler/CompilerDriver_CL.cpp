@@ -88,6 +88,15 @@ CompilerDriver_CL::~CompilerDriver_CL() = default;
         }
     }
 
+    // Extend source mapping to paths on this machine
+    if ( m_IsClangCL && ( isLocal == false ) )
+    {
+        if ( ProcessArg_RemoteSourceMapping( token, "-Xclang", outFullArgs ) )
+        {
+            return true;
+        }
+    }
+
     // NOTE: Leave /I includes for compatibility with Recode
     // (unlike Clang, MSVC is ok with leaving the /I when compiling preprocessed code)
 
@@ -271,19 +280,33 @@ CompilerDriver_CL::~CompilerDriver_CL() = default;
     {
         if ( ( m_SourceMapping.IsEmpty() == false ) && isLocal )
         {
-            const AString& workingDir = FBuild::Get().GetOptions().GetWorkingDir();
-            AStackString<> tmp;
-            // Using -ffile-prefix-map would be better since that would change not only the file paths in
-            // the DWARF debugging information but also in the __FILE__ and related predefined macros, but
-            // -ffile-prefix-map is only supported starting with GCC 8 and Clang 10. The -fdebug-prefix-map
-            // option is available starting with Clang 3.8 and all modern GCC versions.
-            tmp = " -Xclang "; // When clang is operating in "CL mode", it seems to need the -Xclang prefix for the command
-            tmp.AppendFormat(" \"-fdebug-prefix-map=%s=%s\"", workingDir.Get(), m_SourceMapping.Get());
-            outFullArgs += tmp;
+            AStackString<> mappingArg;
+            GetSourceMappingArg( FBuild::Get().GetOptions().GetWorkingDir(), m_SourceMapping, mappingArg );
+            outFullArgs.AddDelimiter();
+            outFullArgs += "-Xclang"; // When clang is operating in "CL mode", it seems to need the -Xclang prefix for the command
+            outFullArgs.AddDelimiter();
+            outFullArgs += mappingArg;
         }
     }
 }
 
+// AddAdditionalArgs_PreparePreprocessedForRemote
+//------------------------------------------------------------------------------
+/*virtual*/ void CompilerDriver_CL::AddAdditionalArgs_PreparePreprocessedForRemote( Args & outFullArgs )
+{
+    // Forward source mapping for paths in the working dir (the worker extends this
+    // to its own paths)
+    if ( m_IsClangCL && ( m_SourceMapping.IsEmpty() == false ) )
+    {
+        AStackString<> mappingArg;
+        GetSourceMappingArg( FBuild::Get().GetOptions().GetWorkingDir(), m_SourceMapping, mappingArg );
+        outFullArgs += "-Xclang";
+        outFullArgs.AddDelimiter();
+        outFullArgs += mappingArg;
+        outFullArgs.AddDelimiter();
+    }
+}
+
 
 // ProcessArg_PreparePreprocessedForRemote
 //------------------------------------------------------------------------------
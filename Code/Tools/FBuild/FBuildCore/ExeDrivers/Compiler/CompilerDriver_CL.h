@@ -47,6 +47,7 @@ protected:
                                                           size_t & index,
                                                           const AString & nextToken,
                                                           Args & outFullArgs ) const override;
+    virtual void AddAdditionalArgs_PreparePreprocessedForRemote( Args & outFullArgs ) override;
 
     static bool IsCompilerArg_MSVC( const AString & token, const char * arg );
     static bool IsStartOfCompilerArg_MSVC( const AString & token, const char * arg );
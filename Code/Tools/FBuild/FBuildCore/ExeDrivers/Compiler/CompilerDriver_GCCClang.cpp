@@ -10,8 +10,12 @@
 #include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderBundle.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 
+// Core
+#include "Core/FileIO/PathUtils.h"
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 CompilerDriver_GCCClang::CompilerDriver_GCCClang( bool isClang )
@@ -124,6 +128,15 @@ CompilerDriver_GCCClang::~CompilerDriver_GCCClang() = default;
         return true;
     }
 
+    // Extend source mapping to paths on this machine
+    if ( isLocal == false )
+    {
+        if ( ProcessArg_RemoteSourceMapping( token, nullptr, outFullArgs ) )
+        {
+            return true;
+        }
+    }
+
     return false;
 }
 
@@ -146,6 +159,51 @@ CompilerDriver_GCCClang::~CompilerDriver_GCCClang() = default;
     return CompilerDriverBase::ProcessArg_Common( token, index, outFullArgs );
 }
 
+// ProcessArg_CompileHeaderBundle
+//------------------------------------------------------------------------------
+/*virtual*/ bool CompilerDriver_GCCClang::ProcessArg_CompileHeaderBundle( const AString & token,
+                                                                          size_t & index,
+                                                                          const AString & nextToken,
+                                                                          Args & outFullArgs ) const
+{
+    // The original source is compiled, so undo any -x language update made
+    // by the client for compiling preprocessed output
+    if ( ( token == "-x" ) && ( nextToken.IsEmpty() == false ) )
+    {
+        outFullArgs += token;
+        outFullArgs.AddDelimiter();
+
+        const AString & language = nextToken;
+        ++index; // consume extra arg
+        if ( language == "cpp-output" )
+        {
+            outFullArgs += "c";
+        }
+        else if ( language.EndsWith( "-cpp-output" ) )
+        {
+            outFullArgs += AStackString<>( language.Get(), language.GetEnd() - 11 ); // strlen( "-cpp-output" )
+        }
+        else
+        {
+            outFullArgs += language;
+        }
+        outFullArgs.AddDelimiter();
+        return true;
+    }
+
+    // Absolute include paths refer to the client, so are redirected to the sandbox
+    // (relative paths already resolve there)
+    if ( ProcessArg_HeaderBundleIncludePath( "-I", token, index, nextToken, outFullArgs ) ||
+         ProcessArg_HeaderBundleIncludePath( "-isystem", token, index, nextToken, outFullArgs ) ||
+         ProcessArg_HeaderBundleIncludePath( "-iquote", token, index, nextToken, outFullArgs ) ||
+         ProcessArg_HeaderBundleIncludePath( "-idirafter", token, index, nextToken, outFullArgs ) )
+    {
+        return true;
+    }
+
+    return false;
+}
+
 // AddAdditionalArgs_Preprocessor
 //------------------------------------------------------------------------------
 /*virtual*/ void CompilerDriver_GCCClang::AddAdditionalArgs_Preprocessor( Args & outFullArgs ) const
@@ -182,14 +240,21 @@ CompilerDriver_GCCClang::~CompilerDriver_GCCClang() = default;
     // Add args for source mapping
     if ( ( m_SourceMapping.IsEmpty() == false ) && isLocal )
     {
-        const AString& workingDir = FBuild::Get().GetOptions().GetWorkingDir();
-        AStackString<> tmp;
-        // Using -ffile-prefix-map would be better since that would change not only the file paths in
-        // the DWARF debugging information but also in the __FILE__ and related predefined macros, but
-        // -ffile-prefix-map is only supported starting with GCC 8 and Clang 10. The -fdebug-prefix-map
-        // option is available starting with Clang 3.8 and all modern GCC versions.
-        tmp.Format(" \"-fdebug-prefix-map=%s=%s\"", workingDir.Get(), m_SourceMapping.Get());
-        outFullArgs += tmp;
+        AStackString<> mappingArg;
+        GetSourceMappingArg( FBuild::Get().GetOptions().GetWorkingDir(), m_SourceMapping, mappingArg );
+        outFullArgs.AddDelimiter();
+        outFullArgs += mappingArg;
+    }
+
+    // Record paths in the debug info as they are on the client
+    if ( m_HeaderBundleRoot.IsEmpty() == false )
+    {
+        AStackString<> sandboxRoot( m_HeaderBundleRoot );
+        sandboxRoot.TrimEnd( NATIVE_SLASH );
+        AStackString<> mappingArg;
+        GetSourceMappingArg( sandboxRoot, AString::GetEmpty(), mappingArg );
+        outFullArgs.AddDelimiter();
+        outFullArgs += mappingArg;
     }
 }
 
@@ -215,6 +280,21 @@ CompilerDriver_GCCClang::~CompilerDriver_GCCClang() = default;
     return false;
 }
 
+// AddAdditionalArgs_PreparePreprocessedForRemote
+//------------------------------------------------------------------------------
+/*virtual*/ void CompilerDriver_GCCClang::AddAdditionalArgs_PreparePreprocessedForRemote( Args & outFullArgs )
+{
+    // Forward source mapping for paths in the working dir (the worker extends this
+    // to its own paths)
+    if ( m_SourceMapping.IsEmpty() == false )
+    {
+        AStackString<> mappingArg;
+        GetSourceMappingArg( FBuild::Get().GetOptions().GetWorkingDir(), m_SourceMapping, mappingArg );
+        outFullArgs += mappingArg;
+        outFullArgs.AddDelimiter();
+    }
+}
+
 // ProcessArg_XLanguageOption
 //------------------------------------------------------------------------------
 bool CompilerDriver_GCCClang::ProcessArg_XLanguageOption( const AString & token,
@@ -294,4 +374,64 @@ bool CompilerDriver_GCCClang::ProcessArg_DependencyOption( const AString & token
     return false;
 }
 
+// ProcessArg_HeaderBundleIncludePath
+//------------------------------------------------------------------------------
+bool CompilerDriver_GCCClang::ProcessArg_HeaderBundleIncludePath( const char * option,
+                                                                  const AString & token,
+                                                                  size_t & index,
+                                                                  const AString & nextToken,
+                                                                  Args & outFullArgs ) const
+{
+    // Handle quoted args
+    const char * pos = token.Get();
+    const char * end = token.GetEnd();
+    if ( ( token.GetLength() > 2 ) && ( *pos == '"' ) && ( end[ -1 ] == '"' ) )
+    {
+        ++pos;
+        --end;
+    }
+
+    // Path is either attached or the next token
+    AStackString<> path;
+    const AStackString<> unquotedToken( pos, end );
+    const bool separateArg = ( unquotedToken == option );
+    if ( separateArg )
+    {
+        path = nextToken;
+    }
+    else if ( unquotedToken.BeginsWith( option ) )
+    {
+        path = ( unquotedToken.Get() + AString::StrLen( option ) );
+    }
+    else
+    {
+        return false;
+    }
+    if ( ( path.GetLength() > 2 ) && path.BeginsWith( '"' ) && path.EndsWith( '"' ) )
+    {
+        path.Assign( path.Get() + 1, path.GetEnd() - 1 );
+    }
+    if ( ( path.IsEmpty() ) || ( PathUtils::IsFullPath( path ) == false ) )
+    {
+        return false;
+    }
+
+    if ( separateArg )
+    {
+        ++index; // consume extra arg
+    }
+
+    AStackString<> sandboxPath;
+    if ( HeaderBundle::GetSandboxPath( m_HeaderBundleRoot, path, sandboxPath ) == false )
+    {
+        return true; // Dropped, as no headers can be extracted outside the sandbox
+    }
+    outFullArgs += '"';
+    outFullArgs += option;
+    outFullArgs += sandboxPath;
+    outFullArgs += '"';
+    outFullArgs.AddDelimiter();
+    return true;
+}
+
 //------------------------------------------------------------------------------
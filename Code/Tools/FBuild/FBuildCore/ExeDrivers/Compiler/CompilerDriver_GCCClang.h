@@ -34,6 +34,10 @@ public:
     virtual bool ProcessArg_Common( const AString & token,
                                     size_t & index,
                                     Args & outFullArgs ) const override;
+    virtual bool ProcessArg_CompileHeaderBundle( const AString & token,
+                                                 size_t & index,
+                                                 const AString & nextToken,
+                                                 Args & outFullArgs ) const override;
 
     virtual void AddAdditionalArgs_Preprocessor( Args & outFullArgs ) const override;
     virtual void AddAdditionalArgs_Common( bool isLocal,
@@ -44,6 +48,7 @@ public:
                                                           size_t & index,
                                                           const AString & nextToken,
                                                           Args & outFullArgs ) const override;
+    virtual void AddAdditionalArgs_PreparePreprocessedForRemote( Args & outFullArgs ) override;
 
 protected:
     // Helpers
@@ -53,6 +58,11 @@ protected:
                                      Args & outFullArgs ) const;
     bool ProcessArg_DependencyOption( const AString & token,
                                       size_t & index ) const;
+    bool ProcessArg_HeaderBundleIncludePath( const char * option,
+                                             const AString & token,
+                                             size_t & index,
+                                             const AString & nextToken,
+                                             Args & outFullArgs ) const;
 
     bool m_IsClang = false;
 };
@@ -10,14 +10,17 @@
 #include "BFF/Functions/Function.h"
 #include "Cache/ICache.h"
 #include "Cache/Cache.h"
+#include "Cache/CacheDictionaries.h"
 #include "Cache/CachePlugin.h"
 #include "Cache/LightCache.h"
+#include "Graph/CompilerNode.h"
 #include "Graph/Node.h"
 #include "Graph/NodeGraph.h"
 #include "Graph/NodeProxy.h"
 #include "Graph/SettingsNode.h"
 #include "Helpers/BuildProfiler.h"
 #include "Helpers/CompilationDatabase.h"
+#include "Helpers/CPUPlacement.h"
 #include "Protocol/Client.h"
 #include "Protocol/Protocol.h"
 #include "WorkerPool/JobQueue.h"
@@ -100,6 +103,12 @@ FBuild::FBuild( const FBuildOptions & options )
         FNEW( BuildProfiler );
     }
 
+    if ( options.m_CPUPinning )
+    {
+        CPUPlacement * placement = FNEW( CPUPlacement );
+        placement->DetectTopology();
+    }
+
     Function::Create();
 
     NetworkStartupHelper::SetMainShutdownFlag( &s_AbortBuild );
@@ -117,6 +126,7 @@ FBuild::~FBuild()
     FDELETE m_Client;
     FREE( m_EnvironmentString );
 
+    FDELETE m_CacheDictionaries;
     if ( m_Cache )
     {
         m_Cache->Shutdown();
@@ -138,6 +148,11 @@ FBuild::~FBuild()
     }
 
     FDELETE m_ThreadPool;
+
+    if ( CPUPlacement::IsValid() )
+    {
+        FDELETE( &CPUPlacement::Get() );
+    }
 }
 
 // Initialize
@@ -203,7 +218,7 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         }
         else
         {
-            m_Cache = FNEW( Cache() );
+            m_Cache = FNEW( Cache( m_Options.m_CacheChunked ) );
         }
 
         if ( m_Cache->Init( settings->GetCachePath(),
@@ -218,6 +233,10 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
             FDELETE m_Cache;
             m_Cache = nullptr;
         }
+        else
+        {
+            m_CacheDictionaries = FNEW( CacheDictionaries( *m_Cache, m_Options.m_CacheVerbose ) );
+        }
     }
 
     return true;
@@ -394,8 +413,25 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
         Array< AString > workers( settings->GetWorkerList() );
         if ( workers.IsEmpty() )
         {
+            // Toolchains used by the previous build, so workers which already
+            // have them can be preferred
+            Array< uint64_t > toolIds;
+            const size_t numNodes = m_DependencyGraph->GetNodeCount();
+            for ( size_t i = 0; i < numNodes; ++i )
+            {
+                const Node * node = m_DependencyGraph->GetNodeByIndex( i );
+                if ( node->GetType() == Node::COMPILER_NODE )
+                {
+                    const uint64_t toolId = node->CastTo< CompilerNode >()->GetManifest().GetToolId();
+                    if ( toolId != 0 )
+                    {
+                        toolIds.Append( toolId );
+                    }
+                }
+            }
+
             // check for workers through brokerage or environment
-            m_WorkerBrokerage.FindWorkers( workers );
+            m_WorkerBrokerage.FindWorkers( workers, toolIds );
         }
 
         if ( workers.IsEmpty() )
@@ -460,6 +496,10 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
                     // free the network distribution system (if there is one)
                     {
                         MutexHolder mh( m_ClientLifetimeMutex );
+                        if ( m_Client )
+                        {
+                            m_Client->GetWorkerStats( m_BuildStats.m_WorkerStats );
+                        }
                         FDELETE m_Client;
                         m_Client = nullptr;
                     }
@@ -506,6 +546,10 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
         // wrap up/free any jobs that come from the last build pass
         m_JobQueue->FinalizeCompletedJobs( *m_DependencyGraph );
 
+        m_BuildStats.m_NumRacesStarted = m_JobQueue->GetNumRacesStarted();
+        m_BuildStats.m_NumRacesWonLocally = m_JobQueue->GetNumRacesWonLocally();
+        m_BuildStats.m_NumRacesWonRemotely = m_JobQueue->GetNumRacesWonRemotely();
+
         FDELETE m_JobQueue;
         m_JobQueue = nullptr;
 
@@ -919,4 +963,35 @@ uint32_t FBuild::GetNumWorkerConnections() const
     return (uint32_t)( m_Client ? m_Client->GetNumConnections() : 0 );
 }
 
+// FindCacheToolChainKey
+//------------------------------------------------------------------------------
+bool FBuild::FindCacheToolChainKey( uint64_t toolsHash, uint64_t & outKey ) const
+{
+    MutexHolder mh( m_CacheToolChainKeysMutex );
+    for ( const CacheToolChainKey & key : m_CacheToolChainKeys )
+    {
+        if ( key.m_ToolsHash == toolsHash )
+        {
+            outKey = key.m_Key;
+            return true;
+        }
+    }
+    return false;
+}
+
+// AddCacheToolChainKey
+//------------------------------------------------------------------------------
+void FBuild::AddCacheToolChainKey( uint64_t toolsHash, uint64_t key )
+{
+    MutexHolder mh( m_CacheToolChainKeysMutex );
+    for ( const CacheToolChainKey & existing : m_CacheToolChainKeys )
+    {
+        if ( existing.m_ToolsHash == toolsHash )
+        {
+            return; // Another thread computed it at the same time
+        }
+    }
+    m_CacheToolChainKeys.Append( CacheToolChainKey{ toolsHash, key } );
+}
+
 //------------------------------------------------------------------------------
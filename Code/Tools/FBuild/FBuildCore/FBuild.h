@@ -22,6 +22,7 @@
 class Client;
 class Dependencies;
 class FileStream;
+class CacheDictionaries;
 class ICache;
 class MemoryStream;
 class JobQueue;
@@ -106,6 +107,7 @@ public:
     static inline volatile bool * GetAbortBuildPointer() { return &s_AbortBuild; }
 
     inline ICache * GetCache() const { return m_Cache; }
+    inline CacheDictionaries * GetCacheDictionaries() const { return m_CacheDictionaries; }
 
     static bool GetTempDir( AString & outTempDir );
 
@@ -114,6 +116,10 @@ public:
 
     uint32_t GetNumWorkerConnections() const;
 
+    // Tool chain keys for caching, computed once per set of tools (see Node::GetCacheToolChainKey)
+    bool FindCacheToolChainKey( uint64_t toolsHash, uint64_t & outKey ) const;
+    void AddCacheToolChainKey( uint64_t toolsHash, uint64_t key );
+
 protected:
     bool GetTargets( const Array< AString > & targets, Dependencies & outDeps ) const;
 
@@ -130,6 +136,7 @@ protected:
 
     AString m_DependencyGraphFile;
     ICache * m_Cache;
+    CacheDictionaries * m_CacheDictionaries = nullptr;
 
     Timer m_Timer;
     float m_LastProgressOutputTime;
@@ -153,6 +160,14 @@ protected:
     Array< EnvironmentVarAndHash > m_ImportedEnvironmentVars;
     BFFFileExists m_FileExistsInfo;
     BFFUserFunctions m_UserFunctions;
+
+    struct CacheToolChainKey
+    {
+        uint64_t    m_ToolsHash;
+        uint64_t    m_Key;
+    };
+    mutable Mutex m_CacheToolChainKeysMutex;
+    Array< CacheToolChainKey > m_CacheToolChainKeys;
 };
 
 //------------------------------------------------------------------------------
@@ -126,6 +126,27 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_UseCacheWrite = true;
                 continue;
             }
+            else if ( thisArg == "-cachechunked" )
+            {
+                m_CacheChunked = true;
+                continue;
+            }
+            else if ( thisArg == "-cachediagnose" )
+            {
+                m_UseCacheRead = true;
+                m_CacheDiagnose = true;
+                continue;
+            }
+            else if ( thisArg == "-cachediagnostics" )
+            {
+                m_CacheDiagnostics = true;
+                continue;
+            }
+            else if ( thisArg == "-cachedictionary" )
+            {
+                m_CacheDictionary = true;
+                continue;
+            }
             else if ( thisArg == "-cacheinfo" )
             {
                 m_CacheInfo = true;
@@ -148,6 +169,23 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += argv[ sizeIndex ];
                 continue;
             }
+            else if ( thisArg == "-cacheuncompressed" )
+            {
+                const int sizeIndex = ( i + 1 );
+                if ( ( sizeIndex >= argc ) ||
+                     ( AString::ScanS( argv[ sizeIndex ], "%u", &m_CacheUncompressedMinSizeMiB ) ) != 1 )
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <sizeMiB> for '-cacheuncompressed' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
             else if ( thisArg == "-cacheverbose" )
             {
                 m_CacheVerbose = true;
@@ -222,6 +260,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += '"';
                 continue;
             }
+            else if ( thisArg == "-cpupinning" )
+            {
+                m_CPUPinning = true;
+                continue;
+            }
             else if ( thisArg == "-dbfile" )
             {
                 const int32_t pathIndex = ( i + 1 );
@@ -253,6 +296,12 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_AllowDistributed = true;
                 continue;
             }
+            else if ( thisArg == "-distbackground" )
+            {
+                m_AllowDistributed = true;
+                m_DistBackground = true;
+                continue;
+            }
             else if ( thisArg == "-distverbose" )
             {
                 m_AllowDistributed = true;
@@ -630,23 +679,37 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "Options:\n"
             " -cache[read|write]\n"
             "                   Control use of the build cache.\n"
+            " -cachechunked     Store cache entries as chunks shared between entries with\n"
+            "                   similar content. Entries are readable in either mode.\n"
             " -cachecompressionlevel <level>\n"
             "                   Control compression for cache artifacts (default: -1)\n"
             "                   - <= -1 : less compression, with -128 being the lowest\n"
             "                   - ==  0 : disable compression\n"
             "                   - >=  1 : more compression, with 12 being the highest\n"
+            " -cachediagnose    Read from the cache and explain each cache miss by\n"
+            "                   comparing with the most recent -cachediagnostics record.\n"
+            " -cachediagnostics Store diagnostic records alongside cache entries.\n"
+            " -cachedictionary  Compress cache entries with Zstd, using dictionaries built\n"
+            "                   from earlier entries for the same toolchain.\n"
             " -cacheinfo        Output cache statistics.\n"
             " -cachetrim <size> Trim the cache to the given size in MiB.\n"
+            " -cacheuncompressed <size>\n"
+            "                   Store cache entries of at least <size> MiB without\n"
+            "                   compression, so hits can be copied (or cloned) into place.\n"
             " -cacheverbose     Emit details about cache interactions.\n"
             " -clean            Force a clean build.\n"
             " -compdb           Generate JSON compilation database for targets.\n"
             " -config <path>    Explicitly specify the config file to use.\n"
             " -continueafterdbmove\n"
             "       Allow builds after a DB move.\n"
+            " -cpupinning       (Linux) Pin each job to the least loaded group of CPUs\n"
+            "                   sharing a NUMA node and L3 cache.\n"
             " -dbfile <path>    Explicitly specify the dependency database file to use.\n"
             " -debug            (Windows) Break at startup, to attach debugger.\n"
             " -dist             Allow distributed compilation.\n"
             " -distverbose      Print detailed info for distributed compilation.\n"
+            " -distbackground   Allow distributed compilation, at a lower priority than\n"
+            "                   interactive builds sharing the same workers (e.g. for CI).\n"
             " -distcompressionlevel\n"
             "                   Control distributed compilation compression (default: -1)\n"
             "                   - <= -1 : less compression, with -128 being the lowest\n"
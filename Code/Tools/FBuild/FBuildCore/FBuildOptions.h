@@ -61,18 +61,25 @@ public:
     bool        m_GenerateDotGraphFull              = false;
     bool        m_GenerateCompilationDatabase       = false;
     bool        m_NoUnity                           = false;
+    bool        m_CPUPinning                        = false;
 
     // Cache
     bool        m_UseCacheRead                      = false;
     bool        m_UseCacheWrite                     = false;
     bool        m_CacheInfo                         = false;
     bool        m_CacheVerbose                      = false;
+    bool        m_CacheDiagnostics                  = false; // Store diagnostic records with cache entries
+    bool        m_CacheDiagnose                     = false; // Explain cache misses using diagnostic records
+    bool        m_CacheDictionary                   = false; // Compress cache entries using per-toolchain dictionaries
+    bool        m_CacheChunked                      = false; // Store cache entries as deduplicated content-defined chunks
     uint32_t    m_CacheTrim                         = 0;
+    uint32_t    m_CacheUncompressedMinSizeMiB       = 0; // Store entries at least this large without compression (0 = disabled)
     int16_t     m_CacheCompressionLevel             = -1; // See Compresssor.h
 
     // Distributed Compilation
     bool        m_AllowDistributed                  = false;
     bool        m_DistVerbose                       = false;
+    bool        m_DistBackground                    = false; // Lower priority on shared workers
     bool        m_NoLocalConsumptionOfRemoteJobs    = false;
     bool        m_AllowLocalRace                    = true;
     uint16_t    m_DistributionPort                  = Protocol::PROTOCOL_PORT;
@@ -32,6 +32,7 @@ REFLECT_NODE_BEGIN( CompilerNode, Node, MetaNone() )
     REFLECT( m_CompilerFamilyString,"CompilerFamily",       MetaOptional() )
     REFLECT_ARRAY( m_Environment,   "Environment",          MetaOptional() )
     REFLECT( m_UseLightCache,       "UseLightCache_Experimental", MetaOptional() )
+    REFLECT( m_UseHeaderBundles,    "UseHeaderBundles_Experimental", MetaOptional() )
     REFLECT( m_UseRelativePaths,    "UseRelativePaths_Experimental", MetaOptional() )
     REFLECT( m_SourceMapping,       "SourceMapping_Experimental", MetaOptional() )
 
@@ -55,6 +56,7 @@ CompilerNode::CompilerNode()
     , m_CompilerFamilyEnum( static_cast< uint8_t >( CUSTOM ) )
     , m_SimpleDistributionMode( false )
     , m_UseLightCache( false )
+    , m_UseHeaderBundles( false )
     , m_UseRelativePaths( false )
     , m_EnvironmentString( nullptr )
 {
@@ -140,6 +142,14 @@ CompilerNode::CompilerNode()
         return false;
     }
 
+    // Header bundles are only compatible with GCC/Clang for now
+    // - the worker needs to know how include paths are specified to mirror them
+    if ( m_UseHeaderBundles && ( m_CompilerFamilyEnum != GCC ) && ( m_CompilerFamilyEnum != CLANG ) )
+    {
+        Error::Error_1505_HeaderBundlesIncompatibleWithCompiler( iter, function );
+        return false;
+    }
+
     m_Manifest.Initialize( m_ExecutableRootPath, m_StaticDependencies, m_CustomEnvironmentVariables );
 
     return true;
@@ -10,10 +10,16 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ExecBundle.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 
+#include "Core/Containers/Move.h"
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/FileIO/PathUtils.h"
 #include "Core/Math/Conversions.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Process/Process.h"
@@ -35,11 +41,14 @@ REFLECT_NODE_BEGIN( ExecNode, Node, MetaName( "ExecOutput" ) + MetaFile() )
     REFLECT(        m_ExecAlwaysShowOutput,     "ExecAlwaysShowOutput",     MetaOptional() )
     REFLECT(        m_ExecUseStdOutAsOutput,    "ExecUseStdOutAsOutput",    MetaOptional() )
     REFLECT(        m_ExecAlways,               "ExecAlways",               MetaOptional() )
+    REFLECT(        m_ExecCacheable,            "ExecCacheable",            MetaOptional() )
+    REFLECT(        m_ExecAllowDistribution,    "ExecAllowDistribution",    MetaOptional() )
     REFLECT_ARRAY(  m_PreBuildDependencyNames,  "PreBuildDependencies",     MetaOptional() + MetaFile() + MetaAllowNonFile() )
     REFLECT_ARRAY(  m_Environment,              "Environment",              MetaOptional() )
 
     // Internal State
     REFLECT(        m_NumExecInputFiles,        "NumExecInputFiles",        MetaHidden() )
+    REFLECT_STRUCT( m_Manifest,                 "Manifest", ToolManifest,   MetaHidden() + MetaIgnoreForComparison() )
 REFLECT_END( ExecNode )
 
 // CONSTRUCTOR
@@ -51,6 +60,8 @@ ExecNode::ExecNode()
     , m_ExecUseStdOutAsOutput( false )
     , m_ExecAlways( false )
     , m_ExecInputPathRecurse( true )
+    , m_ExecCacheable( false )
+    , m_ExecAllowDistribution( false )
     , m_NumExecInputFiles( 0 )
 {
     m_Type = EXEC_NODE;
@@ -109,6 +120,18 @@ ExecNode::ExecNode()
     m_StaticDependencies.Add( execInputFiles );
     m_StaticDependencies.Add( execInputPaths );
 
+    // The executable is synchronized to workers like a compiler, from the
+    // directory it is in
+    const AString & executableName = executable[ 0 ].GetNode()->GetName();
+    const char * lastSlash = executableName.FindLast( NATIVE_SLASH );
+    AStackString<> executableRoot;
+    if ( lastSlash )
+    {
+        executableRoot.Assign( executableName.Get(), lastSlash + 1 );
+    }
+    const Array< AString > customEnvironmentVariables; // Environment is sent with each job
+    m_Manifest.Initialize( executableRoot, executable, customEnvironmentVariables );
+
     return true;
 }
 
@@ -176,20 +199,127 @@ ExecNode::~ExecNode()
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult ExecNode::DoBuild( Job * job )
 {
-    // If the workingDir is empty, use the current dir for the process
-    const char * workingDir = m_ExecWorkingDir.IsEmpty() ? nullptr : m_ExecWorkingDir.Get();
-
     // Format compiler args string
+    Array< AString > inputFiles;
+    GetInputFileNames( inputFiles );
+    AStackString< 4 * KILOBYTE > fullArgs;
+    GetFullArgs( inputFiles, fullArgs );
+
+    // Try to retrieve the output from the cache
+    AStackString<> cacheId;
+    Array< AString > cacheFileNames( 1, false );
+    cacheFileNames.EmplaceBack( GetName() );
+    const bool useCache = ShouldUseCache() && GetCacheId( fullArgs, cacheId );
+    if ( useCache && RetrieveOutputsFromCache( job, cacheId, cacheFileNames ) )
+    {
+        return NODE_RESULT_OK_CACHE;
+    }
+    if ( useCache )
+    {
+        job->SetCacheName( cacheId ); // Output is written to the cache wherever it is built
+    }
+
+    // Can we do the work remotely?
+    if ( CanDistribute() && PrepareForDistribution( job, inputFiles ) )
+    {
+        return NODE_RESULT_NEED_SECOND_BUILD_PASS;
+    }
+
+    return RunLocal( job, fullArgs );
+}
+
+// DoBuild2
+//------------------------------------------------------------------------------
+/*virtual*/ Node::BuildResult ExecNode::DoBuild2( Job * job, bool /*racingRemoteJob*/ )
+{
+    if ( job->IsLocal() == false )
+    {
+        return DoBuildRemote( job );
+    }
+
+    // Building a distributable job locally
+    Array< AString > inputFiles;
+    GetInputFileNames( inputFiles );
     AStackString< 4 * KILOBYTE > fullArgs;
-    GetFullArgs(fullArgs);
+    GetFullArgs( inputFiles, fullArgs );
+    return RunLocal( job, fullArgs );
+}
+
+// RunLocal
+//------------------------------------------------------------------------------
+Node::BuildResult ExecNode::RunLocal( Job * job, const AString & fullArgs )
+{
+    // If the workingDir is empty, use the current dir for the process
+    const char * workingDir = m_ExecWorkingDir.IsEmpty() ? nullptr : m_ExecWorkingDir.Get();
 
     const char * environment = Node::GetEnvironmentString( m_Environment, m_EnvironmentString );
 
     EmitCompilationMessage( fullArgs );
 
+    return RunExecutable( job, GetExecutable()->GetName().Get(), fullArgs, workingDir, environment );
+}
+
+// DoBuildRemote
+//------------------------------------------------------------------------------
+Node::BuildResult ExecNode::DoBuildRemote( Job * job )
+{
+    // Write the inputs to a sandbox mirroring their paths on the client
+    ExecBundle bundle;
+    AStackString<> error;
+    if ( ( bundle.Load( *job ) == false ) || ( bundle.Extract( error ) == false ) )
+    {
+        job->Error( "Failed to prepare inputs. %s Target: '%s'", error.Get(), GetName().Get() );
+        job->OnSystemError();
+        return NODE_RESULT_FAILED;
+    }
+    job->OwnData( nullptr, 0 ); // Inputs are no longer needed (and must not be returned)
+
+    Array< AString > inputFiles( bundle.GetInputFiles().GetSize(), false );
+    for ( const AString & inputFile : bundle.GetInputFiles() )
+    {
+        VERIFY( bundle.GetSandboxPath( inputFile, inputFiles.EmplaceBack() ) ); // Checked by Extract
+    }
+
+    // Relative paths must resolve as they would on the client
+    AStackString<> workingDir;
+    const AString & clientWorkingDir = m_ExecWorkingDir.IsEmpty() ? job->GetRemoteSourceRoot() : m_ExecWorkingDir;
+    if ( bundle.GetSandboxPath( clientWorkingDir, workingDir ) == false )
+    {
+        job->Error( "Invalid working dir: '%s' Target: '%s'", clientWorkingDir.Get(), GetName().Get() );
+        job->OnSystemError();
+        return NODE_RESULT_FAILED;
+    }
+    if ( FileIO::EnsurePathExists( workingDir ) == false )
+    {
+        job->Error( "Failed to create working dir. Error: %s Dir: '%s'", LAST_ERROR_STR, workingDir.Get() );
+        job->OnSystemError();
+        return NODE_RESULT_FAILED;
+    }
+
+    // Use the synchronized executable
+    AStackString<> executable;
+    job->GetToolManifest()->GetRemoteFilePath( 0, executable );
+    const char * environment = m_Environment.IsEmpty() ? job->GetToolManifest()->GetRemoteEnvironmentString()
+                                                        : Node::GetEnvironmentString( m_Environment, m_EnvironmentString );
+
+    // Output is written to a temp file (see JobQueueRemote::DoBuild)
+    AStackString< 4 * KILOBYTE > fullArgs;
+    GetFullArgs( inputFiles, fullArgs );
+
+    return RunExecutable( job, executable.Get(), fullArgs, workingDir.Get(), environment );
+}
+
+// RunExecutable
+//------------------------------------------------------------------------------
+Node::BuildResult ExecNode::RunExecutable( Job * job,
+                                           const char * executable,
+                                           const AString & fullArgs,
+                                           const char * workingDir,
+                                           const char * environment )
+{
     // spawn the process
-    Process p( FBuild::Get().GetAbortBuildPointer() );
-    const bool spawnOK = p.Spawn( GetExecutable()->GetName().Get(),
+    Process p( FBuild::GetAbortBuildPointer(), job->GetAbortFlagPointer() );
+    const bool spawnOK = p.Spawn( executable,
                             fullArgs.Get(),
                             workingDir,
                             environment );
@@ -201,7 +331,11 @@ ExecNode::~ExecNode()
             return NODE_RESULT_FAILED;
         }
 
-        FLOG_ERROR( "Failed to spawn process for '%s'", GetName().Get() );
+        job->Error( "Failed to spawn process for '%s'", GetName().Get() );
+        if ( job->IsLocal() == false )
+        {
+            job->OnSystemError(); // Problem with the worker
+        }
         return NODE_RESULT_FAILED;
     }
 
@@ -219,9 +353,10 @@ ExecNode::~ExecNode()
     const bool buildFailed = ( result != m_ExecReturnCode );
 
     // Print output if appropriate
+    // (workers have no options, so the client includes them in m_ExecAlwaysShowOutput)
     if ( buildFailed ||
         m_ExecAlwaysShowOutput ||
-        FBuild::Get().GetOptions().m_ShowCommandOutput )
+        ( FBuild::IsValid() && FBuild::Get().GetOptions().m_ShowCommandOutput ) )
     {
         Node::DumpOutput( job, memOut );
         Node::DumpOutput( job, memErr );
@@ -230,7 +365,7 @@ ExecNode::~ExecNode()
     // did the executable fail?
     if ( buildFailed )
     {
-        FLOG_ERROR( "Execution failed. Error: %s Target: '%s'", ERROR_STR( result ), GetName().Get() );
+        job->Error( "Execution failed. Error: %s Target: '%s'", ERROR_STR( result ), GetName().Get() );
         return NODE_RESULT_FAILED;
     }
 
@@ -246,12 +381,134 @@ ExecNode::~ExecNode()
         f.Close();
     }
 
-    // record new file time
-    RecordStampFromBuiltFile();
+    // Remote output is returned to the client (see JobQueueRemote::ReadResults)
+    if ( job->IsLocal() )
+    {
+        if ( job->GetCacheName().IsEmpty() == false )
+        {
+            Array< AString > cacheFileNames( 1, false );
+            cacheFileNames.EmplaceBack( GetName() );
+            WriteOutputsToCache( job, job->GetCacheName(), cacheFileNames );
+        }
+
+        // record new file time
+        RecordStampFromBuiltFile();
+    }
 
     return NODE_RESULT_OK;
 }
 
+// ShouldUseCache
+//------------------------------------------------------------------------------
+bool ExecNode::ShouldUseCache() const
+{
+    // ExecAlways implies the result depends on more than the declared inputs
+    return m_ExecCacheable &&
+           ( m_ExecAlways == false ) &&
+           ( FBuild::Get().GetOptions().m_UseCacheRead ||
+             FBuild::Get().GetOptions().m_UseCacheWrite );
+}
+
+// GetCacheId
+//------------------------------------------------------------------------------
+bool ExecNode::GetCacheId( const AString & fullArgs, AString & outCacheId ) const
+{
+    // Command line, and everything else affecting how the executable is run
+    AStackString< 4 * KILOBYTE > commandLine( fullArgs );
+    commandLine.AppendFormat( "|%s|%i|%u|", m_ExecWorkingDir.Get(), m_ExecReturnCode, (uint32_t)m_ExecUseStdOutAsOutput );
+    for ( const AString & envVar : m_Environment )
+    {
+        commandLine += envVar;
+    }
+
+    // Inputs are the .ExecInput files and the files found in .ExecInputPath
+    Dependencies tools( 1 );
+    tools.Add( m_StaticDependencies[ 0 ].GetNode() );
+    return Node::GetCacheId( tools, m_StaticDependencies.Begin() + 1, m_StaticDependencies.End(), commandLine, outCacheId );
+}
+
+// CanDistribute
+//------------------------------------------------------------------------------
+bool ExecNode::CanDistribute() const
+{
+    // ExecAlways implies the result depends on more than the declared inputs
+    const bool belowMemoryLimit = ( ( Job::GetTotalLocalDataMemoryUsage() / MEGABYTE ) < FBuild::Get().GetSettings()->GetDistributableJobMemoryLimitMiB() );
+    return m_ExecAllowDistribution &&
+           ( m_ExecAlways == false ) &&
+           FBuild::Get().GetOptions().m_AllowDistributed &&
+           belowMemoryLimit;
+}
+
+// PrepareForDistribution
+//------------------------------------------------------------------------------
+bool ExecNode::PrepareForDistribution( Job * job, const Array< AString > & inputFiles )
+{
+    // Hash the executable to identify it on workers
+    Dependencies executable( 1 );
+    executable.Add( m_StaticDependencies[ 0 ].GetNode() );
+    if ( m_Manifest.DoBuild( executable ) == false )
+    {
+        return false; // Run locally, which will report the problem
+    }
+
+    // Inputs are sent with the job
+    ExecBundle bundle;
+    if ( bundle.Init( inputFiles ) == false )
+    {
+        return false; // Run locally, which will report the problem
+    }
+    bundle.Save( *job, FBuild::Get().GetOptions().m_DistributionCompressionLevel );
+    return true;
+}
+
+// SaveRemote
+//------------------------------------------------------------------------------
+/*virtual*/ void ExecNode::SaveRemote( IOStream & stream ) const
+{
+    // Inputs are sent as the job data (see ExecBundle)
+    const bool alwaysShowOutput = m_ExecAlwaysShowOutput ||
+                                  ( FBuild::IsValid() && FBuild::Get().GetOptions().m_ShowCommandOutput );
+    stream.Write( m_Name );
+    stream.Write( m_ExecArguments );
+    stream.Write( m_ExecWorkingDir );
+    stream.Write( m_ExecReturnCode );
+    stream.Write( m_ExecUseStdOutAsOutput );
+    stream.Write( alwaysShowOutput );
+    stream.Write( m_Environment );
+}
+
+// LoadRemote
+//------------------------------------------------------------------------------
+/*static*/ Node * ExecNode::LoadRemote( IOStream & stream )
+{
+    AString name;
+    ExecNode * node = FNEW( ExecNode );
+    if ( ( stream.Read( name ) == false ) ||
+         ( stream.Read( node->m_ExecArguments ) == false ) ||
+         ( stream.Read( node->m_ExecWorkingDir ) == false ) ||
+         ( stream.Read( node->m_ExecReturnCode ) == false ) ||
+         ( stream.Read( node->m_ExecUseStdOutAsOutput ) == false ) ||
+         ( stream.Read( node->m_ExecAlwaysShowOutput ) == false ) ||
+         ( stream.Read( node->m_Environment ) == false ) )
+    {
+        FDELETE node;
+        return nullptr;
+    }
+    node->SetName( Move( name ) );
+    return node;
+}
+
+// Migrate
+//------------------------------------------------------------------------------
+/*virtual*/ void ExecNode::Migrate( const Node & oldNode )
+{
+    // Migrate Node level properties
+    Node::Migrate( oldNode );
+
+    // Migrate the timestamp/hash info stored for the executable in the ToolManifest
+    m_Manifest.Migrate( oldNode.CastTo< ExecNode >()->GetManifest() );
+}
+
 // EmitCompilationMessage
 //------------------------------------------------------------------------------
 void ExecNode::EmitCompilationMessage( const AString & args ) const
@@ -281,9 +538,33 @@ void ExecNode::EmitCompilationMessage( const AString & args ) const
     FLOG_OUTPUT( output );
 }
 
+// GetInputFileNames
+//------------------------------------------------------------------------------
+void ExecNode::GetInputFileNames( Array< AString > & outInputFiles ) const
+{
+    for ( size_t i=1; i < m_StaticDependencies.GetSize(); ++i ) // Note: Skip first dep (exectuable)
+    {
+        const Node * n = m_StaticDependencies[ i ].GetNode();
+
+        // Handle directory lists
+        if ( n->GetType() == Node::DIRECTORY_LIST_NODE )
+        {
+            const DirectoryListNode * dln = n->CastTo< DirectoryListNode >();
+            const Array< FileIO::FileInfo > & files = dln->GetFiles();
+            for ( const FileIO::FileInfo & file : files )
+            {
+                outInputFiles.Append( file.m_Name );
+            }
+            continue;
+        }
+
+        outInputFiles.Append( n->GetName() );
+    }
+}
+
 // GetFullArgs
 //------------------------------------------------------------------------------
-void ExecNode::GetFullArgs(AString & fullArgs) const
+void ExecNode::GetFullArgs( const Array< AString > & inputFiles, AString & fullArgs ) const
 {
     // split into tokens
     Array< AString > tokens(1024, true);
@@ -305,7 +586,7 @@ void ExecNode::GetFullArgs(AString & fullArgs) const
             }
 
             // concatenate files, unquoted
-            GetInputFiles(fullArgs, pre, AString::GetEmpty());
+            GetInputFiles(inputFiles, fullArgs, pre, AString::GetEmpty());
         }
         else if (token.EndsWith("\"%1\""))
         {
@@ -313,7 +594,7 @@ void ExecNode::GetFullArgs(AString & fullArgs) const
             AStackString<> pre(token.Get(), token.GetEnd() - 3); // 3 instead of 4 to include quote
 
             // concatenate files, quoted
-            GetInputFiles(fullArgs, pre, quote);
+            GetInputFiles(inputFiles, fullArgs, pre, quote);
         }
         else if (token.EndsWith("%2"))
         {
@@ -343,39 +624,17 @@ void ExecNode::GetFullArgs(AString & fullArgs) const
 
 // GetInputFiles
 //------------------------------------------------------------------------------
-void ExecNode::GetInputFiles(AString & fullArgs, const AString & pre, const AString & post) const
+void ExecNode::GetInputFiles( const Array< AString > & inputFiles, AString & fullArgs, const AString & pre, const AString & post ) const
 {
     bool first = true; // Handle comma separation
-    for ( size_t i=1; i < m_StaticDependencies.GetSize(); ++i ) // Note: Skip first dep (exectuable)
+    for ( const AString & inputFile : inputFiles )
     {
-        const Dependency & dep = m_StaticDependencies[ i ];
-        const Node * n = dep.GetNode();
-
-        // Handle directory lists
-        if ( n->GetType() == Node::DIRECTORY_LIST_NODE )
-        {
-            const DirectoryListNode * dln = n->CastTo< DirectoryListNode >();
-            const Array< FileIO::FileInfo > & files = dln->GetFiles();
-            for ( const FileIO::FileInfo & file : files )
-            {
-                if ( !first )
-                {
-                    fullArgs += ' ';
-                }
-                fullArgs += pre;
-                fullArgs += file.m_Name;
-                fullArgs += post;
-                first = false;
-            }
-            continue;
-        }
-
         if ( !first )
         {
             fullArgs += ' ';
         }
         fullArgs += pre;
-        fullArgs += dep.GetNode()->GetName();
+        fullArgs += inputFile;
         fullArgs += post;
         first = false;
     }
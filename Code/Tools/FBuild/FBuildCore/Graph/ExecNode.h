@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "FileNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Core/Containers/Array.h"
 
 // Forward Declarations
@@ -22,17 +23,41 @@ public:
 
     static inline Node::Type GetTypeS() { return Node::EXEC_NODE; }
 
+    // Distribution
+    inline const ToolManifest & GetManifest() const { return m_Manifest; }
+    static Node * LoadRemote( IOStream & stream );
+
 private:
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph ) override;
     virtual bool DetermineNeedToBuildStatic() const override;
     virtual BuildResult DoBuild( Job * job ) override;
+    virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob ) override;
+    virtual void Migrate( const Node & oldNode ) override;
+    virtual void SaveRemote( IOStream & stream ) const override;
+
+    BuildResult RunLocal( Job * job, const AString & fullArgs );
+    BuildResult DoBuildRemote( Job * job );
+    BuildResult RunExecutable( Job * job,
+                               const char * executable,
+                               const AString & fullArgs,
+                               const char * workingDir,
+                               const char * environment );
 
     const FileNode * GetExecutable() const { return m_StaticDependencies[0].GetNode()->CastTo< FileNode >(); }
-    void GetFullArgs(AString & fullArgs) const;
-    void GetInputFiles(AString & fullArgs, const AString & pre, const AString & post) const;
+    void GetInputFileNames( Array< AString > & outInputFiles ) const;
+    void GetFullArgs( const Array< AString > & inputFiles, AString & fullArgs ) const;
+    void GetInputFiles( const Array< AString > & inputFiles, AString & fullArgs, const AString & pre, const AString & post ) const;
 
     void EmitCompilationMessage( const AString & args ) const;
 
+    // Caching
+    bool ShouldUseCache() const;
+    bool GetCacheId( const AString & fullArgs, AString & outCacheId ) const;
+
+    // Distribution
+    bool CanDistribute() const;
+    bool PrepareForDistribution( Job * job, const Array< AString > & inputFiles );
+
     // Exposed Properties
     AString             m_ExecExecutable;
     Array< AString >    m_ExecInput;
@@ -48,11 +73,14 @@ private:
     bool                m_ExecUseStdOutAsOutput;
     bool                m_ExecAlways;
     bool                m_ExecInputPathRecurse;
+    bool                m_ExecCacheable;
+    bool                m_ExecAllowDistribution;
     Array< AString >    m_PreBuildDependencyNames;
     Array< AString >    m_Environment;
 
     // Internal State
     uint32_t            m_NumExecInputFiles;
+    ToolManifest        m_Manifest;
     mutable const char * m_EnvironmentString        = nullptr;
 };
 
@@ -35,6 +35,7 @@ REFLECT_NODE_BEGIN( LibraryNode, ObjectListNode, MetaName( "LibrarianOutput" ) +
     REFLECT_ARRAY( m_LibrarianAdditionalInputs, "LibrarianAdditionalInputs",    MetaOptional() + MetaFile() + MetaAllowNonFile( Node::OBJECT_LIST_NODE ) )
     REFLECT( m_LibrarianAllowResponseFile,      "LibrarianAllowResponseFile",   MetaOptional() )
     REFLECT( m_LibrarianForceResponseFile,      "LibrarianForceResponseFile",   MetaOptional() )
+    REFLECT( m_LibrarianAllowCaching,           "LibrarianAllowCaching",        MetaOptional() )
 
     REFLECT( m_NumLibrarianAdditionalInputs,    "NumLibrarianAdditionalInputs", MetaHidden() )
     REFLECT( m_LibrarianFlags,                  "LibrarianFlags",               MetaHidden() )
@@ -169,6 +170,16 @@ LibraryNode::~LibraryNode()
 
     const char * environment = Node::GetEnvironmentString( m_Environment, m_EnvironmentString );
 
+    // Try to retrieve the library from the cache
+    AStackString<> cacheId;
+    Array< AString > cacheFileNames( 1, false );
+    cacheFileNames.EmplaceBack( GetName() );
+    const bool useCache = ShouldUseCache() && GetCacheId( fullArgs, cacheId );
+    if ( useCache && RetrieveOutputsFromCache( job, cacheId, cacheFileNames ) )
+    {
+        return NODE_RESULT_OK_CACHE;
+    }
+
     EmitCompilationMessage( fullArgs );
 
     // spawn the process
@@ -227,12 +238,43 @@ LibraryNode::~LibraryNode()
         }
     }
 
+    if ( useCache )
+    {
+        WriteOutputsToCache( job, cacheId, cacheFileNames );
+    }
+
     // record new file time
     RecordStampFromBuiltFile();
 
     return NODE_RESULT_OK;
 }
 
+// ShouldUseCache
+//------------------------------------------------------------------------------
+bool LibraryNode::ShouldUseCache() const
+{
+    return m_LibrarianAllowCaching &&
+           ( FBuild::Get().GetOptions().m_UseCacheRead ||
+             FBuild::Get().GetOptions().m_UseCacheWrite );
+}
+
+// GetCacheId
+//------------------------------------------------------------------------------
+bool LibraryNode::GetCacheId( const Args & fullArgs, AString & outCacheId ) const
+{
+    // Command line, including the environment
+    AStackString< 4096 > commandLine( fullArgs.GetRawArgs() );
+    for ( const AString & envVar : m_Environment )
+    {
+        commandLine += envVar;
+    }
+
+    // Inputs are the objects, and anything else merged in
+    Dependencies tools( 1 );
+    tools.Add( m_StaticDependencies[ 0 ].GetNode() );
+    return Node::GetCacheId( tools, m_DynamicDependencies.Begin(), m_DynamicDependencies.End(), commandLine, outCacheId );
+}
+
 // BuildArgs
 //------------------------------------------------------------------------------
 bool LibraryNode::BuildArgs( Args & fullArgs ) const
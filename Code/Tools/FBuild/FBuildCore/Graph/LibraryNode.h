@@ -53,6 +53,10 @@ private:
 
     ArgsResponseFileMode GetResponseFileMode() const;
 
+    // Caching
+    bool ShouldUseCache() const;
+    bool GetCacheId( const Args & fullArgs, AString & outCacheId ) const;
+
     // Exposed Properties
     AString             m_Librarian;
     AString             m_LibrarianOptions;
@@ -62,6 +66,7 @@ private:
     Array< AString >    m_Environment;
     bool                m_LibrarianAllowResponseFile;
     bool                m_LibrarianForceResponseFile;
+    bool                m_LibrarianAllowCaching         = false;
 
     // Internal State
     uint32_t            m_NumLibrarianAdditionalInputs  = 0;
@@ -36,6 +36,7 @@ REFLECT_NODE_BEGIN( LinkerNode, Node, MetaName( "LinkerOutput" ) + MetaFile() )
     REFLECT( m_LinkerType,                      "LinkerType",                   MetaOptional() )
     REFLECT( m_LinkerAllowResponseFile,         "LinkerAllowResponseFile",      MetaOptional() )
     REFLECT( m_LinkerForceResponseFile,         "LinkerForceResponseFile",      MetaOptional() )
+    REFLECT( m_LinkerAllowCaching,              "LinkerAllowCaching",           MetaOptional() )
     REFLECT_ARRAY( m_Libraries,                 "Libraries",                    MetaFile() + MetaAllowNonFile() )
     REFLECT_ARRAY( m_Libraries2,                "Libraries2",                   MetaFile() + MetaAllowNonFile() + MetaOptional() )
     REFLECT_ARRAY( m_LinkerAssemblyResources,   "LinkerAssemblyResources",      MetaOptional() + MetaFile() + MetaAllowNonFile( Node::OBJECT_LIST_NODE ) )
@@ -213,6 +214,19 @@ LinkerNode::~LinkerNode()
 
     const char * environment = Node::GetEnvironmentString( m_Environment, m_EnvironmentString );
 
+    // Try to retrieve the outputs from the cache
+    AStackString<> cacheId;
+    Array< AString > cacheFileNames( 4, false );
+    const bool useCache = ShouldUseCache() && GetCacheId( fullArgs, cacheId );
+    if ( useCache )
+    {
+        GetCacheFilePaths( cacheFileNames );
+        if ( RetrieveOutputsFromCache( job, cacheId, cacheFileNames ) )
+        {
+            return NODE_RESULT_OK_CACHE;
+        }
+    }
+
     EmitCompilationMessage( fullArgs );
 
     // we retry if linker crashes
@@ -384,12 +398,126 @@ LinkerNode::~LinkerNode()
         // success!
     }
 
+    if ( useCache )
+    {
+        WriteOutputsToCache( job, cacheId, cacheFileNames );
+    }
+
     // record new file time
     RecordStampFromBuiltFile();
 
     return NODE_RESULT_OK;
 }
 
+// ShouldUseCache
+//------------------------------------------------------------------------------
+bool LinkerNode::ShouldUseCache() const
+{
+    // Incremental links depend on the previous output, so can't be cached
+    return m_LinkerAllowCaching &&
+           ( GetFlag( LINK_FLAG_INCREMENTAL ) == false ) &&
+           ( FBuild::Get().GetOptions().m_UseCacheRead ||
+             FBuild::Get().GetOptions().m_UseCacheWrite );
+}
+
+// GetCacheId
+//------------------------------------------------------------------------------
+bool LinkerNode::GetCacheId( const Args & fullArgs, AString & outCacheId ) const
+{
+    // Command line, including the things that are applied outside of it
+    AStackString< 4096 > commandLine( fullArgs.GetRawArgs() );
+    commandLine += m_LinkerStampExeArgs;
+    for ( const AString & envVar : m_Environment )
+    {
+        commandLine += envVar;
+    }
+
+    // Tools are the linker and stamp exe, and the inputs everything in between
+    const bool hasStampExe = ( m_LinkerStampExe.IsEmpty() == false );
+    Dependencies tools( 2 );
+    tools.Add( m_StaticDependencies[ 0 ].GetNode() );
+    if ( hasStampExe )
+    {
+        tools.Add( m_StaticDependencies.End()[ -1 ].GetNode() );
+    }
+    const Dependency * inputsBegin = m_StaticDependencies.Begin() + 1;
+    const Dependency * inputsEnd = m_StaticDependencies.End() - ( hasStampExe ? 1 : 0 );
+    return Node::GetCacheId( tools, inputsBegin, inputsEnd, commandLine, outCacheId );
+}
+
+// GetCacheFilePaths
+//------------------------------------------------------------------------------
+void LinkerNode::GetCacheFilePaths( Array< AString > & outFileNames ) const
+{
+    outFileNames.EmplaceBack( GetName() );
+
+    // Only MSVC links have outputs other than the primary one
+    if ( GetFlag( LINK_FLAG_MSVC ) == false )
+    {
+        return;
+    }
+
+    // Import library
+    if ( GetType() == Node::DLL_NODE )
+    {
+        AStackString<> importLibName;
+        CastTo< DLLNode >()->GetImportLibName( importLibName );
+        outFileNames.EmplaceBack( importLibName );
+    }
+    else if ( m_ImportLibName.IsEmpty() == false )
+    {
+        outFileNames.EmplaceBack( m_ImportLibName );
+    }
+
+    // PDB and map file, if requested
+    const char * lastDot = GetName().FindLast( '.' );
+    const AStackString<> baseName( GetName().Get(), lastDot ? lastDot : GetName().GetEnd() );
+    AStackString<> pdbName;
+    AStackString<> mapName;
+    bool debug = false;
+    Array< AString > tokens;
+    m_LinkerOptions.Tokenize( tokens );
+    for ( const AString & token : tokens )
+    {
+        if ( IsLinkerArg_MSVC( token, "DEBUG" ) ||
+             IsStartOfLinkerArg_MSVC( token, "DEBUG:FULL" ) ||
+             IsStartOfLinkerArg_MSVC( token, "DEBUG:FASTLINK" ) )
+        {
+            debug = true;
+        }
+        else if ( IsLinkerArg_MSVC( token, "DEBUG:NONE" ) )
+        {
+            debug = false;
+        }
+        else if ( IsStartOfLinkerArg_MSVC( token, "PDB:" ) )
+        {
+            Args::StripQuotes( token.Get() + 5, token.GetEnd(), pdbName );
+        }
+        else if ( IsLinkerArg_MSVC( token, "MAP" ) )
+        {
+            mapName = baseName;
+            mapName += ".map";
+        }
+        else if ( IsStartOfLinkerArg_MSVC( token, "MAP:" ) )
+        {
+            Args::StripQuotes( token.Get() + 5, token.GetEnd(), mapName );
+        }
+    }
+    if ( debug )
+    {
+        if ( pdbName.IsEmpty() )
+        {
+            pdbName = baseName;
+            pdbName += ".pdb";
+        }
+        outFileNames.EmplaceBack( pdbName );
+    }
+    if ( mapName.IsEmpty() == false )
+    {
+        outFileNames.EmplaceBack( mapName );
+    }
+}
+
 // DoPreLinkCleanup
 //------------------------------------------------------------------------------
 bool LinkerNode::DoPreLinkCleanup() const
@@ -68,6 +68,11 @@ protected:
 
     void GetImportLibName( const AString & args, AString & importLibName ) const;
 
+    // Caching
+    bool ShouldUseCache() const;
+    bool GetCacheId( const Args & fullArgs, AString & outCacheId ) const;
+    void GetCacheFilePaths( Array< AString > & outFileNames ) const;
+
     static bool GetOtherLibraries( NodeGraph & nodeGraph, const BFFToken * iter, const Function * function, const AString & args, Dependencies & otherLibraries, bool msvc );
     static bool GetOtherLibrary( NodeGraph & nodeGraph, const BFFToken * iter, const Function * function, Dependencies & libs, const AString & path, const AString & lib, bool & found );
     static bool GetOtherLibrary( NodeGraph & nodeGraph, const BFFToken * iter, const Function * function, Dependencies & libs, const Array< AString > & paths, const AString & lib );
@@ -104,6 +109,7 @@ protected:
     bool                m_LinkerLinkObjects             = false;
     bool                m_LinkerAllowResponseFile;
     bool                m_LinkerForceResponseFile;
+    bool                m_LinkerAllowCaching            = false;
     AString             m_LinkerStampExe;
     AString             m_LinkerStampExeArgs;
     Array< AString >    m_PreBuildDependencyNames;
@@ -7,6 +7,7 @@
 #include "FileNode.h"
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/AliasNode.h"
@@ -38,13 +39,20 @@
 #include "Tools/FBuild/FBuildCore/Graph/MetaData/Meta_IgnoreForComparison.h"
 #include "Tools/FBuild/FBuildCore/Graph/MetaData/Meta_InheritFromOwner.h"
 #include "Tools/FBuild/FBuildCore/Graph/MetaData/Meta_Name.h"
+#include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 
 // Core
 #include "Core/Containers/Array.h"
+#include "Core/Containers/UniquePtr.h"
 #include "Core/Env/Env.h"
+#include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/IOStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
@@ -53,6 +61,7 @@
 #include "Core/Profile/Profile.h"
 #include "Core/Reflection/ReflectedProperty.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
 
 // system
 #include <stdio.h>
@@ -450,8 +459,13 @@ void Node::SetLastBuildTime( uint32_t ms )
     }
 
     // read contents
-    ASSERT( (Node::Type)nodeType == Node::OBJECT_NODE );
-    return ObjectNode::LoadRemote( stream );
+    switch ( (Node::Type)nodeType )
+    {
+        case Node::OBJECT_NODE: return ObjectNode::LoadRemote( stream );
+        case Node::EXEC_NODE:   return ExecNode::LoadRemote( stream );
+        case Node::TEST_NODE:   return TestNode::LoadRemote( stream );
+        default:                return nullptr; // Not a type which is distributed
+    }
 }
 
 // SaveRemote
@@ -460,8 +474,10 @@ void Node::SetLastBuildTime( uint32_t ms )
 {
     ASSERT( node );
 
-    // only 1 type of node is ever serialized over the network
-    ASSERT( node->GetType() == Node::OBJECT_NODE );
+    // only these types of node are ever serialized over the network
+    ASSERT( ( node->GetType() == Node::OBJECT_NODE ) ||
+            ( node->GetType() == Node::EXEC_NODE ) ||
+            ( node->GetType() == Node::TEST_NODE ) );
 
     // save type
     const uint32_t nodeType = (uint32_t)node->GetType();
@@ -1212,4 +1228,314 @@ void Node::RecordStampFromBuiltFile()
     #endif
 }
 
+// GetCacheId
+//------------------------------------------------------------------------------
+/*static*/ bool Node::GetCacheId( const Dependencies & tools,
+                                  const Dependency * inputsBegin,
+                                  const Dependency * inputsEnd,
+                                  const AString & commandLine,
+                                  AString & outCacheId )
+{
+    PROFILE_FUNCTION;
+
+    uint64_t inputKey = 0;
+    if ( GetCacheInputKey( inputsBegin, inputsEnd, inputKey ) == false )
+    {
+        return false; // An input could not be read, so let the tool report it
+    }
+
+    const uint32_t commandLineKey = xxHash::Calc32( commandLine );
+
+    uint64_t toolChainKey = 0;
+    if ( GetCacheToolChainKey( tools, toolChainKey ) == false )
+    {
+        return false; // GetCacheToolChainKey will have emitted an error
+    }
+
+    ICache::GetCacheId( inputKey, commandLineKey, toolChainKey, 0, outCacheId );
+    return true;
+}
+
+// GetCacheInputKey
+//------------------------------------------------------------------------------
+/*static*/ bool Node::GetCacheInputKey( const Dependency * begin, const Dependency * end, uint64_t & outKey )
+{
+    Array< AString > files( 64, true );
+    for ( const Dependency * it = begin; it != end; ++it )
+    {
+        GetCacheInputFiles( it->GetNode(), files );
+    }
+
+    // Combine the hash of the content of each file (names are expected to be
+    // accounted for by the command line, which is hashed separately)
+    Array< uint64_t > hashes( files.GetSize(), false );
+    for ( const AString & file : files )
+    {
+        FileStream fs;
+        if ( fs.Open( file.Get(), FileStream::READ_ONLY ) == false )
+        {
+            return false;
+        }
+        const size_t fileSize = (size_t)fs.GetFileSize();
+        UniquePtr< void > mem( ALLOC( fileSize + 1 ) ); // +1 so empty files are valid
+        if ( fs.ReadBuffer( mem.Get(), fileSize ) != fileSize )
+        {
+            return false;
+        }
+        hashes.Append( xxHash3::Calc64( mem.Get(), fileSize ) );
+    }
+    outKey = xxHash3::Calc64( hashes.Begin(), hashes.GetSize() * sizeof( uint64_t ) );
+    return true;
+}
+
+// GetCacheInputFiles
+//------------------------------------------------------------------------------
+/*static*/ void Node::GetCacheInputFiles( const Node * node, Array< AString > & outFiles )
+{
+    // Mirror the files passed to tools by the nodes using these
+    switch ( node->GetType() )
+    {
+        case Node::OBJECT_LIST_NODE:
+        {
+            // Objects within the list
+            for ( const Dependency & dep : node->GetDynamicDependencies() )
+            {
+                GetCacheInputFiles( dep.GetNode(), outFiles );
+            }
+            return;
+        }
+        case Node::OBJECT_NODE:
+        {
+            // Objects creating a PCH have an object to link only with MSVC
+            const ObjectNode * on = node->CastTo< ObjectNode >();
+            if ( on->IsCreatingPCH() )
+            {
+                if ( on->IsMSVC() || on->IsClangCl() )
+                {
+                    outFiles.Append( on->GetPCHObjectName() );
+                }
+                return;
+            }
+            break;
+        }
+        case Node::DLL_NODE:
+        {
+            // DLLs are linked against via their import library
+            AStackString<> importLibName;
+            node->CastTo< DLLNode >()->GetImportLibName( importLibName );
+            outFiles.Append( importLibName );
+            return;
+        }
+        case Node::COPY_FILE_NODE:
+        {
+            GetCacheInputFiles( node->CastTo< CopyFileNode >()->GetSourceNode(), outFiles );
+            return;
+        }
+        case Node::DIRECTORY_LIST_NODE:
+        {
+            // Files found by the directory listing
+            for ( const FileIO::FileInfo & file : node->CastTo< DirectoryListNode >()->GetFiles() )
+            {
+                outFiles.Append( file.m_Name );
+            }
+            return;
+        }
+        default: break;
+    }
+
+    if ( node->IsAFile() )
+    {
+        // Libraries, objects and other files are used directly
+        outFiles.Append( node->GetName() );
+        return;
+    }
+
+    // Other nodes (like Aliases) contribute their dependencies
+    for ( const Dependency & dep : node->GetStaticDependencies() )
+    {
+        GetCacheInputFiles( dep.GetNode(), outFiles );
+    }
+}
+
+// GetCacheToolChainKey
+//------------------------------------------------------------------------------
+/*static*/ bool Node::GetCacheToolChainKey( const Dependencies & tools, uint64_t & outKey )
+{
+    // Many nodes share the same tools, so the key is only computed once for
+    // each set of tools (and again if any of them change)
+    Array< uint64_t > toolsInfo( tools.GetSize() * 2, false );
+    for ( const Dependency & dep : tools )
+    {
+        toolsInfo.Append( xxHash3::Calc64( dep.GetNode()->GetName() ) );
+        toolsInfo.Append( dep.GetNode()->GetStamp() );
+    }
+    const uint64_t toolsHash = xxHash3::Calc64( toolsInfo.Begin(), toolsInfo.GetSize() * sizeof( uint64_t ) );
+    if ( FBuild::Get().FindCacheToolChainKey( toolsHash, outKey ) )
+    {
+        return true;
+    }
+
+    // Hash the tools the same way as compiler tool chains, relative to the main executable
+    const AString & mainExecutable = tools[ 0 ].GetNode()->GetName();
+    const char * lastSlash = mainExecutable.FindLast( NATIVE_SLASH );
+    const AStackString<> mainExecutableRoot( mainExecutable.Get(), lastSlash ? ( lastSlash + 1 ) : mainExecutable.Get() );
+
+    ToolManifest manifest;
+    manifest.Initialize( mainExecutableRoot, tools, Array< AString >() );
+    if ( manifest.DoBuild( tools ) == false )
+    {
+        return false; // DoBuild will have emitted an error
+    }
+    outKey = manifest.GetToolId();
+    FBuild::Get().AddCacheToolChainKey( toolsHash, outKey );
+    return true;
+}
+
+// RetrieveOutputsFromCache
+//------------------------------------------------------------------------------
+bool Node::RetrieveOutputsFromCache( Job * job, const AString & cacheId, const Array< AString > & fileNames )
+{
+    if ( FBuild::Get().GetOptions().m_UseCacheRead == false )
+    {
+        return false;
+    }
+
+    PROFILE_FUNCTION;
+
+    const Timer t;
+
+    ICache * cache = FBuild::Get().GetCache();
+    ASSERT( cache );
+
+    void * cacheData( nullptr );
+    size_t cacheDataSize( 0 );
+    if ( cache->Retrieve( cacheId, cacheData, cacheDataSize ) == false )
+    {
+        if ( FBuild::Get().GetOptions().m_CacheVerbose )
+        {
+            FLOG_OUTPUT( "%s: %s\n"
+                         " - Cache Miss: %u ms '%s'\n",
+                         GetTypeName(), GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheId.Get() );
+        }
+        SetStatFlag( Node::STATS_CACHE_MISS );
+        return false;
+    }
+
+    MultiBuffer buffer( cacheData, cacheDataSize );
+    if ( buffer.Decompress() == false )
+    {
+        cache->FreeMemory( cacheData, cacheDataSize );
+        FLOG_WARN( "Cache returned invalid data\n"
+                   " - File: '%s'\n"
+                   " - Key : %s\n",
+                   m_Name.Get(), cacheId.Get() );
+        return false;
+    }
+
+    // Extract the files
+    for ( const AString & fileName : fileNames )
+    {
+        const size_t index = size_t( &fileName - fileNames.Begin() );
+        if ( ( EnsurePathExistsForFile( fileName ) == false ) ||
+             ( buffer.ExtractFile( index, fileName ) == false ) )
+        {
+            cache->FreeMemory( cacheData, cacheDataSize );
+            FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileName.Get() );
+            return false;
+        }
+        if ( FileIO::SetFileLastWriteTimeToNow( fileName ) == false )
+        {
+            cache->FreeMemory( cacheData, cacheDataSize );
+            FLOG_ERROR( "Failed to set timestamp after cache hit. Error: %s Target: '%s'", LAST_ERROR_STR, fileName.Get() );
+            return false;
+        }
+    }
+
+    const uint64_t uncompressedDataSize = buffer.GetDataSize();
+    cache->FreeMemory( cacheData, cacheDataSize );
+
+    FileIO::WorkAroundForWindowsFilePermissionProblem( m_Name );
+
+    // record new file time
+    RecordStampFromBuiltFile();
+
+    // Output
+    if ( FBuild::Get().GetOptions().m_ShowCommandSummary ||
+         FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        AStackString<> output;
+        output.Format( "%s: %s <CACHE>\n", GetTypeName(), GetName().Get() );
+        if ( FBuild::Get().GetOptions().m_CacheVerbose )
+        {
+            output.AppendFormat( " - Cache Hit: %u ms (Compressed: %zu - Uncompressed: %" PRIu64 ") '%s'\n",
+                                 uint32_t( t.GetElapsedMS() ), cacheDataSize, uncompressedDataSize, cacheId.Get() );
+        }
+        FLOG_OUTPUT( output );
+    }
+
+    SetStatFlag( Node::STATS_CACHE_HIT );
+    AddCachingBytes( cacheDataSize );
+
+    job->GetBuildProfilerScope()->SetStepName( "Cache Hit" );
+
+    return true;
+}
+
+// WriteOutputsToCache
+//------------------------------------------------------------------------------
+void Node::WriteOutputsToCache( Job * /*job*/, const AString & cacheId, const Array< AString > & fileNames )
+{
+    if ( FBuild::Get().GetOptions().m_UseCacheWrite == false )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    const Timer t;
+
+    // Load files
+    MultiBuffer buffer;
+    size_t problemFileIndex = 0;
+    if ( buffer.CreateFromFiles( fileNames, &problemFileIndex ) == false )
+    {
+        if ( FBuild::Get().GetOptions().m_CacheVerbose )
+        {
+            FLOG_OUTPUT( "%s: %s\n"
+                         " - Cache Store Fail: '%s' (local IO problem with '%s')\n",
+                         GetTypeName(), GetName().Get(), cacheId.Get(), fileNames[ problemFileIndex ].Get() );
+        }
+        return;
+    }
+    const uint64_t uncompressedDataSize = buffer.GetDataSize();
+
+    // Compress
+    buffer.Compress( FBuild::Get().GetOptions().m_CacheCompressionLevel );
+    const uint32_t compressionTime = uint32_t( t.GetElapsedMS() );
+
+    // Commit to cache
+    if ( FBuild::Get().GetCache()->Publish( cacheId, buffer.GetData(), (size_t)buffer.GetDataSize() ) == false )
+    {
+        if ( FBuild::Get().GetOptions().m_CacheVerbose )
+        {
+            FLOG_OUTPUT( "%s: %s\n"
+                         " - Cache Store Fail: %u ms '%s'\n",
+                         GetTypeName(), GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheId.Get() );
+        }
+        return;
+    }
+
+    const uint32_t cachingTime = uint32_t( t.GetElapsedMS() );
+    SetStatFlag( Node::STATS_CACHE_STORE );
+    AddCachingBytes( buffer.GetDataSize() );
+    AddCachingTime( cachingTime );
+
+    if ( FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        FLOG_OUTPUT( "%s: %s\n"
+                     " - Cache Store: %u ms (Store: %u ms - Compress: %u ms) (Compressed: %" PRIu64 " - Uncompressed: %" PRIu64 ") '%s'\n",
+                     GetTypeName(), GetName().Get(), cachingTime, cachingTime - compressionTime, compressionTime, buffer.GetDataSize(), uncompressedDataSize, cacheId.Get() );
+    }
+}
+
 //------------------------------------------------------------------------------
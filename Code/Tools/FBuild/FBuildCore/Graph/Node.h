@@ -144,6 +144,7 @@ public:
     uint32_t GetLastBuildTime() const;
     inline uint32_t GetProcessingTime() const   { return m_ProcessingTime; }
     inline uint32_t GetCachingTime() const      { return m_CachingTime; }
+    inline uint64_t GetCachingBytes() const     { return m_CachingBytes; }
     inline uint32_t GetRecursiveCost() const    { return m_RecursiveCost; }
 
     inline uint32_t GetProgressAccumulator() const { return m_ProgressAccumulator; }
@@ -190,6 +191,7 @@ protected:
     friend class Function;
     friend class JobQueue;
     friend class JobQueueRemote;
+    friend class JobResultCache;
     friend class NodeGraph;
     friend class ProjectGeneratorBase; // TODO:C Remove this
     friend class Report;
@@ -220,6 +222,7 @@ protected:
     void SetLastBuildTime( uint32_t ms );
     inline void     AddProcessingTime( uint32_t ms )  { m_ProcessingTime += ms; }
     inline void     AddCachingTime( uint32_t ms )     { m_CachingTime += ms; }
+    inline void     AddCachingBytes( uint64_t bytes ) { m_CachingBytes += bytes; }
 
     static void FixupPathForVSIntegration( AString & line );
     static void FixupPathForVSIntegration_GCC( AString & line, const char * tag );
@@ -244,6 +247,18 @@ protected:
 
     void RecordStampFromBuiltFile();
 
+    // Caching of outputs for nodes other than ObjectNode (which has specialized handling)
+    static bool GetCacheId( const Dependencies & tools,
+                            const Dependency * inputsBegin,
+                            const Dependency * inputsEnd,
+                            const AString & commandLine,
+                            AString & outCacheId );
+    static bool GetCacheInputKey( const Dependency * begin, const Dependency * end, uint64_t & outKey );
+    static void GetCacheInputFiles( const Node * node, Array< AString > & outFiles );
+    static bool GetCacheToolChainKey( const Dependencies & tools, uint64_t & outKey );
+    bool        RetrieveOutputsFromCache( Job * job, const AString & cacheId, const Array< AString > & fileNames );
+    void        WriteOutputsToCache( Job * job, const AString & cacheId, const Array< AString > & fileNames );
+
     // Members are ordered to minimize wasted bytes due to padding.
     // Most frequently accessed members are favored for placement in the first cache line.
     AString             m_Name;                     // Full name. **Set by constructor**
@@ -262,6 +277,7 @@ protected:
     uint32_t            m_ProcessingTime = 0;       // Time spent on this node during this build
     uint32_t            m_CachingTime = 0;          // Time spent caching this node
     mutable uint32_t    m_ProgressAccumulator = 0;  // Used to estimate build progress percentage
+    uint64_t            m_CachingBytes = 0;         // Bytes retrieved from or stored to the cache for this node
 
     Dependencies        m_PreBuildDependencies;
     Dependencies        m_StaticDependencies;
@@ -6,6 +6,8 @@
 #include "ObjectNode.h"
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionObjectList.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheDiagnostics.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheDictionaries.h"
 #include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/ExeDrivers/Compiler/CompilerDriverBase.h"
 #include "Tools/FBuild/FBuildCore/ExeDrivers/Compiler/CompilerDriver_CL.h"
@@ -29,11 +31,14 @@
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CIncludeParser.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressorDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderBundle.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ResponseFile.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 // Core
@@ -43,6 +48,7 @@
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Process/Process.h"
@@ -418,9 +424,11 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     }
 
     // Try to use the light cache if enabled
-    if ( useCache && GetCompiler()->GetUseLightCache() )
+    LightCache lc;
+    bool lightCacheUsable = false;
+    const bool useLightCache = ( useCache && GetCompiler()->GetUseLightCache() );
+    if ( useLightCache )
     {
-        LightCache lc;
         if ( lc.Hash( this, fullArgs.GetFinalArgs(), m_LightCacheKey, m_Includes ) == false )
         {
             // Light cache could not be used (can't parse includes)
@@ -438,6 +446,7 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
         {
             // LightCache hashing was successful
             SetStatFlag( Node::STATS_LIGHT_CACHE ); // Light compatible
+            lightCacheUsable = true;
 
             // Try retrieve from cache
             GetCacheName( job ); // Prepare the cache key (always done here even if write only mode)
@@ -463,6 +472,26 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
         }
     }
 
+    // Distribute the source and headers instead of preprocessing if possible
+    if ( ( pass == PASS_PREPROCESSOR_ONLY ) && CanUseHeaderBundle( useCache ) )
+    {
+        // Parse includes here if not already done for the LightCache
+        if ( useLightCache == false )
+        {
+            uint64_t sourceHash;
+            m_Includes.Clear();
+            lightCacheUsable = lc.Hash( this, fullArgs.GetFinalArgs(), sourceHash, m_Includes );
+        }
+
+        if ( lightCacheUsable && PrepareHeaderBundle( job, lc ) )
+        {
+            return NODE_RESULT_NEED_SECOND_BUILD_PASS;
+        }
+
+        // Fall through to generate preprocessed output for distribution....
+        m_Includes.Clear();
+    }
+
     if ( pass == PASS_PREPROCESSOR_ONLY )
     {
         if ( BuildPreprocessedOutput( fullArgs, job, useDeoptimization ) == false )
@@ -606,10 +635,35 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor2( Job * job, bool useDeopt
         }
     }
 
+    // Header bundles contain the original source
+    if ( job->IsHeaderBundle() )
+    {
+        usePreProcessedOutput = false;
+    }
+
     Args fullArgs;
     AStackString<> tmpDirectoryName;
     AStackString<> tmpFileName;
-    if ( usePreProcessedOutput )
+    AStackString<> sandboxRoot;
+    if ( job->IsHeaderBundle() && ( job->IsLocal() == false ) )
+    {
+        AStackString<> sandboxSourceFile;
+        if ( ExtractHeaderBundle( job, sandboxRoot, sandboxSourceFile ) == false )
+        {
+            HeaderBundle::DeleteSandbox( sandboxRoot );
+            return NODE_RESULT_FAILED; // ExtractHeaderBundle will have emitted an error
+        }
+
+        const bool showIncludes( false );
+        const bool useSourceMapping( true );
+        const bool finalize( true );
+        if ( !BuildArgs( job, fullArgs, PASS_COMPILE_HEADER_BUNDLE, useDeoptimization, showIncludes, useSourceMapping, finalize, sandboxSourceFile ) )
+        {
+            HeaderBundle::DeleteSandbox( sandboxRoot );
+            return NODE_RESULT_FAILED; // BuildArgs will have emitted an error
+        }
+    }
+    else if ( usePreProcessedOutput )
     {
         if ( WriteTmpFile( job, tmpDirectoryName, tmpFileName ) == false )
         {
@@ -673,6 +727,12 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor2( Job * job, bool useDeopt
         FileIO::DirectoryDelete( tmpDirectoryName );
     }
 
+    // cleanup header bundle sandbox
+    if ( sandboxRoot.IsEmpty() == false )
+    {
+        HeaderBundle::DeleteSandbox( sandboxRoot );
+    }
+
     if ( result == false )
     {
         // If the failure is forced due to a local cancellation, mark up the profiler
@@ -951,9 +1011,6 @@ bool ObjectNode::ProcessIncludesWithPreProcessor( Job * job )
         case CompilerNode::CompilerFamily::CSHARP:          ASSERT( false ); break; // Guarded in ObjectListNode::Initialize
     }
 
-    // Source mappings are not currently forwarded so can only compiled locally
-    const bool hasSourceMapping = ( compilerNode->GetSourceMapping().IsEmpty() == false );
-
     // Check MS compiler options
     if ( flags.IsMSVC() || flags.IsClangCl() )
     {
@@ -1012,14 +1069,12 @@ bool ObjectNode::ProcessIncludesWithPreProcessor( Job * job )
         // 3) pch files can't be built from preprocessed output (disabled acceleration), so can't be distributed
         // 4) user only wants preprocessor step executed
         // 5) Distribution of /analyze is not currently supported due to preprocessor/_PREFAST_ inconsistencies
-        // 6) Source mappings are not currently forwarded so can only compiled locally
         if ( !usingCLR && !usingPreprocessorOnly )
         {
             if ( isDistributableCompiler &&
                  !usingWinRT &&
                  !( flags.IsCreatingPCH() )&&
-                 !( flags.IsUsingStaticAnalysisMSVC() ) &&
-                 !hasSourceMapping )
+                 !( flags.IsUsingStaticAnalysisMSVC() ) )
             {
                 flags.Set( CompilerFlags::FLAG_CAN_BE_DISTRIBUTED );
             }
@@ -1109,11 +1164,10 @@ bool ObjectNode::ProcessIncludesWithPreProcessor( Job * job )
     {
         // * Creation of the PCH must be done locally to generate a usable PCH
         // * Objective C/C++ cannot be distributed
-        // * Source mappings are not currently forwarded so can only compiled locally
         // * Remote compilation with Gcov coverage is disabled as it has some issues:
         //   1. .gcno files will contain incorrect build root path (working directory on the worker).
         //   2. Object files compiled remotely will create .gcda files in the directory where these object files were stored on the worker.
-        if ( !creatingPCH && !objectiveC && !hasSourceMapping && !flags.IsUsingGcovCoverage() )
+        if ( !creatingPCH && !objectiveC && !flags.IsUsingGcovCoverage() )
         {
             if ( isDistributableCompiler )
             {
@@ -1211,6 +1265,7 @@ bool ObjectNode::ProcessIncludesWithPreProcessor( Job * job )
     // Prepare args for remote worker
     UniquePtr<CompilerDriverBase, DeleteDeletor> driver;
     CreateDriver( m_CompilerFlags, AString::GetEmpty(), driver );
+    driver->SetUseSourceMapping( GetCompiler()->GetSourceMapping() );
     Array< AString > tokens( 1024, true );
     compilerOptions.Tokenize( tokens );
     Args fullArgs;
@@ -1343,21 +1398,7 @@ const AString & ObjectNode::GetCacheName( Job * job ) const
     uint32_t commandLineKey;
     {
         Args args;
-        const bool useDeoptimization = false;
-        const bool showIncludes = false;
-        const bool useSourceMapping = false; // Source mapping compiler flags contain local paths, so we treat them specially
-        const bool finalize = false; // Don't write args to response file
-        BuildArgs( job, args, PASS_COMPILE_PREPROCESSED, useDeoptimization, showIncludes, useSourceMapping, finalize );
-
-        if ( job->IsLocal() )
-        {
-            // Append the source mapping destination only, so different machines with different
-            // working directory local paths compute consistent keys.
-            const AString& sourceMapping = job->GetNode()->CastTo<ObjectNode>()->GetCompiler()->GetSourceMapping();
-            args.AddDelimiter();
-            args += sourceMapping;
-        }
-
+        GetCacheKeyArgs( job, args );
         commandLineKey = xxHash::Calc32( args.GetRawArgs().Get(), args.GetRawArgs().GetLength() );
     }
     ASSERT( commandLineKey );
@@ -1381,6 +1422,26 @@ const AString & ObjectNode::GetCacheName( Job * job ) const
     return job->GetCacheName();
 }
 
+// GetCacheKeyArgs
+//------------------------------------------------------------------------------
+void ObjectNode::GetCacheKeyArgs( Job * job, Args & outArgs ) const
+{
+    const bool useDeoptimization = false;
+    const bool showIncludes = false;
+    const bool useSourceMapping = false; // Source mapping compiler flags contain local paths, so we treat them specially
+    const bool finalize = false; // Don't write args to response file
+    BuildArgs( job, outArgs, PASS_COMPILE_PREPROCESSED, useDeoptimization, showIncludes, useSourceMapping, finalize );
+
+    if ( job->IsLocal() )
+    {
+        // Append the source mapping destination only, so different machines with different
+        // working directory local paths compute consistent keys.
+        const AString& sourceMapping = job->GetNode()->CastTo<ObjectNode>()->GetCompiler()->GetSourceMapping();
+        outArgs.AddDelimiter();
+        outArgs += sourceMapping;
+    }
+}
+
 // RetrieveFromCache
 //------------------------------------------------------------------------------
 bool ObjectNode::RetrieveFromCache( Job * job )
@@ -1399,6 +1460,14 @@ bool ObjectNode::RetrieveFromCache( Job * job )
     ICache * cache = FBuild::Get().GetCache();
     ASSERT( cache );
 
+    // Entries stored without compression can be copied directly into place
+    // (the MSVC PCH key is derived from the entry content however)
+    if ( ( ( IsCreatingPCH() && IsMSVC() ) == false ) &&
+         RetrieveFromCacheByCopy( job, cacheFileName, t ) )
+    {
+        return true;
+    }
+
     void * cacheData( nullptr );
     size_t cacheDataSize( 0 );
     if ( cache->Retrieve( cacheFileName, cacheData, cacheDataSize ) )
@@ -1412,12 +1481,31 @@ bool ObjectNode::RetrieveFromCache( Job * job )
             pchKey = xxHash3::Calc64( cacheData, cacheDataSize );
         }
 
+        // Get dictionary if entry was compressed with one
+        const CompressorDictionary * dictionary = nullptr;
+        const uint32_t dictionaryId = Compressor::IsValidData( cacheData, cacheDataSize ) ? Compressor::GetDictionaryId( cacheData, cacheDataSize ) : 0;
+        if ( dictionaryId != 0 )
+        {
+            const uint64_t toolChainKey = GetCompiler()->CastTo< CompilerNode >()->GetManifest().GetToolId();
+            dictionary = FBuild::Get().GetCacheDictionaries()->GetForDecompression( toolChainKey, dictionaryId );
+            if ( dictionary == nullptr )
+            {
+                cache->FreeMemory( cacheData, cacheDataSize );
+                FLOG_WARN( "Cache entry requires unavailable dictionary\n"
+                           " - File      : '%s'\n"
+                           " - Key       : %s\n"
+                           " - Dictionary: %08X\n",
+                           m_Name.Get(), cacheFileName.Get(), dictionaryId );
+                return false;
+            }
+        }
+
         const uint32_t startDecompress = uint32_t( t.GetElapsedMS() );
 
         MultiBuffer buffer( cacheData, cacheDataSize );
 
         // do decompression
-        if ( buffer.Decompress() == false )
+        if ( buffer.Decompress( dictionary ) == false )
         {
             FLOG_WARN( "Cache returned invalid data\n"
                        " - File: '%s'\n"
@@ -1458,34 +1546,22 @@ bool ObjectNode::RetrieveFromCache( Job * job )
 
         cache->FreeMemory( cacheData, cacheDataSize );
 
-        FileIO::WorkAroundForWindowsFilePermissionProblem( m_Name );
-
-        // record new file time (note that time may differ from what we set above due to
-        // file system precision)
-        RecordStampFromBuiltFile();
-
-        // Output
-        if ( FBuild::Get().GetOptions().m_ShowCommandSummary ||
-             FBuild::Get().GetOptions().m_CacheVerbose )
-        {
-            AStackString<> output;
-            output.Format( "Obj: %s <CACHE>\n", GetName().Get() );
-            if ( FBuild::Get().GetOptions().m_CacheVerbose )
-            {
-                output.AppendFormat( " - Cache Hit: %u ms (Retrieve: %u ms - Decompress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, stopDecompress - startDecompress, cacheDataSize, uncompressedDataSize, cacheFileName.Get() );
-            }
-            FLOG_OUTPUT( output );
-        }
-
-        SetStatFlag( Node::STATS_CACHE_HIT );
-
         // Dependent objects need to know the PCH key to be able to pull from the cache
         if ( IsCreatingPCH() && IsMSVC() )
         {
             m_PCHCacheKey = pchKey;
         }
 
-        job->GetBuildProfilerScope()->SetStepName( "Cache Hit" );
+        AStackString<> verboseDetails;
+        if ( FBuild::Get().GetOptions().m_CacheVerbose )
+        {
+            verboseDetails.Format( " - Cache Hit: %u ms (Retrieve: %u ms - Decompress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, stopDecompress - startDecompress, cacheDataSize, uncompressedDataSize, cacheFileName.Get() );
+            if ( dictionaryId != 0 )
+            {
+                verboseDetails.AppendFormat( " - Dictionary: %08X\n", dictionaryId );
+            }
+        }
+        OnCacheHit( job, cacheDataSize, verboseDetails );
 
         return true;
     }
@@ -1498,10 +1574,79 @@ bool ObjectNode::RetrieveFromCache( Job * job )
                      GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
     }
 
+    if ( FBuild::Get().GetOptions().m_CacheDiagnose )
+    {
+        DiagnoseCacheMiss( job );
+    }
+
     SetStatFlag( Node::STATS_CACHE_MISS );
     return false;
 }
 
+// RetrieveFromCacheByCopy
+//------------------------------------------------------------------------------
+bool ObjectNode::RetrieveFromCacheByCopy( Job * job, const AString & cacheFileName, const Timer & t )
+{
+    PROFILE_FUNCTION;
+
+    ICache * cache = FBuild::Get().GetCache();
+
+    Array< AString > fileNames( 4, false );
+    fileNames.Append( m_Name );
+    GetExtraCacheFilePaths( job, fileNames );
+
+    // Copy each file directly from the entry. If anything goes wrong (including
+    // the entry being compressed), retrieving the entry normally will handle
+    // (and report) it.
+    uint64_t cacheDataSize = 0;
+    if ( cache->RetrieveToFiles( cacheFileName, fileNames, cacheDataSize ) == false )
+    {
+        return false;
+    }
+    for ( const AString & fileName : fileNames )
+    {
+        if ( FileIO::SetFileLastWriteTimeToNow( fileName ) == false )
+        {
+            return false;
+        }
+    }
+
+    AStackString<> verboseDetails;
+    if ( FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        verboseDetails.Format( " - Cache Hit: %u ms (Copy) (Uncompressed: %" PRIu64 ") '%s'\n", uint32_t( t.GetElapsedMS() ), cacheDataSize, cacheFileName.Get() );
+    }
+    OnCacheHit( job, cacheDataSize, verboseDetails );
+
+    return true;
+}
+
+// OnCacheHit
+//------------------------------------------------------------------------------
+void ObjectNode::OnCacheHit( Job * job, uint64_t cacheDataSize, const AString & verboseDetails )
+{
+    FileIO::WorkAroundForWindowsFilePermissionProblem( m_Name );
+
+    // record new file time (note that time may differ from what we set above due to
+    // file system precision)
+    RecordStampFromBuiltFile();
+
+    // Output
+    if ( FBuild::Get().GetOptions().m_ShowCommandSummary ||
+         FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        AStackString<> output;
+        output.Format( "Obj: %s <CACHE>\n", GetName().Get() );
+        output += verboseDetails;
+        FLOG_OUTPUT( output );
+    }
+
+    SetStatFlag( Node::STATS_CACHE_HIT );
+    AddCachingBytes( cacheDataSize );
+
+    job->GetBuildProfilerScope()->SetStepName( "Cache Hit" );
+}
+
 // WriteToCache_FromDisk
 //------------------------------------------------------------------------------
 void ObjectNode::WriteToCache_FromDisk( Job * job )
@@ -1551,8 +1696,27 @@ void ObjectNode::WriteToCache_FromUncompressedData( Job * job,
     // Compress
     const Timer t;
     const uint32_t startCompress( (uint32_t)t.GetElapsedMS() );
+    // Large entries can be stored without compression, so hits can be copied directly into place
+    const uint64_t uncompressedMinSize = ( (uint64_t)FBuild::Get().GetOptions().m_CacheUncompressedMinSizeMiB * MEGABYTE );
+    const bool storeUncompressed = ( uncompressedMinSize > 0 ) && ( uncompressedDataSize >= uncompressedMinSize );
+    const int32_t compressionLevel = storeUncompressed ? 0 : FBuild::Get().GetOptions().m_CacheCompressionLevel;
+    const CompressorDictionary * dictionary = nullptr;
+    if ( FBuild::Get().GetOptions().m_CacheDictionary && ( compressionLevel != 0 ) )
+    {
+        const uint64_t toolChainKey = GetCompiler()->CastTo< CompilerNode >()->GetManifest().GetToolId();
+        dictionary = FBuild::Get().GetCacheDictionaries()->GetForCompression( toolChainKey, uncompressedData, (size_t)uncompressedDataSize );
+    }
     Compressor c;
-    c.Compress(uncompressedData, uncompressedDataSize, FBuild::Get().GetOptions().m_CacheCompressionLevel );
+    if ( dictionary )
+    {
+        // Positive levels map directly to Zstd levels. Negative levels favor
+        // speed (LZ4 "acceleration") so use the fastest regular Zstd level.
+        c.CompressZstd( uncompressedData, uncompressedDataSize, ( compressionLevel > 0 ) ? compressionLevel : 1, dictionary );
+    }
+    else
+    {
+        c.Compress( uncompressedData, uncompressedDataSize, compressionLevel );
+    }
     const uint32_t compressionTime = ( (uint32_t)t.GetElapsedMS() - startCompress );
 
     WriteToCache_FromCompressedData( job,
@@ -1587,6 +1751,7 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
         const uint32_t publishTime = ( (uint32_t)t.GetElapsedMS() - startPublish );
 
         SetStatFlag( Node::STATS_CACHE_STORE );
+        AddCachingBytes( compressedDataSize );
 
         // Dependent objects need to know the PCH key to be able to pull from the cache
         if ( IsCreatingPCH() && IsMSVC() )
@@ -1611,6 +1776,11 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
             }
             FLOG_OUTPUT( output );
         }
+
+        if ( FBuild::Get().GetOptions().m_CacheDiagnostics )
+        {
+            WriteCacheDiagnostics( job );
+        }
     }
     else
     {
@@ -1626,6 +1796,97 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
     }
 }
 
+// GetCacheDiagnostics
+//------------------------------------------------------------------------------
+void ObjectNode::GetCacheDiagnostics( Job * job, CacheDiagnostics & outDiagnostics ) const
+{
+    PROFILE_FUNCTION;
+
+    VERIFY( outDiagnostics.SetCacheId( GetCacheName( job ) ) );
+
+    Args args;
+    GetCacheKeyArgs( job, args );
+    outDiagnostics.SetArgs( args.GetRawArgs() );
+
+    outDiagnostics.SetToolManifest( GetCompiler()->CastTo< CompilerNode >()->GetManifest() );
+
+    for ( const AString & include : m_Includes )
+    {
+        outDiagnostics.AddInclude( include );
+    }
+}
+
+// WriteCacheDiagnostics
+//------------------------------------------------------------------------------
+void ObjectNode::WriteCacheDiagnostics( Job * job ) const
+{
+    PROFILE_FUNCTION;
+
+    CacheDiagnostics diagnostics;
+    GetCacheDiagnostics( job, diagnostics );
+
+    AString record;
+    diagnostics.Serialize( record );
+
+    // Store the record alongside the entry it describes, and as the most
+    // recent record for this object (used to find the nearest entry on a miss)
+    AStackString<> diagnosticsId;
+    AStackString<> indexId;
+    ICache::GetCacheDiagnosticsId( GetCacheName( job ), diagnosticsId );
+    ICache::GetCacheDiagnosticsIndexId( CacheDiagnostics::GetObjectKey( m_Name ), indexId );
+
+    ICache * cache = FBuild::Get().GetCache();
+    const bool ok = cache->Publish( diagnosticsId, record.Get(), record.GetLength() ) &&
+                    cache->Publish( indexId, record.Get(), record.GetLength() );
+    if ( ( ok == false ) && FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        FLOG_OUTPUT( "Obj: %s\n"
+                     " - Cache Diagnostics Store Fail: '%s'\n",
+                     GetName().Get(), diagnosticsId.Get() );
+    }
+}
+
+// DiagnoseCacheMiss
+//------------------------------------------------------------------------------
+void ObjectNode::DiagnoseCacheMiss( Job * job ) const
+{
+    PROFILE_FUNCTION;
+
+    AStackString<> output;
+    output.Format( "Obj: %s\n"
+                   " - Cache Miss Diagnosis: '%s'\n",
+                   GetName().Get(), GetCacheName( job ).Get() );
+
+    // Find the most recently stored record for this object
+    AStackString<> indexId;
+    ICache::GetCacheDiagnosticsIndexId( CacheDiagnostics::GetObjectKey( m_Name ), indexId );
+
+    ICache * cache = FBuild::Get().GetCache();
+    void * cacheData( nullptr );
+    size_t cacheDataSize( 0 );
+    if ( cache->Retrieve( indexId, cacheData, cacheDataSize ) == false )
+    {
+        output += " - No diagnostic record available (populate with -cachediagnostics)\n";
+        FLOG_OUTPUT( output );
+        return;
+    }
+
+    CacheDiagnostics cached;
+    const bool valid = cached.Deserialize( cacheData, cacheDataSize );
+    cache->FreeMemory( cacheData, cacheDataSize );
+    if ( valid == false )
+    {
+        output += " - Diagnostic record is invalid or from an incompatible version\n";
+        FLOG_OUTPUT( output );
+        return;
+    }
+
+    CacheDiagnostics local;
+    GetCacheDiagnostics( job, local );
+    local.Compare( cached, output );
+    FLOG_OUTPUT( output );
+}
+
 // GetExtraCacheFilePaths
 //------------------------------------------------------------------------------
 void ObjectNode::GetExtraCacheFilePaths( const Job * job, Array< AString > & outFileNames ) const
@@ -1766,6 +2027,20 @@ bool ObjectNode::BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool us
     driver->SetRelativeBasePath( basePath );
     driver->SetForceColoredDiagnostics( forceColoredDiagnostics );
     driver->SetUseSourceMapping( ( useSourceMapping && job->IsLocal() ) ? GetCompiler()->GetSourceMapping() : AString::GetEmpty() );
+    if ( job->IsLocal() == false )
+    {
+        // Source mapping forwarded from the client is extended to paths on this machine
+        AStackString<> remoteWorkingDir;
+        job->GetToolManifest()->GetRemotePath( remoteWorkingDir );
+        remoteWorkingDir.TrimEnd( NATIVE_SLASH ); // Compiler sees the dir without the trailing slash
+        driver->SetRemoteWorkingDir( remoteWorkingDir );
+    }
+    if ( pass == PASS_COMPILE_HEADER_BUNDLE )
+    {
+        AStackString<> sandboxRoot;
+        GetHeaderBundleSandboxRoot( sandboxRoot );
+        driver->SetHeaderBundleRoot( sandboxRoot );
+    }
 
     // Adjust args for as needed for the given compiler
     const size_t numTokens = tokens.GetSize();
@@ -1787,6 +2062,12 @@ bool ObjectNode::BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool us
             continue;
         }
 
+        // Handle compiling header bundle args adjustment
+        if ( ( pass == PASS_COMPILE_HEADER_BUNDLE ) && driver->ProcessArg_CompileHeaderBundle( token, i, nextToken, fullArgs ) )
+        {
+            continue;
+        }
+
         // Handle general args adjustment
         if ( driver->ProcessArg_Common( token, i, fullArgs ) )
         {
@@ -2168,6 +2449,107 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
     return true;
 }
 
+// CanUseHeaderBundle
+//------------------------------------------------------------------------------
+bool ObjectNode::CanUseHeaderBundle( bool useCache ) const
+{
+    const CompilerNode * compiler = GetCompiler();
+    if ( ( compiler->GetUseHeaderBundles() == false ) ||
+         ( ( IsGCC() || IsClang() ) == false ) )
+    {
+        return false;
+    }
+
+    // A PCH must be created or used by the preprocessor
+    if ( IsCreatingPCH() || IsUsingPCH() )
+    {
+        return false;
+    }
+
+    // The preprocessed output is needed for the cache key if not using the LightCache
+    if ( useCache && ( compiler->GetUseLightCache() == false ) )
+    {
+        return false;
+    }
+
+    // Source mapping can't be combined with the mapping of the sandbox
+    if ( compiler->GetSourceMapping().IsEmpty() == false )
+    {
+        return false;
+    }
+
+    // Forced includes are not found by the LightCache
+    if ( m_CompilerOptions.Find( "-include" ) || m_CompilerOptions.Find( "-imacros" ) )
+    {
+        return false;
+    }
+
+    const bool belowMemoryLimit = ( ( Job::GetTotalLocalDataMemoryUsage() / MEGABYTE ) < FBuild::Get().GetSettings()->GetDistributableJobMemoryLimitMiB() );
+    return ( belowMemoryLimit && m_CompilerFlags.IsDistributable() && m_AllowDistribution && FBuild::Get().GetOptions().m_AllowDistributed );
+}
+
+// PrepareHeaderBundle
+//------------------------------------------------------------------------------
+bool ObjectNode::PrepareHeaderBundle( Job * job, const LightCache & lightCache ) const
+{
+    PROFILE_FUNCTION;
+
+    HeaderBundle bundle;
+    if ( bundle.Init( GetSourceFile()->GetName(), lightCache ) == false )
+    {
+        return false;
+    }
+
+    MemoryStream ms;
+    bundle.Serialize( ms );
+
+    // compress job data
+    Compressor c;
+    c.Compress( ms.GetData(), ms.GetSize(), FBuild::Get().GetOptions().m_DistributionCompressionLevel );
+    const size_t compressedSize = c.GetResultSize();
+    job->OwnData( c.ReleaseResult(), compressedSize, true );
+    job->SetIsHeaderBundle( true );
+    return true;
+}
+
+// ExtractHeaderBundle
+//------------------------------------------------------------------------------
+bool ObjectNode::ExtractHeaderBundle( Job * job, AString & outSandboxRoot, AString & outSourceFile ) const
+{
+    GetHeaderBundleSandboxRoot( outSandboxRoot );
+
+    HeaderBundle bundle;
+    if ( bundle.Load( *job ) == false )
+    {
+        job->Error( "Failed to load header bundle. Target: '%s'", GetName().Get() );
+        job->OnSystemError();
+        return false;
+    }
+
+    AStackString<> error;
+    if ( bundle.Extract( JobQueueRemote::Get().GetHeaderFileStore(), outSandboxRoot, outSourceFile, error ) == false )
+    {
+        job->Error( "Failed to extract header bundle. %s Target: '%s'", error.Get(), GetName().Get() );
+        job->OnSystemError();
+        return false;
+    }
+
+    // Free compressed buffer as we don't need it anymore
+    job->OwnData( nullptr, 0, false );
+
+    return true;
+}
+
+// GetHeaderBundleSandboxRoot
+//------------------------------------------------------------------------------
+void ObjectNode::GetHeaderBundleSandboxRoot( AString & outSandboxRoot ) const
+{
+    const AString & sourceFileName = GetSourceFile()->GetName();
+    const uint32_t sourceNameHash = xxHash::Calc32( sourceFileName.Get(), sourceFileName.GetLength() );
+    WorkerThread::GetTempFileDirectory( outSandboxRoot );
+    outSandboxRoot.AppendFormat( "%08X%csandbox%c", sourceNameHash, NATIVE_SLASH, NATIVE_SLASH );
+}
+
 // BuildFinalOutput
 //------------------------------------------------------------------------------
 bool ObjectNode::BuildFinalOutput( Job * job, const Args & fullArgs ) const
@@ -2183,7 +2565,22 @@ bool ObjectNode::BuildFinalOutput( Job * job, const Args & fullArgs ) const
     {
         ASSERT( job->GetToolManifest() );
         job->GetToolManifest()->GetRemoteFilePath( 0, compiler );
-        job->GetToolManifest()->GetRemotePath( workingDir );
+        if ( job->IsHeaderBundle() )
+        {
+            // Relative paths must resolve as they would on the client
+            AStackString<> sandboxRoot;
+            GetHeaderBundleSandboxRoot( sandboxRoot );
+            if ( HeaderBundle::GetSandboxPath( sandboxRoot, job->GetRemoteSourceRoot(), workingDir ) == false )
+            {
+                job->Error( "Invalid working dir: '%s' Target: '%s'", job->GetRemoteSourceRoot().Get(), GetName().Get() );
+                job->OnSystemError();
+                return false;
+            }
+        }
+        else
+        {
+            job->GetToolManifest()->GetRemotePath( workingDir );
+        }
     }
 
     // spawn the process
@@ -16,13 +16,16 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class Args;
+class CacheDiagnostics;
 class CompilerDriverBase;
 class ConstMemoryStream;
 class Function;
+class LightCache;
 class MultiBuffer;
 class NodeGraph;
 class NodeProxy;
 class ObjectNode;
+class Timer;
 enum class ArgsResponseFileMode : uint32_t;
 
 // Defines
@@ -113,6 +116,7 @@ public:
         uint32_t m_Flags = 0;
     };
     const CompilerFlags& GetCompilerFlags() const { return m_CompilerFlags; }
+    const AString & GetCompilerOptions() const { return m_CompilerOptions; }
 
     static CompilerFlags DetermineFlags( const CompilerNode * compilerNode,
                                          const AString & args,
@@ -201,7 +205,10 @@ private:
     bool ProcessIncludesWithPreProcessor( Job * job );
 
     const AString & GetCacheName( Job * job ) const;
+    void GetCacheKeyArgs( Job * job, Args & outArgs ) const;
     bool RetrieveFromCache( Job * job );
+    bool RetrieveFromCacheByCopy( Job * job, const AString & cacheFileName, const Timer & t );
+    void OnCacheHit( Job * job, uint64_t cacheDataSize, const AString & verboseDetails );
     void WriteToCache_FromDisk( Job * job );
     void WriteToCache_FromUncompressedData( Job * job,
                                             const void * uncompressedData,
@@ -210,6 +217,9 @@ private:
                                           const void * compressedData,
                                           uint64_t compressedDataSize,
                                           uint32_t compressionTimeMS );
+    void GetCacheDiagnostics( Job * job, CacheDiagnostics & outDiagnostics ) const;
+    void WriteCacheDiagnostics( Job * job ) const;
+    void DiagnoseCacheMiss( Job * job ) const;
     void GetExtraCacheFilePaths( const Job * job, Array< AString > & outFileNames ) const;
 
     void EmitCompilationMessage( const Args & fullArgs, bool useDeoptimization, bool stealingRemoteJob = false, bool racingRemoteJob = false, bool useDedicatedPreprocessor = false, bool isRemote = false ) const;
@@ -220,6 +230,7 @@ private:
         PASS_COMPILE_PREPROCESSED,
         PASS_COMPILE,
         PASS_PREP_FOR_SIMPLE_DISTRIBUTION,
+        PASS_COMPILE_HEADER_BUNDLE,
     };
     bool BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool useDeoptimization, bool useShowIncludes, bool useSourceMapping, bool finalize, const AString & overrideSrcFile = AString::GetEmpty() ) const;
 
@@ -227,6 +238,10 @@ private:
     bool LoadStaticSourceFileForDistribution( const Args & fullArgs, Job * job, bool useDeoptimization ) const;
     void TransferPreprocessedData( const char * data, size_t dataSize, Job * job ) const;
     bool WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpFileName ) const;
+    bool CanUseHeaderBundle( bool useCache ) const;
+    bool PrepareHeaderBundle( Job * job, const LightCache & lightCache ) const;
+    bool ExtractHeaderBundle( Job * job, AString & outSandboxRoot, AString & outSourceFile ) const;
+    void GetHeaderBundleSandboxRoot( AString & outSandboxRoot ) const;
     bool BuildFinalOutput( Job * job, const Args & fullArgs ) const;
 
     static void HandleSystemFailures( Job * job, int result, const AString & stdOut, const AString & stdErr );
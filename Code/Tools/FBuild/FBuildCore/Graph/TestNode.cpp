@@ -9,11 +9,17 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ExecBundle.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 
+#include "Core/Containers/Move.h"
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/FileIO/PathUtils.h"
 #include "Core/Math/Conversions.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Process/Process.h"
@@ -33,11 +39,14 @@ REFLECT_NODE_BEGIN( TestNode, Node, MetaName( "TestOutput" ) + MetaFile() )
     REFLECT(        m_TestWorkingDir,           "TestWorkingDir",           MetaOptional() + MetaPath() )
     REFLECT(        m_TestTimeOut,              "TestTimeOut",              MetaOptional() + MetaRange( 0, 4 * 60 * 60 ) ) // 4hrs
     REFLECT(        m_TestAlwaysShowOutput,     "TestAlwaysShowOutput",     MetaOptional() )
+    REFLECT(        m_TestCacheable,            "TestCacheable",            MetaOptional() )
+    REFLECT(        m_TestAllowDistribution,    "TestAllowDistribution",    MetaOptional() )
     REFLECT_ARRAY(  m_PreBuildDependencyNames,  "PreBuildDependencies",     MetaOptional() + MetaFile() + MetaAllowNonFile() )
     REFLECT_ARRAY(  m_Environment,              "Environment",              MetaOptional() )
 
     // Internal State
     REFLECT(        m_NumTestInputFiles,        "NumTestInputFiles",        MetaHidden() )
+    REFLECT_STRUCT( m_Manifest,                 "Manifest", ToolManifest,   MetaHidden() + MetaIgnoreForComparison() )
 REFLECT_END( TestNode )
 
 // CONSTRUCTOR
@@ -50,6 +59,8 @@ TestNode::TestNode()
     , m_TestTimeOut( 0 )
     , m_TestAlwaysShowOutput( false )
     , m_TestInputPathRecurse( true )
+    , m_TestCacheable( false )
+    , m_TestAllowDistribution( false )
     , m_NumTestInputFiles( 0 )
     , m_EnvironmentString( nullptr )
 {
@@ -107,6 +118,18 @@ TestNode::TestNode()
     m_StaticDependencies.Add( testInputFiles );
     m_StaticDependencies.Add( testInputPaths );
 
+    // The executable is synchronized to workers like a compiler, from the
+    // directory it is in
+    const AString & executableName = executable[ 0 ].GetNode()->GetName();
+    const char * lastSlash = executableName.FindLast( NATIVE_SLASH );
+    AStackString<> executableRoot;
+    if ( lastSlash )
+    {
+        executableRoot.Assign( executableName.Get(), lastSlash + 1 );
+    }
+    const Array< AString > customEnvironmentVariables; // Environment is sent with each job
+    m_Manifest.Initialize( executableRoot, executable, customEnvironmentVariables );
+
     return true;
 }
 
@@ -170,19 +193,95 @@ const char * TestNode::GetEnvironmentString() const
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult TestNode::DoBuild( Job * job )
 {
+    // A passing result (and its output) may be available from the cache
+    AStackString<> cacheId;
+    const bool useCache = ShouldUseCache() && GetCacheId( cacheId );
+    if ( useCache && RetrieveFromCache( job, cacheId ) )
+    {
+        return NODE_RESULT_OK_CACHE;
+    }
+    if ( useCache )
+    {
+        job->SetCacheName( cacheId ); // Output is written to the cache wherever the test runs
+    }
+
+    // Can we run the test remotely?
+    if ( CanDistribute() && PrepareForDistribution( job ) )
+    {
+        return NODE_RESULT_NEED_SECOND_BUILD_PASS;
+    }
+
+    return DoBuild2( job, false );
+}
+
+// DoBuild2
+//------------------------------------------------------------------------------
+/*virtual*/ Node::BuildResult TestNode::DoBuild2( Job * job, bool /*racingRemoteJob*/ )
+{
+    if ( job->IsLocal() == false )
+    {
+        return DoBuildRemote( job );
+    }
+
     // If the workingDir is empty, use the current dir for the process
     const char * workingDir = m_TestWorkingDir.IsEmpty() ? nullptr : m_TestWorkingDir.Get();
 
     EmitCompilationMessage( workingDir );
 
-    // spawn the process
-    Process p( FBuild::Get().GetAbortBuildPointer() );
-    const char * environmentString = GetEnvironmentString();
+    return RunTest( job, GetTestExecutable()->GetName().Get(), workingDir, GetEnvironmentString() );
+}
 
-    const bool spawnOK = p.Spawn( GetTestExecutable()->GetName().Get(),
+// DoBuildRemote
+//------------------------------------------------------------------------------
+Node::BuildResult TestNode::DoBuildRemote( Job * job )
+{
+    // Write the inputs to a sandbox mirroring their paths on the client
+    ExecBundle bundle;
+    AStackString<> error;
+    if ( ( bundle.Load( *job ) == false ) || ( bundle.Extract( error ) == false ) )
+    {
+        job->Error( "Failed to prepare inputs. %s Target: '%s'", error.Get(), GetName().Get() );
+        job->OnSystemError();
+        return NODE_RESULT_FAILED;
+    }
+    job->OwnData( nullptr, 0 ); // Inputs are no longer needed (and must not be returned)
+
+    // Arguments are passed unmodified, so inputs should be given relative to
+    // the working dir, which is mirrored in the sandbox
+    AStackString<> workingDir;
+    const AString & clientWorkingDir = m_TestWorkingDir.IsEmpty() ? job->GetRemoteSourceRoot() : m_TestWorkingDir;
+    if ( bundle.GetSandboxPath( clientWorkingDir, workingDir ) == false )
+    {
+        job->Error( "Invalid working dir: '%s' Target: '%s'", clientWorkingDir.Get(), GetName().Get() );
+        job->OnSystemError();
+        return NODE_RESULT_FAILED;
+    }
+    if ( FileIO::EnsurePathExists( workingDir ) == false )
+    {
+        job->Error( "Failed to create working dir. Error: %s Dir: '%s'", LAST_ERROR_STR, workingDir.Get() );
+        job->OnSystemError();
+        return NODE_RESULT_FAILED;
+    }
+
+    // Use the synchronized executable
+    AStackString<> executable;
+    job->GetToolManifest()->GetRemoteFilePath( 0, executable );
+    const char * environment = m_Environment.IsEmpty() ? job->GetToolManifest()->GetRemoteEnvironmentString()
+                                                        : GetEnvironmentString();
+
+    return RunTest( job, executable.Get(), workingDir.Get(), environment );
+}
+
+// RunTest
+//------------------------------------------------------------------------------
+Node::BuildResult TestNode::RunTest( Job * job, const char * executable, const char * workingDir, const char * environment )
+{
+    // spawn the process
+    Process p( FBuild::GetAbortBuildPointer(), job->GetAbortFlagPointer() );
+    const bool spawnOK = p.Spawn( executable,
                                   m_TestArguments.Get(),
                                   workingDir,
-                                  environmentString );
+                                  environment );
 
     if ( !spawnOK )
     {
@@ -191,7 +290,11 @@ const char * TestNode::GetEnvironmentString() const
             return NODE_RESULT_FAILED;
         }
 
-        FLOG_ERROR( "Failed to spawn process for '%s'", GetName().Get() );
+        job->Error( "Failed to spawn process for '%s'", GetName().Get() );
+        if ( job->IsLocal() == false )
+        {
+            job->OnSystemError(); // Problem with the worker
+        }
         return NODE_RESULT_FAILED;
     }
 
@@ -216,24 +319,24 @@ const char * TestNode::GetEnvironmentString() const
 
     if ( timedOut == true )
     {
-        FLOG_ERROR( "Test timed out after %u s (%s)", m_TestTimeOut, m_TestExecutable.Get() );
+        job->Error( "Test timed out after %u s (%s)", m_TestTimeOut, m_TestExecutable.Get() );
     }
     else if ( result != 0 )
     {
-        FLOG_ERROR( "Test failed. Error: %s Target: '%s'", ERROR_STR( result ), GetName().Get() );
+        job->Error( "Test failed. Error: %s Target: '%s'", ERROR_STR( result ), GetName().Get() );
     }
 
     // write the test output (saved for pass or fail)
     FileStream fs;
     if ( fs.Open( GetName().Get(), FileStream::WRITE_ONLY ) == false )
     {
-        FLOG_ERROR( "Failed to open test output file '%s'", GetName().Get() );
+        job->Error( "Failed to open test output file '%s'", GetName().Get() );
         return NODE_RESULT_FAILED;
     }
     if ( ( ( memOut.IsEmpty() == false ) && ( fs.Write( memOut.Get(), memOut.GetLength() ) != memOut.GetLength() ) ) ||
          ( ( memErr.IsEmpty() == false ) && ( fs.Write( memErr.Get(), memErr.GetLength() ) != memErr.GetLength() ) ) )
     {
-        FLOG_ERROR( "Failed to write test output file '%s'", GetName().Get() );
+        job->Error( "Failed to write test output file '%s'", GetName().Get() );
         return NODE_RESULT_FAILED;
     }
     fs.Close();
@@ -246,12 +349,170 @@ const char * TestNode::GetEnvironmentString() const
 
     // test passed
 
-    // record new file time
-    RecordStampFromBuiltFile();
+    // Remote output is returned to the client (see JobQueueRemote::ReadResults)
+    if ( job->IsLocal() )
+    {
+        // only passing results are cached, so failures are always re-run
+        if ( job->GetCacheName().IsEmpty() == false )
+        {
+            Array< AString > cacheFileNames( 1, false );
+            cacheFileNames.EmplaceBack( GetName() );
+            WriteOutputsToCache( job, job->GetCacheName(), cacheFileNames );
+        }
+
+        // record new file time
+        RecordStampFromBuiltFile();
+    }
 
     return NODE_RESULT_OK;
 }
 
+// ShouldUseCache
+//------------------------------------------------------------------------------
+bool TestNode::ShouldUseCache() const
+{
+    return m_TestCacheable &&
+           ( FBuild::Get().GetOptions().m_UseCacheRead ||
+             FBuild::Get().GetOptions().m_UseCacheWrite );
+}
+
+// GetCacheId
+//------------------------------------------------------------------------------
+bool TestNode::GetCacheId( AString & outCacheId ) const
+{
+    // Command line, and everything else affecting how the test is run
+    AStackString<> commandLine( m_TestArguments );
+    commandLine.AppendFormat( "|%s|", m_TestWorkingDir.Get() );
+    for ( const AString & envVar : m_Environment )
+    {
+        commandLine += envVar;
+    }
+
+    // Inputs are the .TestInput files and the files found in .TestInputPath
+    Dependencies tools( 1 );
+    tools.Add( m_StaticDependencies[ 0 ].GetNode() );
+    return Node::GetCacheId( tools, m_StaticDependencies.Begin() + 1, m_StaticDependencies.End(), commandLine, outCacheId );
+}
+
+// RetrieveFromCache
+//------------------------------------------------------------------------------
+bool TestNode::RetrieveFromCache( Job * job, const AString & cacheId )
+{
+    // The output file holds the stdout and stderr of the test
+    Array< AString > cacheFileNames( 1, false );
+    cacheFileNames.EmplaceBack( GetName() );
+    if ( RetrieveOutputsFromCache( job, cacheId, cacheFileNames ) == false )
+    {
+        return false;
+    }
+
+    // Show the output as if the test had run
+    if ( m_TestAlwaysShowOutput )
+    {
+        FileStream fs;
+        AString output;
+        if ( fs.Open( GetName().Get(), FileStream::READ_ONLY ) )
+        {
+            output.SetLength( (uint32_t)fs.GetFileSize() );
+            if ( fs.ReadBuffer( output.Get(), output.GetLength() ) == output.GetLength() )
+            {
+                Node::DumpOutput( job, output );
+            }
+        }
+    }
+    return true;
+}
+
+// CanDistribute
+//------------------------------------------------------------------------------
+bool TestNode::CanDistribute() const
+{
+    const bool belowMemoryLimit = ( ( Job::GetTotalLocalDataMemoryUsage() / MEGABYTE ) < FBuild::Get().GetSettings()->GetDistributableJobMemoryLimitMiB() );
+    return m_TestAllowDistribution &&
+           FBuild::Get().GetOptions().m_AllowDistributed &&
+           belowMemoryLimit;
+}
+
+// PrepareForDistribution
+//------------------------------------------------------------------------------
+bool TestNode::PrepareForDistribution( Job * job )
+{
+    // Hash the executable to identify it on workers
+    Dependencies executable( 1 );
+    executable.Add( m_StaticDependencies[ 0 ].GetNode() );
+    if ( m_Manifest.DoBuild( executable ) == false )
+    {
+        return false; // Run locally, which will report the problem
+    }
+
+    // Inputs are the .TestInput files and the files found in .TestInputPath
+    Array< AString > inputFiles( m_NumTestInputFiles + m_DynamicDependencies.GetSize(), false );
+    for ( size_t i = 1; i <= m_NumTestInputFiles; ++i )
+    {
+        inputFiles.Append( m_StaticDependencies[ i ].GetNode()->GetName() );
+    }
+    for ( const Dependency & dep : m_DynamicDependencies )
+    {
+        inputFiles.Append( dep.GetNode()->GetName() );
+    }
+
+    ExecBundle bundle;
+    if ( bundle.Init( inputFiles ) == false )
+    {
+        return false; // Run locally, which will report the problem
+    }
+    bundle.Save( *job, FBuild::Get().GetOptions().m_DistributionCompressionLevel );
+    return true;
+}
+
+// SaveRemote
+//------------------------------------------------------------------------------
+/*virtual*/ void TestNode::SaveRemote( IOStream & stream ) const
+{
+    // Inputs are sent as the job data (see ExecBundle)
+    const bool alwaysShowOutput = m_TestAlwaysShowOutput ||
+                                  ( FBuild::IsValid() && FBuild::Get().GetOptions().m_ShowCommandOutput );
+    stream.Write( m_Name );
+    stream.Write( m_TestExecutable );
+    stream.Write( m_TestArguments );
+    stream.Write( m_TestWorkingDir );
+    stream.Write( m_TestTimeOut );
+    stream.Write( alwaysShowOutput );
+    stream.Write( m_Environment );
+}
+
+// LoadRemote
+//------------------------------------------------------------------------------
+/*static*/ Node * TestNode::LoadRemote( IOStream & stream )
+{
+    AString name;
+    TestNode * node = FNEW( TestNode );
+    if ( ( stream.Read( name ) == false ) ||
+         ( stream.Read( node->m_TestExecutable ) == false ) ||
+         ( stream.Read( node->m_TestArguments ) == false ) ||
+         ( stream.Read( node->m_TestWorkingDir ) == false ) ||
+         ( stream.Read( node->m_TestTimeOut ) == false ) ||
+         ( stream.Read( node->m_TestAlwaysShowOutput ) == false ) ||
+         ( stream.Read( node->m_Environment ) == false ) )
+    {
+        FDELETE node;
+        return nullptr;
+    }
+    node->SetName( Move( name ) );
+    return node;
+}
+
+// Migrate
+//------------------------------------------------------------------------------
+/*virtual*/ void TestNode::Migrate( const Node & oldNode )
+{
+    // Migrate Node level properties
+    Node::Migrate( oldNode );
+
+    // Migrate the timestamp/hash info stored for the executable in the ToolManifest
+    m_Manifest.Migrate( oldNode.CastTo< TestNode >()->GetManifest() );
+}
+
 // EmitCompilationMessage
 //------------------------------------------------------------------------------
 void TestNode::EmitCompilationMessage( const char * workingDir ) const
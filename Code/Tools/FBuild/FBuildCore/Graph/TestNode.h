@@ -25,12 +25,31 @@ public:
     inline const Node* GetTestExecutable() const { return m_StaticDependencies[0].GetNode(); }
     const char * GetEnvironmentString() const;
 
+    // Distribution
+    inline const ToolManifest & GetManifest() const { return m_Manifest; }
+    static Node * LoadRemote( IOStream & stream );
+
 private:
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph ) override;
     virtual BuildResult DoBuild( Job * job ) override;
+    virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob ) override;
+    virtual void Migrate( const Node & oldNode ) override;
+    virtual void SaveRemote( IOStream & stream ) const override;
+
+    BuildResult DoBuildRemote( Job * job );
+    BuildResult RunTest( Job * job, const char * executable, const char * workingDir, const char * environment );
 
     void EmitCompilationMessage( const char * workingDir ) const;
 
+    // Caching
+    bool ShouldUseCache() const;
+    bool GetCacheId( AString & outCacheId ) const;
+    bool RetrieveFromCache( Job * job, const AString & cacheId );
+
+    // Distribution
+    bool CanDistribute() const;
+    bool PrepareForDistribution( Job * job );
+
     AString             m_TestExecutable;
     Array< AString >    m_TestInput;
     Array< AString >    m_TestInputPath;
@@ -43,11 +62,14 @@ private:
     uint32_t            m_TestTimeOut;
     bool                m_TestAlwaysShowOutput;
     bool                m_TestInputPathRecurse;
+    bool                m_TestCacheable;
+    bool                m_TestAllowDistribution;
     Array< AString >    m_PreBuildDependencyNames;
     Array< AString >    m_Environment;
 
     // Internal State
     uint32_t            m_NumTestInputFiles;
+    ToolManifest        m_Manifest;
     mutable const char * m_EnvironmentString;
 };
 
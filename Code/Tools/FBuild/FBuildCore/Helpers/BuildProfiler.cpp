@@ -122,6 +122,7 @@ bool BuildProfiler::SaveJSON( const FBuildOptions & options,  const char * fileN
     // - Global metrics
     buffer += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":-2,\"tid\":0,\"args\":{\"name\":\"Memory Usage\"}},";
     buffer += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":-3,\"tid\":0,\"args\":{\"name\":\"Network Usage\"}},";
+    buffer += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":-4,\"tid\":0,\"args\":{\"name\":\"CPU Usage\"}},";
 
     // - Local Processing
     AStackString<> args( options.GetArgs() );
@@ -193,6 +194,18 @@ bool BuildProfiler::SaveJSON( const FBuildOptions & options,  const char * fileN
                                     (uint64_t)( (double)metrics.m_Time * freqMul ),
                                     metrics.m_NumConnections );
         }
+
+        // NUMA node utilization (if using CPU pinning)
+        if ( metrics.m_NumNodes > 0 )
+        {
+            buffer.AppendFormat( "{\"name\":\"Node Utilization (%%)\",\"ph\":\"C\",\"ts\":%" PRIu64 ",\"pid\":-4,\"args\":{",
+                                 (uint64_t)( (double)metrics.m_Time * freqMul ) );
+            for ( uint32_t i = 0; i < metrics.m_NumNodes; ++i )
+            {
+                buffer.AppendFormat( "%s\"Node%u\":%u", ( i > 0 ) ? "," : "", i, (uint32_t)metrics.m_NodeUtilization[ i ] );
+            }
+            buffer += "}},";
+        }
     }
 
     // Open output file and write the majority of the profiling info
@@ -252,6 +265,12 @@ void BuildProfiler::MetricsUpdate()
         // Network connections
         metrics.m_NumConnections = (uint16_t)FBuild::Get().GetNumWorkerConnections();
 
+        // Jobs per NUMA node
+        if ( CPUPlacement::IsValid() )
+        {
+            metrics.m_NumNodes = CPUPlacement::Get().GetNodeUtilization( metrics.m_NodeUtilization, CPUPlacement::kMaxReportedNodes );
+        }
+
         // Exit if we're finished. We check the exit condition here to ensure
         // we always do one final metrics gathering operation before exiting
         if ( m_ThreadExit.Load() )
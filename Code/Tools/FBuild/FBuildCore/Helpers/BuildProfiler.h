@@ -4,6 +4,9 @@
 
 // Includes
 //------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/CPUPlacement.h"
+
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/Containers/Singleton.h"
@@ -90,6 +93,10 @@ protected:
 
         // Network
         uint16_t            m_NumConnections = 0;
+
+        // CPU placement (jobs running on each NUMA node, as a % of its CPUs)
+        uint32_t            m_NumNodes = 0;
+        uint16_t            m_NodeUtilization[ CPUPlacement::kMaxReportedNodes ] = {};
     };
 
     // Track information about workers which performed useful work
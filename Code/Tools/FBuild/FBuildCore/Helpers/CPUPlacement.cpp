@@ -0,0 +1,404 @@
+// CPUPlacement - Pin jobs to groups of CPUs sharing a NUMA node and L3 cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CPUPlacement.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Strings/AString.h"
+
+// system
+#if defined( __LINUX__ )
+    #include <pthread.h>
+    #include <sched.h>
+    #include <stdio.h>
+#endif
+
+// Helpers
+//------------------------------------------------------------------------------
+namespace
+{
+    #if defined( __LINUX__ )
+        // Read the first line of a small file (such as those in /sys)
+        bool ReadSysFile( const char * path, AString & outContents )
+        {
+            FILE * f = fopen( path, "rb" );
+            if ( f == nullptr )
+            {
+                return false;
+            }
+            char buffer[ 1024 ];
+            const bool ok = ( fgets( buffer, sizeof( buffer ), f ) != nullptr );
+            fclose( f );
+            if ( ok )
+            {
+                outContents = buffer;
+                outContents.TrimEnd( '\n' );
+            }
+            return ok;
+        }
+    #endif
+
+    // Set the CPUs the calling thread (and processes it spawns) can run on
+    void SetThreadAffinity( const Array<uint32_t> & cpus )
+    {
+        #if defined( __LINUX__ )
+            cpu_set_t set;
+            CPU_ZERO( &set );
+            for ( const uint32_t cpu : cpus )
+            {
+                if ( cpu < CPU_SETSIZE )
+                {
+                    CPU_SET( cpu, &set );
+                }
+            }
+            VERIFY( pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0 );
+        #else
+            (void)cpus; // TODO:WINDOWS TODO:MAC Pin to processor group/affinity set
+        #endif
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CPUPlacement::CPUPlacement() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CPUPlacement::~CPUPlacement() = default;
+
+// DetectTopology
+//------------------------------------------------------------------------------
+void CPUPlacement::DetectTopology()
+{
+    PROFILE_FUNCTION;
+
+    #if defined( __LINUX__ )
+        // Only consider CPUs we're allowed to run on
+        cpu_set_t allowed;
+        CPU_ZERO( &allowed );
+        if ( sched_getaffinity( 0, sizeof( allowed ), &allowed ) != 0 )
+        {
+            return;
+        }
+
+        // NUMA nodes (a single node if the kernel doesn't report them)
+        Array<uint32_t> nodeIds;
+        AStackString<> contents;
+        if ( ( ReadSysFile( "/sys/devices/system/node/online", contents ) == false ) ||
+             ( ParseCPUList( contents.Get(), nodeIds ) == false ) )
+        {
+            nodeIds.Clear();
+            nodeIds.Append( 0 );
+        }
+
+        for ( const uint32_t nodeId : nodeIds )
+        {
+            // CPUs on this node
+            Array<uint32_t> nodeCPUs;
+            AStackString<> path;
+            path.Format( "/sys/devices/system/node/node%u/cpulist", nodeId );
+            if ( ( ReadSysFile( path.Get(), contents ) == false ) ||
+                 ( ParseCPUList( contents.Get(), nodeCPUs ) == false ) )
+            {
+                if ( nodeIds.GetSize() > 1 )
+                {
+                    continue; // node is unusable
+                }
+                for ( uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+                {
+                    nodeCPUs.Append( cpu );
+                }
+            }
+
+            // Group by L3 cache, identified by the lowest CPU sharing it
+            Array<uint32_t> groupKeys;
+            Array<Array<uint32_t>> groups;
+            for ( const uint32_t cpu : nodeCPUs )
+            {
+                if ( ( cpu >= CPU_SETSIZE ) || ( CPU_ISSET( cpu, &allowed ) == 0 ) )
+                {
+                    continue;
+                }
+
+                uint32_t key = 0; // all of the node, if the cache is not reported
+                Array<uint32_t> sharedCPUs;
+                path.Format( "/sys/devices/system/cpu/cpu%u/cache/index3/shared_cpu_list", cpu );
+                if ( ReadSysFile( path.Get(), contents ) &&
+                     ParseCPUList( contents.Get(), sharedCPUs ) &&
+                     ( sharedCPUs.IsEmpty() == false ) )
+                {
+                    key = sharedCPUs[ 0 ];
+                }
+
+                const uint32_t * existing = groupKeys.Find( key );
+                if ( existing )
+                {
+                    groups[ (size_t)( existing - groupKeys.Begin() ) ].Append( cpu );
+                }
+                else
+                {
+                    groupKeys.Append( key );
+                    groups.EmplaceBack().Append( cpu );
+                }
+            }
+
+            for ( const Array<uint32_t> & group : groups )
+            {
+                AddDomain( nodeId, group );
+            }
+        }
+    #else
+        // TODO:WINDOWS Use GetLogicalProcessorInformationEx
+        // TODO:MAC Single node, with no affinity control
+    #endif
+}
+
+// AddDomain
+//------------------------------------------------------------------------------
+void CPUPlacement::AddDomain( uint32_t nodeId, const Array<uint32_t> & cpus )
+{
+    if ( cpus.IsEmpty() )
+    {
+        return;
+    }
+
+    MutexHolder mh( m_Mutex );
+
+    // Find or add the node
+    uint32_t nodeIndex = 0;
+    for ( ; nodeIndex < m_Nodes.GetSize(); ++nodeIndex )
+    {
+        if ( m_Nodes[ nodeIndex ].m_NodeId == nodeId )
+        {
+            break;
+        }
+    }
+    if ( nodeIndex == m_Nodes.GetSize() )
+    {
+        NodeInfo & node = m_Nodes.EmplaceBack();
+        node.m_NodeId = nodeId;
+        node.m_NumCPUs = 0;
+        node.m_ActiveJobs = 0;
+        node.m_HeavyJobs = 0;
+    }
+    m_Nodes[ nodeIndex ].m_NumCPUs += (uint32_t)cpus.GetSize();
+
+    Domain & domain = m_Domains.EmplaceBack();
+    domain.m_NodeIndex = nodeIndex;
+    domain.m_CPUs = cpus;
+    domain.m_ActiveJobs = 0;
+}
+
+// Acquire
+//------------------------------------------------------------------------------
+uint32_t CPUPlacement::Acquire( bool memoryHeavy )
+{
+    MutexHolder mh( m_Mutex );
+
+    ASSERT( m_Domains.IsEmpty() == false );
+
+    // Memory heavy jobs go to the node with the fewest other memory heavy
+    // jobs (relative to its size), then the least loaded node
+    uint32_t heavyNode = (uint32_t)m_Nodes.GetSize(); // any node
+    if ( memoryHeavy )
+    {
+        heavyNode = 0;
+        for ( uint32_t i = 1; i < m_Nodes.GetSize(); ++i )
+        {
+            const NodeInfo & a = m_Nodes[ i ];
+            const NodeInfo & b = m_Nodes[ heavyNode ];
+            const uint64_t heavyA = (uint64_t)a.m_HeavyJobs * b.m_NumCPUs;
+            const uint64_t heavyB = (uint64_t)b.m_HeavyJobs * a.m_NumCPUs;
+            const uint64_t activeA = (uint64_t)a.m_ActiveJobs * b.m_NumCPUs;
+            const uint64_t activeB = (uint64_t)b.m_ActiveJobs * a.m_NumCPUs;
+            if ( ( heavyA < heavyB ) || ( ( heavyA == heavyB ) && ( activeA < activeB ) ) )
+            {
+                heavyNode = i;
+            }
+        }
+    }
+
+    // Least loaded domain (relative to its size), favoring earlier domains
+    uint32_t best = (uint32_t)m_Domains.GetSize();
+    for ( uint32_t i = 0; i < m_Domains.GetSize(); ++i )
+    {
+        const Domain & domain = m_Domains[ i ];
+        if ( memoryHeavy && ( domain.m_NodeIndex != heavyNode ) )
+        {
+            continue;
+        }
+        if ( best == m_Domains.GetSize() )
+        {
+            best = i;
+            continue;
+        }
+        const Domain & bestDomain = m_Domains[ best ];
+        if ( ( (uint64_t)domain.m_ActiveJobs * bestDomain.m_CPUs.GetSize() ) <
+             ( (uint64_t)bestDomain.m_ActiveJobs * domain.m_CPUs.GetSize() ) )
+        {
+            best = i;
+        }
+    }
+    ASSERT( best < m_Domains.GetSize() );
+
+    Domain & domain = m_Domains[ best ];
+    NodeInfo & node = m_Nodes[ domain.m_NodeIndex ];
+    ++domain.m_ActiveJobs;
+    ++node.m_ActiveJobs;
+    if ( memoryHeavy )
+    {
+        ++node.m_HeavyJobs;
+    }
+    return best;
+}
+
+// Release
+//------------------------------------------------------------------------------
+void CPUPlacement::Release( uint32_t domainIndex, bool memoryHeavy )
+{
+    MutexHolder mh( m_Mutex );
+
+    Domain & domain = m_Domains[ domainIndex ];
+    NodeInfo & node = m_Nodes[ domain.m_NodeIndex ];
+    ASSERT( domain.m_ActiveJobs > 0 );
+    --domain.m_ActiveJobs;
+    --node.m_ActiveJobs;
+    if ( memoryHeavy )
+    {
+        ASSERT( node.m_HeavyJobs > 0 );
+        --node.m_HeavyJobs;
+    }
+}
+
+// GetNodeUtilization
+//------------------------------------------------------------------------------
+uint32_t CPUPlacement::GetNodeUtilization( uint16_t * outPercent, uint32_t maxNodes ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    const uint32_t numNodes = Math::Min( (uint32_t)m_Nodes.GetSize(), maxNodes );
+    for ( uint32_t i = 0; i < numNodes; ++i )
+    {
+        const NodeInfo & node = m_Nodes[ i ];
+        outPercent[ i ] = (uint16_t)Math::Min<uint32_t>( ( node.m_ActiveJobs * 100 ) / node.m_NumCPUs, 0xFFFF );
+    }
+    return numNodes;
+}
+
+// ParseCPUList
+//------------------------------------------------------------------------------
+/*static*/ bool CPUPlacement::ParseCPUList( const char * list, Array<uint32_t> & outCPUs )
+{
+    outCPUs.Clear();
+
+    const char * pos = list;
+    while ( ( *pos == ' ' ) || ( *pos == '\t' ) )
+    {
+        ++pos;
+    }
+    if ( ( *pos == '\0' ) || ( *pos == '\n' ) )
+    {
+        return true; // empty list (e.g. a node with no CPUs)
+    }
+
+    for ( ;; )
+    {
+        // First (or only) CPU of a range
+        if ( ( *pos < '0' ) || ( *pos > '9' ) )
+        {
+            return false;
+        }
+        uint32_t first = 0;
+        while ( ( *pos >= '0' ) && ( *pos <= '9' ) )
+        {
+            first = ( first * 10 ) + (uint32_t)( *pos - '0' );
+            ++pos;
+        }
+
+        // Last CPU of a range
+        uint32_t last = first;
+        if ( *pos == '-' )
+        {
+            ++pos;
+            if ( ( *pos < '0' ) || ( *pos > '9' ) )
+            {
+                return false;
+            }
+            last = 0;
+            while ( ( *pos >= '0' ) && ( *pos <= '9' ) )
+            {
+                last = ( last * 10 ) + (uint32_t)( *pos - '0' );
+                ++pos;
+            }
+            if ( ( last < first ) || ( ( last - first ) >= 65536 ) )
+            {
+                return false;
+            }
+        }
+
+        for ( uint32_t cpu = first; cpu <= last; ++cpu )
+        {
+            outCPUs.Append( cpu );
+        }
+
+        if ( *pos == ',' )
+        {
+            ++pos;
+            continue;
+        }
+        return ( ( *pos == '\0' ) || ( *pos == '\n' ) );
+    }
+}
+
+// CONSTRUCTOR (CPUPlacementScope)
+//------------------------------------------------------------------------------
+CPUPlacementScope::CPUPlacementScope( bool memoryHeavy )
+    : m_DomainIndex( 0 )
+    , m_MemoryHeavy( memoryHeavy )
+{
+    if ( ( CPUPlacement::IsValid() == false ) || ( CPUPlacement::Get().GetNumDomains() == 0 ) )
+    {
+        m_DomainIndex = kNotPlaced;
+        return;
+    }
+
+    CPUPlacement & placement = CPUPlacement::Get();
+    m_DomainIndex = placement.Acquire( memoryHeavy );
+
+    // Pinning to the only domain would not change anything
+    if ( placement.GetNumDomains() > 1 )
+    {
+        SetThreadAffinity( placement.GetDomainCPUs( m_DomainIndex ) );
+    }
+}
+
+// DESTRUCTOR (CPUPlacementScope)
+//------------------------------------------------------------------------------
+CPUPlacementScope::~CPUPlacementScope()
+{
+    if ( m_DomainIndex == kNotPlaced )
+    {
+        return;
+    }
+
+    CPUPlacement & placement = CPUPlacement::Get();
+    placement.Release( m_DomainIndex, m_MemoryHeavy );
+
+    // Allow the thread to run anywhere again
+    if ( placement.GetNumDomains() > 1 )
+    {
+        Array<uint32_t> allCPUs;
+        for ( uint32_t i = 0; i < placement.GetNumDomains(); ++i )
+        {
+            allCPUs.Append( placement.GetDomainCPUs( i ) );
+        }
+        SetThreadAffinity( allCPUs );
+    }
+}
+
+//------------------------------------------------------------------------------
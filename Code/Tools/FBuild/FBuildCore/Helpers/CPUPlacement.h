@@ -0,0 +1,83 @@
+// CPUPlacement - Pin jobs to groups of CPUs sharing a NUMA node and L3 cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/Singleton.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// CPUPlacement
+//------------------------------------------------------------------------------
+// On machines with several NUMA nodes (or several L3 caches per node), the OS
+// scheduler can migrate a compiler between caches and nodes during its life,
+// leaving it to run from cold caches and remote memory. Instead, each job is
+// pinned (along with the processes it spawns, which inherit the affinity of
+// the thread) to the least loaded group of CPUs sharing an L3 cache. Memory
+// heavy jobs (such as links) are also kept spread across nodes, so they
+// don't compete for the memory bandwidth of one node.
+class CPUPlacement : public Singleton<CPUPlacement>
+{
+public:
+    CPUPlacement();
+    ~CPUPlacement();
+
+    // Group the CPUs available to the process by NUMA node and L3 cache
+    void DetectTopology();
+    void AddDomain( uint32_t nodeId, const Array<uint32_t> & cpus ); // Also for tests
+
+    uint32_t GetNumDomains() const { return (uint32_t)m_Domains.GetSize(); }
+    uint32_t GetNumNodes() const { return (uint32_t)m_Nodes.GetSize(); }
+    const Array<uint32_t> & GetDomainCPUs( uint32_t domainIndex ) const { return m_Domains[ domainIndex ].m_CPUs; }
+    uint32_t GetDomainNodeId( uint32_t domainIndex ) const { return m_Nodes[ m_Domains[ domainIndex ].m_NodeIndex ].m_NodeId; }
+
+    // Choose the domain a job should run in, and account for it until released
+    uint32_t Acquire( bool memoryHeavy );
+    void Release( uint32_t domainIndex, bool memoryHeavy );
+
+    // Jobs running on each node, as a % of its CPUs
+    enum : uint32_t { kMaxReportedNodes = 8 };
+    uint32_t GetNodeUtilization( uint16_t * outPercent, uint32_t maxNodes ) const; // returns num written
+
+    // Parse a Linux cpulist (e.g. "0-3,8,10-11")
+    static bool ParseCPUList( const char * list, Array<uint32_t> & outCPUs );
+
+private:
+    struct NodeInfo
+    {
+        uint32_t        m_NodeId;
+        uint32_t        m_NumCPUs;
+        uint32_t        m_ActiveJobs;
+        uint32_t        m_HeavyJobs;
+    };
+    struct Domain
+    {
+        uint32_t        m_NodeIndex;
+        Array<uint32_t> m_CPUs;
+        uint32_t        m_ActiveJobs;
+    };
+
+    mutable Mutex       m_Mutex;
+    Array<NodeInfo>     m_Nodes;
+    Array<Domain>       m_Domains;
+};
+
+// CPUPlacementScope
+//------------------------------------------------------------------------------
+// Pin the calling thread for the duration of a job, if CPUPlacement is active
+class CPUPlacementScope
+{
+public:
+    explicit CPUPlacementScope( bool memoryHeavy );
+    ~CPUPlacementScope();
+
+private:
+    enum : uint32_t { kNotPlaced = 0xFFFFFFFF };
+
+    uint32_t    m_DomainIndex;
+    bool        m_MemoryHeavy;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,149 @@
+// CompressionSelector - Choose how results are compressed for a network link
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CompressionSelector.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+
+// Core
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Candidates, from fastest to smallest
+//------------------------------------------------------------------------------
+namespace
+{
+    const CompressionSelector::Choice g_CompressionCandidates[] =
+    {
+        { 0,    false },    // None
+        { -1,   false },    // LZ4 (default for results)
+        { 9,    false },    // LZ4HC
+        { 1,    true },     // Zstd
+        { 3,    true },     // Zstd (default level)
+        { 9,    true },     // Zstd
+    };
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressionSelector::CompressionSelector()
+    : m_Calibrated( false )
+{
+    static_assert( ( sizeof( g_CompressionCandidates ) / sizeof( g_CompressionCandidates[ 0 ] ) ) == kNumCandidates, "Unexpected number of candidates" );
+    for ( uint32_t i = 0; i < kNumCandidates; ++i )
+    {
+        m_Candidates[ i ].m_Choice = g_CompressionCandidates[ i ];
+        m_Candidates[ i ].m_SecondsPerByte = 0.0f;
+        m_Candidates[ i ].m_Ratio = 1.0f;
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressionSelector::~CompressionSelector() = default;
+
+// Calibrate
+//------------------------------------------------------------------------------
+void CompressionSelector::Calibrate( const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+    if ( m_Calibrated || ( dataSize < kMinCalibrationSize ) )
+    {
+        return;
+    }
+
+    for ( Candidate & candidate : m_Candidates )
+    {
+        if ( candidate.m_Choice.m_Level == 0 )
+        {
+            continue; // Nothing to measure
+        }
+
+        // Repeat small inputs so timings are not just noise
+        const float kMinTimeSec = 0.002f;
+        uint32_t iterations = 0;
+        size_t compressedSize = dataSize;
+        const Timer t;
+        while ( ( iterations == 0 ) || ( t.GetElapsed() < kMinTimeSec ) )
+        {
+            Compressor c;
+            if ( candidate.m_Choice.m_Zstd )
+            {
+                c.CompressZstd( data, dataSize, candidate.m_Choice.m_Level );
+            }
+            else
+            {
+                c.Compress( data, dataSize, candidate.m_Choice.m_Level );
+            }
+            compressedSize = c.GetResultSize();
+
+            Compressor d;
+            d.Decompress( c.GetResult() );
+            ++iterations;
+        }
+
+        candidate.m_SecondsPerByte = t.GetElapsed() / ( (float)iterations * (float)dataSize );
+        candidate.m_Ratio = ( (float)compressedSize / (float)dataSize );
+    }
+    m_Calibrated = true;
+}
+
+// IsCalibrated
+//------------------------------------------------------------------------------
+bool CompressionSelector::IsCalibrated() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Calibrated;
+}
+
+// Select
+//------------------------------------------------------------------------------
+bool CompressionSelector::Select( uint32_t linkKiBPerSec, bool allowZstd, Choice & outChoice ) const
+{
+    MutexHolder mh( m_Mutex );
+    if ( ( m_Calibrated == false ) || ( linkKiBPerSec == 0 ) )
+    {
+        return false;
+    }
+
+    // Expected time per uncompressed byte
+    const float linkSecondsPerByte = 1.0f / ( (float)linkKiBPerSec * 1024.0f );
+    const Candidate * best = nullptr;
+    float bestCost = 0.0f;
+    for ( const Candidate & candidate : m_Candidates )
+    {
+        if ( candidate.m_Choice.m_Zstd && ( allowZstd == false ) )
+        {
+            continue;
+        }
+        const float cost = candidate.m_SecondsPerByte + ( candidate.m_Ratio * linkSecondsPerByte );
+        if ( ( best == nullptr ) || ( cost < bestCost ) )
+        {
+            best = &candidate;
+            bestCost = cost;
+        }
+    }
+    outChoice = best->m_Choice;
+    return true;
+}
+
+// GetDescription
+//------------------------------------------------------------------------------
+/*static*/ void CompressionSelector::GetDescription( const Choice & choice, AString & outDescription )
+{
+    if ( choice.m_Level == 0 )
+    {
+        outDescription = "None";
+        return;
+    }
+    const char * type = choice.m_Zstd ? "Zstd" : ( choice.m_Level > 0 ) ? "LZ4HC" : "LZ4";
+    outDescription.Format( "%s (%i)", type, (int32_t)choice.m_Level );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,59 @@
+// CompressionSelector - Choose how results are compressed for a network link
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// CompressionSelector
+//------------------------------------------------------------------------------
+// Compressing results costs worker CPU time but saves transfer time. Which
+// matters more depends on the link: on a fast LAN compressing can take longer
+// than sending the data as-is, while on a slow link the best ratio wins.
+// The throughput and ratio of each candidate are measured once on a
+// representative result, and combined with the measured rate of a link to
+// choose the candidate with the lowest expected time.
+class CompressionSelector
+{
+public:
+    CompressionSelector();
+    ~CompressionSelector();
+
+    struct Choice
+    {
+        int16_t m_Level;    // See Compressor::Compress and Compressor::CompressZstd
+        bool    m_Zstd;
+    };
+
+    // Measure candidates with the (uncompressed) data. Only the first call does any work.
+    void Calibrate( const void * data, size_t dataSize );
+    bool IsCalibrated() const;
+
+    // Choose for a link. Returns false if not calibrated or the rate is unknown.
+    bool Select( uint32_t linkKiBPerSec, bool allowZstd, Choice & outChoice ) const;
+
+    static void GetDescription( const Choice & choice, AString & outDescription );
+
+    enum : uint32_t { kMinCalibrationSize = ( 64 * 1024 ) };
+
+private:
+    struct Candidate
+    {
+        Choice  m_Choice;
+        float   m_SecondsPerByte; // compression + decompression
+        float   m_Ratio;          // compressed size / uncompressed size
+    };
+    enum : uint32_t { kNumCandidates = 6 };
+
+    mutable Mutex   m_Mutex;
+    bool            m_Calibrated;
+    Candidate       m_Candidates[ kNumCandidates ];
+};
+
+//------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressorDictionary.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
@@ -43,7 +44,7 @@ Compressor::~Compressor()
 {
     ASSERT( data );
     const Header * header = (const Header *)data;
-    if ( header->m_CompressionType > 1 )
+    if ( header->m_CompressionType > COMPRESSION_TYPE_ZSTD_DICTIONARY )
     {
         return false;
     }
@@ -70,6 +71,43 @@ Compressor::~Compressor()
     return header->m_UncompressedSize;
 }
 
+// GetUncompressedDataOffset
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Compressor::GetUncompressedDataOffset( const void * header, size_t headerSize, uint64_t dataSize )
+{
+    static_assert( ( sizeof( Header ) + sizeof( DictionaryHeader ) ) <= kMaxHeaderSize, "kMaxHeaderSize is too small" );
+
+    if ( headerSize < sizeof( Header ) )
+    {
+        return 0;
+    }
+    const Header * h = static_cast< const Header * >( header );
+    if ( ( h->m_CompressionType != COMPRESSION_TYPE_NONE ) ||
+         ( h->m_CompressedSize != h->m_UncompressedSize ) ||
+         ( ( h->m_CompressedSize + sizeof( Header ) ) != dataSize ) )
+    {
+        return 0;
+    }
+    return sizeof( Header );
+}
+
+// GetDictionaryId
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Compressor::GetDictionaryId( const void * data, size_t dataSize )
+{
+    // Only valid to call on data that is known to be compressor format
+    ASSERT( IsValidData( data, dataSize ) );
+
+    const Header * header = (const Header *)data;
+    if ( ( header->m_CompressionType != COMPRESSION_TYPE_ZSTD_DICTIONARY ) ||
+         ( dataSize < ( sizeof( Header ) + sizeof( DictionaryHeader ) ) ) )
+    {
+        return 0;
+    }
+    const DictionaryHeader * dictionaryHeader = (const DictionaryHeader *)( header + 1 );
+    return dictionaryHeader->m_DictionaryId;
+}
+
 // Compress
 //------------------------------------------------------------------------------
 bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressionLevel )
@@ -123,7 +161,7 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
     // fill out header
     Header * header = (Header*)m_Result;
-    header->m_CompressionType = compressed ? 1u : 0u;   // compression type
+    header->m_CompressionType = compressed ? COMPRESSION_TYPE_LZ4 : COMPRESSION_TYPE_NONE; // compression type
     header->m_UncompressedSize = (uint32_t)dataSize;    // input size
     header->m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)dataSize;    // output size
 
@@ -132,7 +170,7 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
 // Decompress
 //------------------------------------------------------------------------------
-bool Compressor::Decompress( const void * data )
+bool Compressor::Decompress( const void * data, const CompressorDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
@@ -141,15 +179,22 @@ bool Compressor::Decompress( const void * data )
 
     const Header * header = (const Header *)data;
 
+    // handle Zstd (which handles its own uncompressed case)
+    if ( header->m_CompressionType >= COMPRESSION_TYPE_ZSTD )
+    {
+        return DecompressZstd( data, dictionary );
+    }
+    (void)dictionary; // Not used by LZ4
+
     // handle uncompressed case
-    if ( header->m_CompressionType == 0 )
+    if ( header->m_CompressionType == COMPRESSION_TYPE_NONE )
     {
         m_Result = ALLOC( header->m_UncompressedSize );
         memcpy( m_Result, (const char *)data + sizeof( Header ), header->m_UncompressedSize );
         m_ResultSize = header->m_UncompressedSize;
         return true;
     }
-    ASSERT( header->m_CompressionType == 1 );
+    ASSERT( header->m_CompressionType == COMPRESSION_TYPE_LZ4 );
 
     // uncompressed size
     const uint32_t uncompressedSize = header->m_UncompressedSize;
@@ -177,7 +222,8 @@ bool Compressor::Decompress( const void * data )
 //------------------------------------------------------------------------------
 bool Compressor::CompressZstd( const void * data,
                                size_t dataSize,
-                               int32_t compressionLevel)
+                               int32_t compressionLevel,
+                               const CompressorDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
@@ -191,7 +237,27 @@ bool Compressor::CompressZstd( const void * data,
     size_t compressedSize;
 
     // do compression
-    if ( compressionLevel > 0 )
+    const ZSTD_CDict * cdict = ( dictionary && ( compressionLevel > 0 ) ) ? dictionary->GetCompressionDictionary( compressionLevel ) : nullptr;
+    if ( cdict )
+    {
+        ZSTD_CCtx * cctx = ZSTD_createCCtx();
+        compressedSize = ZSTD_compress_usingCDict( cctx,
+                                                   output.Get(),
+                                                   worstCaseSize,
+                                                   static_cast<const char *>( data ),
+                                                   dataSize,
+                                                   cdict );
+        ZSTD_freeCCtx( cctx );
+        if ( ZSTD_isError( compressedSize ) )
+        {
+            compressedSize = dataSize; // Store uncompressed
+        }
+        else
+        {
+            compressedSize += sizeof( DictionaryHeader );
+        }
+    }
+    else if ( compressionLevel > 0 )
     {
         compressedSize = ZSTD_compress( output.Get(),
                                         worstCaseSize,
@@ -208,7 +274,16 @@ bool Compressor::CompressZstd( const void * data,
     // did the compression yield any benefit?
     const bool compressed = ( compressedSize < dataSize );
 
-    if (compressed)
+    if ( compressed && cdict )
+    {
+        // trim memory usage to compressed size, inserting dictionary id before the Zstd frame
+        m_Result = ALLOC( (uint32_t)compressedSize + sizeof(Header) );
+        DictionaryHeader * dictionaryHeader = (DictionaryHeader *)( (char *)m_Result + sizeof(Header) );
+        dictionaryHeader->m_DictionaryId = dictionary->GetId();
+        memcpy( dictionaryHeader + 1, output.Get(), (size_t)compressedSize - sizeof( DictionaryHeader ) );
+        m_ResultSize = (uint32_t)compressedSize + sizeof(Header);
+    }
+    else if ( compressed )
     {
         // trim memory usage to compressed size
         m_Result = ALLOC( (uint32_t)compressedSize + sizeof(Header) );
@@ -225,7 +300,7 @@ bool Compressor::CompressZstd( const void * data,
 
     // fill out header
     Header * header = (Header *)m_Result;
-    header->m_CompressionType = compressed ? 2u : 0u;   // compression type
+    header->m_CompressionType = compressed ? ( cdict ? COMPRESSION_TYPE_ZSTD_DICTIONARY : COMPRESSION_TYPE_ZSTD ) : COMPRESSION_TYPE_NONE; // compression type
     header->m_UncompressedSize = (uint32_t)dataSize;    // input size
     header->m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)dataSize; // output size
 
@@ -234,7 +309,7 @@ bool Compressor::CompressZstd( const void * data,
 
 // DecompressZstd
 //------------------------------------------------------------------------------
-bool Compressor::DecompressZstd( const void * data )
+bool Compressor::DecompressZstd( const void * data, const CompressorDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
@@ -244,28 +319,57 @@ bool Compressor::DecompressZstd( const void * data )
     const Header * header = static_cast<const Header *>(data);
 
     // handle uncompressed case
-    if (header->m_CompressionType == 0)
+    if (header->m_CompressionType == COMPRESSION_TYPE_NONE)
     {
         m_Result = ALLOC(header->m_UncompressedSize);
         memcpy(m_Result, (const char *)data + sizeof(Header), header->m_UncompressedSize);
         m_ResultSize = header->m_UncompressedSize;
         return true;
     }
-    ASSERT( header->m_CompressionType == 2 );
+    ASSERT( ( header->m_CompressionType == COMPRESSION_TYPE_ZSTD ) ||
+            ( header->m_CompressionType == COMPRESSION_TYPE_ZSTD_DICTIONARY ) );
+
+    // skip over header to Zstd data
+    const char * compressedData = ( (const char *)data + sizeof(Header) );
+    size_t compressedSize = header->m_CompressedSize;
+
+    // Data compressed with a dictionary can only be decompressed with the same one
+    if ( header->m_CompressionType == COMPRESSION_TYPE_ZSTD_DICTIONARY )
+    {
+        const DictionaryHeader * dictionaryHeader = (const DictionaryHeader *)compressedData;
+        if ( ( dictionary == nullptr ) || ( dictionary->GetId() != dictionaryHeader->m_DictionaryId ) )
+        {
+            return false;
+        }
+        compressedData += sizeof( DictionaryHeader );
+        compressedSize -= sizeof( DictionaryHeader );
+    }
 
     // uncompressed size
     const uint32_t uncompressedSize = header->m_UncompressedSize;
     m_Result = ALLOC( uncompressedSize );
     m_ResultSize = uncompressedSize;
 
-    // skip over header to LZ4 data
-    const char * compressedData = ( (const char *)data + sizeof(Header) );
-
     // decompress
-    const size_t bytesDecompressed = ZSTD_decompress( m_Result,
-                                                      uncompressedSize,
-                                                      compressedData,
-                                                      header->m_CompressedSize );
+    size_t bytesDecompressed;
+    if ( header->m_CompressionType == COMPRESSION_TYPE_ZSTD_DICTIONARY )
+    {
+        ZSTD_DCtx * dctx = ZSTD_createDCtx();
+        bytesDecompressed = ZSTD_decompress_usingDDict( dctx,
+                                                        m_Result,
+                                                        uncompressedSize,
+                                                        compressedData,
+                                                        compressedSize,
+                                                        dictionary->GetDecompressionDictionary() );
+        ZSTD_freeDCtx( dctx );
+    }
+    else
+    {
+        bytesDecompressed = ZSTD_decompress( m_Result,
+                                             uncompressedSize,
+                                             compressedData,
+                                             compressedSize );
+    }
     if ( bytesDecompressed == uncompressedSize )
     {
         return true;
@@ -6,6 +6,10 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CompressorDictionary;
+
 // Compressor
 //------------------------------------------------------------------------------
 class Compressor
@@ -16,17 +20,23 @@ public:
 
     static bool     IsValidData( const void * data, size_t dataSize );
     static uint32_t GetUncompressedSize( const void * data, size_t dataSize );
+    static uint32_t GetDictionaryId( const void * data, size_t dataSize ); // 0 if no dictionary is needed
+
+    // Offset of the data in a buffer stored without compression (or 0 if decompression is needed).
+    // Only the start of the buffer (up to kMaxHeaderSize) is required.
+    static uint32_t GetUncompressedDataOffset( const void * header, size_t headerSize, uint64_t dataSize );
+    static const size_t kMaxHeaderSize = 16;
 
     // compressionLevel:
     //   < 0 : use LZ4, with values directly mapping to "acceleration level"
     //  == 0 : disable compression
     //   > 0 : use LZ4HC, with values direcly mapping to "compression level"
     bool Compress( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default LZ4 compression level
-    bool Decompress( const void * data );
+    bool Decompress( const void * data, const CompressorDictionary * dictionary = nullptr ); // Also handles Zstd data
 
     // Zstd
-    bool CompressZstd( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default Zstd compression level
-    bool DecompressZstd( const void * data );
+    bool CompressZstd( const void * data, size_t dataSize, int32_t compressionLevel = -1, const CompressorDictionary * dictionary = nullptr ); // -1 = default Zstd compression level
+    bool DecompressZstd( const void * data, const CompressorDictionary * dictionary = nullptr );
 
     const void *    GetResult() const       { return m_Result; }
     size_t          GetResultSize() const   { return m_ResultSize; }
@@ -34,11 +44,22 @@ public:
     inline void *   ReleaseResult()         { void * r = m_Result; m_Result = nullptr; m_ResultSize = 0; return r; }
 
 private:
+    enum : uint32_t
+    {
+        COMPRESSION_TYPE_NONE               = 0,
+        COMPRESSION_TYPE_LZ4                = 1,
+        COMPRESSION_TYPE_ZSTD               = 2,
+        COMPRESSION_TYPE_ZSTD_DICTIONARY    = 3, // Followed by DictionaryHeader
+    };
     struct Header
     {
         uint32_t m_CompressionType;
         uint32_t m_UncompressedSize;
-        uint32_t m_CompressedSize;
+        uint32_t m_CompressedSize;  // Includes DictionaryHeader if present
+    };
+    struct DictionaryHeader
+    {
+        uint32_t m_DictionaryId;
     };
     void * m_Result;
     size_t m_ResultSize;
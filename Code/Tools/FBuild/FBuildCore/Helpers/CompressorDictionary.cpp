@@ -0,0 +1,119 @@
+// CompressorDictionary
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CompressorDictionary.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Profile/Profile.h"
+
+// External
+#define ZSTD_STATIC_LINKING_ONLY // For ZSTD_dct_rawContent
+#include "zstd.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressorDictionary::CompressorDictionary()
+    : m_Id( 0 )
+    , m_Content( 0, true )
+    , m_DDict( nullptr )
+    , m_CDicts( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressorDictionary::~CompressorDictionary()
+{
+    for ( CDict & cdict : m_CDicts )
+    {
+        ZSTD_freeCDict( cdict.m_CDict );
+    }
+    ZSTD_freeDDict( m_DDict );
+}
+
+// Create
+//------------------------------------------------------------------------------
+bool CompressorDictionary::Create( const void * content, size_t contentSize )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_DDict == nullptr );
+    if ( contentSize == 0 )
+    {
+        return false;
+    }
+
+    m_Content.Append( static_cast< const uint8_t * >( content ),
+                      static_cast< const uint8_t * >( content ) + contentSize );
+
+    // Raw content dictionaries have no id of their own, so derive one from the
+    // content (0 is reserved to mean "no dictionary")
+    m_Id = xxHash::Calc32( m_Content.Begin(), m_Content.GetSize() );
+    m_Id = ( m_Id == 0 ) ? 1 : m_Id;
+
+    // Content is always treated as raw, even if it happens to begin with the
+    // Zstd dictionary magic number
+    m_DDict = ZSTD_createDDict_advanced( m_Content.Begin(),
+                                         m_Content.GetSize(),
+                                         ZSTD_dlm_byRef,
+                                         ZSTD_dct_rawContent,
+                                         ZSTD_defaultCMem );
+    return ( m_DDict != nullptr );
+}
+
+// AppendSample
+//------------------------------------------------------------------------------
+/*static*/ void CompressorDictionary::AppendSample( const void * sample,
+                                                    size_t sampleSize,
+                                                    size_t maxBytesFromSample,
+                                                    Array< uint8_t > & inOutContent )
+{
+    const uint8_t * data = static_cast< const uint8_t * >( sample );
+    if ( sampleSize <= maxBytesFromSample )
+    {
+        inOutContent.Append( data, data + sampleSize );
+        return;
+    }
+
+    const size_t fromStart = ( maxBytesFromSample / 2 );
+    const size_t fromEnd = ( maxBytesFromSample - fromStart );
+    inOutContent.Append( data, data + fromStart );
+    inOutContent.Append( data + sampleSize - fromEnd, data + sampleSize );
+}
+
+// GetCompressionDictionary
+//------------------------------------------------------------------------------
+const ZSTD_CDict_s * CompressorDictionary::GetCompressionDictionary( int32_t compressionLevel ) const
+{
+    ASSERT( m_DDict ); // Create must have succeeded
+
+    MutexHolder mh( m_CDictsMutex );
+
+    for ( const CDict & cdict : m_CDicts )
+    {
+        if ( cdict.m_CompressionLevel == compressionLevel )
+        {
+            return cdict.m_CDict;
+        }
+    }
+
+    PROFILE_SECTION( "CreateCDict" );
+    const ZSTD_compressionParameters params = ZSTD_getCParams( compressionLevel, 0, m_Content.GetSize() );
+    ZSTD_CDict * cdict = ZSTD_createCDict_advanced( m_Content.Begin(),
+                                                    m_Content.GetSize(),
+                                                    ZSTD_dlm_byRef,
+                                                    ZSTD_dct_rawContent,
+                                                    params,
+                                                    ZSTD_defaultCMem );
+    if ( cdict )
+    {
+        m_CDicts.Append( CDict{ compressionLevel, cdict } );
+    }
+    return cdict;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,60 @@
+// CompressorDictionary
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+// CompressorDictionary
+//------------------------------------------------------------------------------
+// A Zstd "raw content" dictionary: a blob of data representative of the data
+// to be compressed, which Zstd can reference when compressing small inputs.
+class CompressorDictionary
+{
+public:
+    explicit CompressorDictionary();
+    ~CompressorDictionary();
+
+    // Create from previously built (or stored) content
+    bool Create( const void * content, size_t contentSize );
+
+    // Build content from a sample of representative data. The start and end of
+    // each sample are used, since that's where most formats keep their headers
+    // and tables (and where shared structure is concentrated).
+    static void AppendSample( const void * sample,
+                              size_t sampleSize,
+                              size_t maxBytesFromSample,
+                              Array< uint8_t > & inOutContent );
+
+    uint32_t        GetId() const           { return m_Id; }
+    const void *    GetContent() const      { return m_Content.Begin(); }
+    size_t          GetContentSize() const  { return m_Content.GetSize(); }
+
+    // Pre-digested forms used by the Compressor
+    const ZSTD_CDict_s *    GetCompressionDictionary( int32_t compressionLevel ) const;
+    const ZSTD_DDict_s *    GetDecompressionDictionary() const { return m_DDict; }
+
+private:
+    struct CDict
+    {
+        int32_t         m_CompressionLevel;
+        ZSTD_CDict_s *  m_CDict;
+    };
+
+    uint32_t                m_Id;
+    Array< uint8_t >        m_Content;
+    ZSTD_DDict_s *          m_DDict;
+    mutable Mutex           m_CDictsMutex;
+    mutable Array< CDict >  m_CDicts; // Created on demand per compression level
+};
+
+//------------------------------------------------------------------------------
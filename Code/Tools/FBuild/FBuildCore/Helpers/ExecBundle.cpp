@@ -0,0 +1,167 @@
+// ExecBundle - Inputs needed to run an Exec() or Test() executable remotely
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ExecBundle.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderBundle.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
+
+// Core
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define EXEC_BUNDLE_MAX_INPUT_SIZE ( 256 * MEGABYTE ) // Total, beyond which nodes run locally
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+ExecBundle::ExecBundle()
+    : m_InputFiles( 0, true )
+    , m_InputContents( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+ExecBundle::~ExecBundle()
+{
+    if ( m_SandboxRoot.IsEmpty() == false )
+    {
+        HeaderBundle::DeleteSandbox( m_SandboxRoot );
+    }
+}
+
+// Init
+//------------------------------------------------------------------------------
+bool ExecBundle::Init( const Array< AString > & inputFiles )
+{
+    PROFILE_FUNCTION;
+
+    m_InputFiles = inputFiles;
+    m_InputContents.SetCapacity( inputFiles.GetSize() );
+    uint64_t totalSize = 0;
+    for ( const AString & inputFile : inputFiles )
+    {
+        // Inputs are held in memory (on the client and the worker), so large
+        // inputs are better used where they are
+        FileStream f;
+        if ( f.Open( inputFile.Get() ) == false )
+        {
+            return false;
+        }
+        totalSize += f.GetFileSize();
+        if ( totalSize > EXEC_BUNDLE_MAX_INPUT_SIZE )
+        {
+            return false;
+        }
+        AString & contents = m_InputContents.EmplaceBack();
+        const uint32_t fileSize = (uint32_t)f.GetFileSize();
+        contents.SetLength( fileSize );
+        if ( f.ReadBuffer( contents.Get(), fileSize ) != fileSize )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void ExecBundle::Save( Job & job, int32_t compressionLevel ) const
+{
+    MemoryStream ms;
+    ms.Write( m_InputFiles );
+    ms.Write( m_InputContents );
+
+    Compressor c;
+    c.Compress( ms.GetData(), ms.GetSize(), compressionLevel );
+    const size_t compressedSize = c.GetResultSize();
+    job.OwnData( c.ReleaseResult(), compressedSize, true );
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool ExecBundle::Load( const Job & job )
+{
+    const void * data = job.GetData();
+    size_t dataSize = job.GetDataSize();
+
+    // handle compressed data
+    Compressor c; // scoped here so we can access decompression buffer
+    if ( job.IsDataCompressed() )
+    {
+        if ( c.Decompress( data ) == false )
+        {
+            return false;
+        }
+        data = c.GetResult();
+        dataSize = c.GetResultSize();
+    }
+
+    ConstMemoryStream ms( data, dataSize );
+    return Deserialize( ms );
+}
+
+// Deserialize
+//------------------------------------------------------------------------------
+bool ExecBundle::Deserialize( IOStream & stream )
+{
+    return ( stream.Read( m_InputFiles ) &&
+             stream.Read( m_InputContents ) &&
+             ( m_InputFiles.GetSize() == m_InputContents.GetSize() ) );
+}
+
+// Extract
+//------------------------------------------------------------------------------
+bool ExecBundle::Extract( AString & outError )
+{
+    PROFILE_FUNCTION;
+
+    // Clear anything left behind by a previous job on this thread
+    WorkerThread::GetTempFileDirectory( m_SandboxRoot );
+    m_SandboxRoot.AppendFormat( "exec%csandbox%c", NATIVE_SLASH, NATIVE_SLASH );
+    HeaderBundle::DeleteSandbox( m_SandboxRoot );
+
+    AStackString<> sandboxFile;
+    for ( size_t i = 0; i < m_InputFiles.GetSize(); ++i )
+    {
+        if ( GetSandboxPath( m_InputFiles[ i ], sandboxFile ) == false )
+        {
+            outError.Format( "Invalid input path: '%s'", m_InputFiles[ i ].Get() );
+            return false;
+        }
+        const AString & contents = m_InputContents[ i ];
+
+        FileStream f;
+        if ( ( FileIO::EnsurePathExistsForFile( sandboxFile ) == false ) ||
+             ( f.Open( sandboxFile.Get(), FileStream::WRITE_ONLY ) == false ) ||
+             ( f.WriteBuffer( contents.Get(), contents.GetLength() ) != contents.GetLength() ) )
+        {
+            outError.Format( "Failed to write input file. Error: %s File: '%s'", LAST_ERROR_STR, sandboxFile.Get() );
+            return false;
+        }
+    }
+    return true;
+}
+
+// GetSandboxPath
+//------------------------------------------------------------------------------
+bool ExecBundle::GetSandboxPath( const AString & fileName, AString & outPath ) const
+{
+    ASSERT( m_SandboxRoot.IsEmpty() == false ); // Extract must be called first
+    return HeaderBundle::GetSandboxPath( m_SandboxRoot, fileName, outPath );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,53 @@
+// ExecBundle - Inputs needed to run an Exec() or Test() executable remotely
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class IOStream;
+class Job;
+
+// ExecBundle
+//------------------------------------------------------------------------------
+// Exec() and Test() nodes can only be distributed if everything they read is
+// declared as an input. The job data holds the names and contents of those
+// inputs, which the worker writes to a sandbox mirroring the client's paths.
+// The executable itself is synchronized like a compiler (see ToolManifest).
+class ExecBundle
+{
+public:
+    ExecBundle();
+    ~ExecBundle();
+
+    // Client: read the inputs and store them (compressed) as the job data
+    // (fails if they are too large to distribute)
+    bool Init( const Array< AString > & inputFiles );
+    void Save( Job & job, int32_t compressionLevel ) const;
+
+    // Worker: read from the (possibly compressed) data of a job
+    bool Load( const Job & job );
+
+    const Array< AString > & GetInputFiles() const { return m_InputFiles; }
+
+    // Worker: write the inputs to a sandbox for the current thread (which is
+    // deleted again when the bundle is destroyed)
+    bool Extract( AString & outError );
+
+    // Location of a client file (or dir) in the sandbox (fails if the path would leave it)
+    bool GetSandboxPath( const AString & fileName, AString & outPath ) const;
+
+private:
+    bool Deserialize( IOStream & stream );
+
+    Array< AString >    m_InputFiles;
+    Array< AString >    m_InputContents;
+    AString             m_SandboxRoot;
+};
+
+//------------------------------------------------------------------------------
@@ -39,6 +39,9 @@ FBuildStats::FBuildStats()
     , m_TotalBuildTime( 0.0f )
     , m_TotalLocalCPUTimeMS( 0 )
     , m_TotalRemoteCPUTimeMS( 0 )
+    , m_NumRacesStarted( 0 )
+    , m_NumRacesWonLocally( 0 )
+    , m_NumRacesWonRemotely( 0 )
     , m_RootNode( nullptr )
     , m_NodesByTime( 100 * 1000, true )
 {}
@@ -192,6 +195,13 @@ void FBuildStats::OutputSummary() const
         output.AppendFormat( " - Misses     : %u\n", misses );
         output.AppendFormat( " - Stores     : %u\n", stores );
     }
+    if ( m_NumRacesStarted > 0 )
+    {
+        output += "Races:\n";
+        output.AppendFormat( " - Started    : %u\n", m_NumRacesStarted );
+        output.AppendFormat( " - Won Local  : %u\n", m_NumRacesWonLocally );
+        output.AppendFormat( " - Won Remote : %u\n", m_NumRacesWonRemotely );
+    }
 
     AStackString<> buffer;
     FormatTime( m_TotalBuildTime, buffer );
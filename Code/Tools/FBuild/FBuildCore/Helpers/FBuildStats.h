@@ -33,6 +33,11 @@ public:
     uint32_t    m_TotalLocalCPUTimeMS;  // Total CPU time on local host
     uint32_t    m_TotalRemoteCPUTimeMS; // Total CPU time on remote workers
 
+    // local races of remote jobs
+    uint32_t    m_NumRacesStarted;
+    uint32_t    m_NumRacesWonLocally;
+    uint32_t    m_NumRacesWonRemotely;
+
     // after the build it complete, accumulate all the stats
     void GatherPostBuildStatistics( const NodeGraph & nodeGraph, Node * node );
 
@@ -67,6 +72,22 @@ public:
         uint32_t m_CachingTimeMS;
     };
 
+    // performance of each remote worker used (gathered by the Client)
+    struct WorkerStats
+    {
+        AString     m_Name;
+        uint32_t    m_NumJobs           = 0;    // Jobs completed
+        uint32_t    m_NumFailures       = 0;    // System errors and jobs lost to disconnection
+        uint32_t    m_AvgLatencyMS      = 0;    // Time from sending a job to receiving the result
+        float       m_RelativeLatency   = 0.0f; // Latency relative to previous build times (0 if unknown)
+        uint64_t    m_BytesSent         = 0;
+        uint64_t    m_BytesReceived     = 0;
+        uint32_t    m_NumJobRequestBatches = 0; // Messages requesting several jobs
+        uint32_t    m_NumResultBatches  = 0;    // Messages returning several results
+        bool        m_Straggler         = false;
+    };
+    Array< WorkerStats > m_WorkerStats;
+
     static void FormatTime( float timeInSeconds, AString & outBuffer );
 
     const Node * GetRootNode() const { return m_RootNode; }
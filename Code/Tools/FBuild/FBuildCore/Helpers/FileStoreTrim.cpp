@@ -0,0 +1,59 @@
+// FileStoreTrim - Bound the files kept by a worker's file stores
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FileStoreTrim.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Time.h"
+
+// Trim
+//------------------------------------------------------------------------------
+/*static*/ uint32_t FileStoreTrim::Trim( const AString & root, uint64_t maxSize, uint32_t maxAgeSecs )
+{
+    PROFILE_FUNCTION;
+
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( root, nullptr, false, &files );
+
+    uint64_t totalSize = 0;
+    for ( const FileIO::FileInfo & info : files )
+    {
+        totalSize += info.m_Size;
+    }
+
+    // Least recently used first
+    files.Sort( []( const FileIO::FileInfo & a, const FileIO::FileInfo & b )
+    {
+        return ( a.m_LastWriteTime < b.m_LastWriteTime );
+    } );
+
+    #if defined( __WINDOWS__ )
+        const uint64_t maxAge = ( (uint64_t)maxAgeSecs * 10000000 );
+    #else
+        const uint64_t maxAge = ( (uint64_t)maxAgeSecs * 1000000000 );
+    #endif
+    const uint64_t currentTime = Time::GetCurrentFileTime();
+
+    uint32_t numRemoved = 0;
+    for ( const FileIO::FileInfo & info : files )
+    {
+        const bool tooOld = ( currentTime > info.m_LastWriteTime ) &&
+                            ( ( currentTime - info.m_LastWriteTime ) > maxAge );
+        if ( ( tooOld == false ) && ( totalSize <= maxSize ) )
+        {
+            break; // Remaining files were used more recently
+        }
+        if ( FileIO::FileDelete( info.m_Name.Get() ) )
+        {
+            totalSize -= info.m_Size;
+            ++numRemoved;
+        }
+    }
+    return numRemoved;
+}
+
+//------------------------------------------------------------------------------
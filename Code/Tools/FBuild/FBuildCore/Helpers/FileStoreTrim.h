@@ -0,0 +1,25 @@
+// FileStoreTrim - Bound the files kept by a worker's file stores
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// FileStoreTrim
+//------------------------------------------------------------------------------
+// File stores (see ToolFileStore, HeaderFileStore) record the use of a file by
+// updating its last write time. Files not used for longer than the age limit
+// are removed, followed by the least recently used files until the store is
+// within the size limit. Files in use can fail to be removed, which is fine.
+class FileStoreTrim
+{
+public:
+    static uint32_t Trim( const AString & root, uint64_t maxSize, uint32_t maxAgeSecs ); // returns num files removed
+};
+
+//------------------------------------------------------------------------------
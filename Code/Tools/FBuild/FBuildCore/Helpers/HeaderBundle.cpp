@@ -0,0 +1,249 @@
+// HeaderBundle - Source file and headers needed to compile it remotely
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "HeaderBundle.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/LightCache.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderFileStore.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+
+// Core
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define HEADER_BUNDLE_MAX_SOURCE_SIZE ( 256 * MEGABYTE ) // Larger sources are preprocessed instead
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+HeaderBundle::HeaderBundle()
+    : m_HeaderFiles( 256, true )
+    , m_HeaderHashes( 256, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+HeaderBundle::~HeaderBundle() = default;
+
+// Init
+//------------------------------------------------------------------------------
+bool HeaderBundle::Init( const AString & sourceFileName, const LightCache & lightCache )
+{
+    PROFILE_FUNCTION;
+
+    m_SourceFile = sourceFileName;
+
+    // The source is always needed, so it's sent with the job
+    {
+        FileStream f;
+        if ( ( f.Open( sourceFileName.Get() ) == false ) ||
+             ( f.GetFileSize() > HEADER_BUNDLE_MAX_SOURCE_SIZE ) )
+        {
+            return false;
+        }
+        const uint32_t fileSize = (uint32_t)f.GetFileSize();
+        m_SourceContents.SetLength( fileSize );
+        if ( f.ReadBuffer( m_SourceContents.Get(), fileSize ) != fileSize )
+        {
+            return false;
+        }
+    }
+
+    // Headers (and forced includes) are only sent if the worker needs them
+    Array< AString > fileNames;
+    Array< uint64_t > contentHashes;
+    lightCache.GetIncludedFiles( fileNames, contentHashes );
+    for ( size_t i = 0; i < fileNames.GetSize(); ++i )
+    {
+        if ( fileNames[ i ] != sourceFileName )
+        {
+            m_HeaderFiles.Append( fileNames[ i ] );
+            m_HeaderHashes.Append( contentHashes[ i ] );
+        }
+    }
+    return true;
+}
+
+// Serialize
+//------------------------------------------------------------------------------
+void HeaderBundle::Serialize( IOStream & stream ) const
+{
+    stream.Write( m_SourceFile );
+    stream.Write( m_SourceContents );
+    stream.Write( m_HeaderFiles );
+    stream.Write( m_HeaderHashes );
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool HeaderBundle::Load( const Job & job )
+{
+    const void * data = job.GetData();
+    size_t dataSize = job.GetDataSize();
+
+    // handle compressed data
+    Compressor c; // scoped here so we can access decompression buffer
+    if ( job.IsDataCompressed() )
+    {
+        if ( c.Decompress( data ) == false )
+        {
+            return false;
+        }
+        data = c.GetResult();
+        dataSize = c.GetResultSize();
+    }
+
+    ConstMemoryStream ms( data, dataSize );
+    return Deserialize( ms );
+}
+
+// Deserialize
+//------------------------------------------------------------------------------
+bool HeaderBundle::Deserialize( IOStream & stream )
+{
+    return ( stream.Read( m_SourceFile ) &&
+             stream.Read( m_SourceContents ) &&
+             stream.Read( m_HeaderFiles ) &&
+             stream.Read( m_HeaderHashes ) &&
+             ( m_HeaderFiles.GetSize() == m_HeaderHashes.GetSize() ) );
+}
+
+// GetExtractedSize
+//------------------------------------------------------------------------------
+uint64_t HeaderBundle::GetExtractedSize( const HeaderFileStore & store ) const
+{
+    uint64_t size = m_SourceContents.GetLength();
+    for ( const uint64_t hash : m_HeaderHashes )
+    {
+        size += store.GetSize( hash );
+    }
+    return size;
+}
+
+// Extract
+//------------------------------------------------------------------------------
+bool HeaderBundle::Extract( const HeaderFileStore & store, const AString & sandboxRoot, AString & outSourceFile, AString & outError ) const
+{
+    PROFILE_FUNCTION;
+
+    AStackString<> sandboxFile;
+    for ( size_t i = 0; i < m_HeaderFiles.GetSize(); ++i )
+    {
+        if ( GetSandboxPath( sandboxRoot, m_HeaderFiles[ i ], sandboxFile ) == false )
+        {
+            outError.Format( "Invalid header path: '%s'", m_HeaderFiles[ i ].Get() );
+            return false;
+        }
+        if ( store.Retrieve( m_HeaderHashes[ i ], sandboxFile ) == false )
+        {
+            // Not stored if the client couldn't provide it (e.g. modified during the build)
+            outError.Format( "Header unavailable: '%s'", m_HeaderFiles[ i ].Get() );
+            return false;
+        }
+    }
+
+    if ( GetSandboxPath( sandboxRoot, m_SourceFile, outSourceFile ) == false )
+    {
+        outError.Format( "Invalid source path: '%s'", m_SourceFile.Get() );
+        return false;
+    }
+    FileStream f;
+    if ( ( FileIO::EnsurePathExistsForFile( outSourceFile ) == false ) ||
+         ( f.Open( outSourceFile.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( m_SourceContents.Get(), m_SourceContents.GetLength() ) != m_SourceContents.GetLength() ) )
+    {
+        outError.Format( "Failed to write source file. Error: %s File: '%s'", LAST_ERROR_STR, outSourceFile.Get() );
+        return false;
+    }
+    return true;
+}
+
+// DeleteSandbox
+//------------------------------------------------------------------------------
+/*static*/ void HeaderBundle::DeleteSandbox( const AString & sandboxRoot )
+{
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( sandboxRoot, nullptr, true, &files );
+
+    // Delete files, noting the directories they were in
+    Array< AString > dirs( files.GetSize(), true );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        FileIO::FileDelete( file.m_Name.Get() );
+
+        AStackString<> dir( file.m_Name.Get(), file.m_Name.FindLast( NATIVE_SLASH ) );
+        while ( ( dir.GetLength() > sandboxRoot.GetLength() ) && ( dirs.Find( dir ) == nullptr ) )
+        {
+            dirs.Append( dir );
+            const char * parentEnd = dir.FindLast( NATIVE_SLASH );
+            if ( parentEnd == nullptr )
+            {
+                break;
+            }
+            dir.SetLength( (uint32_t)( parentEnd - dir.Get() ) );
+        }
+    }
+
+    // Then directories (children before parents)
+    dirs.Sort( []( const AString & a, const AString & b ) { return ( a.GetLength() > b.GetLength() ); } );
+    for ( const AString & dir : dirs )
+    {
+        FileIO::DirectoryDelete( dir );
+    }
+    AStackString<> root( sandboxRoot );
+    root.TrimEnd( NATIVE_SLASH );
+    FileIO::DirectoryDelete( root );
+}
+
+// GetSandboxPath
+//------------------------------------------------------------------------------
+/*static*/ bool HeaderBundle::GetSandboxPath( const AString & sandboxRoot, const AString & fileName, AString & outPath )
+{
+    ASSERT( sandboxRoot.EndsWith( NATIVE_SLASH ) );
+    outPath = sandboxRoot;
+
+    // Client paths are absolute, so only the root (or drive) needs removing
+    const char * pos = fileName.Get();
+    #if defined( __WINDOWS__ )
+        if ( ( fileName.GetLength() >= 2 ) && ( pos[ 1 ] == ':' ) )
+        {
+            outPath += pos[ 0 ]; // Drive letter becomes a directory
+            pos += 2;
+        }
+    #endif
+    while ( ( *pos == NATIVE_SLASH ) || ( *pos == OTHER_SLASH ) )
+    {
+        ++pos;
+    }
+
+    // Paths come from the client, so must not leave the sandbox (e.g. "/a/../../b")
+    AStackString<> relativePath;
+    NodeGraph::CleanPath( AStackString<>( pos ), relativePath, false );
+    if ( relativePath.BeginsWith( ".." ) &&
+         ( ( relativePath.GetLength() == 2 ) || ( relativePath[ 2 ] == NATIVE_SLASH ) ) )
+    {
+        return false;
+    }
+
+    if ( outPath.EndsWith( NATIVE_SLASH ) == false )
+    {
+        outPath += NATIVE_SLASH;
+    }
+    outPath += relativePath;
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,59 @@
+// HeaderBundle - Source file and headers needed to compile it remotely
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class HeaderFileStore;
+class IOStream;
+class Job;
+class LightCache;
+
+// HeaderBundle
+//------------------------------------------------------------------------------
+// An alternative to preprocessing on the client before distributing a job.
+// The job data holds the source file and the names and content hashes of the
+// headers found by the LightCache. The worker requests headers it doesn't have
+// (see HeaderFileStore) and compiles the source in a sandbox which mirrors the
+// client's paths.
+class HeaderBundle
+{
+public:
+    HeaderBundle();
+    ~HeaderBundle();
+
+    // Client: gather files after LightCache::Hash succeeded
+    bool Init( const AString & sourceFileName, const LightCache & lightCache );
+    void Serialize( IOStream & stream ) const;
+
+    // Worker: read from the (possibly compressed) data of a job
+    bool Load( const Job & job );
+
+    const AString &             GetSourceFile() const       { return m_SourceFile; }
+    const Array< AString > &    GetHeaderFiles() const      { return m_HeaderFiles; }
+    const Array< uint64_t > &   GetHeaderHashes() const     { return m_HeaderHashes; }
+
+    // Worker: write the source and headers to their mirrored locations
+    uint64_t GetExtractedSize( const HeaderFileStore & store ) const;
+    bool Extract( const HeaderFileStore & store, const AString & sandboxRoot, AString & outSourceFile, AString & outError ) const;
+    static void DeleteSandbox( const AString & sandboxRoot );
+
+    // Location of a client file in the sandbox (fails if the path would leave it)
+    static bool GetSandboxPath( const AString & sandboxRoot, const AString & fileName, AString & outPath );
+
+private:
+    bool Deserialize( IOStream & stream );
+
+    AString             m_SourceFile;
+    AString             m_SourceContents;
+    Array< AString >    m_HeaderFiles;
+    Array< uint64_t >   m_HeaderHashes;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,146 @@
+// HeaderFileStore - Headers received by a worker for header bundle jobs
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "HeaderFileStore.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileStoreTrim.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define HEADER_FILE_STORE_MAX_SIZE ( 1024ULL * 1024 * 1024 ) // 1 GiB
+#define HEADER_FILE_STORE_MAX_AGE_SECS ( 24 * 60 * 60 ) // 1 day
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+HeaderFileStore::HeaderFileStore()
+    : m_MaxSize( HEADER_FILE_STORE_MAX_SIZE )
+    , m_MaxAgeSecs( HEADER_FILE_STORE_MAX_AGE_SECS )
+{
+    VERIFY( FBuild::GetTempDir( m_Root ) );
+    #if defined( __WINDOWS__ )
+        m_Root += ".fbuild.tmp\\worker\\headers\\";
+    #else
+        m_Root += "_fbuild.tmp/worker/headers/";
+    #endif
+}
+
+// SetRoot
+//------------------------------------------------------------------------------
+void HeaderFileStore::SetRoot( const AString & root )
+{
+    m_Root = root;
+    PathUtils::EnsureTrailingSlash( m_Root );
+}
+
+// Has
+//------------------------------------------------------------------------------
+bool HeaderFileStore::Has( uint64_t contentHash ) const
+{
+    AStackString<> storeFileName;
+    GetStoreFileName( contentHash, storeFileName );
+
+    // Record the use, so the header is kept until the job retrieves it (see Trim)
+    return FileIO::SetFileLastWriteTimeToNow( storeFileName );
+}
+
+// GetSize
+//------------------------------------------------------------------------------
+uint64_t HeaderFileStore::GetSize( uint64_t contentHash ) const
+{
+    AStackString<> storeFileName;
+    GetStoreFileName( contentHash, storeFileName );
+    FileIO::FileInfo info;
+    return FileIO::GetFileInfo( storeFileName, info ) ? info.m_Size : 0;
+}
+
+// Store
+//------------------------------------------------------------------------------
+bool HeaderFileStore::Store( uint64_t contentHash, const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    // Contents are checked once here, so they can be used without checking later
+    if ( xxHash3::Calc64( data, dataSize ) != contentHash )
+    {
+        return false;
+    }
+
+    AStackString<> storeFileName;
+    GetStoreFileName( contentHash, storeFileName );
+    if ( FileIO::SetFileLastWriteTimeToNow( storeFileName ) )
+    {
+        return true; // Already stored (and the use recorded)
+    }
+
+    // Write to a temporary file first, so an interrupted write is never
+    // mistaken for a stored file
+    AStackString<> tmpFileName;
+    tmpFileName.Format( "%s.%u.tmp", storeFileName.Get(), m_NumFilesStored.Increment() );
+    {
+        FileStream f;
+        if ( ( FileIO::EnsurePathExistsForFile( tmpFileName ) == false ) ||
+             ( f.Open( tmpFileName.Get(), FileStream::WRITE_ONLY ) == false ) ||
+             ( f.WriteBuffer( data, dataSize ) != dataSize ) )
+        {
+            f.Close();
+            FileIO::FileDelete( tmpFileName.Get() );
+            return false;
+        }
+    }
+    if ( FileIO::FileMove( tmpFileName, storeFileName ) == false )
+    {
+        FileIO::FileDelete( tmpFileName.Get() );
+        return FileIO::FileExists( storeFileName.Get() ); // Another thread may have stored the same header
+    }
+    return true;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool HeaderFileStore::Retrieve( uint64_t contentHash, const AString & dstFileName ) const
+{
+    AStackString<> storeFileName;
+    GetStoreFileName( contentHash, storeFileName );
+
+    // Record the use, so the header is kept (see Trim)
+    FileIO::SetFileLastWriteTimeToNow( storeFileName );
+
+    return ( FileIO::EnsurePathExistsForFile( dstFileName ) &&
+             FileIO::FileCopy( storeFileName.Get(), dstFileName.Get() ) );
+}
+
+// SetLimits
+//------------------------------------------------------------------------------
+void HeaderFileStore::SetLimits( uint64_t maxSize, uint32_t maxAgeSecs )
+{
+    m_MaxSize = maxSize;
+    m_MaxAgeSecs = maxAgeSecs;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+uint32_t HeaderFileStore::Trim()
+{
+    return FileStoreTrim::Trim( m_Root, m_MaxSize, m_MaxAgeSecs );
+}
+
+// GetStoreFileName
+//------------------------------------------------------------------------------
+void HeaderFileStore::GetStoreFileName( uint64_t contentHash, AString & outFileName ) const
+{
+    outFileName.Format( "%s%016" PRIX64, m_Root.Get(), contentHash );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,49 @@
+// HeaderFileStore - Headers received by a worker for header bundle jobs
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Strings/AString.h"
+
+// HeaderFileStore
+//------------------------------------------------------------------------------
+// Jobs sent as header bundles (see HeaderBundle) only list the headers they
+// need. Headers are kept here, keyed by their contents, so each one is only
+// transferred from a client once, no matter how many jobs (or clients) use it.
+class HeaderFileStore
+{
+public:
+    HeaderFileStore();
+
+    // Location of the store (defaults to the worker temp dir)
+    void            SetRoot( const AString & root );
+    const AString & GetRoot() const { return m_Root; }
+
+    bool            Has( uint64_t contentHash ) const;
+    uint64_t        GetSize( uint64_t contentHash ) const; // 0 if not stored
+
+    // Add a header received from a client (fails if the contents don't match the hash)
+    bool            Store( uint64_t contentHash, const void * data, size_t dataSize );
+
+    // Place a copy of a stored header at the given path
+    bool            Retrieve( uint64_t contentHash, const AString & dstFileName ) const;
+
+    // Remove headers no job has used recently (see FileStoreTrim)
+    void            SetLimits( uint64_t maxSize, uint32_t maxAgeSecs );
+    uint32_t        Trim(); // returns num files removed
+
+    uint32_t        GetNumFilesStored() const { return m_NumFilesStored.Load(); }
+
+private:
+    void            GetStoreFileName( uint64_t contentHash, AString & outFileName ) const;
+
+    AString             m_Root;
+    uint64_t            m_MaxSize;
+    uint32_t            m_MaxAgeSecs;
+    Atomic<uint32_t>    m_NumFilesStored;
+};
+
+//------------------------------------------------------------------------------
@@ -155,6 +155,39 @@ bool MultiBuffer::ExtractFile( size_t index, const AString& fileName ) const
     return true;
 }
 
+// GetFileRange
+//------------------------------------------------------------------------------
+/*static*/ bool MultiBuffer::GetFileRange( const void * header,
+                                           size_t headerSize,
+                                           size_t index,
+                                           uint64_t & outOffset,
+                                           uint64_t & outSize )
+{
+    ConstMemoryStream stream( header, headerSize );
+    uint32_t numFiles = 0;
+    if ( ( stream.Read( numFiles ) == false ) ||
+         ( index >= numFiles ) ||
+         ( numFiles > MAX_FILES ) )
+    {
+        return false;
+    }
+
+    // work out data offset from file sizes
+    outOffset = sizeof( uint32_t ) + ( sizeof( uint64_t ) * numFiles );
+    for ( size_t i = 0; i <= index; ++i )
+    {
+        if ( stream.Read( outSize ) == false )
+        {
+            return false;
+        }
+        if ( i < index )
+        {
+            outOffset += outSize;
+        }
+    }
+    return true;
+}
+
 // Compress
 //------------------------------------------------------------------------------
 void MultiBuffer::Compress( int32_t compressionLevel )
@@ -170,9 +203,24 @@ void MultiBuffer::Compress( int32_t compressionLevel )
     m_WriteStream->Replace( c.ReleaseResult(), compressedSize );
 }
 
+// CompressZstd
+//------------------------------------------------------------------------------
+void MultiBuffer::CompressZstd( int32_t compressionLevel, const CompressorDictionary * dictionary )
+{
+    ASSERT( m_WriteStream ); // Data needs to be populated
+
+    // Compress the data
+    Compressor c;
+    c.CompressZstd( m_WriteStream->GetData(), m_WriteStream->GetSize(), compressionLevel, dictionary );
+
+    // Transfer compressed results
+    const size_t compressedSize = c.GetResultSize();
+    m_WriteStream->Replace( c.ReleaseResult(), compressedSize );
+}
+
 // Decompress
 //------------------------------------------------------------------------------
-bool MultiBuffer::Decompress()
+bool MultiBuffer::Decompress( const CompressorDictionary * dictionary )
 {
     ASSERT( m_ReadStream ); // Data needs to be populated
 
@@ -182,7 +230,7 @@ bool MultiBuffer::Decompress()
         return false;
     }
     Compressor c;
-    if ( c.Decompress( m_ReadStream->GetData() ) == false )
+    if ( c.Decompress( m_ReadStream->GetData(), dictionary ) == false )
     {
         return false;
     }
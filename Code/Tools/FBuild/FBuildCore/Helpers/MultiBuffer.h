@@ -11,6 +11,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+class CompressorDictionary;
 class ConstMemoryStream;
 class MemoryStream;
 
@@ -27,15 +28,21 @@ public:
     bool ExtractFile( size_t index, const AString& fileName ) const;
 
     void Compress( int32_t compressionLevel );
-    bool Decompress();
+    void CompressZstd( int32_t compressionLevel, const CompressorDictionary * dictionary = nullptr );
+    bool Decompress( const CompressorDictionary * dictionary = nullptr );
 
     const void *    GetData() const;
     uint64_t        GetDataSize() const;
 
     void *          Release( size_t & outSize );
 
-private:
+    // Locate a file within serialized data, using just the start of it (up to MAX_HEADER_SIZE)
+    static bool     GetFileRange( const void * header, size_t headerSize, size_t index, uint64_t & outOffset, uint64_t & outSize );
+
     enum : uint32_t { MAX_FILES = 4 };
+    enum : uint32_t { MAX_HEADER_SIZE = ( sizeof( uint32_t ) + ( MAX_FILES * sizeof( uint64_t ) ) ) };
+
+private:
 
     ConstMemoryStream * m_ReadStream;
     MemoryStream *      m_WriteStream;
@@ -0,0 +1,157 @@
+// ProcFS - Parse the contents of Linux /proc, cgroup and pressure files
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ProcFS.h"
+
+// Core
+#include "Core/Strings/AString.h"
+
+// system
+#include <stdlib.h>
+
+// ParseSystemStat
+//------------------------------------------------------------------------------
+/*static*/ bool ProcFS::ParseSystemStat( const AString & stat,
+                                         uint64_t & outIdleTicks,
+                                         uint64_t & outKernTicks,
+                                         uint64_t & outUserTicks )
+{
+    // First line should be system totals
+    if ( stat.BeginsWith( "cpu " ) == false )
+    {
+        return false;
+    }
+
+    uint64_t values[ 16 ];
+    uint32_t numValues = 0;
+    const char * pos = stat.Get() + 4; // skip "cpu "
+    while ( numValues < 16 )
+    {
+        char * end;
+        const uint64_t value = strtoull( pos, &end, 10 );
+        if ( end == pos )
+        {
+            break; // end of line
+        }
+        values[ numValues++ ] = value;
+        pos = end;
+    }
+    if ( numValues < 4 )
+    {
+        return false;
+    }
+
+    // 0+1 = user/nice time, 2 = kernel time
+    outUserTicks = values[ 0 ] + values[ 1 ];
+    outKernTicks = values[ 2 ];
+
+    // idle is all times minus user/nice/kernel
+    outIdleTicks = 0;
+    for ( uint32_t i = 3; i < numValues; ++i )
+    {
+        outIdleTicks += values[ i ];
+    }
+    return true;
+}
+
+// ParseProcessStat
+//------------------------------------------------------------------------------
+/*static*/ bool ProcFS::ParseProcessStat( const AString & stat,
+                                          uint32_t & outParentPID,
+                                          uint64_t & outUserTicks,
+                                          uint64_t & outKernTicks )
+{
+    // Fields after the exe name (index 1) start with the state (index 2)
+    const char * pos = stat.FindLast( ')' );
+    if ( pos == nullptr )
+    {
+        return false;
+    }
+    ++pos;
+    while ( *pos == ' ' )
+    {
+        ++pos;
+    }
+    if ( ( *pos == '\0' ) || ( pos[ 1 ] != ' ' ) )
+    {
+        return false; // state is a single character
+    }
+    ++pos;
+
+    // Item index 3 (0-based) is the parent PID and 13 and 14 are the utime
+    // and stime. Some fields in between can be negative.
+    int64_t values[ 15 ];
+    for ( uint32_t i = 3; i < 15; ++i )
+    {
+        char * end;
+        values[ i ] = strtoll( pos, &end, 10 );
+        if ( end == pos )
+        {
+            return false;
+        }
+        pos = end;
+    }
+    outParentPID = (uint32_t)values[ 3 ];
+    outUserTicks = (uint64_t)values[ 13 ];
+    outKernTicks = (uint64_t)values[ 14 ];
+    return true;
+}
+
+// ParseCGroupPath
+//------------------------------------------------------------------------------
+/*static*/ bool ProcFS::ParseCGroupPath( const AString & cgroups, AString & outPath )
+{
+    const char * entry = cgroups.BeginsWith( "0::" ) ? cgroups.Get() : cgroups.Find( "\n0::" );
+    if ( entry == nullptr )
+    {
+        return false; // Only cgroup v1 is available
+    }
+    entry = cgroups.Find( "::", entry ) + 2;
+    const char * entryEnd = cgroups.Find( '\n', entry );
+    outPath.Assign( entry, entryEnd ? entryEnd : cgroups.GetEnd() );
+    return true;
+}
+
+// ParseCPUMax
+//------------------------------------------------------------------------------
+/*static*/ bool ProcFS::ParseCPUMax( const AString & cpuMax, float & outNumCPUs )
+{
+    uint32_t quota = 0;
+    uint32_t period = 0;
+    if ( ( cpuMax.Scan( "%u %u", &quota, &period ) != 2 ) || ( period == 0 ) )
+    {
+        return false; // "max" if unlimited
+    }
+    outNumCPUs = (float)quota / (float)period;
+    return true;
+}
+
+// ParsePressure
+//------------------------------------------------------------------------------
+/*static*/ bool ProcFS::ParsePressure( const AString & pressure, float & outPercent )
+{
+    return ( pressure.Scan( "some avg10=%f", &outPercent ) == 1 );
+}
+
+// ParseKeyValue
+//------------------------------------------------------------------------------
+/*static*/ bool ProcFS::ParseKeyValue( const AString & contents, const char * key, uint64_t & outValue )
+{
+    const size_t keyLen = AString::StrLen( key );
+    for ( const char * line = contents.Get(); line; )
+    {
+        if ( ( AString::StrNCmp( line, key, keyLen ) == 0 ) && ( line[ keyLen ] == ' ' ) )
+        {
+            char * end;
+            outValue = strtoull( line + keyLen + 1, &end, 10 );
+            return ( end != ( line + keyLen + 1 ) );
+        }
+        line = contents.Find( '\n', line );
+        line = line ? ( line + 1 ) : nullptr;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
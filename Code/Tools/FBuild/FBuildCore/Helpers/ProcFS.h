@@ -0,0 +1,49 @@
+// ProcFS - Parse the contents of Linux /proc, cgroup and pressure files
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// ProcFS
+//------------------------------------------------------------------------------
+// Parsing is separate from reading the files, so formats can be tested on any
+// platform (and edge cases tested without creating processes with odd names).
+class ProcFS
+{
+public:
+    // /proc/stat - System totals are on the first line
+    // e.g. "cpu  user nice system idle iowait irq softirq steal guest guest_nice"
+    // Idle time is everything other than user, nice and system time.
+    static bool ParseSystemStat( const AString & stat,
+                                 uint64_t & outIdleTicks,
+                                 uint64_t & outKernTicks,
+                                 uint64_t & outUserTicks );
+
+    // /proc/<pid>/stat - e.g. "1234 (exe name) S 1 ..."
+    // The exe name can contain spaces and ')', so fields are counted from the last ')'
+    static bool ParseProcessStat( const AString & stat,
+                                  uint32_t & outParentPID,
+                                  uint64_t & outUserTicks,
+                                  uint64_t & outKernTicks );
+
+    // /proc/self/cgroup - Path of the (v2) unified hierarchy entry "0::<path>"
+    static bool ParseCGroupPath( const AString & cgroups, AString & outPath );
+
+    // cpu.max - "<quota> <period>", or "max <period>" if unlimited
+    static bool ParseCPUMax( const AString & cpuMax, float & outNumCPUs );
+
+    // cpu.pressure, memory.pressure - Percentage of time at least one task was stalled
+    // e.g. "some avg10=1.23 avg60=0.87 avg300=0.20 total=12345"
+    static bool ParsePressure( const AString & pressure, float & outPercent );
+
+    // cpu.stat and similar - One "key value" pair per line
+    static bool ParseKeyValue( const AString & contents, const char * key, uint64_t & outValue );
+};
+
+//------------------------------------------------------------------------------
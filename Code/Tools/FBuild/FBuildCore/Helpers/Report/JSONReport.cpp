@@ -43,6 +43,9 @@ void JSONReport::Generate( const NodeGraph & nodeGraph, const FBuildStats & stat
     DoCacheStats( stats );
     Write( ",\n\t" );
 
+    DoWorkerStats( stats );
+    Write( ",\n\t" );
+
     DoCPUTimeByLibrary();
     Write( ",\n\t" );
 
@@ -135,6 +138,11 @@ void JSONReport::CreateOverview( const FBuildStats & stats )
     const float remoteRatio = ( totalRemoteCPUInSeconds / totalBuildTime );
     Write( "\"Remote CPU Time\": \"%s (%.1f:1)\",\n\t\t", buffer.Get(), (double)remoteRatio );
 
+    // Local races of remote jobs
+    Write( "\"Races Started\": %u,\n\t\t", stats.m_NumRacesStarted );
+    Write( "\"Races Won Locally\": %u,\n\t\t", stats.m_NumRacesWonLocally );
+    Write( "\"Races Won Remotely\": %u,\n\t\t", stats.m_NumRacesWonRemotely );
+
     // version info
     Write( "\"Version\": \"%s %s\",\n\t\t", FBUILD_VERSION_STRING, FBUILD_VERSION_PLATFORM );
 
@@ -370,7 +378,9 @@ void JSONReport::DoCacheStats( const FBuildStats & /*stats*/ )
             Write( "\n\t\t\t\t" );
 
             Write( "\"Stores\": %u,\n\t\t\t\t", cStores );
-            Write( "\"Store Time (s)\": %.3f\n\t\t\t", (double)cStoreTime );
+            Write( "\"Store Time (s)\": %.3f,\n\t\t\t\t", (double)cStoreTime );
+            Write( "\"Hit Bytes\": %" PRIu64 ",\n\t\t\t\t", ls->m_CacheHitBytes );
+            Write( "\"Store Bytes\": %" PRIu64 "\n\t\t\t", ls->m_CacheStoreBytes );
 
             Write( "}" );
 
@@ -387,6 +397,41 @@ void JSONReport::DoCacheStats( const FBuildStats & /*stats*/ )
     Write( "\n\t}" );
 }
 
+// DoWorkerStats
+//------------------------------------------------------------------------------
+void JSONReport::DoWorkerStats( const FBuildStats & stats )
+{
+    Write( "\"Remote Workers\": [" );
+
+    for ( size_t i = 0; i < stats.m_WorkerStats.GetSize(); ++i )
+    {
+        const FBuildStats::WorkerStats & ws = stats.m_WorkerStats[ i ];
+
+        AStackString<> name( ws.m_Name );
+        JSON::Escape( name );
+
+        Write( "\n\t\t{\n\t\t\t" );
+        Write( "\"Name\": \"%s\",\n\t\t\t", name.Get() );
+        Write( "\"Jobs\": %u,\n\t\t\t", ws.m_NumJobs );
+        Write( "\"Failures\": %u,\n\t\t\t", ws.m_NumFailures );
+        Write( "\"Average Latency (ms)\": %u,\n\t\t\t", ws.m_AvgLatencyMS );
+        Write( "\"Relative Latency\": %.2f,\n\t\t\t", (double)ws.m_RelativeLatency );
+        Write( "\"Sent (MiB)\": %.2f,\n\t\t\t", (double)ws.m_BytesSent / (double)MEGABYTE );
+        Write( "\"Received (MiB)\": %.2f,\n\t\t\t", (double)ws.m_BytesReceived / (double)MEGABYTE );
+        Write( "\"Job Request Batches\": %u,\n\t\t\t", ws.m_NumJobRequestBatches );
+        Write( "\"Result Batches\": %u,\n\t\t\t", ws.m_NumResultBatches );
+        Write( "\"Straggler\": %s", ws.m_Straggler ? "true" : "false" );
+        Write( "\n\t\t}" );
+
+        if ( i < stats.m_WorkerStats.GetSize() - 1 )
+        {
+            Write( "," );
+        }
+    }
+
+    Write( "\n\t]" );
+}
+
 // DoCPUTimeByLibrary
 //------------------------------------------------------------------------------
 void JSONReport::DoCPUTimeByLibrary()
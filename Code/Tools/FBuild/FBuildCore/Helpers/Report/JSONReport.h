@@ -25,6 +25,7 @@ private:
     // JsonReport sections
     void CreateOverview( const FBuildStats & stats );
     void DoCacheStats( const FBuildStats & stats );
+    void DoWorkerStats( const FBuildStats & stats );
     void DoCPUTimeByType( const FBuildStats & stats );
     void DoCPUTimeByItem( const FBuildStats & stats );
     void DoCPUTimeByLibrary();
@@ -157,11 +157,13 @@ void Report::GetLibraryStatsRecurse( Array< LibraryStats * > & libStats, const N
             if ( cacheHit )
             {
                 currentLib->m_ObjectCount_CacheHits++;
+                currentLib->m_CacheHitBytes += node->GetCachingBytes();
             }
             if ( node->GetStatFlag( Node::STATS_CACHE_STORE ) )
             {
                 currentLib->m_ObjectCount_CacheStores++;
                 currentLib->m_CacheTimeMS += node->GetCachingTime();
+                currentLib->m_CacheStoreBytes += node->GetCachingBytes();
             }
         }
 
@@ -199,6 +201,8 @@ void Report::GetLibraryStatsRecurse( Array< LibraryStats * > & libStats, const N
         currentLib->m_ObjectCount_CacheHits = 0;
         currentLib->m_ObjectCount_CacheStores = 0;
         currentLib->m_CacheTimeMS = 0;
+        currentLib->m_CacheHitBytes = 0;
+        currentLib->m_CacheStoreBytes = 0;
 
         // count time for library/dll itself
         if ( node->GetStatFlag( Node::STATS_BUILT ) || node->GetStatFlag( Node::STATS_FAILED ) )
@@ -51,6 +51,8 @@ protected:
         uint32_t        m_ObjectCount_CacheHits;
         uint32_t        m_ObjectCount_CacheStores;
         uint32_t        m_CacheTimeMS;
+        uint64_t        m_CacheHitBytes;
+        uint64_t        m_CacheStoreBytes;
 
         bool operator < ( const LibraryStats & other ) const { return m_CPUTimeMS > other.m_CPUTimeMS; }
     };
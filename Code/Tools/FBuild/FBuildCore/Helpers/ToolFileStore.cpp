@@ -0,0 +1,221 @@
+// ToolFileStore - Toolchain files on a worker, shared between toolchains
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ToolFileStore.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileStoreTrim.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/Env/Env.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define TOOL_FILE_STORE_MAX_SIZE ( 4ULL * 1024 * 1024 * 1024 ) // 4 GiB
+#define TOOL_FILE_STORE_MAX_AGE_SECS ( 7 * 24 * 60 * 60 ) // 1 week
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+ToolFileStore::ToolFileStore()
+    : m_MaxSize( TOOL_FILE_STORE_MAX_SIZE )
+    , m_MaxAgeSecs( TOOL_FILE_STORE_MAX_AGE_SECS )
+{
+    GetDefaultRoot( m_Root );
+}
+
+// SetRoot
+//------------------------------------------------------------------------------
+void ToolFileStore::SetRoot( const AString & root )
+{
+    m_Root = root;
+    PathUtils::EnsureTrailingSlash( m_Root );
+}
+
+// GetDefaultRoot
+//------------------------------------------------------------------------------
+/*static*/ void ToolFileStore::GetDefaultRoot( AString & outRoot )
+{
+    // The temp dir can be cleaned at any time (e.g. on reboot), losing every
+    // stored file, so prefer the user's cache dir
+    if ( GetCacheDir( outRoot ) )
+    {
+        #if defined( __WINDOWS__ )
+            outRoot += "FASTBuild\\ToolFiles\\";
+        #else
+            outRoot += "fastbuild/toolfiles/";
+        #endif
+        return;
+    }
+
+    VERIFY( FBuild::GetTempDir( outRoot ) );
+    #if defined( __WINDOWS__ )
+        outRoot += ".fbuild.tmp\\worker\\files\\";
+    #else
+        outRoot += "_fbuild.tmp/worker/files/";
+    #endif
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool ToolFileStore::Retrieve( const ToolManifestFile & file, const AString & dstFileName )
+{
+    PROFILE_FUNCTION;
+
+    if ( file.GetContentHash() == 0 )
+    {
+        return false; // Client doesn't send content hashes
+    }
+
+    AStackString<> storeFileName;
+    GetStoreFileName( file, storeFileName );
+
+    // Check the stored file is intact before using it
+    {
+        FileStream f;
+        if ( ( f.Open( storeFileName.Get() ) == false ) ||
+             ( f.GetFileSize() != file.GetUncompressedContentSize() ) )
+        {
+            return false; // Never stored (or incomplete)
+        }
+        UniquePtr< char > mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
+        if ( ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() ) ||
+             ( xxHash3::Calc64( mem.Get(), (size_t)f.GetFileSize() ) != file.GetContentHash() ) )
+        {
+            // Remove corrupt file so it can be stored again
+            f.Close();
+            FileIO::FileDelete( storeFileName.Get() );
+            return false;
+        }
+    }
+
+    // Record the use, so the file is kept (see Trim)
+    FileIO::SetFileLastWriteTimeToNow( storeFileName );
+
+    // Link (or copy, sharing storage where supported)
+    if ( FileIO::EnsurePathExistsForFile( dstFileName ) == false )
+    {
+        return false;
+    }
+    FileIO::FileDelete( dstFileName.Get() ); // Remove any incomplete file
+    if ( ( FileIO::FileLink( storeFileName, dstFileName ) == false ) &&
+         ( FileIO::FileCopyRange( storeFileName, 0, file.GetUncompressedContentSize(), dstFileName ) == false ) )
+    {
+        return false;
+    }
+
+    // mark executable
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        FileIO::SetExecutable( dstFileName.Get() );
+    #endif
+
+    m_NumFilesRetrieved.Increment();
+    return true;
+}
+
+// Store
+//------------------------------------------------------------------------------
+void ToolFileStore::Store( const ToolManifestFile & file, const AString & srcFileName )
+{
+    PROFILE_FUNCTION;
+
+    if ( file.GetContentHash() == 0 )
+    {
+        return; // Client doesn't send content hashes
+    }
+
+    AStackString<> storeFileName;
+    GetStoreFileName( file, storeFileName );
+    if ( FileIO::FileExists( storeFileName.Get() ) )
+    {
+        return; // Already stored
+    }
+
+    // Link to the toolchain file, which is complete (only possible when the
+    // store is on the same volume)
+    if ( FileIO::EnsurePathExistsForFile( storeFileName ) &&
+         FileIO::FileLink( srcFileName, storeFileName ) )
+    {
+        return;
+    }
+
+    // Otherwise copy to a temporary
+    // file first, so an interrupted copy is never mistaken for a stored file
+    AStackString<> tmpFileName;
+    tmpFileName.Format( "%s.%u.tmp", storeFileName.Get(), m_NumFilesStored.Increment() );
+    if ( ( FileIO::FileCopyRange( srcFileName, 0, file.GetUncompressedContentSize(), tmpFileName ) == false ) ||
+         ( FileIO::FileMove( tmpFileName, storeFileName ) == false ) )
+    {
+        FileIO::FileDelete( tmpFileName.Get() );
+    }
+}
+
+// SetLimits
+//------------------------------------------------------------------------------
+void ToolFileStore::SetLimits( uint64_t maxSize, uint32_t maxAgeSecs )
+{
+    m_MaxSize = maxSize;
+    m_MaxAgeSecs = maxAgeSecs;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+uint32_t ToolFileStore::Trim()
+{
+    // Files linked to toolchains in use are kept recent by ToolManifest::TouchFiles
+    return FileStoreTrim::Trim( m_Root, m_MaxSize, m_MaxAgeSecs );
+}
+
+// GetStoreFileName
+//------------------------------------------------------------------------------
+void ToolFileStore::GetStoreFileName( const ToolManifestFile & file, AString & outFileName ) const
+{
+    // Keyed by contents only, so identical files are shared whatever their
+    // name or toolchain
+    outFileName.Format( "%s%016" PRIX64 "-%08X", m_Root.Get(), file.GetContentHash(), file.GetUncompressedContentSize() );
+}
+
+// GetCacheDir
+//------------------------------------------------------------------------------
+/*static*/ bool ToolFileStore::GetCacheDir( AString & outDir )
+{
+    #if defined( __WINDOWS__ )
+        if ( Env::GetEnvVariable( "LOCALAPPDATA", outDir ) && ( outDir.IsEmpty() == false ) )
+        {
+            PathUtils::EnsureTrailingSlash( outDir );
+            return true;
+        }
+    #elif defined( __OSX__ )
+        if ( Env::GetEnvVariable( "HOME", outDir ) && ( outDir.IsEmpty() == false ) )
+        {
+            PathUtils::EnsureTrailingSlash( outDir );
+            outDir += "Library/Caches/";
+            return true;
+        }
+    #else
+        if ( Env::GetEnvVariable( "XDG_CACHE_HOME", outDir ) && ( outDir.IsEmpty() == false ) )
+        {
+            PathUtils::EnsureTrailingSlash( outDir );
+            return true;
+        }
+        if ( Env::GetEnvVariable( "HOME", outDir ) && ( outDir.IsEmpty() == false ) )
+        {
+            PathUtils::EnsureTrailingSlash( outDir );
+            outDir += ".cache/";
+            return true;
+        }
+    #endif
+    return false;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+// ToolFileStore - Toolchain files on a worker, shared between toolchains
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ToolManifestFile;
+
+// ToolFileStore
+//------------------------------------------------------------------------------
+// Different toolchains (e.g. patch releases of the same compiler) have most of
+// their files in common. Files received for any toolchain are kept here, keyed
+// by their contents, so a new toolchain only needs to synchronize files the
+// worker has never seen. The store is kept outside the temp dir, so it survives
+// the temp dir being cleaned. Stored files are hard links to toolchain files
+// when on the same volume (copies otherwise), so they take no extra space while
+// a toolchain uses them.
+class ToolFileStore
+{
+public:
+    ToolFileStore();
+
+    // Location of the store (defaults to the user's cache dir, see GetDefaultRoot)
+    void            SetRoot( const AString & root );
+    const AString & GetRoot() const { return m_Root; }
+    static void     GetDefaultRoot( AString & outRoot );
+
+    // Place a stored file with the same contents at the given path
+    // (files without a content hash, from older clients, are never stored)
+    bool            Retrieve( const ToolManifestFile & file, const AString & dstFileName );
+
+    // Add a synchronized toolchain file, if not already stored
+    void            Store( const ToolManifestFile & file, const AString & srcFileName );
+
+    // Remove files no toolchain has used recently (see FileStoreTrim)
+    void            SetLimits( uint64_t maxSize, uint32_t maxAgeSecs );
+    uint32_t        Trim(); // returns num files removed
+
+    uint32_t        GetNumFilesRetrieved() const { return m_NumFilesRetrieved.Load(); }
+
+private:
+    void            GetStoreFileName( const ToolManifestFile & file, AString & outFileName ) const;
+    static bool     GetCacheDir( AString & outDir );
+
+    AString             m_Root;
+    uint64_t            m_MaxSize;
+    uint32_t            m_MaxAgeSecs;
+    Atomic<uint32_t>    m_NumFilesRetrieved;
+    Atomic<uint32_t>    m_NumFilesStored;
+};
+
+//------------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolFileStore.h"
 
 // system
 #include <memory.h> // memcpy
@@ -38,6 +39,7 @@ REFLECT_STRUCT_BEGIN( ToolManifestFile, Struct, MetaNone() )
     REFLECT( m_Name,        "Name",         MetaHidden() )
     REFLECT( m_TimeStamp,   "TimeStamp",    MetaHidden() )
     REFLECT( m_Hash,        "Hash",         MetaHidden() )
+    REFLECT( m_ContentHash, "ContentHash",  MetaHidden() )
     REFLECT( m_UncompressedContentSize, "UncompressedContentSize",  MetaHidden() )
     REFLECT( m_CompressedContentSize, "CompressedContentSize",  MetaHidden() )
 REFLECT_END( ToolManifestFile )
@@ -141,6 +143,7 @@ bool ToolManifestFile::DoBuild()
 
     // Store the hash and timestamp
     m_Hash = xxHash::Calc32( uncompressedContent, uncompressedContentSize ); // TODO:C Switch to 64 bit hash
+    m_ContentHash = xxHash3::Calc64( uncompressedContent, uncompressedContentSize );
     m_TimeStamp = FileIO::GetFileLastWriteTime( m_Name );
 
     // Compress and keep the data if it might be useful
@@ -161,6 +164,7 @@ void ToolManifestFile::Migrate( const ToolManifestFile & oldFile )
     ASSERT( m_Name == oldFile.m_Name );
     m_TimeStamp = oldFile.m_TimeStamp;
     m_Hash = oldFile.m_Hash;
+    m_ContentHash = oldFile.m_ContentHash;
 }
 
 // Generate
@@ -271,11 +275,18 @@ void ToolManifest::SerializeForRemote( IOStream & ms ) const
     {
         ms.Write( m_CustomEnvironmentVariables[ i ] );
     }
+
+    // Content hashes (since PROTOCOL_VERSION_MINOR_TOOL_CONTENT_HASHES) follow
+    // everything older workers read, so they ignore them
+    for ( size_t i = 0; i < numFiles; ++i )
+    {
+        ms.Write( m_Files[ i ].GetContentHash() );
+    }
 }
 
 // DeserializeFromRemote
 //------------------------------------------------------------------------------
-bool ToolManifest::DeserializeFromRemote( IOStream & ms )
+bool ToolManifest::DeserializeFromRemote( IOStream & ms, ToolFileStore & fileStore )
 {
     // NOTE: In clients prior to v1.07 a bug could cause ToolManifests to be
     //       corrupt so we try to read this stream in a way that allows us to
@@ -341,12 +352,27 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
         customEnvironmentVariables.EmplaceBack( Move( envVar ) );
     }
 
+    // Content hashes (absent from older clients, so files can't be shared)
+    if ( ms.Tell() < ms.GetFileSize() )
+    {
+        for ( ToolManifestFile & file : files )
+        {
+            uint64_t contentHash( 0 );
+            if ( !ms.Read( contentHash ) )
+            {
+                return false; // Corrupt stream
+            }
+            file.SetContentHash( contentHash );
+        }
+    }
+
     // Deserialization is complete so we can keep what we've read
     m_MainExecutableRootPath = mainExecutablePath;
     m_Files = Move( files );
     m_CustomEnvironmentVariables = Move( customEnvironmentVariables );
 
-    // determine if any files are remaining from a previous run
+    // determine if any files are remaining from a previous run, or were
+    // received for other toolchains
     size_t numFilesAlreadySynchronized = 0;
     for ( size_t i=0; i<(size_t)numFiles; ++i )
     {
@@ -362,28 +388,24 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
         FileIO::SetFileLastWriteTimeToNow( localFile );
 
         // is this file already present?
-        UniquePtr< FileStream, DeleteDeletor > fileStream( FNEW( FileStream ) );
-        FileStream & f = *( fileStream.Get() );
-        if ( f.Open( localFile.Get() ) == false )
-        {
-            continue; // file not found
-        }
-        if ( f.GetFileSize() != m_Files[ i ].GetUncompressedContentSize() )
+        FileStream * fileLock = OpenRemoteFile( localFile, m_Files[ i ] );
+        if ( fileLock )
         {
-            continue; // file is not complete
+            // Files synchronized before they were being stored are stored now
+            fileStore.Store( m_Files[ i ], localFile );
         }
-        UniquePtr< char > mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
-        if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
+        else if ( fileStore.Retrieve( m_Files[ i ], localFile ) )
         {
-            continue; // problem reading file
+            // An identical file was received for another toolchain
+            fileLock = OpenRemoteFile( localFile, m_Files[ i ] );
         }
-        if ( xxHash::Calc32( mem.Get(), (size_t)f.GetFileSize() ) != m_Files[ i ].GetHash() )
+        if ( fileLock == nullptr )
         {
-            continue; // file contents unexpected
+            continue; // file not available
         }
 
         // file present and ok
-        m_Files[ i ].SetFileLock( fileStream.Release() ); // NOTE: keep file open to prevent deletions
+        m_Files[ i ].SetFileLock( fileLock ); // NOTE: keep file open to prevent deletions
         m_Files[ i ].SetSyncState( ToolManifestFile::SYNCHRONIZED );
         numFilesAlreadySynchronized++;
     }
@@ -477,6 +499,32 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
     return true; // Deserialization ok
 }
 
+// OpenRemoteFile
+//------------------------------------------------------------------------------
+/*static*/ FileStream * ToolManifest::OpenRemoteFile( const AString & fileName, const ToolManifestFile & file )
+{
+    UniquePtr< FileStream, DeleteDeletor > fileStream( FNEW( FileStream ) );
+    FileStream & f = *( fileStream.Get() );
+    if ( f.Open( fileName.Get() ) == false )
+    {
+        return nullptr; // file not found
+    }
+    if ( f.GetFileSize() != file.GetUncompressedContentSize() )
+    {
+        return nullptr; // file is not complete
+    }
+    UniquePtr< char > mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
+    if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
+    {
+        return nullptr; // problem reading file
+    }
+    if ( xxHash::Calc32( mem.Get(), (size_t)f.GetFileSize() ) != file.GetHash() )
+    {
+        return nullptr; // file contents unexpected
+    }
+    return fileStream.Release();
+}
+
 // GetSynchronizationStatus
 //------------------------------------------------------------------------------
 bool ToolManifest::GetSynchronizationStatus( uint32_t & syncDone, uint32_t & syncTotal ) const
@@ -581,7 +629,8 @@ const void * ToolManifestFile::GetFileData( size_t & outDataSize ) const
 bool ToolManifest::ReceiveFileData( uint32_t fileId,
                                     const void * data,
                                     size_t & dataSize,
-                                    bool & outCorruptData )
+                                    bool & outCorruptData,
+                                    ToolFileStore & fileStore )
 {
     MutexHolder mh( m_Mutex );
 
@@ -629,7 +678,9 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
         return false; // FAILED
     }
 
-    // write to disk
+    // write to disk (replacing rather than overwriting any existing file, which
+    // may be linked to the ToolFileStore)
+    FileIO::FileDelete( fileName.Get() );
     FileStream fs;
     if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
     {
@@ -653,6 +704,9 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
         return false; // FAILED
     }
 
+    // Make the file available to other toolchains
+    fileStore.Store( f, fileName );
+
     // This file is now synchronized
     f.SetFileLock( fileStream.Release() ); // NOTE: Keep file open to prevent deletion
     f.SetSyncState( ToolManifestFile::SYNCHRONIZED );
@@ -8,6 +8,7 @@ class Dependencies;
 class FileStream;
 class IOStream;
 class Node;
+class ToolFileStore;
 
 // Includes
 //------------------------------------------------------------------------------
@@ -46,11 +47,13 @@ public:
     const AString &     GetName() const                     { return m_Name; }
     uint64_t            GetTimeStamp() const                { return m_TimeStamp; }
     uint32_t            GetHash() const                     { return m_Hash; }
+    uint64_t            GetContentHash() const              { return m_ContentHash; }
     uint32_t            GetUncompressedContentSize() const  { return m_UncompressedContentSize; }
     SyncState           GetSyncState() const                { return m_SyncState; }
 
     // Modify state
     void                SetSyncState( SyncState state )         { m_SyncState = state; }
+    void                SetContentHash( uint64_t contentHash )  { m_ContentHash = contentHash; }
     void                SetFileLock( FileStream * fileLock )    { m_FileLock = fileLock; }
 
 protected:
@@ -60,6 +63,7 @@ protected:
     AString          m_Name;
     uint64_t         m_TimeStamp     = 0;
     uint32_t         m_Hash          = 0;
+    uint64_t         m_ContentHash   = 0; // xxHash3, identifies identical files in a ToolFileStore
     mutable uint32_t m_UncompressedContentSize = 0;
     mutable uint32_t m_CompressedContentSize = 0;
 
@@ -89,7 +93,7 @@ public:
     inline uint64_t GetTimeStamp() const { return m_TimeStamp; }
 
     void SerializeForRemote( IOStream & ms ) const;
-    bool DeserializeFromRemote( IOStream & ms );
+    bool DeserializeFromRemote( IOStream & ms, ToolFileStore & fileStore );
 
     inline bool IsSynchronized() const { return m_Synchronized; }
     bool GetSynchronizationStatus( uint32_t & syncDone, uint32_t & syncTotal ) const;
@@ -108,7 +112,7 @@ public:
     void CancelSynchronizingFiles();
 
     const void *    GetFileData( uint32_t fileId, size_t & dataSize ) const;
-    bool            ReceiveFileData( uint32_t fileId, const void * data, size_t & dataSize, bool & outCorruptData );
+    bool            ReceiveFileData( uint32_t fileId, const void * data, size_t & dataSize, bool & outCorruptData, ToolFileStore & fileStore );
 
     void            GetRemotePath( AString & path ) const;
     void            GetRemoteFilePath( uint32_t fileId, AString & exe ) const;
@@ -121,6 +125,8 @@ public:
     #endif
 
 private:
+    static FileStream * OpenRemoteFile( const AString & fileName, const ToolManifestFile & file );
+
     mutable Mutex   m_Mutex;
 
     // Reflected
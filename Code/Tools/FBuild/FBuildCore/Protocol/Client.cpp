@@ -6,21 +6,31 @@
 #include "Client.h"
 
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheDictionaries.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Graph/ExecNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/TestNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressorDictionary.h"
 #include <Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h>
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
 
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
 #include "Core/Math/Random.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Network/Network.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 
@@ -29,6 +39,12 @@
 #define CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS ( 0.1f )
 #define CONNECTION_REATTEMPT_DELAY_TIME ( 10.0f )
 #define SYSTEM_ERROR_ATTEMPT_COUNT ( 3 )
+#define WORKER_PERFORMANCE_UPDATE_FREQUENCY_SECONDS ( 1.0f )
+#define WORKER_PERFORMANCE_MIN_SAMPLES ( 4 )        // jobs with a known previous build time needed to judge a worker
+#define WORKER_STRAGGLER_MIN_SAMPLES ( 8 )
+#define WORKER_SLOW_FACTOR ( 1.5f )                 // relative to the fastest worker
+#define WORKER_STRAGGLER_FACTOR ( 3.0f )            // relative to the median worker
+#define WORKER_MAX_FAILURE_RATE ( 0.1f )
 #define DIST_INFO( ... ) do { if ( m_DetailedLogging ) { FLOG_OUTPUT( __VA_ARGS__ ); } } while( false )
 
 // CONSTRUCTOR
@@ -61,6 +77,56 @@ Client::~Client()
     m_Thread.Join();
 
     ShutdownAllConnections();
+
+    // Summarize worker performance for -distverbose
+    if ( m_DetailedLogging )
+    {
+        Array< FBuildStats::WorkerStats > stats;
+        GetWorkerStats( stats );
+        for ( const FBuildStats::WorkerStats & ws : stats )
+        {
+            DIST_INFO( "Worker: %s - Jobs: %u, Failures: %u, Avg Latency: %ums, Relative Latency: %.2f, Sent: %.1f MiB, Received: %.1f MiB, Batches: %u/%u%s\n",
+                       ws.m_Name.Get(),
+                       ws.m_NumJobs,
+                       ws.m_NumFailures,
+                       ws.m_AvgLatencyMS,
+                       (double)ws.m_RelativeLatency,
+                       (double)ws.m_BytesSent / (double)MEGABYTE,
+                       (double)ws.m_BytesReceived / (double)MEGABYTE,
+                       ws.m_NumJobRequestBatches,
+                       ws.m_NumResultBatches,
+                       ws.m_Straggler ? " (Straggler)" : "" );
+        }
+    }
+}
+
+// GetWorkerStats
+//------------------------------------------------------------------------------
+void Client::GetWorkerStats( Array< FBuildStats::WorkerStats > & outStats )
+{
+    MutexHolder mh( m_ServerListMutex );
+
+    for ( size_t i = 0; i < m_ServerList.GetSize(); ++i )
+    {
+        ServerState & ss = m_ServerList[ i ];
+        MutexHolder ssMH( ss.m_Mutex );
+        if ( ( ss.m_NumJobsCompleted == 0 ) && ( ss.m_NumFailures == 0 ) && ( ss.m_BytesSent == 0 ) )
+        {
+            continue; // never used
+        }
+
+        FBuildStats::WorkerStats & ws = outStats.EmplaceBack();
+        ws.m_Name = m_WorkerList[ i ];
+        ws.m_NumJobs = ss.m_NumJobsCompleted;
+        ws.m_NumFailures = ss.m_NumFailures;
+        ws.m_AvgLatencyMS = ss.m_NumJobsCompleted ? (uint32_t)( ss.m_TotalLatencyMS / ss.m_NumJobsCompleted ) : 0;
+        ws.m_RelativeLatency = ss.m_NumRelativeLatencySamples ? ss.m_RelativeLatency : 0.0f;
+        ws.m_BytesSent = ss.m_BytesSent;
+        ws.m_BytesReceived = ss.m_BytesReceived;
+        ws.m_NumJobRequestBatches = ss.m_NumJobRequestBatches;
+        ws.m_NumResultBatches = ss.m_NumResultBatches;
+        ws.m_Straggler = ss.m_Straggler;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -82,14 +148,23 @@ Client::~Client()
             JobQueue::Get().ReturnUnfinishedDistributableJob( *it );
             ++it;
         }
+        ss->m_NumFailures += (uint32_t)ss->m_Jobs.GetSize();
         ss->m_Jobs.Clear();
     }
 
+    // Partially received results are no longer needed
+    for ( StreamedResult * sr : ss->m_StreamedResults )
+    {
+        DiscardStreamedResult( sr );
+    }
+    ss->m_StreamedResults.Clear();
+
     // This is usually null here, but might need to be freed if
     // we had the connection drop between message and payload
-    FREE( (void *)( ss->m_CurrentMessage ) );
+    FreeBuffer( (void *)( ss->m_CurrentMessage ) );
 
     ss->m_RemoteName.Clear();
+    ss->m_NumSlotsKnown = false;
     AtomicStoreRelaxed( &ss->m_Connection, static_cast< const ConnectionInfo * >( nullptr ) );
     ss->m_CurrentMessage = nullptr;
 }
@@ -113,6 +188,7 @@ void Client::ThreadFunc()
 
     // ensure first status update will be sent more rapidly
     m_StatusUpdateTimer.Start();
+    m_PerformanceUpdateTimer.Start();
 
     for ( ;; )
     {
@@ -128,6 +204,12 @@ void Client::ThreadFunc()
             break;
         }
 
+        if ( m_PerformanceUpdateTimer.GetElapsed() >= WORKER_PERFORMANCE_UPDATE_FREQUENCY_SECONDS )
+        {
+            UpdateWorkerPerformance();
+            m_PerformanceUpdateTimer.Start();
+        }
+
         Thread::Sleep( 1 );
         if ( m_ShouldExit.Load() )
         {
@@ -174,10 +256,68 @@ void Client::LookForWorkers()
     Random r;
     const size_t startIndex = r.GetRandIndex( (uint32_t)numWorkers );
 
-    // find someone to connect to
-    for ( size_t j=0; j<numWorkers; j++ )
+    // Prefer workers which performed well earlier in the build, then those
+    // not used yet, and only then slow or unreliable ones
+    Array< uint32_t > ranks;
+    Array< float > relativeLatencies;
+    Array< uint32_t > handshakeLatencies;
+    Array< size_t > order;
+    ranks.SetSize( numWorkers );
+    relativeLatencies.SetSize( numWorkers );
+    handshakeLatencies.SetSize( numWorkers );
+    order.SetCapacity( numWorkers );
+    for ( size_t j = 0; j < numWorkers; ++j )
     {
         const size_t i( ( j + startIndex ) % numWorkers );
+        ServerState & ss = m_ServerList[ i ];
+        MutexHolder ssMH( ss.m_Mutex );
+        ranks[ i ] = GetWorkerRank( ss );
+        relativeLatencies[ i ] = ss.m_RelativeLatency;
+        handshakeLatencies[ i ] = ss.m_HandshakeLatencyMS;
+        order.Append( i );
+    }
+    order.Sort( [ & ]( size_t a, size_t b )
+    {
+        if ( ranks[ a ] != ranks[ b ] )
+        {
+            return ( ranks[ a ] < ranks[ b ] );
+        }
+        if ( ( ranks[ a ] == 0 ) && ( relativeLatencies[ a ] != relativeLatencies[ b ] ) )
+        {
+            return ( relativeLatencies[ a ] < relativeLatencies[ b ] );
+        }
+        // Workers which responded quickly to a previous handshake come before slower ones
+        // (workers not connected to yet come first, so they are tried)
+        if ( handshakeLatencies[ a ] != handshakeLatencies[ b ] )
+        {
+            return ( handshakeLatencies[ a ] < handshakeLatencies[ b ] );
+        }
+        // keep randomized order
+        return ( ( ( a + numWorkers - startIndex ) % numWorkers ) < ( ( b + numWorkers - startIndex ) % numWorkers ) );
+    } );
+
+    // Connect to several workers at once, so the pool is usable quickly on a
+    // fresh build. We try more workers than we need so that the ones which
+    // respond fastest are used in preference.
+    const size_t freeSlots = ( m_WorkerConnectionLimit - numConnections );
+    const size_t maxCandidates = ( freeSlots * 2 );
+
+    // Resolve host names of the workers we might connect to (once). This is
+    // done in parallel and without holding the server state locks, since
+    // resolution can take up to the timeout for each unresolvable host.
+    ResolveWorkerHostNames( order, ranks, freeSlots, maxCandidates );
+
+    StackArray< size_t, 64 > candidates;
+    Array< ConnectRequest > requests;
+    for ( size_t j=0; ( j < numWorkers ) && ( candidates.GetSize() < maxCandidates ); j++ )
+    {
+        const size_t i( order[ j ] );
+
+        // only fall back to slow or unreliable workers if needed
+        if ( ( ranks[ i ] == 2 ) && ( candidates.GetSize() >= freeSlots ) )
+        {
+            break;
+        }
 
         ServerState & ss = m_ServerList[ i ];
         if ( AtomicLoadRelaxed( &ss.m_Connection ) )
@@ -191,40 +331,158 @@ void Client::LookForWorkers()
             continue;
         }
 
-        // lock the server state
-        MutexHolder mhSS( ss.m_Mutex );
+        // lock the server state (released once connections are complete)
+        ss.m_Mutex.Lock();
 
         ASSERT( ss.m_Jobs.IsEmpty() );
 
         if ( ss.m_DelayTimer.GetElapsed() < CONNECTION_REATTEMPT_DELAY_TIME )
         {
+            ss.m_Mutex.Unlock();
+            continue;
+        }
+
+        // host name not resolved yet (will be on a later pass)
+        if ( ss.m_HostIP == 0 )
+        {
+            ss.m_Mutex.Unlock();
             continue;
         }
 
         DIST_INFO( "Connecting to: %s\n", m_WorkerList[ i ].Get() );
-        const ConnectionInfo * ci = Connect( m_WorkerList[ i ], m_Port, 2000, &ss ); // 2000ms connection timeout
-        if ( ci == nullptr )
+        ConnectRequest & request = requests.EmplaceBack();
+        request.m_HostIP = ss.m_HostIP;
+        request.m_Port = m_Port;
+        request.m_UserData = &ss;
+        candidates.Append( i );
+    }
+
+    if ( candidates.IsEmpty() )
+    {
+        return;
+    }
+
+    ConnectParallel( requests, (uint32_t)freeSlots, 2000 ); // 2000ms connection timeout
+
+    // Workers connected first are the most responsive, so tell those about
+    // available jobs first
+    StackArray< size_t, 64 > connected;
+    for ( size_t j = 0; j < candidates.GetSize(); ++j )
+    {
+        if ( requests[ j ].m_Result == ConnectRequest::CONNECTED )
+        {
+            connected.Append( j );
+        }
+    }
+    connected.Sort( [ &requests ]( size_t a, size_t b )
+    {
+        return ( requests[ a ].m_LatencyMS < requests[ b ].m_LatencyMS );
+    } );
+    for ( const size_t j : connected )
+    {
+        const size_t i = candidates[ j ];
+        ServerState & ss = m_ServerList[ i ];
+        const ConnectionInfo * ci = requests[ j ].m_Connection;
+
+        DIST_INFO( " - connection: %s (OK - %2.1fms)\n", m_WorkerList[ i ].Get(), (double)requests[ j ].m_LatencyMS );
+        const uint32_t numJobsAvailable = (uint32_t)JobQueue::Get().GetNumDistributableJobsAvailable();
+
+        ss.m_RemoteName = m_WorkerList[ i ];
+        AtomicStoreRelaxed( &ss.m_Connection, ci ); // success!
+        ss.m_NumJobsAvailable = numJobsAvailable;
+        ss.m_ProtocolVersionMinor = 0; // until the server reports otherwise
+        ss.m_DictionariesSent.Clear();
+
+        // A straggler is only reconnected when no better worker is available,
+        // so give it a fresh chance
+        if ( ss.m_Straggler )
+        {
+            ss.m_Straggler = false;
+            ss.m_NumRelativeLatencySamples = 0;
+        }
+
+        // send connection msg (the server info reply measures the handshake latency)
+        ss.m_AwaitingHandshake = true;
+        ss.m_HandshakeTimer.Start();
+        const uint8_t priority = FBuild::Get().GetOptions().m_DistBackground ? (uint8_t)Protocol::PRIORITY_BACKGROUND
+                                                                             : (uint8_t)Protocol::PRIORITY_INTERACTIVE;
+        const Protocol::MsgConnection msg( numJobsAvailable, priority );
+        SendMessageInternal( ci, msg );
+    }
+
+    // Handle failures and release locks
+    for ( size_t j = 0; j < candidates.GetSize(); ++j )
+    {
+        const size_t i = candidates[ j ];
+        ServerState & ss = m_ServerList[ i ];
+        if ( requests[ j ].m_Result == ConnectRequest::FAILED )
         {
             DIST_INFO( " - connection: %s (FAILED)\n", m_WorkerList[ i ].Get() );
             ss.m_DelayTimer.Start(); // reset connection attempt delay
+            ss.m_HostIP = 0; // resolve again, in case the address has changed
         }
-        else
-        {
-            DIST_INFO( " - connection: %s (OK)\n", m_WorkerList[ i ].Get() );
-            const uint32_t numJobsAvailable = (uint32_t)JobQueue::Get().GetNumDistributableJobsAvailable();
+        // ABANDONED workers (not needed this time) can be retried immediately
+        ss.m_Mutex.Unlock();
+    }
+}
 
-            ss.m_RemoteName = m_WorkerList[ i ];
-            AtomicStoreRelaxed( &ss.m_Connection, ci ); // success!
-            ss.m_NumJobsAvailable = numJobsAvailable;
+// ResolveWorkerHostNames
+//------------------------------------------------------------------------------
+void Client::ResolveWorkerHostNames( const Array< size_t > & order, const Array< uint32_t > & ranks, size_t freeSlots, size_t maxCandidates )
+{
+    PROFILE_FUNCTION;
 
-            // send connection msg
-            const Protocol::MsgConnection msg( numJobsAvailable );
-            SendMessageInternal( ci, msg );
+    // Find the workers which would be candidates for connection, following
+    // the same rules as LookForWorkers
+    Array< size_t > toResolve;
+    Array< AString > hostNames;
+    size_t numCandidates = 0;
+    for ( size_t j = 0; ( j < order.GetSize() ) && ( numCandidates < maxCandidates ); ++j )
+    {
+        const size_t i( order[ j ] );
+        if ( ( ranks[ i ] == 2 ) && ( numCandidates >= freeSlots ) )
+        {
+            break;
+        }
+
+        ServerState & ss = m_ServerList[ i ];
+        if ( AtomicLoadRelaxed( &ss.m_Connection ) || ss.m_Denylisted )
+        {
+            continue;
         }
 
-        // limit to one connection attempt per iteration
+        MutexHolder ssMH( ss.m_Mutex );
+        if ( ss.m_DelayTimer.GetElapsed() < CONNECTION_REATTEMPT_DELAY_TIME )
+        {
+            continue;
+        }
+        ++numCandidates;
+        if ( ss.m_HostIP == 0 )
+        {
+            toResolve.Append( i );
+            hostNames.Append( m_WorkerList[ i ] );
+        }
+    }
+    if ( toResolve.IsEmpty() )
+    {
         return;
     }
+
+    Array< uint32_t > hostIPs;
+    Network::GetHostIPsFromNames( hostNames, hostIPs, 1000 );
+
+    for ( size_t j = 0; j < toResolve.GetSize(); ++j )
+    {
+        const size_t i( toResolve[ j ] );
+        ServerState & ss = m_ServerList[ i ];
+        MutexHolder ssMH( ss.m_Mutex );
+        ss.m_HostIP = hostIPs[ j ];
+        if ( ss.m_HostIP == 0 )
+        {
+            DIST_INFO( " - connection: %s (FAILED - Unable to resolve)\n", m_WorkerList[ i ].Get() );
+            ss.m_DelayTimer.Start(); // reset connection attempt delay
+        }
+    }
 }
 
 // CommunicateJobAvailability
@@ -285,6 +543,140 @@ void Client::CommunicateJobAvailability()
     }
 }
 
+// UpdateWorkerPerformance
+//------------------------------------------------------------------------------
+void Client::UpdateWorkerPerformance()
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_ServerListMutex );
+
+    // Gather performance of connected workers with enough completed jobs to judge
+    Array< float > relativeLatencies( m_ServerList.GetSize() );
+    size_t numSpareWorkers = 0; // workers which could replace a straggler
+    for ( ServerState & ss : m_ServerList )
+    {
+        MutexHolder ssMH( ss.m_Mutex );
+        if ( AtomicLoadRelaxed( &ss.m_Connection ) == nullptr )
+        {
+            if ( GetWorkerRank( ss ) < 2 )
+            {
+                ++numSpareWorkers;
+            }
+            continue;
+        }
+        if ( ss.m_NumRelativeLatencySamples >= WORKER_PERFORMANCE_MIN_SAMPLES )
+        {
+            relativeLatencies.Append( ss.m_RelativeLatency );
+        }
+    }
+    if ( relativeLatencies.GetSize() < 2 )
+    {
+        return; // nothing to compare against
+    }
+    relativeLatencies.Sort();
+    const float fastest = relativeLatencies[ 0 ];
+    const float median = relativeLatencies[ relativeLatencies.GetSize() / 2 ];
+
+    Array< const ConnectionInfo * > toDisconnect;
+    for ( ServerState & ss : m_ServerList )
+    {
+        MutexHolder ssMH( ss.m_Mutex );
+        const ConnectionInfo * connection = AtomicLoadRelaxed( &ss.m_Connection );
+        if ( ( connection == nullptr ) ||
+             ( ss.m_NumRelativeLatencySamples < WORKER_PERFORMANCE_MIN_SAMPLES ) )
+        {
+            continue;
+        }
+
+        // Slower workers take the cheapest jobs, so the jobs on the critical
+        // path of the build go to faster workers
+        ss.m_PreferCheapJobs = ( ss.m_RelativeLatency > ( fastest * WORKER_SLOW_FACTOR ) );
+
+        // Stop using chronic stragglers if another worker could be used instead
+        if ( ( ss.m_Straggler == false ) &&
+             ( numSpareWorkers > 0 ) &&
+             ( ss.m_NumRelativeLatencySamples >= WORKER_STRAGGLER_MIN_SAMPLES ) &&
+             ( ss.m_RelativeLatency > ( median * WORKER_STRAGGLER_FACTOR ) ) )
+        {
+            DIST_INFO( "Straggler: %s (%.2fx median latency)\n", ss.m_RemoteName.Get(), (double)( ss.m_RelativeLatency / median ) );
+            ss.m_Straggler = true;
+            --numSpareWorkers;
+        }
+
+        // Disconnect once in-flight jobs are complete, so its connection
+        // slot can be used by another worker
+        if ( ss.m_Straggler && ss.m_Jobs.IsEmpty() )
+        {
+            toDisconnect.Append( connection );
+        }
+    }
+
+    for ( const ConnectionInfo * connection : toDisconnect )
+    {
+        Disconnect( connection );
+    }
+}
+
+// GetWorkerRank
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Client::GetWorkerRank( const ServerState & ss )
+{
+    // 2 - Slow or unreliable
+    const uint32_t numAttempts = ( ss.m_NumJobsCompleted + ss.m_NumFailures );
+    if ( ss.m_Denylisted ||
+         ss.m_Straggler ||
+         ( ( numAttempts > 0 ) && ( (float)ss.m_NumFailures > ( (float)numAttempts * WORKER_MAX_FAILURE_RATE ) ) ) )
+    {
+        return 2;
+    }
+
+    // 0 - Known to perform well
+    if ( ( ss.m_NumRelativeLatencySamples >= WORKER_PERFORMANCE_MIN_SAMPLES ) && ( ss.m_PreferCheapJobs == false ) )
+    {
+        return 0;
+    }
+
+    // 1 - Unknown (or slower than others)
+    return 1;
+}
+
+// RecordJobPerformance
+//------------------------------------------------------------------------------
+/*static*/ void Client::RecordJobPerformance( ServerState & ss, const Job & job, int64_t resultReceivedTime, size_t resultSize, bool systemError )
+{
+    ss.m_BytesReceived += resultSize;
+    if ( systemError )
+    {
+        ++ss.m_NumFailures;
+        return;
+    }
+
+    const uint32_t latencyMS = (uint32_t)( (float)( resultReceivedTime - job.GetRemoteSendTime() ) * Timer::GetFrequencyInvFloatMS() );
+    ++ss.m_NumJobsCompleted;
+    ss.m_TotalLatencyMS += latencyMS;
+
+    // Jobs differ greatly in cost, so workers are compared using latency
+    // relative to the previous build time of each job. This makes comparisons
+    // independent of which jobs each worker was given.
+    if ( job.GetNode()->GetStatFlag( Node::STATS_FIRST_BUILD ) )
+    {
+        return; // never built before (build time is only a default estimate)
+    }
+    const uint32_t previousBuildTime = Math::Max( job.GetNode()->GetLastBuildTime(), 1u );
+    const float relativeLatency = ( (float)latencyMS / (float)previousBuildTime );
+    if ( ss.m_NumRelativeLatencySamples == 0 )
+    {
+        ss.m_RelativeLatency = relativeLatency;
+    }
+    else
+    {
+        // moving average, so a worker which becomes busy is noticed
+        ss.m_RelativeLatency += ( ( relativeLatency - ss.m_RelativeLatency ) * 0.2f );
+    }
+    ++ss.m_NumRelativeLatencySamples;
+}
+
 // SendMessageInternal
 //------------------------------------------------------------------------------
 void Client::SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg )
@@ -316,6 +708,22 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
                 (uint32_t)memoryStream.GetSize() );
 }
 
+// SendMessageInternal
+//------------------------------------------------------------------------------
+void Client::SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream, const void * payloadTail, size_t payloadTailSize )
+{
+    if ( msg.Send( connection, memoryStream, payloadTail, payloadTailSize ) )
+    {
+        return;
+    }
+
+    DIST_INFO( "Send Failed: %s (Type: %u, Size: %u, Payload: %u)\n",
+                ((ServerState *)connection->GetUserData())->m_RemoteName.Get(),
+                (uint32_t)msg.GetType(),
+                msg.GetSize(),
+                (uint32_t)( memoryStream.GetSize() + payloadTailSize ) );
+}
+
 // SendMessageInternal
 //------------------------------------------------------------------------------
 void Client::SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const ConstMemoryStream & memoryStream )
@@ -375,6 +783,12 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_REQUEST_JOBS:
+        {
+            const Protocol::MsgRequestJobs * msg = static_cast< const Protocol::MsgRequestJobs * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_JOB_RESULT:
         {
             const Protocol::MsgJobResult * msg = static_cast< const Protocol::MsgJobResult * >( imsg );
@@ -387,6 +801,18 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_JOB_RESULTS:
+        {
+            const Protocol::MsgJobResults * msg = static_cast< const Protocol::MsgJobResults * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_JOB_RESULT_CHUNK:
+        {
+            const Protocol::MsgJobResultChunk * msg = static_cast< const Protocol::MsgJobResultChunk * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         case Protocol::MSG_REQUEST_MANIFEST:
         {
             const Protocol::MsgRequestManifest * msg = static_cast< const Protocol::MsgRequestManifest * >( imsg );
@@ -399,6 +825,24 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_CAPACITY:
+        {
+            const Protocol::MsgCapacity * msg = static_cast< const Protocol::MsgCapacity * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_SERVER_INFO:
+        {
+            const Protocol::MsgServerInfo * msg = static_cast< const Protocol::MsgServerInfo * >( imsg );
+            Process( connection, msg );
+            break;
+        }
+        case Protocol::MSG_REQUEST_HEADERS:
+        {
+            const Protocol::MsgRequestHeaders * msg = static_cast< const Protocol::MsgRequestHeaders * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -410,8 +854,8 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
     }
 
     // free everything
-    FREE( (void *)( ss->m_CurrentMessage ) );
-    FREE( payload );
+    FreeBuffer( (void *)( ss->m_CurrentMessage ) );
+    FreeBuffer( payload );
     ss->m_CurrentMessage = nullptr;
 }
 
@@ -421,37 +865,107 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
 {
     PROFILE_SECTION( "MsgRequestJob" );
 
+    if ( SendJob( connection ) == false )
+    {
+        SendNoJobAvailable( connection, 1 );
+    }
+}
+
+// Process( MsgRequestJobs )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg )
+{
+    PROFILE_SECTION( "MsgRequestJobs" );
+
+    const uint32_t numJobs = msg->GetNumJobs();
+    if ( numJobs > 1 )
+    {
+        ServerState * ss = (ServerState *)connection->GetUserData();
+        MutexHolder mh( ss->m_Mutex );
+        ++ss->m_NumJobRequestBatches;
+    }
+
+    // Each requested job is answered individually, so the worker can start on
+    // the first job while the others are still being sent
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        if ( SendJob( connection ) == false )
+        {
+            // No more jobs right now - answer all remaining requests
+            SendNoJobAvailable( connection, ( numJobs - i ) );
+            return;
+        }
+    }
+}
+
+// SendNoJobAvailable
+//------------------------------------------------------------------------------
+void Client::SendNoJobAvailable( const ConnectionInfo * connection, uint32_t count )
+{
+    PROFILE_SECTION( "NoJob" );
+
     ServerState * ss = (ServerState *)connection->GetUserData();
     ASSERT( ss );
 
-    // no jobs for deny listed workers
-    if ( ss->m_Denylisted )
+    // tell the client we don't have anything right now
+    // (we completed or gave away the job already)
+    MutexHolder mh( ss->m_Mutex );
+    const Protocol::MsgNoJobAvailable msg;
+    for ( uint32_t i = 0; i < count; ++i )
     {
-        MutexHolder mh( ss->m_Mutex );
-        const Protocol::MsgNoJobAvailable msg;
         SendMessageInternal( connection, msg );
-        return;
     }
+}
 
-    Job * job = JobQueue::Get().GetDistributableJobToProcess( true );
-    if ( job == nullptr )
+// SendJob
+//------------------------------------------------------------------------------
+bool Client::SendJob( const ConnectionInfo * connection )
+{
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // no jobs for deny listed workers, or stragglers waiting to be disconnected
+    if ( ss->m_Denylisted || ss->m_Straggler )
+    {
+        return false;
+    }
+
+    // Expected latency of this worker, so the job can be raced if it takes too long
+    float relativeLatency = 0.0f; // unknown
     {
-        PROFILE_SECTION( "NoJob" );
-        // tell the client we don't have anything right now
-        // (we completed or gave away the job already)
         MutexHolder mh( ss->m_Mutex );
-        const Protocol::MsgNoJobAvailable msg;
-        SendMessageInternal( connection, msg );
-        return;
+
+        // Requests can cross with a reduction in the worker's job slots, so
+        // don't send jobs it would only return
+        if ( ss->m_NumSlotsKnown && ( ss->m_Jobs.GetSize() >= Server::GetMaxJobs( ss->m_NumSlots ) ) )
+        {
+            return false;
+        }
+
+        if ( ss->m_NumRelativeLatencySamples >= WORKER_PERFORMANCE_MIN_SAMPLES )
+        {
+            relativeLatency = ss->m_RelativeLatency;
+        }
+    }
+
+    // Only servers which report support can compile header bundles
+    const bool allowHeaderBundles = ( ss->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_HEADER_BUNDLES );
+    const bool allowRemoteExec = ( ss->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_REMOTE_EXEC );
+
+    Job * job = JobQueue::Get().GetDistributableJobToProcess( true, ss->m_PreferCheapJobs, relativeLatency, allowHeaderBundles, allowRemoteExec );
+    if ( job == nullptr )
+    {
+        return false;
     }
 
-    // send the job to the client
+    // send the job to the client (job data is sent separately)
     MemoryStream stream;
     job->Serialize( stream );
 
     MutexHolder mh( ss->m_Mutex );
 
     ss->m_Jobs.Append( job ); // Track in-flight job
+    ss->m_BytesSent += ( stream.GetSize() + job->GetDataSize() );
 
     // Reset the Available Jobs count for this worker. This ensures that we send
     // another status update message to communicate new jobs becoming available.
@@ -460,42 +974,102 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     ss->m_NumJobsAvailable = 0;
 
     // if tool is explicity specified, get the id of the tool manifest
-    const Node * n = job->GetNode()->CastTo< ObjectNode >()->GetCompiler();
-    const ToolManifest & manifest = n->CastTo< CompilerNode >()->GetManifest();
-    const uint64_t toolId = manifest.GetToolId();
+    const uint64_t toolId = GetToolManifest( *job ).GetToolId();
     ASSERT( toolId );
 
     // output to signify remote start
     if ( FBuild::Get().GetOptions().m_ShowCommandSummary )
     {
-        FLOG_OUTPUT( "-> Obj: %s <REMOTE: %s>\n", job->GetNode()->GetName().Get(), ss->m_RemoteName.Get() );
+        const bool isObject = ( job->GetNode()->GetType() == Node::OBJECT_NODE );
+        FLOG_OUTPUT( "-> %s: %s <REMOTE: %s>\n", isObject ? "Obj" : "Run", job->GetNode()->GetName().Get(), ss->m_RemoteName.Get() );
     }
     FLOG_MONITOR( "START_JOB %s \"%s\" \n", ss->m_RemoteName.Get(), job->GetNode()->GetName().Get() );
 
     // Determine compression level we'd like the Server to use for returning the results
     int16_t resultCompressionLevel = -1; // Default compression level
+    bool resultCompressionZstd = false;
+    bool cacheCompressionOverride = false;
     if ( FBuild::IsValid() )
     {
-        // If we will write the results to the cache, and this node is cacheable
-        // then we want to respect higher cache compression levels if set
-        const int16_t cacheCompressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
-        if ( ( cacheCompressionLevel != 0 ) &&
-             ( FBuild::Get().GetOptions().m_UseCacheWrite ) &&
-             ( job->GetNode()->CastTo< ObjectNode >()->ShouldUseCache() ) )
+        // If we will write the results to the cache, and this node is cacheable
+        // then we want to respect higher cache compression levels if set
+        // (Exec() and Test() nodes note their cache id on the job)
+        const int16_t cacheCompressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
+        const bool cacheable = ( job->GetNode()->GetType() == Node::OBJECT_NODE ) ? job->GetNode()->CastTo< ObjectNode >()->ShouldUseCache()
+                                                                                  : ( job->GetCacheName().IsEmpty() == false );
+        if ( ( cacheCompressionLevel != 0 ) &&
+             ( FBuild::Get().GetOptions().m_UseCacheWrite ) &&
+             cacheable )
+        {
+            resultCompressionLevel = Math::Max( resultCompressionLevel, cacheCompressionLevel );
+            cacheCompressionOverride = true;
+        }
+    }
+
+    // Otherwise, choose what is fastest for the link to this worker
+    CompressionSelector::Choice choice;
+    const bool allowZstd = ( ss->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_ZSTD_RESULTS );
+    if ( ( cacheCompressionOverride == false ) &&
+         m_ResultCompressionSelector.Select( ss->m_Connection->GetReceiveRateKiBPerSec(), allowZstd, choice ) )
+    {
+        resultCompressionLevel = choice.m_Level;
+        resultCompressionZstd = choice.m_Zstd;
+        if ( ( choice.m_Level != ss->m_ResultCompression.m_Level ) || ( choice.m_Zstd != ss->m_ResultCompression.m_Zstd ) )
+        {
+            ss->m_ResultCompression = choice;
+            AStackString<> description;
+            CompressionSelector::GetDescription( choice, description );
+            DIST_INFO( "Result compression: %s - %s (Link: %u KiB/s)\n", ss->m_RemoteName.Get(),
+                                                                          description.Get(),
+                                                                          ss->m_Connection->GetReceiveRateKiBPerSec() );
+        }
+    }
+
+    // Objects can be compressed with the cache dictionary for their toolchain,
+    // once the worker has it. Results can then be stored to the cache as-is.
+    const CompressorDictionary * dictionary = nullptr;
+    if ( ( ss->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_RESULT_DICTIONARIES ) &&
+         ( resultCompressionLevel != 0 ) &&
+         ( job->GetNode()->GetType() == Node::OBJECT_NODE ) &&
+         FBuild::IsValid() &&
+         FBuild::Get().GetOptions().m_CacheDictionary &&
+         FBuild::Get().GetCacheDictionaries() )
+    {
+        dictionary = FBuild::Get().GetCacheDictionaries()->GetCurrent( toolId );
+    }
+    if ( dictionary && cacheCompressionOverride )
+    {
+        // Match what is stored for local builds (see ObjectNode::WriteToCache_FromUncompressedData)
+        resultCompressionLevel = ( resultCompressionLevel > 0 ) ? resultCompressionLevel : 1;
+        resultCompressionZstd = true;
+    }
+    if ( dictionary && resultCompressionZstd )
+    {
+        MemoryStream key;
+        key.Write( toolId );
+        key.Write( dictionary->GetId() );
+        const uint64_t sentKey = xxHash3::Calc64( key.GetData(), key.GetSize() );
+        if ( ss->m_DictionariesSent.Find( sentKey ) == nullptr )
         {
-            resultCompressionLevel = Math::Max( resultCompressionLevel, cacheCompressionLevel );
+            PROFILE_SECTION( "SendDictionary" );
+            const Protocol::MsgDictionary msg( toolId, dictionary->GetId() );
+            const ConstMemoryStream content( dictionary->GetContent(), dictionary->GetContentSize() );
+            SendMessageInternal( connection, msg, content );
+            ss->m_DictionariesSent.Append( sentKey );
         }
     }
 
     // Take note of the results compression level so we know to expect
     // compressed results
     job->SetResultCompressionLevel( resultCompressionLevel );
+    job->SetResultCompressionZstd( resultCompressionZstd );
 
     {
         PROFILE_SECTION( "SendJob" );
-        const Protocol::MsgJob msg( toolId, resultCompressionLevel );
-        SendMessageInternal( connection, msg, stream );
+        const Protocol::MsgJob msg( toolId, resultCompressionLevel, job->IsHeaderBundle(), resultCompressionZstd );
+        SendMessageInternal( connection, msg, stream, job->GetData(), job->GetDataSize() );
     }
+    return true;
 }
 
 // Process( MsgJobResult )
@@ -516,6 +1090,170 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
     ProcessJobResultCommon( connection, compressed, payload, payloadSize );
 }
 
+// Process( MsgJobResults )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResults * /*msg*/, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResults" );
+
+    ConstMemoryStream ms( payload, payloadSize );
+
+    uint32_t numResults = 0;
+    ms.Read( numResults );
+    if ( numResults > 1 )
+    {
+        ServerState * ss = (ServerState *)connection->GetUserData();
+        MutexHolder mh( ss->m_Mutex );
+        ++ss->m_NumResultBatches;
+    }
+    for ( uint32_t i = 0; i < numResults; ++i )
+    {
+        bool compressed = false;
+        ms.Read( compressed );
+        uint32_t resultSize = 0;
+        ms.Read( resultSize );
+
+        const uint64_t resultPos = ms.Tell();
+        ASSERT( ( resultPos + resultSize ) <= payloadSize );
+        ProcessJobResultCommon( connection, compressed, (const char *)payload + resultPos, resultSize );
+        ms.Seek( resultPos + resultSize );
+    }
+}
+
+// Process( MsgJobResultChunk )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResultChunk" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // Find the result this is part of, or start a new one. The result itself
+    // is only used on this connection's thread, so the lock isn't held while
+    // writing to disk (which would hold up sending jobs to other workers).
+    const uint32_t jobId = msg->GetJobId();
+    StreamedResult * sr = nullptr;
+    {
+        MutexHolder mh( ss->m_Mutex );
+        for ( StreamedResult * s : ss->m_StreamedResults )
+        {
+            if ( s->m_JobId == jobId )
+            {
+                sr = s;
+                break;
+            }
+        }
+        if ( sr == nullptr )
+        {
+            Job ** job = ss->m_Jobs.FindDeref( jobId );
+            ASSERT( job );
+            if ( job == nullptr )
+            {
+                return;
+            }
+            sr = FNEW( StreamedResult );
+            sr->m_JobId = jobId;
+            sr->m_Node = ( *job )->GetNode();
+            ss->m_StreamedResults.Append( sr );
+        }
+    }
+    if ( sr->m_Failed )
+    {
+        return; // Error already reported, result will be discarded
+    }
+
+    // Files are sent in order, each starting with a new chunk
+    if ( sr->m_TmpFiles.IsEmpty() || ( msg->GetFileIndex() != ( sr->m_TmpFiles.GetSize() - 1 ) ) )
+    {
+        if ( sr->m_File.IsOpen() )
+        {
+            sr->m_File.Close();
+        }
+
+        AStackString<> fileName;
+        if ( ( msg->GetFileIndex() != sr->m_TmpFiles.GetSize() ) ||
+             ( GetResultFileName( sr->m_Node, msg->GetFileIndex(), fileName ) == false ) )
+        {
+            ASSERT( false ); // Protocol bug
+            sr->m_Failed = true;
+            return;
+        }
+
+        AString & tmpFileName = sr->m_TmpFiles.EmplaceBack();
+        tmpFileName.Format( "%s.%u.tmp", fileName.Get(), jobId );
+        if ( ( Node::EnsurePathExistsForFile( fileName ) == false ) ||
+             ( sr->m_File.Open( tmpFileName.Get(), FileStream::WRITE_ONLY ) == false ) )
+        {
+            FLOG_ERROR( "Failed to create file. Error: %s File: '%s'", LAST_ERROR_STR, tmpFileName.Get() );
+            sr->m_Failed = true;
+            return;
+        }
+    }
+
+    // Decompress straight to disk
+    const void * data = payload;
+    size_t dataSize = payloadSize;
+    Compressor c;
+    if ( msg->IsCompressed() )
+    {
+        if ( c.Decompress( payload ) == false )
+        {
+            FLOG_ERROR( "Failed to decompress result from '%s'", ss->m_RemoteName.Get() );
+            sr->m_Failed = true;
+            return;
+        }
+        data = c.GetResult();
+        dataSize = c.GetResultSize();
+    }
+    if ( sr->m_File.WriteBuffer( data, dataSize ) != dataSize )
+    {
+        FLOG_ERROR( "Failed to write file. Error: %s File: '%s'", LAST_ERROR_STR, sr->m_TmpFiles.Top().Get() );
+        sr->m_Failed = true;
+    }
+}
+
+// Process( MsgCapacity )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgCapacity * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgCapacity" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    ConstMemoryStream ms( payload, payloadSize );
+    uint32_t numReturnedJobs = 0;
+    ms.Read( numReturnedJobs );
+
+    // Take back queued jobs the worker no longer has room for
+    StackArray< Job * > returnedJobs;
+    {
+        MutexHolder mh( ss->m_Mutex );
+        ss->m_NumSlots = msg->GetNumSlots();
+        ss->m_NumSlotsKnown = true;
+        for ( uint32_t i = 0; i < numReturnedJobs; ++i )
+        {
+            uint32_t jobId = 0;
+            ms.Read( jobId );
+            Job ** job = ss->m_Jobs.FindDeref( jobId );
+            if ( job )
+            {
+                returnedJobs.Append( *job );
+                ss->m_Jobs.Erase( job );
+            }
+        }
+    }
+
+    DIST_INFO( "Worker %s now has %u job slots (%u jobs returned)\n", ss->m_RemoteName.Get(), msg->GetNumSlots(), numReturnedJobs );
+
+    // Make them available to other workers (or to build locally)
+    for ( Job * job : returnedJobs )
+    {
+        JobQueue::Get().ReturnUnfinishedDistributableJob( job );
+    }
+}
+
 // ProcessJobResultCommon
 //------------------------------------------------------------------------------
 void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize )
@@ -557,9 +1295,27 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
     ms.Read( dataSize );
     const void * data = (const char *)ms.GetData() + ms.Tell();
 
+    StreamedResult * streamedResult = nullptr;
     {
         MutexHolder mh( ss->m_Mutex );
-        VERIFY( ss->m_Jobs.FindDerefAndErase( jobId ) );
+        Job ** sentJob = ss->m_Jobs.FindDeref( jobId );
+        ASSERT( sentJob );
+        if ( sentJob )
+        {
+            RecordJobPerformance( *ss, **sentJob, receivedResultEndTime, payloadSize, systemError );
+            ss->m_Jobs.Erase( sentJob );
+        }
+
+        // Was the data streamed ahead of the result?
+        for ( StreamedResult ** it = ss->m_StreamedResults.Begin(); it != ss->m_StreamedResults.End(); ++it )
+        {
+            if ( ( *it )->m_JobId == jobId )
+            {
+                streamedResult = *it;
+                ss->m_StreamedResults.Erase( it );
+                break;
+            }
+        }
     }
 
     // Has the job been cancelled in the interim?
@@ -575,6 +1331,13 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
                                                    node, // Set by OnReturnRemoteJob
                                                    jobSystemErrorCount ); // Set by OnReturnRemoteJob
 
+    // Streamed data is only kept for successful results we still want
+    if ( streamedResult && ( ( job == nullptr ) || ( result == false ) ) )
+    {
+        DiscardStreamedResult( streamedResult );
+        streamedResult = nullptr;
+    }
+
     // Prepare failure output if needed
     AStackString< 8192 > failureOutput;
     if ( result == false )
@@ -691,16 +1454,84 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
 
     job->SetMessages( messages );
 
-    if ( result == true )
+    if ( ( result == true ) && ( node->GetType() != Node::OBJECT_NODE ) )
+    {
+        // Exec() and Test() nodes return a single output file
+        FileNode * fileNode = (FileNode *)node;
+
+        MultiBuffer mb( data, dataSize );
+        bool decompressed = true;
+        if ( isCompressed && ( streamedResult == nullptr ) ) // Streamed results have no data here
+        {
+            decompressed = DecompressJobResult( *job, mb );
+        }
+        if ( decompressed )
+        {
+            CalibrateResultCompression( mb );
+        }
+
+        const AString & nodeName = fileNode->GetName();
+        if ( streamedResult )
+        {
+            result = FinishStreamedResult( *streamedResult );
+            FDELETE streamedResult;
+        }
+        else if ( decompressed == false )
+        {
+            FLOG_ERROR( "Failed to decompress result for '%s'", nodeName.Get() );
+            result = false;
+        }
+        else if ( Node::EnsurePathExistsForFile( nodeName ) == false )
+        {
+            FLOG_ERROR( "Failed to create path for '%s'", nodeName.Get() );
+            result = false;
+        }
+        else
+        {
+            result = WriteFileToDisk( nodeName, mb, 0 );
+        }
+
+        if ( result )
+        {
+            // Store to cache if needed
+            if ( FBuild::Get().GetOptions().m_UseCacheWrite && ( job->GetCacheName().IsEmpty() == false ) )
+            {
+                Array< AString > cacheFileNames( 1, false );
+                cacheFileNames.EmplaceBack( nodeName );
+                fileNode->WriteOutputsToCache( job, job->GetCacheName(), cacheFileNames );
+            }
+
+            // record new file time
+            fileNode->RecordStampFromBuiltFile();
+
+            // record time taken to build
+            fileNode->SetLastBuildTime( buildTime );
+            fileNode->SetStatFlag( Node::STATS_BUILT );
+            fileNode->SetStatFlag( Node::STATS_BUILT_REMOTE );
+        }
+        else
+        {
+            fileNode->SetStatFlag( Node::STATS_FAILED );
+        }
+
+        // output of remote work
+        AStackString<> msgBuffer;
+        job->GetMessagesForLog( msgBuffer );
+        if ( msgBuffer.IsEmpty() == false )
+        {
+            Node::DumpOutput( nullptr, msgBuffer, nullptr );
+        }
+    }
+    else if ( result == true )
     {
         // built ok - serialize to disc
 
         ObjectNode * objectNode = node->CastTo< ObjectNode >();
 
-        // Store to cache if needed
+        // Store to cache if needed (streamed results once written to disk, below)
         const bool writeToCache = FBuild::Get().GetOptions().m_UseCacheWrite &&
                                   objectNode->ShouldUseCache();
-        if ( writeToCache )
+        if ( writeToCache && ( streamedResult == nullptr ) )
         {
             if ( isCompressed )
             {
@@ -719,13 +1550,47 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
 
         // Decompress if needed
         MultiBuffer mb( data, dataSize );
-        if ( isCompressed )
+        bool decompressed = true;
+        if ( isCompressed && ( streamedResult == nullptr ) ) // Streamed results have no data here
+        {
+            decompressed = DecompressJobResult( *job, mb );
+        }
+        if ( decompressed )
         {
-            mb.Decompress();
+            CalibrateResultCompression( mb );
         }
 
         const AString & nodeName = objectNode->GetName();
-        if ( Node::EnsurePathExistsForFile( nodeName ) == false )
+        if ( streamedResult )
+        {
+            result = FinishStreamedResult( *streamedResult );
+            FDELETE streamedResult;
+            if ( result && writeToCache )
+            {
+                objectNode->WriteToCache_FromDisk( job );
+            }
+
+            if ( result )
+            {
+                // record new file time
+                objectNode->RecordStampFromBuiltFile();
+
+                // record time taken to build
+                objectNode->SetLastBuildTime( buildTime );
+                objectNode->SetStatFlag(Node::STATS_BUILT);
+                objectNode->SetStatFlag(Node::STATS_BUILT_REMOTE);
+            }
+            else
+            {
+                objectNode->SetStatFlag( Node::STATS_FAILED );
+            }
+        }
+        else if ( decompressed == false )
+        {
+            FLOG_ERROR( "Failed to decompress result for '%s'", nodeName.Get() );
+            result = false;
+        }
+        else if ( Node::EnsurePathExistsForFile( nodeName ) == false )
         {
             FLOG_ERROR( "Failed to create path for '%s'", nodeName.Get() );
             result = false;
@@ -888,7 +1753,79 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
 
     // Send file to worker
     const Protocol::MsgFile resultMsg( toolId, fileId );
-    MutexHolder mh( static_cast<ServerState *>(connection->GetUserData())->m_Mutex );
+    ServerState * ss = static_cast<ServerState *>( connection->GetUserData() );
+    MutexHolder mh( ss->m_Mutex );
+    ss->m_BytesSent += dataSize;
+    SendMessageInternal( connection, resultMsg, ms );
+}
+
+// Process( MsgServerInfo )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgServerInfo * msg )
+{
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    MutexHolder mh( ss->m_Mutex );
+    ss->m_ProtocolVersionMinor = msg->GetProtocolVersionMinor();
+
+    // This is the reply to our connection msg, so completes the handshake
+    if ( ss->m_AwaitingHandshake )
+    {
+        ss->m_AwaitingHandshake = false;
+        ss->m_HandshakeLatencyMS = Math::Max( (uint32_t)ss->m_HandshakeTimer.GetElapsedMS(), 1u );
+        DIST_INFO( " - handshake: %s (%ums)\n", ss->m_RemoteName.Get(), ss->m_HandshakeLatencyMS );
+    }
+}
+
+// Process( MsgRequestHeaders )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestHeaders * /*msg*/, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgRequestHeaders" );
+
+    ConstMemoryStream requestStream( payload, payloadSize );
+    Array< AString > fileNames;
+    Array< uint64_t > contentHashes;
+    if ( ( requestStream.Read( fileNames ) == false ) ||
+         ( requestStream.Read( contentHashes ) == false ) ||
+         ( fileNames.GetSize() != contentHashes.GetSize() ) )
+    {
+        ASSERT( false ); // this indicates a protocol bug
+        Disconnect( connection );
+        return;
+    }
+
+    // Headers are only sent if they still match the hash the job was created
+    // with. If not (modified during the build), the job will fail on the worker
+    // and be built locally.
+    MemoryStream ms;
+    ms.Write( (uint32_t)fileNames.GetSize() );
+    for ( size_t i = 0; i < fileNames.GetSize(); ++i )
+    {
+        AString contents;
+        FileStream f;
+        bool available = false;
+        if ( f.Open( fileNames[ i ].Get() ) )
+        {
+            const uint32_t fileSize = (uint32_t)f.GetFileSize();
+            contents.SetLength( fileSize );
+            available = ( f.ReadBuffer( contents.Get(), fileSize ) == fileSize ) &&
+                        ( xxHash3::Calc64( contents.Get(), fileSize ) == contentHashes[ i ] );
+        }
+        ms.Write( contentHashes[ i ] );
+        ms.Write( available );
+        if ( available )
+        {
+            ms.Write( contents );
+        }
+    }
+
+    // Send headers to worker
+    const Protocol::MsgHeaders resultMsg;
+    ServerState * ss = static_cast<ServerState *>( connection->GetUserData() );
+    MutexHolder mh( ss->m_Mutex );
+    ss->m_BytesSent += ms.GetSize();
     SendMessageInternal( connection, resultMsg, ms );
 }
 
@@ -905,8 +1842,7 @@ const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, ui
           it != ss->m_Jobs.End();
           ++it )
     {
-        const Node * n = ( *it )->GetNode()->CastTo< ObjectNode >()->GetCompiler();
-        const ToolManifest & m = n->CastTo< CompilerNode >()->GetManifest();
+        const ToolManifest & m = GetToolManifest( **it );
         if ( m.GetToolId() == toolId )
         {
             // found a job with the same toolid
@@ -917,6 +1853,147 @@ const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, ui
     return nullptr;
 }
 
+// CalibrateResultCompression
+//------------------------------------------------------------------------------
+void Client::CalibrateResultCompression( const MultiBuffer & results )
+{
+    // A large real result is representative of what workers will compress
+    if ( ( results.GetDataSize() >= CompressionSelector::kMinCalibrationSize ) &&
+         ( m_ResultCompressionSelector.IsCalibrated() == false ) )
+    {
+        m_ResultCompressionSelector.Calibrate( results.GetData(), (size_t)results.GetDataSize() );
+    }
+}
+
+// DecompressJobResult
+//------------------------------------------------------------------------------
+/*static*/ bool Client::DecompressJobResult( const Job & job, MultiBuffer & results )
+{
+    // Objects may have been compressed with a cache dictionary
+    const CompressorDictionary * dictionary = nullptr;
+    const void * data = results.GetData();
+    const size_t dataSize = (size_t)results.GetDataSize();
+    const uint32_t dictionaryId = Compressor::IsValidData( data, dataSize ) ? Compressor::GetDictionaryId( data, dataSize ) : 0;
+    if ( dictionaryId != 0 )
+    {
+        if ( ( FBuild::IsValid() == false ) || ( FBuild::Get().GetCacheDictionaries() == nullptr ) )
+        {
+            return false;
+        }
+        dictionary = FBuild::Get().GetCacheDictionaries()->GetForDecompression( GetToolManifest( job ).GetToolId(), dictionaryId );
+        if ( dictionary == nullptr )
+        {
+            return false;
+        }
+    }
+    return results.Decompress( dictionary );
+}
+
+// GetToolManifest
+//------------------------------------------------------------------------------
+/*static*/ const ToolManifest & Client::GetToolManifest( const Job & job )
+{
+    const Node * node = job.GetNode();
+    switch ( node->GetType() )
+    {
+        case Node::EXEC_NODE: return node->CastTo< ExecNode >()->GetManifest();
+        case Node::TEST_NODE: return node->CastTo< TestNode >()->GetManifest();
+        default:
+        {
+            const Node * n = node->CastTo< ObjectNode >()->GetCompiler();
+            return n->CastTo< CompilerNode >()->GetManifest();
+        }
+    }
+}
+
+// GetResultFileName
+//------------------------------------------------------------------------------
+/*static*/ bool Client::GetResultFileName( const Node * node, size_t index, AString & outFileName )
+{
+    // Matches the order files are returned in (see JobQueueRemote::ReadResults)
+    if ( index == 0 )
+    {
+        outFileName = node->GetName(); // Object file (or output of Exec/Test)
+        return true;
+    }
+    if ( node->GetType() != Node::OBJECT_NODE )
+    {
+        return false;
+    }
+
+    const ObjectNode * on = node->CastTo< ObjectNode >();
+    size_t fileIndex = 1;
+    if ( on->IsUsingPDB() )
+    {
+        if ( index == fileIndex++ )
+        {
+            on->GetPDBName( outFileName );
+            return true;
+        }
+    }
+    if ( on->IsUsingStaticAnalysisMSVC() )
+    {
+        if ( index == fileIndex++ )
+        {
+            on->GetNativeAnalysisXMLPath( outFileName );
+            return true;
+        }
+    }
+    return false;
+}
+
+// FinishStreamedResult
+//------------------------------------------------------------------------------
+/*static*/ bool Client::FinishStreamedResult( StreamedResult & sr )
+{
+    if ( sr.m_File.IsOpen() )
+    {
+        sr.m_File.Close();
+    }
+
+    // All files must have been received
+    AStackString<> fileName;
+    bool ok = ( sr.m_Failed == false ) &&
+              ( GetResultFileName( sr.m_Node, sr.m_TmpFiles.GetSize(), fileName ) == false );
+    if ( ok == false )
+    {
+        FLOG_ERROR( "Incomplete result for '%s'", sr.m_Node->GetName().Get() );
+    }
+
+    // Move each into place (or remove them if not usable)
+    for ( size_t i = 0; i < sr.m_TmpFiles.GetSize(); ++i )
+    {
+        const AString & tmpFileName = sr.m_TmpFiles[ i ];
+        if ( ok )
+        {
+            GetResultFileName( sr.m_Node, i, fileName );
+            if ( FileIO::FileMove( tmpFileName, fileName ) )
+            {
+                continue;
+            }
+            FLOG_ERROR( "Failed to create file. Error: %s File: '%s'", LAST_ERROR_STR, fileName.Get() );
+            ok = false;
+        }
+        FileIO::FileDelete( tmpFileName.Get() );
+    }
+    return ok;
+}
+
+// DiscardStreamedResult
+//------------------------------------------------------------------------------
+/*static*/ void Client::DiscardStreamedResult( StreamedResult * sr )
+{
+    if ( sr->m_File.IsOpen() )
+    {
+        sr->m_File.Close();
+    }
+    for ( const AString & tmpFileName : sr->m_TmpFiles )
+    {
+        FileIO::FileDelete( tmpFileName.Get() );
+    }
+    FDELETE sr;
+}
+
 // WriteFileToDisk
 //------------------------------------------------------------------------------
 bool Client::WriteFileToDisk( const AString & fileName, const MultiBuffer & multiBuffer, size_t index ) const
@@ -935,9 +2012,30 @@ Client::ServerState::ServerState()
     : m_Connection( nullptr )
     , m_CurrentMessage( nullptr )
     , m_NumJobsAvailable( 0 )
+    , m_NumSlots( 0 )
+    , m_NumSlotsKnown( false )
     , m_Jobs( 16, true )
+    , m_StreamedResults( 0, true )
+    , m_HostIP( 0 )
+    , m_ProtocolVersionMinor( 0 )
+    , m_AwaitingHandshake( false )
+    , m_DictionariesSent( 0, true )
     , m_Denylisted( false )
+    , m_NumJobsCompleted( 0 )
+    , m_NumFailures( 0 )
+    , m_HandshakeLatencyMS( 0 )
+    , m_TotalLatencyMS( 0 )
+    , m_RelativeLatency( 0.0f )
+    , m_NumRelativeLatencySamples( 0 )
+    , m_BytesSent( 0 )
+    , m_BytesReceived( 0 )
+    , m_NumJobRequestBatches( 0 )
+    , m_NumResultBatches( 0 )
+    , m_PreferCheapJobs( false )
+    , m_Straggler( false )
 {
+    m_ResultCompression.m_Level = 0x7FFF; // None chosen yet (not a valid level)
+    m_ResultCompression.m_Zstd = false;
     m_DelayTimer.Start( 999.0f );
 }
 
@@ -4,7 +4,11 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionSelector.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
+
 #include "Core/Containers/Array.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
@@ -17,14 +21,22 @@ class ConstMemoryStream;
 class Job;
 class MemoryStream;
 class MultiBuffer;
+class Node;
 namespace Protocol
 {
     class IMessage;
+    class MsgCapacity;
+    class MsgHeaders;
     class MsgJobResult;
+    class MsgJobResultChunk;
     class MsgJobResultCompressed;
+    class MsgJobResults;
     class MsgRequestJob;
+    class MsgRequestJobs;
     class MsgRequestManifest;
     class MsgRequestFile;
+    class MsgRequestHeaders;
+    class MsgServerInfo;
     class MsgServerStatus;
 }
 class ToolManifest;
@@ -40,30 +52,49 @@ public:
             bool detailedLogging );
     virtual ~Client() override;
 
+    // Performance of each worker used so far
+    void GetWorkerStats( Array< FBuildStats::WorkerStats > & outStats );
+
 private:
     virtual void OnDisconnected( const ConnectionInfo * connection ) override;
     virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
 
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResult *, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultCompressed * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResults * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgCapacity * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgServerInfo * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestHeaders * msg, const void * payload, size_t payloadSize );
 
     void ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize );
 
+    bool SendJob( const ConnectionInfo * connection ); // false if no job could be sent
+    void SendNoJobAvailable( const ConnectionInfo * connection, uint32_t count );
+
     const ToolManifest * FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const;
+    static const ToolManifest & GetToolManifest( const Job & job );
+    void CalibrateResultCompression( const MultiBuffer & results );
+    static bool DecompressJobResult( const Job & job, MultiBuffer & results );
     bool WriteFileToDisk( const AString& fileName, const MultiBuffer & multiBuffer, size_t index ) const;
+    static bool GetResultFileName( const Node * node, size_t index, AString & outFileName );
 
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
 
     void            LookForWorkers();
+    void            ResolveWorkerHostNames( const Array< size_t > & order, const Array< uint32_t > & ranks, size_t freeSlots, size_t maxCandidates );
     void            CommunicateJobAvailability();
+    void            UpdateWorkerPerformance();
 
     // More verbose name to avoid conflict with windows.h SendMessage
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg );
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream );
+    void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream, const void * payloadTail, size_t payloadTailSize );
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const ConstMemoryStream & memoryStream );
 
     Array< AString >    m_WorkerList;   // workers to connect to
@@ -73,6 +104,23 @@ private:
 
     // state
     Timer               m_StatusUpdateTimer;
+    Timer               m_PerformanceUpdateTimer;
+    CompressionSelector m_ResultCompressionSelector; // calibrated on the first large result
+
+    // A large result being received in chunks (see MsgJobResultChunk). Each
+    // output file is written alongside its destination, and moved into place
+    // once the result confirms the job succeeded. Only used by the thread
+    // receiving from the worker (the list of them is protected by m_Mutex).
+    struct StreamedResult
+    {
+        uint32_t            m_JobId = 0;
+        const Node *        m_Node = nullptr;
+        FileStream          m_File;         // file currently being written
+        Array< AString >    m_TmpFiles;     // one per output file received so far
+        bool                m_Failed = false;
+    };
+    static bool     FinishStreamedResult( StreamedResult & sr );
+    static void     DiscardStreamedResult( StreamedResult * sr );
 
     struct ServerState
     {
@@ -85,10 +133,35 @@ private:
         const Protocol::IMessage * m_CurrentMessage;
         Timer                   m_DelayTimer;
         uint32_t                m_NumJobsAvailable;     // num jobs we've told this server we have available
+        uint32_t                m_NumSlots;             // job slots the server last advertised (if m_NumSlotsKnown)
+        bool                    m_NumSlotsKnown;        // server has advertised its job slots
         Array< Job * >          m_Jobs;                 // jobs we've sent to this server
+        Array< StreamedResult * > m_StreamedResults;    // results currently being received
+        uint32_t                m_HostIP;               // resolved on first connection attempt
+        uint8_t                 m_ProtocolVersionMinor; // as reported by the server (0 if not reported)
+        bool                    m_AwaitingHandshake;    // connection msg sent, but server info not yet received
+        Timer                   m_HandshakeTimer;       // from sending the connection msg
+        Array< uint64_t >       m_DictionariesSent;     // hashes of toolchain + dictionary ids sent on this connection
 
         bool                    m_Denylisted;
+
+        // performance (retained across connections)
+        uint32_t                m_NumJobsCompleted;
+        uint32_t                m_NumFailures;          // system errors and jobs lost to disconnection
+        uint32_t                m_HandshakeLatencyMS;   // from connection msg to server info on the last connection (0 if unknown)
+        uint64_t                m_TotalLatencyMS;       // from sending jobs to receiving results
+        float                   m_RelativeLatency;      // moving average of latency relative to previous build times
+        uint32_t                m_NumRelativeLatencySamples;
+        uint64_t                m_BytesSent;
+        uint64_t                m_BytesReceived;
+        uint32_t                m_NumJobRequestBatches; // messages requesting several jobs
+        uint32_t                m_NumResultBatches;     // messages returning several results
+        bool                    m_PreferCheapJobs;      // slower than other workers, so leave expensive jobs to them
+        bool                    m_Straggler;            // much slower than other workers, so stop using it
+        CompressionSelector::Choice m_ResultCompression;  // last choice for this link (reported on change)
     };
+    static void     RecordJobPerformance( ServerState & ss, const Job & job, int64_t resultReceivedTime, size_t resultSize, bool systemError );
+    static uint32_t GetWorkerRank( const ServerState & ss );
     Mutex                   m_ServerListMutex;
     Array< ServerState >    m_ServerList;
     uint32_t                m_WorkerConnectionLimit;
@@ -36,6 +36,17 @@
             "RequestFile",
             "File",
             "JobResultCompressed",
+            "RequestJobs",
+            "JobResults",
+            "Capacity",
+            "WorkerStatus",
+            "RequestWorkers",
+            "Workers",
+            "ServerInfo",
+            "RequestHeaders",
+            "Headers",
+            "JobResultChunk",
+            "Dictionary",
         };
         static_assert( ( sizeof( msgNames ) / sizeof(const char *) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
 
@@ -87,6 +98,35 @@ bool Protocol::IMessage::Send( const ConnectionInfo * connection, const ConstMem
     return pool.Send( connection, this, m_MsgSize, payload.GetData(), payload.GetSize() );
 }
 
+// IMessage::Send (with payload)
+//------------------------------------------------------------------------------
+bool Protocol::IMessage::Send( const ConnectionInfo * connection, const MemoryStream & payload, const void * payloadTail, size_t payloadTailSize ) const
+{
+    ASSERT( connection );
+    ASSERT( m_HasPayload == true ); // must NOT use Send with payload
+
+    // The payload is sent as the stream followed by the tail, which avoids
+    // copying large data (like job data) into the stream
+    const TCPConnectionPool::SendBuffer payloadBuffers[ 2 ] =
+    {
+        { (uint32_t)payload.GetSize(), payload.GetData() },
+        { (uint32_t)payloadTailSize, payloadTail },
+    };
+    TCPConnectionPool & pool = connection->GetTCPConnectionPool();
+    return pool.Send( connection, this, m_MsgSize, payloadBuffers, 2 );
+}
+
+// IMessage::Send (with payload)
+//------------------------------------------------------------------------------
+bool Protocol::IMessage::Send( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * payloadBuffers, uint32_t numPayloadBuffers ) const
+{
+    ASSERT( connection );
+    ASSERT( m_HasPayload == true ); // must NOT use Send with payload
+
+    TCPConnectionPool & pool = connection->GetTCPConnectionPool();
+    return pool.Send( connection, this, m_MsgSize, payloadBuffers, numPayloadBuffers );
+}
+
 // IMessage::Broadcast
 //------------------------------------------------------------------------------
 bool Protocol::IMessage::Broadcast( TCPConnectionPool * pool ) const
@@ -100,12 +140,13 @@ bool Protocol::IMessage::Broadcast( TCPConnectionPool * pool ) const
 
 // MsgConnection
 //------------------------------------------------------------------------------
-Protocol::MsgConnection::MsgConnection( uint32_t numJobsAvailable )
+Protocol::MsgConnection::MsgConnection( uint32_t numJobsAvailable, uint8_t priority )
     : Protocol::IMessage( Protocol::MSG_CONNECTION, sizeof( MsgConnection ), false )
     , m_ProtocolVersion( PROTOCOL_VERSION_MAJOR )
     , m_NumJobsAvailable( numJobsAvailable )
     , m_Platform(Env::GetPlatform())
     , m_ProtocolVersionMinor( PROTOCOL_VERSION_MINOR )
+    , m_Priority( priority )
 {
     memset( m_Padding2, 0, sizeof( m_Padding2 ) );
     memset( m_HostName, 0, sizeof( m_HostName ) );
@@ -130,6 +171,14 @@ Protocol::MsgRequestJob::MsgRequestJob()
 {
 }
 
+// MsgRequestJobs
+//------------------------------------------------------------------------------
+Protocol::MsgRequestJobs::MsgRequestJobs( uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_JOBS, sizeof( MsgRequestJobs ), false )
+    , m_NumJobs( numJobs )
+{
+}
+
 // MsgNoJobAvailable
 //------------------------------------------------------------------------------
 Protocol::MsgNoJobAvailable::MsgNoJobAvailable()
@@ -139,12 +188,13 @@ Protocol::MsgNoJobAvailable::MsgNoJobAvailable()
 
 // MsgJob
 //------------------------------------------------------------------------------
-Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel )
+Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel, bool isHeaderBundle, bool resultCompressionZstd )
     : Protocol::IMessage( Protocol::MSG_JOB, sizeof( MsgJob ), true )
     , m_ResultCompressionLevel( resultCompressionLevel )
+    , m_IsHeaderBundle( isHeaderBundle ? 1 : 0 )
+    , m_ResultCompressionZstd( resultCompressionZstd ? 1 : 0 )
     , m_ToolId( toolId )
 {
-    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
     ASSERT( toolId );
 }
 
@@ -162,6 +212,85 @@ Protocol::MsgJobResultCompressed::MsgJobResultCompressed()
 {
 }
 
+// MsgJobResults
+//------------------------------------------------------------------------------
+Protocol::MsgJobResults::MsgJobResults()
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULTS, sizeof( MsgJobResults ), true )
+{
+}
+
+// MsgCapacity
+//------------------------------------------------------------------------------
+Protocol::MsgCapacity::MsgCapacity( uint32_t numSlots )
+    : Protocol::IMessage( Protocol::MSG_CAPACITY, sizeof( MsgCapacity ), true )
+    , m_NumSlots( numSlots )
+{
+}
+
+// MsgWorkerStatus
+//------------------------------------------------------------------------------
+Protocol::MsgWorkerStatus::MsgWorkerStatus( uint16_t numCPUs, uint16_t numSlots, uint16_t numFreeSlots )
+    : Protocol::IMessage( Protocol::MSG_WORKER_STATUS, sizeof( MsgWorkerStatus ), true )
+    , m_ProtocolVersion( PROTOCOL_VERSION_MAJOR )
+    , m_NumCPUs( numCPUs )
+    , m_NumSlots( numSlots )
+    , m_NumFreeSlots( numFreeSlots )
+    , m_Platform( Env::GetPlatform() )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgRequestWorkers
+//------------------------------------------------------------------------------
+Protocol::MsgRequestWorkers::MsgRequestWorkers()
+    : Protocol::IMessage( Protocol::MSG_REQUEST_WORKERS, sizeof( MsgRequestWorkers ), true )
+    , m_ProtocolVersion( PROTOCOL_VERSION_MAJOR )
+    , m_Platform( Env::GetPlatform() )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgWorkers
+//------------------------------------------------------------------------------
+Protocol::MsgWorkers::MsgWorkers()
+    : Protocol::IMessage( Protocol::MSG_WORKERS, sizeof( MsgWorkers ), true )
+{
+}
+
+// MsgServerInfo
+//------------------------------------------------------------------------------
+Protocol::MsgServerInfo::MsgServerInfo()
+    : Protocol::IMessage( Protocol::MSG_SERVER_INFO, sizeof( MsgServerInfo ), false )
+    , m_ProtocolVersionMinor( PROTOCOL_VERSION_MINOR )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgRequestHeaders
+//------------------------------------------------------------------------------
+Protocol::MsgRequestHeaders::MsgRequestHeaders()
+    : Protocol::IMessage( Protocol::MSG_REQUEST_HEADERS, sizeof( MsgRequestHeaders ), true )
+{
+}
+
+// MsgHeaders
+//------------------------------------------------------------------------------
+Protocol::MsgHeaders::MsgHeaders()
+    : Protocol::IMessage( Protocol::MSG_HEADERS, sizeof( MsgHeaders ), true )
+{
+}
+
+// MsgJobResultChunk
+//------------------------------------------------------------------------------
+Protocol::MsgJobResultChunk::MsgJobResultChunk( uint32_t jobId, uint8_t fileIndex, bool compressed )
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULT_CHUNK, sizeof( MsgJobResultChunk ), true )
+    , m_JobId( jobId )
+    , m_FileIndex( fileIndex )
+    , m_Compressed( compressed ? 1 : 0 )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
 // MsgRequestManifest
 //------------------------------------------------------------------------------
 Protocol::MsgRequestManifest::MsgRequestManifest( uint64_t toolId )
@@ -198,4 +327,13 @@ Protocol::MsgFile::MsgFile( uint64_t toolId, uint32_t fileId )
 {
 }
 
+// MsgDictionary
+//------------------------------------------------------------------------------
+Protocol::MsgDictionary::MsgDictionary( uint64_t toolId, uint32_t dictionaryId )
+    : Protocol::IMessage( Protocol::MSG_DICTIONARY, sizeof( MsgDictionary ), true )
+    , m_DictionaryId( dictionaryId )
+    , m_ToolId( toolId )
+{
+}
+
 //------------------------------------------------------------------------------
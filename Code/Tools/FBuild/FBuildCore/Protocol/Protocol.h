@@ -6,13 +6,13 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/MSVCStaticAnalysis.h"
 #include "Core/Env/Types.h"
+#include "Core/Network/TCPConnectionPool.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
 class ConnectionInfo;
 class ConstMemoryStream;
 class MemoryStream;
-class TCPConnectionPool;
 
 // Defines
 //------------------------------------------------------------------------------
@@ -32,10 +32,30 @@ namespace Protocol
 
     // Protocol Version
     enum : uint32_t { PROTOCOL_VERSION_MAJOR = 22 };    // Changes here make workers incompatible
-    enum : uint8_t  { PROTOCOL_VERSION_MINOR = 2 };     // Changes must be forwards and backwards compatible
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR = 10 };     // Changes must be forwards and backwards compatible
+
+    // Minor versions at which optional features became available
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_JOB_BATCHING = 3 }; // MSG_REQUEST_JOBS and MSG_JOB_RESULTS
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_CAPACITY = 4 };     // MSG_CAPACITY
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_HEADER_BUNDLES = 5 };// MSG_SERVER_INFO, MSG_REQUEST_HEADERS and MSG_HEADERS
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_REMOTE_EXEC = 6 };  // Exec() and Test() jobs
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_ZSTD_RESULTS = 7 }; // MsgJob can request Zstd compressed results
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_STREAMED_RESULTS = 8 };// MSG_JOB_RESULT_CHUNK
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_RESULT_DICTIONARIES = 9 };// MSG_DICTIONARY
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR_TOOL_CONTENT_HASHES = 10 };// MsgManifest includes xxHash3 of each file
 
     enum { PROTOCOL_TEST_PORT = PROTOCOL_PORT + 1 }; // Different port for use by tests
 
+    enum : uint16_t { COORDINATOR_PORT = PROTOCOL_PORT + 2 };         // See WorkerCoordinator
+    enum { COORDINATOR_TEST_PORT = PROTOCOL_PORT + 3 };
+
+    // Priority of a client when workers share job slots between several clients
+    enum ClientPriority : uint8_t
+    {
+        PRIORITY_INTERACTIVE    = 0, // A developer waiting for a build (older clients always send this)
+        PRIORITY_BACKGROUND     = 1, // CI and other unattended builds
+    };
+
     // Identifiers for all unique messages
     //------------------------------------------------------------------------------
     enum MessageType : uint8_t
@@ -57,6 +77,21 @@ namespace Protocol
 
         MSG_JOB_RESULT_COMPRESSED   = 11, // Server -> Client : Return completed job (compressed)
 
+        MSG_REQUEST_JOBS        = 12,// Server -> Client : Ask for several jobs to do
+        MSG_JOB_RESULTS         = 13,// Server -> Client : Return several completed jobs
+
+        MSG_CAPACITY            = 14,// Server -> Client : Number of job slots changed (returning jobs not started)
+
+        MSG_WORKER_STATUS       = 15,// Worker -> Coordinator : Availability, free job slots and cached toolchains
+        MSG_REQUEST_WORKERS     = 16,// Client -> Coordinator : Ask for workers
+        MSG_WORKERS             = 17,// Client <- Coordinator : Respond with workers, most suitable first
+
+        MSG_SERVER_INFO         = 18,// Server -> Client : Features supported by the worker
+        MSG_REQUEST_HEADERS     = 19,// Server -> Client : Ask for headers needed by header bundle jobs
+        MSG_HEADERS             = 20,// Server <- Client : Send requested headers
+        MSG_JOB_RESULT_CHUNK    = 21,// Server -> Client : Part of a large result, ahead of the result itself
+        MSG_DICTIONARY          = 22,// Server <- Client : Dictionary to compress results of a toolchain with
+
         NUM_MESSAGES            // leave last
     };
 };
@@ -75,6 +110,8 @@ namespace Protocol
         bool Send( const ConnectionInfo * connection ) const;
         bool Send( const ConnectionInfo * connection, const MemoryStream & payload ) const;
         bool Send( const ConnectionInfo * connection, const ConstMemoryStream & payload ) const;
+        bool Send( const ConnectionInfo * connection, const MemoryStream & payload, const void * payloadTail, size_t payloadTailSize ) const;
+        bool Send( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * payloadBuffers, uint32_t numPayloadBuffers ) const;
         bool Broadcast( TCPConnectionPool * pool ) const;
 
         inline MessageType  GetType() const { return m_MsgType; }
@@ -97,19 +134,21 @@ namespace Protocol
     class MsgConnection : public IMessage
     {
     public:
-        explicit MsgConnection( uint32_t numJobsAvailable );
+        explicit MsgConnection( uint32_t numJobsAvailable, uint8_t priority = PRIORITY_INTERACTIVE );
 
         inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
         inline uint32_t GetNumJobsAvailable() const { return m_NumJobsAvailable; }
         inline uint8_t  GetPlatform() const { return m_Platform; }
         const char * GetHostName() const { return m_HostName; }
         uint8_t         GetProtocolVersionMinor() const { return m_ProtocolVersionMinor; }
+        uint8_t         GetPriority() const { return m_Priority; }
     private:
         uint32_t        m_ProtocolVersion;
         uint32_t        m_NumJobsAvailable;
         uint8_t         m_Platform;
         uint8_t         m_ProtocolVersionMinor;
-        uint8_t         m_Padding2[2];
+        uint8_t         m_Priority;
+        uint8_t         m_Padding2[1];
         char            m_HostName[ 64 ];
     };
     static_assert( sizeof( MsgConnection ) == sizeof( IMessage ) + 76, "MsgConnection message has incorrect size" );
@@ -136,6 +175,21 @@ namespace Protocol
     };
     static_assert( sizeof( MsgRequestJob ) == sizeof( IMessage ), "MsgRequestJob message has incorrect size" );
 
+    // MsgRequestJobs
+    //------------------------------------------------------------------------------
+    // Equivalent to several MsgRequestJob. Each requested job is answered
+    // individually with a MsgJob or a MsgNoJobAvailable.
+    class MsgRequestJobs : public IMessage
+    {
+    public:
+        explicit MsgRequestJobs( uint32_t numJobs );
+
+        inline uint32_t GetNumJobs() const { return m_NumJobs; }
+    private:
+        uint32_t        m_NumJobs;
+    };
+    static_assert( sizeof( MsgRequestJobs ) == sizeof( IMessage ) + 4, "MsgRequestJobs message has incorrect size" );
+
     // MsgNoJobAvailable
     //------------------------------------------------------------------------------
     class MsgNoJobAvailable : public IMessage
@@ -150,13 +204,16 @@ namespace Protocol
     class MsgJob : public IMessage
     {
     public:
-        explicit MsgJob( uint64_t toolId, int16_t resultCompressionLevel );
+        explicit MsgJob( uint64_t toolId, int16_t resultCompressionLevel, bool isHeaderBundle = false, bool resultCompressionZstd = false );
 
         inline uint64_t GetToolId() const { return m_ToolId; }
         int16_t         GetResultCompressionLevel() const { return m_ResultCompressionLevel; }
+        bool            IsHeaderBundle() const { return ( m_IsHeaderBundle != 0 ); }
+        bool            IsResultCompressionZstd() const { return ( m_ResultCompressionZstd != 0 ); }
     private:
         int16_t     m_ResultCompressionLevel;
-        char        m_Padding2[ 2 ];
+        uint8_t     m_IsHeaderBundle; // Always 0 from clients prior to PROTOCOL_VERSION_MINOR_HEADER_BUNDLES
+        uint8_t     m_ResultCompressionZstd; // Always 0 from clients prior to PROTOCOL_VERSION_MINOR_ZSTD_RESULTS
         uint64_t m_ToolId;
     };
     static_assert( sizeof( MsgJob ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgJob message has incorrect size" );
@@ -179,6 +236,151 @@ namespace Protocol
     };
     static_assert( sizeof( MsgJobResultCompressed ) == sizeof( IMessage ), "MsgJobResultCompressed message has incorrect size" );
 
+    // MsgJobResults
+    //------------------------------------------------------------------------------
+    // Equivalent to several MsgJobResult/MsgJobResultCompressed. The payload is
+    // the number of results, then for each a compressed flag, the size of the
+    // result and the result itself (as it would be sent individually).
+    class MsgJobResults : public IMessage
+    {
+    public:
+        MsgJobResults();
+
+        enum : uint32_t { kMaxResults = 16 }; // Limited by number of buffers sent at once
+    };
+    static_assert( sizeof( MsgJobResults ) == sizeof( IMessage ), "MsgJobResults message has incorrect size" );
+
+    // MsgJobResultChunk
+    //------------------------------------------------------------------------------
+    // Large results are streamed as a series of chunks, each (optionally)
+    // compressed on its own, so the worker never holds the whole result in
+    // memory and the client can write each chunk to disk as it arrives. The
+    // chunks for each output file are sent in order, followed by the
+    // MsgJobResult/MsgJobResultCompressed for the job (with no data).
+    class MsgJobResultChunk : public IMessage
+    {
+    public:
+        MsgJobResultChunk( uint32_t jobId, uint8_t fileIndex, bool compressed );
+
+        inline uint32_t GetJobId() const        { return m_JobId; }
+        inline uint8_t  GetFileIndex() const    { return m_FileIndex; }
+        inline bool     IsCompressed() const    { return ( m_Compressed != 0 ); }
+
+        enum : uint32_t { kChunkSize = ( 4 * 1024 * 1024 ) }; // Uncompressed size of each chunk
+    private:
+        uint32_t        m_JobId;
+        uint8_t         m_FileIndex;
+        uint8_t         m_Compressed;
+        uint8_t         m_Padding2[ 2 ];
+    };
+    static_assert( sizeof( MsgJobResultChunk ) == sizeof( IMessage ) + 8, "MsgJobResultChunk message has incorrect size" );
+
+    // MsgCapacity
+    //------------------------------------------------------------------------------
+    // Sent when the number of job slots on the worker changes. When reduced, the
+    // payload lists the ids of queued jobs the worker won't build (the number of
+    // jobs, then each id), so the client can build them elsewhere.
+    class MsgCapacity : public IMessage
+    {
+    public:
+        explicit MsgCapacity( uint32_t numSlots );
+
+        inline uint32_t GetNumSlots() const { return m_NumSlots; }
+    private:
+        uint32_t        m_NumSlots;
+    };
+    static_assert( sizeof( MsgCapacity ) == sizeof( IMessage ) + 4, "MsgCapacity message has incorrect size" );
+
+    // MsgWorkerStatus
+    //------------------------------------------------------------------------------
+    // Sent periodically by workers to a WorkerCoordinator. The payload is the
+    // address of the worker, then the ids of the toolchains it has cached.
+    class MsgWorkerStatus : public IMessage
+    {
+    public:
+        MsgWorkerStatus( uint16_t numCPUs, uint16_t numSlots, uint16_t numFreeSlots );
+
+        inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+        inline uint8_t  GetPlatform() const { return m_Platform; }
+        inline uint16_t GetNumCPUs() const { return m_NumCPUs; }
+        inline uint16_t GetNumSlots() const { return m_NumSlots; }
+        inline uint16_t GetNumFreeSlots() const { return m_NumFreeSlots; }
+    private:
+        uint32_t        m_ProtocolVersion;
+        uint16_t        m_NumCPUs;
+        uint16_t        m_NumSlots;     // 0 when not available
+        uint16_t        m_NumFreeSlots;
+        uint8_t         m_Platform;
+        uint8_t         m_Padding2[ 1 ];
+    };
+    static_assert( sizeof( MsgWorkerStatus ) == sizeof( IMessage ) + 12, "MsgWorkerStatus message has incorrect size" );
+
+    // MsgRequestWorkers
+    //------------------------------------------------------------------------------
+    // The payload is the ids of the toolchains the client expects to use (if
+    // known), so workers which already have them can be preferred.
+    class MsgRequestWorkers : public IMessage
+    {
+    public:
+        MsgRequestWorkers();
+
+        inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+        inline uint8_t  GetPlatform() const { return m_Platform; }
+    private:
+        uint32_t        m_ProtocolVersion;
+        uint8_t         m_Platform;
+        uint8_t         m_Padding2[ 3 ];
+    };
+    static_assert( sizeof( MsgRequestWorkers ) == sizeof( IMessage ) + 8, "MsgRequestWorkers message has incorrect size" );
+
+    // MsgWorkers
+    //------------------------------------------------------------------------------
+    // The payload is the addresses of the workers.
+    class MsgWorkers : public IMessage
+    {
+    public:
+        MsgWorkers();
+    };
+    static_assert( sizeof( MsgWorkers ) == sizeof( IMessage ), "MsgWorkers message has incorrect size" );
+
+    // MsgServerInfo
+    //------------------------------------------------------------------------------
+    // Sent once connected to clients which support it, so they know which
+    // features the worker supports.
+    class MsgServerInfo : public IMessage
+    {
+    public:
+        MsgServerInfo();
+
+        inline uint8_t  GetProtocolVersionMinor() const { return m_ProtocolVersionMinor; }
+    private:
+        uint8_t         m_ProtocolVersionMinor;
+        uint8_t         m_Padding2[ 3 ];
+    };
+    static_assert( sizeof( MsgServerInfo ) == sizeof( IMessage ) + 4, "MsgServerInfo message has incorrect size" );
+
+    // MsgRequestHeaders
+    //------------------------------------------------------------------------------
+    // The payload is the names of the headers the worker doesn't have, then
+    // their content hashes (as listed in the HeaderBundle of a job).
+    class MsgRequestHeaders : public IMessage
+    {
+    public:
+        MsgRequestHeaders();
+    };
+    static_assert( sizeof( MsgRequestHeaders ) == sizeof( IMessage ), "MsgRequestHeaders message has incorrect size" );
+
+    // MsgHeaders
+    //------------------------------------------------------------------------------
+    // The payload is the number of headers, then for each the content hash, a
+    // flag indicating if it is available and (if so) the contents.
+    class MsgHeaders : public IMessage
+    {
+    public:
+        MsgHeaders();
+    };
+    static_assert( sizeof( MsgHeaders ) == sizeof( IMessage ), "MsgHeaders message has incorrect size" );
+
     // MsgRequestManifest
     //------------------------------------------------------------------------------
     class MsgRequestManifest : public IMessage
@@ -237,6 +439,25 @@ namespace Protocol
     };
     static_assert( sizeof( MsgFile ) == sizeof( IMessage ) + 12, "MsgFile message has incorrect size" );
 
+    // MsgDictionary
+    //------------------------------------------------------------------------------
+    // Sent before the first job of a toolchain requesting Zstd compressed
+    // results, when the client has a cache dictionary for that toolchain. The
+    // payload is the dictionary. Results of later jobs for the toolchain are
+    // compressed with it.
+    class MsgDictionary : public IMessage
+    {
+    public:
+        MsgDictionary( uint64_t toolId, uint32_t dictionaryId );
+
+        inline uint64_t GetToolId() const       { return m_ToolId; }
+        inline uint32_t GetDictionaryId() const { return m_DictionaryId; }
+    private:
+        uint32_t m_DictionaryId;
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgDictionary ) == sizeof( IMessage ) + 12, "MsgDictionary message has incorrect size" );
+
     // MsgServerStatus
     //------------------------------------------------------------------------------
     class MsgServerStatus : public IMessage
@@ -7,34 +7,49 @@
 #include "Protocol.h"
 
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderBundle.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
+#include "Core/Containers/UniquePtr.h"
 #include "Core/Env/Env.h"
 #include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
 // Defines
 //------------------------------------------------------------------------------
-#if defined( __OSX__ ) || defined( __LINUX__ )
-    // Touch files every 4 hours
-    #define SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS (60.0f * 60.0f * 4.0f)
-#endif
+// Touch toolchain files (and trim the toolchain file store) every 4 hours
+#define SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS (60.0f * 60.0f * 4.0f)
+
+// Job slots are shared between clients in proportion to these weights
+#define SERVER_WEIGHT_INTERACTIVE 4.0
+#define SERVER_WEIGHT_BACKGROUND 1.0
+#define SERVER_DEFAULT_JOB_TIME_MS 1000.0f  // Assumed job time until a client has completed a job
+#define SERVER_MIN_JOB_TIME_MS 10.0f
+#define SERVER_AVG_SMOOTHING 0.1f           // Weight of new samples for per-client averages
+#define SERVER_STREAMED_RESULT_THRESHOLD ( 16 * 1024 * 1024 ) // Stream results at least this big to clients which support it
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Server::Server( uint32_t numThreadsInJobQueue )
     : m_ShouldExit( false )
     , m_ClientList( 32, true )
+    , m_NumSlots( WorkerThreadRemote::GetNumCPUsToUse() )
+    , m_StreamedResultThreshold( SERVER_STREAMED_RESULT_THRESHOLD )
 {
     m_JobQueueRemote = FNEW( JobQueueRemote( numThreadsInJobQueue ? numThreadsInJobQueue : Env::GetNumProcessors() ) );
 
     m_Thread.Start( ThreadFuncStatic, "Server", this );
+    m_StreamThread.Start( StreamThreadFuncStatic, "ServerStream", this );
 }
 
 // DESTRUCTOR
@@ -44,6 +59,15 @@ Server::~Server()
     m_ShouldExit.Store( true );
     JobQueueRemote::Get().WakeMainThread();
     m_Thread.Join();
+    m_StreamSemaphore.Signal();
+    m_StreamThread.Join();
+
+    // Results not yet streamed are abandoned
+    for ( const StreamedJob & streamedJob : m_StreamedJobs )
+    {
+        FDELETE streamedJob.m_Job;
+    }
+    m_StreamedJobs.Clear();
 
     ShutdownAllConnections();
 
@@ -96,6 +120,82 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     return false; // no toolchain is currently synching
 }
 
+// GetNumResultsReused
+//------------------------------------------------------------------------------
+uint32_t Server::GetNumResultsReused() const
+{
+    return m_JobQueueRemote->GetNumResultsReused();
+}
+
+// GetNumResultDictionaries
+//------------------------------------------------------------------------------
+size_t Server::GetNumResultDictionaries() const
+{
+    return m_JobQueueRemote->GetNumResultDictionaries();
+}
+
+// GetNumJobsActive
+//------------------------------------------------------------------------------
+uint32_t Server::GetNumJobsActive() const
+{
+    MutexHolder mh( m_ClientListMutex );
+
+    uint32_t numJobsActive = 0;
+    for ( const ClientState * cs : m_ClientList )
+    {
+        numJobsActive += cs->m_NumJobsActive.Load();
+    }
+    return numJobsActive;
+}
+
+// GetToolIds
+//------------------------------------------------------------------------------
+void Server::GetToolIds( Array< uint64_t > & outToolIds ) const
+{
+    MutexHolder mh( m_ToolManifestsMutex );
+
+    for ( const ToolManifest * tm : m_Tools )
+    {
+        if ( tm->IsSynchronized() )
+        {
+            outToolIds.Append( tm->GetToolId() );
+        }
+    }
+}
+
+// GetClientStatus
+//------------------------------------------------------------------------------
+void Server::GetClientStatus( AString & outStatus ) const
+{
+    outStatus.Clear();
+
+    MutexHolder mh( m_ClientListMutex );
+
+    uint32_t totalJobsActive = 0;
+    for ( const ClientState * cs : m_ClientList )
+    {
+        totalJobsActive += cs->m_NumJobsActive.Load();
+    }
+
+    for ( const ClientState * cs : m_ClientList )
+    {
+        const uint32_t jobsActive = cs->m_NumJobsActive.Load();
+        if ( ( jobsActive == 0 ) && ( cs->m_Waiting == false ) )
+        {
+            continue; // Not using the worker
+        }
+
+        const uint32_t share = (uint32_t)( ( jobsActive * 100 ) / Math::Max( totalJobsActive, 1u ) );
+        const bool background = ( cs->m_Priority.Load() == Protocol::PRIORITY_BACKGROUND );
+        outStatus.AppendFormat( "%s%s %u%%%s (wait %.1fs)",
+                                outStatus.IsEmpty() ? "" : ", ",
+                                cs->m_HostName.IsEmpty() ? "?" : cs->m_HostName.Get(),
+                                share,
+                                background ? " [background]" : "",
+                                (double)cs->m_AvgWaitTime );
+    }
+}
+
 // OnConnected
 //------------------------------------------------------------------------------
 /*virtual*/ void Server::OnConnected( const ConnectionInfo * connection )
@@ -145,6 +245,33 @@ bool Server::IsSynchingTool( AString & statusStr ) const
         const bool found = m_ClientList.FindAndErase( cs );
         ASSERT( found ); (void)found;
 
+        // Discard any large results waiting to be streamed to this client,
+        // and stop any being streamed (the current send is cancelled by
+        // closing the connection)
+        for ( ;; )
+        {
+            {
+                MutexHolder streamMH( m_StreamMutex );
+                for ( size_t i = 0; i < m_StreamedJobs.GetSize(); )
+                {
+                    if ( m_StreamedJobs[ i ].m_Client == cs )
+                    {
+                        FDELETE m_StreamedJobs[ i ].m_Job;
+                        m_StreamedJobs.Erase( &m_StreamedJobs[ i ] );
+                        continue;
+                    }
+                    ++i;
+                }
+                if ( m_StreamingClient != cs )
+                {
+                    break;
+                }
+                m_StreamCancelled.Store( true );
+            }
+            Disconnect( connection );
+            Thread::Sleep( 1 );
+        }
+
         // because we cancelled manifest synchronization, we need to check if other
         // connections are waiting for the same manifest
         for ( ClientState * otherCS : m_ClientList )
@@ -162,7 +289,7 @@ bool Server::IsSynchingTool( AString & statusStr ) const
 
         // This is usually null here, but might need to be freed if
         // we had the connection drop between message and payload
-        FREE( (void *)( cs->m_CurrentMessage ) );
+        FreeBuffer( (void *)( cs->m_CurrentMessage ) );
 
         // delete any jobs where we were waiting on Tool synchronization
         for ( Job * job : cs->m_WaitingJobs )
@@ -170,6 +297,13 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             delete job;
         }
 
+        // and any waiting for headers
+        for ( HeaderWait * wait : cs->m_WaitingForHeaders )
+        {
+            delete wait->m_Job;
+            FDELETE wait;
+        }
+
         FDELETE cs;
     }
 }
@@ -248,6 +382,18 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_HEADERS:
+        {
+            const Protocol::MsgHeaders * msg = static_cast< const Protocol::MsgHeaders * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_DICTIONARY:
+        {
+            const Protocol::MsgDictionary * msg = static_cast< const Protocol::MsgDictionary * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -258,8 +404,8 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     }
 
     // free everything
-    FREE( (void *)( cs->m_CurrentMessage ) );
-    FREE( payload );
+    FreeBuffer( (void *)( cs->m_CurrentMessage ) );
+    FreeBuffer( payload );
     cs->m_CurrentMessage = nullptr;
 }
 
@@ -292,7 +438,15 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgConn
     MutexHolder mh( cs->m_Mutex );
     cs->m_NumJobsAvailable.Store( msg->GetNumJobsAvailable() );
     cs->m_ProtocolVersionMinor = msg->GetProtocolVersionMinor();
+    cs->m_Priority.Store( msg->GetPriority() );
     cs->m_HostName = msg->GetHostName();
+
+    // Let clients which understand it know which features are supported
+    if ( cs->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_HEADER_BUNDLES )
+    {
+        const Protocol::MsgServerInfo infoMsg;
+        infoMsg.Send( connection );
+    }
 }
 
 // Process( MsgStatus )
@@ -335,79 +489,165 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
         Job * job = FNEW( Job( ms ) );
         job->SetUserData( cs );
         job->SetResultCompressionLevel( msg->GetResultCompressionLevel() );
+        job->SetResultCompressionZstd( msg->IsResultCompressionZstd() );
+        job->SetIsHeaderBundle( msg->IsHeaderBundle() );
+        if ( cs->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_STREAMED_RESULTS )
+        {
+            job->SetStreamedResultThreshold( m_StreamedResultThreshold.Load() );
+        }
 
         // Get ToolId
         const uint64_t toolId = msg->GetToolId();
         ASSERT( toolId );
 
-
+        // Compress Zstd results with the toolchain's dictionary, if the client sent one
+        if ( msg->IsResultCompressionZstd() && ( msg->GetResultCompressionLevel() != 0 ) )
         {
-            // Find or create the manifest
-            MutexHolder manifestMH( m_ToolManifestsMutex );
-
-            ToolManifest ** found = m_Tools.FindDeref( toolId );
-            ToolManifest * manifest = found ? *found : nullptr;
-            if ( manifest )
+            for ( const ResultDictionary & rd : cs->m_ResultDictionaries )
             {
-                job->SetToolManifest( manifest );
-
-                // Is tool fully synchronized?
-                if ( manifest->IsSynchronized() )
+                if ( rd.m_ToolId == toolId )
                 {
-                    // we have all the files - we can do the job
-                    JobQueueRemote::Get().QueueJob( job );
-                    return;
+                    job->SetResultDictionaryId( rd.m_DictionaryId );
+                    break;
                 }
+            }
+        }
 
-                // If we have an associated connection, we're already synchronizing
-                // on that connection and don't need to do anything.
-                // That may be a connection to another client or to the same client
-                const bool isSynchronizing = ( manifest->GetUserData() != nullptr );
-                if ( isSynchronizing )
-                {
-                    // We just need to wait for syncrhonization to complete
-                }
-                else
-                {
-                    // Take ownership of toolchain
-                    manifest->SetUserData( (void *)connection );
+        // Header bundles can't start until all their headers are available
+        if ( job->IsHeaderBundle() && RequestMissingHeaders( connection, cs, job, toolId ) )
+        {
+            return;
+        }
 
-                    const bool hasManifest = ( manifest->GetFiles().IsEmpty() == false );
-                    if ( hasManifest )
-                    {
-                        // Missing some files - request any not already being sync'd
-                        RequestMissingFiles( connection, manifest );
-                    }
-                    else
-                    {
-                        // Manifest was not sync'd. This can happen if disconnection
-                        // occurs before the manifest was received.
+        QueueJobOrWaitForToolchain( connection, cs, job, toolId );
+    }
+}
 
-                        // request manifest
-                        const Protocol::MsgRequestManifest reqMsg( toolId );
-                        reqMsg.Send( connection );
-                    }
-                }
+// RequestMissingHeaders
+//------------------------------------------------------------------------------
+bool Server::RequestMissingHeaders( const ConnectionInfo * connection, ClientState * cs, Job * job, uint64_t toolId )
+{
+    HeaderBundle bundle;
+    if ( bundle.Load( *job ) == false )
+    {
+        return false; // Job will fail when started
+    }
+
+    // Find headers not yet stored, and which of those we need to ask for
+    const HeaderFileStore & store = m_JobQueueRemote->GetHeaderFileStore();
+    const Array< AString > & headerFiles = bundle.GetHeaderFiles();
+    const Array< uint64_t > & headerHashes = bundle.GetHeaderHashes();
+    Array< uint64_t > missingHeaders( 0, true );
+    Array< AString > requestFiles( 0, true );
+    Array< uint64_t > requestHashes( 0, true );
+    for ( size_t i = 0; i < headerHashes.GetSize(); ++i )
+    {
+        const uint64_t hash = headerHashes[ i ];
+        if ( store.Has( hash ) || missingHeaders.Find( hash ) )
+        {
+            continue;
+        }
+        missingHeaders.Append( hash );
+
+        // Another job may already be waiting for it
+        if ( cs->m_RequestedHeaders.Find( hash ) == nullptr )
+        {
+            cs->m_RequestedHeaders.Append( hash );
+            requestFiles.Append( headerFiles[ i ] );
+            requestHashes.Append( hash );
+        }
+    }
+    if ( missingHeaders.IsEmpty() )
+    {
+        return false;
+    }
+
+    // Wait until missing headers arrive
+    HeaderWait * wait = FNEW( HeaderWait );
+    wait->m_Job = job;
+    wait->m_ToolId = toolId;
+    wait->m_MissingHeaders.Swap( missingHeaders );
+    cs->m_WaitingForHeaders.Append( wait );
+
+    if ( requestFiles.IsEmpty() == false )
+    {
+        MemoryStream ms;
+        ms.Write( requestFiles );
+        ms.Write( requestHashes );
+        const Protocol::MsgRequestHeaders reqMsg;
+        reqMsg.Send( connection, ms );
+    }
+    return true;
+}
+
+// QueueJobOrWaitForToolchain
+//------------------------------------------------------------------------------
+void Server::QueueJobOrWaitForToolchain( const ConnectionInfo * connection, ClientState * cs, Job * job, uint64_t toolId )
+{
+    // Find or create the manifest
+    MutexHolder manifestMH( m_ToolManifestsMutex );
+
+    ToolManifest ** found = m_Tools.FindDeref( toolId );
+    ToolManifest * manifest = found ? *found : nullptr;
+    if ( manifest )
+    {
+        job->SetToolManifest( manifest );
+
+        // Is tool fully synchronized?
+        if ( manifest->IsSynchronized() )
+        {
+            // we have all the files - we can do the job
+            JobQueueRemote::Get().QueueJob( job );
+            return;
+        }
+
+        // If we have an associated connection, we're already synchronizing
+        // on that connection and don't need to do anything.
+        // That may be a connection to another client or to the same client
+        const bool isSynchronizing = ( manifest->GetUserData() != nullptr );
+        if ( isSynchronizing )
+        {
+            // We just need to wait for syncrhonization to complete
+        }
+        else
+        {
+            // Take ownership of toolchain
+            manifest->SetUserData( (void *)connection );
+
+            const bool hasManifest = ( manifest->GetFiles().IsEmpty() == false );
+            if ( hasManifest )
+            {
+                // Missing some files - request any not already being sync'd
+                RequestMissingFiles( connection, manifest );
             }
             else
             {
-                // first time seeing this tool
-
-                // create manifest object
-                manifest = FNEW( ToolManifest( toolId ) );
-                manifest->SetUserData( (void *)connection ); // This connection owns synchronization
-                job->SetToolManifest( manifest );
-                m_Tools.Append( manifest );
+                // Manifest was not sync'd. This can happen if disconnection
+                // occurs before the manifest was received.
 
-                // request manifest of tool chain
+                // request manifest
                 const Protocol::MsgRequestManifest reqMsg( toolId );
                 reqMsg.Send( connection );
             }
-
-            // can't start job yet - put it on hold
-            cs->m_WaitingJobs.Append( job );
         }
     }
+    else
+    {
+        // first time seeing this tool
+
+        // create manifest object
+        manifest = FNEW( ToolManifest( toolId ) );
+        manifest->SetUserData( (void *)connection ); // This connection owns synchronization
+        job->SetToolManifest( manifest );
+        m_Tools.Append( manifest );
+
+        // request manifest of tool chain
+        const Protocol::MsgRequestManifest reqMsg( toolId );
+        reqMsg.Send( connection );
+    }
+
+    // can't start job yet - put it on hold
+    cs->m_WaitingJobs.Append( job );
 }
 
 // Process( MsgManifest )
@@ -425,7 +665,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
         ToolManifest ** found = m_Tools.FindDeref( toolId );
         ASSERT( found );
         manifest = *found;
-        if ( manifest->DeserializeFromRemote( ms ) == false )
+        if ( manifest->DeserializeFromRemote( ms, m_ToolFileStore ) == false )
         {
             // NOTE: In clients prior to v1.07 a bug could cause MsgManifest messages to be
             //       corrupt and for deserialization to corrupt internal state.
@@ -484,7 +724,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
         ASSERT( manifest->GetUserData() == connection ); (void)connection;
 
         bool corruptData = false;
-        if ( manifest->ReceiveFileData( fileId, payload, payloadSize, corruptData ) == false )
+        if ( manifest->ReceiveFileData( fileId, payload, payloadSize, corruptData, m_ToolFileStore ) == false )
         {
             if ( corruptData )
             {
@@ -534,6 +774,104 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
     CheckWaitingJobs( manifest );
 }
 
+// Process( MsgHeaders )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgHeaders *, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgHeaders" );
+
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    ASSERT( cs );
+
+    // Store the headers. Headers which were unavailable (or failed to store) will
+    // cause the jobs which need them to fail.
+    ConstMemoryStream ms( payload, payloadSize );
+    uint32_t numHeaders = 0;
+    if ( ms.Read( numHeaders ) == false )
+    {
+        ASSERT( false ); // this indicates a protocol bug
+        Disconnect( connection );
+        return;
+    }
+    Array< uint64_t > receivedHeaders( numHeaders, false );
+    HeaderFileStore & store = m_JobQueueRemote->GetHeaderFileStore();
+    for ( uint32_t i = 0; i < numHeaders; ++i )
+    {
+        uint64_t hash;
+        bool available;
+        if ( ( ms.Read( hash ) == false ) || ( ms.Read( available ) == false ) )
+        {
+            ASSERT( false ); // this indicates a protocol bug
+            Disconnect( connection );
+            return;
+        }
+        if ( available )
+        {
+            AString contents;
+            if ( ms.Read( contents ) == false )
+            {
+                ASSERT( false ); // this indicates a protocol bug
+                Disconnect( connection );
+                return;
+            }
+            store.Store( hash, contents.Get(), contents.GetLength() );
+        }
+        receivedHeaders.Append( hash );
+    }
+
+    // Start any jobs which are no longer waiting
+    MutexHolder mh( cs->m_Mutex );
+    for ( const uint64_t hash : receivedHeaders )
+    {
+        cs->m_RequestedHeaders.FindAndErase( hash );
+    }
+    const int32_t numWaiting = (int32_t)cs->m_WaitingForHeaders.GetSize();
+    for ( int32_t i = ( numWaiting - 1 ); i >= 0; --i )
+    {
+        HeaderWait * wait = cs->m_WaitingForHeaders[ (size_t)i ];
+        for ( const uint64_t hash : receivedHeaders )
+        {
+            wait->m_MissingHeaders.FindAndErase( hash );
+        }
+        if ( wait->m_MissingHeaders.IsEmpty() )
+        {
+            cs->m_WaitingForHeaders.EraseIndex( (size_t)i );
+            QueueJobOrWaitForToolchain( connection, cs, wait->m_Job, wait->m_ToolId );
+            FDELETE wait;
+        }
+    }
+}
+
+// Process( MsgDictionary )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgDictionary * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgDictionary" );
+
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    ASSERT( cs );
+
+    // If the dictionary can't be used, results are compressed without one
+    // (which the client handles as before)
+    const uint64_t toolId = msg->GetToolId();
+    const uint32_t dictionaryId = msg->GetDictionaryId();
+    const bool added = m_JobQueueRemote->AddResultDictionary( dictionaryId, payload, payloadSize );
+
+    MutexHolder mh( cs->m_Mutex );
+    for ( ResultDictionary & rd : cs->m_ResultDictionaries )
+    {
+        if ( rd.m_ToolId == toolId )
+        {
+            cs->m_ResultDictionaries.Erase( &rd );
+            break;
+        }
+    }
+    if ( added )
+    {
+        cs->m_ResultDictionaries.Append( ResultDictionary{ toolId, dictionaryId } );
+    }
+}
+
 // CheckWaitingJobs
 //------------------------------------------------------------------------------
 void Server::CheckWaitingJobs( const ToolManifest * manifest )
@@ -595,6 +933,8 @@ void Server::ThreadFunc()
     {
         FinalizeCompletedJobs();
 
+        UpdateCapacity();
+
         FindNeedyClients();
 
         TouchToolchains();
@@ -603,6 +943,143 @@ void Server::ThreadFunc()
     }
 }
 
+// StreamThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Server::StreamThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "ServerStreamThread" );
+
+    Server * s = (Server *)param;
+    s->StreamThreadFunc();
+    return 0;
+}
+
+// StreamThreadFunc
+//------------------------------------------------------------------------------
+void Server::StreamThreadFunc()
+{
+    for ( ;; )
+    {
+        m_StreamSemaphore.Wait();
+        if ( m_ShouldExit.Load() )
+        {
+            break;
+        }
+
+        StreamedJob streamedJob = { nullptr, nullptr };
+        {
+            MutexHolder mh( m_StreamMutex );
+            if ( m_StreamedJobs.IsEmpty() )
+            {
+                continue; // discarded when the client disconnected
+            }
+            streamedJob = m_StreamedJobs[ 0 ];
+            m_StreamedJobs.PopFront();
+            m_StreamingClient = streamedJob.m_Client;
+            m_StreamCancelled.Store( false );
+        }
+
+        SendStreamedJobResult( streamedJob.m_Client, streamedJob.m_Job );
+
+        {
+            MutexHolder mh( m_StreamMutex );
+            m_StreamingClient = nullptr;
+        }
+        FDELETE streamedJob.m_Job;
+    }
+}
+
+// UpdateCapacity
+//------------------------------------------------------------------------------
+void Server::UpdateCapacity()
+{
+    const uint32_t numSlots = WorkerThreadRemote::GetNumCPUsToUse();
+    if ( numSlots == m_NumSlots )
+    {
+        return;
+    }
+    const bool shrinking = ( numSlots < m_NumSlots );
+    m_NumSlots = numSlots;
+
+    PROFILE_FUNCTION;
+
+    // When shrinking, jobs in progress are finished, but queued jobs beyond
+    // what the remaining slots need are returned so clients can build them
+    // elsewhere
+    StackArray< Job * > returnedJobs;
+    if ( shrinking )
+    {
+        m_JobQueueRemote->TakeExcessQueuedJobs( GetMaxJobs( numSlots ), CanReturnJob, returnedJobs );
+    }
+
+    // Let clients know, so they can rebalance
+    {
+        MutexHolder mh( m_ClientListMutex );
+
+        for ( ClientState * cs : m_ClientList )
+        {
+            if ( cs->m_ProtocolVersionMinor < Protocol::PROTOCOL_VERSION_MINOR_CAPACITY )
+            {
+                continue;
+            }
+
+            StackArray< uint32_t > jobIds;
+            for ( const Job * job : returnedJobs )
+            {
+                if ( job->GetUserData() == cs )
+                {
+                    jobIds.Append( job->GetJobId() );
+                }
+            }
+            const uint32_t numReturnedJobs = (uint32_t)jobIds.GetSize();
+            MemoryStream ms;
+            ms.Write( numReturnedJobs );
+            for ( const uint32_t jobId : jobIds )
+            {
+                ms.Write( jobId );
+            }
+
+            ASSERT( cs->m_NumJobsActive.Load() >= numReturnedJobs );
+            cs->m_NumJobsActive.Sub( numReturnedJobs );
+
+            MutexHolder mh2( cs->m_Mutex );
+            const Protocol::MsgCapacity msg( numSlots );
+            msg.Send( cs->m_Connection, ms );
+        }
+    }
+
+    m_NumJobsReturned.Add( (uint32_t)returnedJobs.GetSize() );
+    for ( Job * job : returnedJobs )
+    {
+        FDELETE job;
+    }
+}
+
+// GetMaxJobs
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Server::GetMaxJobs( uint32_t numSlots )
+{
+    if ( numSlots == 0 )
+    {
+        return 0;
+    }
+
+    // Over request to overlap building with network transfers. Jobs beyond the
+    // number of CPUs wait in the queue so a thread can start on the next job as
+    // soon as it finishes the current one.
+    return ( numSlots + Math::Max( 1u, ( numSlots / 4 ) ) );
+}
+
+// CanReturnJob
+//------------------------------------------------------------------------------
+/*static*/ bool Server::CanReturnJob( const Job * job )
+{
+    // Only clients which understand MsgCapacity can take jobs back
+    // (Called with the job still queued, so the client state remains valid)
+    const ClientState * cs = static_cast< const ClientState * >( job->GetUserData() );
+    return ( cs && ( cs->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_CAPACITY ) );
+}
+
 // FindNeedyClients
 //------------------------------------------------------------------------------
 void Server::FindNeedyClients()
@@ -615,165 +1092,452 @@ void Server::FindNeedyClients()
     PROFILE_FUNCTION;
 
     // determine job availability
-    int32_t availableJobs = (int32_t)WorkerThreadRemote::GetNumCPUsToUse();
+    int32_t availableJobs = (int32_t)GetMaxJobs( WorkerThreadRemote::GetNumCPUsToUse() );
     if ( availableJobs == 0 )
     {
         return;
     }
-    ++availableJobs; // over request to parallelize building/network transfers
-
 
     {
         MutexHolder mh( m_ClientListMutex );
 
-        // determine if all available job slots are in use
-        for ( const ClientState * cs : m_ClientList )
+        const size_t numClients = m_ClientList.GetSize();
+        for ( ClientState * cs : m_ClientList )
         {
             // any jobs requested or in progress reduce the available count
             const uint32_t jobsRequested = cs->m_NumJobsRequested.Load();
             const uint32_t jobsActive = cs->m_NumJobsActive.Load();
             const int32_t reservedJobs = static_cast<int32_t>( jobsRequested + jobsActive );
             availableJobs -= reservedJobs;
-            if ( availableJobs <= 0 )
+
+            // Note when clients start wanting job slots
+            const bool wantsJobs = ( jobsRequested < cs->m_NumJobsAvailable.Load() );
+            if ( wantsJobs && ( cs->m_Waiting == false ) )
             {
-                return;
+                cs->m_Waiting = true;
+                cs->m_WaitTimer.Start();
+
+                // A client can't save up its share while it has nothing to do
+                cs->m_VirtualTime = Math::Max( cs->m_VirtualTime, m_VirtualTime );
+            }
+            else if ( wantsJobs == false )
+            {
+                cs->m_Waiting = false;
             }
         }
 
-        // we have some jobs available
-
-        // sort clients to find neediest first
-        m_ClientList.SortDeref();
+        // determine if all available job slots are in use
+        if ( availableJobs <= 0 )
+        {
+            return;
+        }
 
-        const Protocol::MsgRequestJob msg;
+        // we have some jobs available
 
+        // Grant each job slot to the client which has received the least worker
+        // time (adjusted for priority) so far. This is weighted fair queuing
+        // using the expected job time of each client, so clients with short jobs
+        // are granted slots more often and see lower latency.
+        StackArray< uint32_t > jobsToRequest;
+        jobsToRequest.SetSize( numClients );
+        for ( uint32_t & numJobs : jobsToRequest )
+        {
+            numJobs = 0;
+        }
         while ( availableJobs > 0 )
         {
-            bool anyJobsRequested = false;
-
-            for ( ClientState * cs : m_ClientList )
+            size_t next = numClients;
+            for ( size_t i = 0; i < numClients; ++i )
             {
-                const uint32_t reservedJobs = cs->m_NumJobsRequested.Load();
-
+                const ClientState * cs = m_ClientList[ i ];
+                const uint32_t reservedJobs = ( cs->m_NumJobsRequested.Load() + jobsToRequest[ i ] );
                 if ( reservedJobs >= cs->m_NumJobsAvailable.Load() )
                 {
-                    continue; // we've maxed out the requests to this worker
+                    continue; // we've maxed out the requests to this client
                 }
-
-                // request job from this client
+                if ( ( next == numClients ) || ( cs->m_VirtualTime < m_ClientList[ next ]->m_VirtualTime ) )
                 {
-                    // Acquire the lock but don't wait if unavailable
-                    TryMutexHolder tryLock( cs->m_Mutex );
-                    if ( tryLock.IsLocked() == false )
-                    {
-                        continue; // Skip this worker for now
-                    }
-                    cs->m_NumJobsRequested.Increment(); // Must be before Send() to ensure consistent counts
-                    msg.Send( cs->m_Connection );
-                }
-                availableJobs--;
-                anyJobsRequested = true;
-
-                // Have we consumed all of our requests?
-                if ( availableJobs == 0 )
-                {
-                    break;
+                    next = i;
                 }
             }
 
-            // if we did a pass and couldn't request any more jobs, then bail out
-            if ( anyJobsRequested == false )
+            // if no client wants any more jobs, then bail out
+            if ( next == numClients )
             {
                 break;
             }
+
+            ClientState * cs = m_ClientList[ next ];
+            m_VirtualTime = cs->m_VirtualTime;
+            cs->m_VirtualTime += GetJobSlotCost( *cs );
+            jobsToRequest[ next ]++;
+            availableJobs--;
+        }
+
+        // request jobs from clients
+        for ( size_t i = 0; i < numClients; ++i )
+        {
+            const uint32_t numJobs = jobsToRequest[ i ];
+            if ( numJobs == 0 )
+            {
+                continue;
+            }
+
+            ClientState * cs = m_ClientList[ i ];
+
+            // Acquire the lock but don't wait if unavailable
+            TryMutexHolder tryLock( cs->m_Mutex );
+            if ( tryLock.IsLocked() == false )
+            {
+                cs->m_VirtualTime -= ( numJobs * GetJobSlotCost( *cs ) ); // Not granted after all
+                continue; // Skip this worker for now
+            }
+            cs->m_NumJobsRequested.Add( numJobs ); // Must be before Send() to ensure consistent counts
+
+            // Record how long the client waited for a job slot
+            if ( cs->m_Waiting )
+            {
+                const float waitTime = cs->m_WaitTimer.GetElapsed();
+                cs->m_AvgWaitTime += ( waitTime - cs->m_AvgWaitTime ) * SERVER_AVG_SMOOTHING;
+                cs->m_Waiting = false;
+            }
+
+            // Older clients must be asked for jobs one at a time
+            if ( cs->m_ProtocolVersionMinor >= Protocol::PROTOCOL_VERSION_MINOR_JOB_BATCHING )
+            {
+                const Protocol::MsgRequestJobs msg( numJobs );
+                msg.Send( cs->m_Connection );
+            }
+            else
+            {
+                const Protocol::MsgRequestJob msg;
+                for ( uint32_t j = 0; j < numJobs; ++j )
+                {
+                    msg.Send( cs->m_Connection );
+                }
+            }
         }
     }
 }
 
+// GetJobSlotCost
+//------------------------------------------------------------------------------
+/*static*/ double Server::GetJobSlotCost( const ClientState & cs )
+{
+    const float jobTimeMS = ( cs.m_AvgJobTimeMS > 0.0f ) ? cs.m_AvgJobTimeMS : SERVER_DEFAULT_JOB_TIME_MS;
+    const double weight = ( cs.m_Priority.Load() == Protocol::PRIORITY_BACKGROUND ) ? SERVER_WEIGHT_BACKGROUND
+                                                                                   : SERVER_WEIGHT_INTERACTIVE;
+    return (double)Math::Max( jobTimeMS, SERVER_MIN_JOB_TIME_MS ) / weight;
+}
+
 // FinalizeCompletedJobs
 //------------------------------------------------------------------------------
 void Server::FinalizeCompletedJobs()
 {
     PROFILE_FUNCTION;
 
+    // Gather all completed jobs so results for the same client can be sent together
     JobQueueRemote & jcr = JobQueueRemote::Get();
+    StackArray< Job * > completedJobs;
     while ( Job * job = jcr.GetCompletedJob() )
     {
-        // get associated connection
-        ClientState * cs = (ClientState *)job->GetUserData();
+        completedJobs.Append( job );
+    }
+    if ( completedJobs.IsEmpty() )
+    {
+        return;
+    }
+
+    StackArray< Job * > streamedJobs; // now owned by the stream thread
+    {
+        MutexHolder mh( m_ClientListMutex );
 
+        StackArray< Job * > clientJobs;
+        for ( size_t i = 0; i < completedJobs.GetSize(); ++i )
         {
-            MutexHolder mh( m_ClientListMutex );
+            // get associated connection
+            ClientState * cs = (ClientState *)completedJobs[ i ]->GetUserData();
+            if ( cs == nullptr )
+            {
+                continue; // already handled with an earlier job for the same client
+            }
+
+            // gather all the jobs for this client
+            clientJobs.Clear();
+            for ( size_t j = i; j < completedJobs.GetSize(); ++j )
+            {
+                if ( completedJobs[ j ]->GetUserData() == cs )
+                {
+                    clientJobs.Append( completedJobs[ j ] );
+                    completedJobs[ j ]->SetUserData( nullptr );
+                }
+            }
 
             const bool connectionStillActive = ( m_ClientList.Find( cs ) != nullptr );
-            if ( connectionStillActive )
+            if ( connectionStillActive == false )
             {
-                const Node::State result = job->GetNode()->GetState();
-                ASSERT( ( result == Node::UP_TO_DATE ) || ( result == Node::FAILED ) );
+                // we might get here without finding the connection
+                // (if the connection was lost before we completed)
+                continue;
+            }
 
-                MemoryStream ms;
-                ms.Write( job->GetJobId() );
-                ms.Write( job->GetNode()->GetName() );
-                ms.Write( result == Node::UP_TO_DATE );
-                ms.Write( job->GetSystemErrorCount() > 0 );
-                ms.Write( job->GetMessages() );
-                ms.Write( job->GetNode()->GetLastBuildTime() );
-                ms.Write( job->GetRemoteThreadIndex() ); // The thread used to build the job to assist with visualization
+            ASSERT( cs->m_NumJobsActive.Load() >= clientJobs.GetSize() );
+            cs->m_NumJobsActive.Sub( (uint32_t)clientJobs.GetSize() );
 
-                // write the data - build result for success, or output+errors for failure
-                ms.Write( (uint32_t)job->GetDataSize() );
-                ms.WriteBuffer( job->GetData(), job->GetDataSize() );
+            // Track typical job time, to share the worker fairly
+            for ( const Job * job : clientJobs )
+            {
+                const float jobTimeMS = (float)job->GetNode()->GetLastBuildTime();
+                cs->m_AvgJobTimeMS = ( cs->m_AvgJobTimeMS > 0.0f ) ? ( cs->m_AvgJobTimeMS + ( jobTimeMS - cs->m_AvgJobTimeMS ) * SERVER_AVG_SMOOTHING )
+                                                                   : jobTimeMS;
+            }
 
+            // Large results are streamed on another thread, so reading and
+            // compressing them doesn't hold up other clients (or other results
+            // for this client)
+            for ( size_t j = 0; j < clientJobs.GetSize(); )
+            {
+                Job * job = clientJobs[ j ];
+                if ( job->HasStreamedResult() )
                 {
-                    ASSERT( cs->m_NumJobsActive.Load() > 0 );
-                    cs->m_NumJobsActive.Decrement();
-
-                    MutexHolder mh2( cs->m_Mutex );
-
-                    if ( job->GetResultCompressionLevel() == 0 )
-                    {
-                        // Uncompressed
-                        const Protocol::MsgJobResult msg;
-                        msg.Send( cs->m_Connection, ms );
-                    }
-                    else
                     {
-                        // Compressed
-                        const Protocol::MsgJobResultCompressed msg;
-                        msg.Send( cs->m_Connection, ms );
+                        MutexHolder streamMH( m_StreamMutex );
+                        m_StreamedJobs.Append( StreamedJob{ job, cs } );
                     }
+                    m_StreamSemaphore.Signal();
+                    streamedJobs.Append( job );
+                    clientJobs.Erase( &clientJobs[ j ] );
+                    continue;
+                }
+                ++j;
+            }
+
+            MutexHolder mh2( cs->m_Mutex );
+
+            // Older clients must be sent results one at a time
+            if ( ( clientJobs.GetSize() == 1 ) ||
+                 ( cs->m_ProtocolVersionMinor < Protocol::PROTOCOL_VERSION_MINOR_JOB_BATCHING ) )
+            {
+                for ( const Job * job : clientJobs )
+                {
+                    SendJobResult( cs, job );
                 }
             }
             else
             {
-                // we might get here without finding the connection
-                // (if the connection was lost before we completed)
+                for ( size_t j = 0; j < clientJobs.GetSize(); j += Protocol::MsgJobResults::kMaxResults )
+                {
+                    const size_t numResults = Math::Min( (size_t)Protocol::MsgJobResults::kMaxResults, ( clientJobs.GetSize() - j ) );
+                    SendJobResults( cs, &clientJobs[ j ], numResults );
+                }
             }
         }
+    }
 
-        FDELETE job;
+    for ( Job * job : completedJobs )
+    {
+        if ( streamedJobs.Find( job ) == nullptr )
+        {
+            FDELETE job;
+        }
     }
 }
 
-// TouchToolchains
+// SerializeJobResult
 //------------------------------------------------------------------------------
-void Server::TouchToolchains()
+/*static*/ void Server::SerializeJobResult( const Job * job, MemoryStream & ms )
 {
-    #if defined( __OSX__ ) || defined( __LINUX__)
-        if ( m_TouchToolchainTimer.GetElapsed() < SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS )
+    const Node::State result = job->GetNode()->GetState();
+    ASSERT( ( result == Node::UP_TO_DATE ) || ( result == Node::FAILED ) );
+
+    ms.Write( job->GetJobId() );
+    ms.Write( job->GetNode()->GetName() );
+    ms.Write( ( result == Node::UP_TO_DATE ) && ( job->GetSystemErrorCount() == 0 ) ); // (see SendStreamedJobResult)
+    ms.Write( job->GetSystemErrorCount() > 0 );
+    ms.Write( job->GetMessages() );
+    ms.Write( job->GetNode()->GetLastBuildTime() );
+    ms.Write( job->GetRemoteThreadIndex() ); // The thread used to build the job to assist with visualization
+
+    // write the data - build result for success, or output+errors for failure
+    // (the data itself is sent directly from the job, avoiding a copy)
+    ms.Write( (uint32_t)job->GetDataSize() );
+}
+
+// SendJobResult
+//------------------------------------------------------------------------------
+/*static*/ void Server::SendJobResult( const ClientState * cs, const Job * job )
+{
+    MemoryStream ms;
+    SerializeJobResult( job, ms );
+
+    if ( job->GetResultCompressionLevel() == 0 )
+    {
+        // Uncompressed
+        const Protocol::MsgJobResult msg;
+        msg.Send( cs->m_Connection, ms, job->GetData(), job->GetDataSize() );
+    }
+    else
+    {
+        // Compressed
+        const Protocol::MsgJobResultCompressed msg;
+        msg.Send( cs->m_Connection, ms, job->GetData(), job->GetDataSize() );
+    }
+}
+
+// SendJobResults
+//------------------------------------------------------------------------------
+/*static*/ void Server::SendJobResults( const ClientState * cs, Job * const * jobs, size_t numJobs )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( numJobs <= Protocol::MsgJobResults::kMaxResults );
+
+    // Headers for all results are written to one stream, with the data for
+    // each result sent directly from the job
+    MemoryStream ms;
+    ms.Write( (uint32_t)numJobs );
+    uint32_t headerEnds[ Protocol::MsgJobResults::kMaxResults ];
+    MemoryStream header;
+    for ( size_t i = 0; i < numJobs; ++i )
+    {
+        const Job * job = jobs[ i ];
+        header.Reset();
+        SerializeJobResult( job, header );
+
+        ms.Write( job->GetResultCompressionLevel() != 0 );
+        ms.Write( (uint32_t)( header.GetSize() + job->GetDataSize() ) );
+        ms.WriteBuffer( header.GetData(), header.GetSize() );
+        headerEnds[ i ] = (uint32_t)ms.GetSize();
+    }
+
+    TCPConnectionPool::SendBuffer buffers[ Protocol::MsgJobResults::kMaxResults * 2 ];
+    uint32_t headerStart = 0;
+    for ( size_t i = 0; i < numJobs; ++i )
+    {
+        buffers[ i * 2 ].size = ( headerEnds[ i ] - headerStart );
+        buffers[ i * 2 ].data = ( (const char *)ms.GetData() + headerStart );
+        buffers[ i * 2 + 1 ].size = (uint32_t)jobs[ i ]->GetDataSize();
+        buffers[ i * 2 + 1 ].data = jobs[ i ]->GetData();
+        headerStart = headerEnds[ i ];
+    }
+
+    const Protocol::MsgJobResults msg;
+    msg.Send( cs->m_Connection, buffers, (uint32_t)( numJobs * 2 ) );
+}
+
+// SendStreamedJobResult
+//------------------------------------------------------------------------------
+void Server::SendStreamedJobResult( ClientState * cs, Job * job )
+{
+    PROFILE_FUNCTION;
+
+    // Each output file is read and sent in chunks, compressed individually so
+    // the client can decompress each to disk as it arrives. Only one chunk is
+    // held in memory at a time. Chunks are read, compressed and sent in turn
+    // (the next chunk is not prepared until the send of this one returns).
+    // The client is only locked while each chunk is sent, so other messages
+    // to it are only held up by one chunk at a time.
+    const int16_t compressionLevel = job->GetResultCompressionLevel();
+    const bool compress = ( compressionLevel != 0 );
+    UniquePtr< char > buffer( (char *)ALLOC( Protocol::MsgJobResultChunk::kChunkSize ) );
+
+    const Array< AString > & files = job->GetStreamedResultFiles();
+    for ( size_t i = 0; i < files.GetSize(); ++i )
+    {
+        FileStream f;
+        if ( f.Open( files[ i ].Get() ) == false )
         {
-            return;
+            job->Error( "Error reading file: '%s'", files[ i ].Get() );
+            job->OnSystemError();
+            break;
         }
-        m_TouchToolchainTimer.Start();
 
-        MutexHolder manifestMH( m_ToolManifestsMutex );
-        for ( const ToolManifest * toolManifest : m_Tools )
+        // Always at least one chunk, so empty files are created too
+        uint64_t remaining = f.GetFileSize();
+        bool readOk = true;
+        do
+        {
+            const uint32_t chunkSize = (uint32_t)Math::Min< uint64_t >( remaining, Protocol::MsgJobResultChunk::kChunkSize );
+            if ( f.ReadBuffer( buffer.Get(), chunkSize ) != chunkSize )
+            {
+                readOk = false;
+                break;
+            }
+            remaining -= chunkSize;
+
+            Compressor c;
+            if ( compress )
+            {
+                if ( job->IsResultCompressionZstd() )
+                {
+                    c.CompressZstd( buffer.Get(), chunkSize, compressionLevel );
+                }
+                else
+                {
+                    c.Compress( buffer.Get(), chunkSize, compressionLevel );
+                }
+            }
+
+            if ( m_ShouldExit.Load() || m_StreamCancelled.Load() )
+            {
+                return; // Client disconnected or server shutting down
+            }
+            const Protocol::MsgJobResultChunk msg( job->GetJobId(), (uint8_t)i, compress );
+            const ConstMemoryStream chunk( compress ? c.GetResult() : buffer.Get(),
+                                           compress ? c.GetResultSize() : chunkSize );
+            MutexHolder mh( cs->m_Mutex );
+            if ( msg.Send( cs->m_Connection, chunk ) == false )
+            {
+                return; // Connection lost
+            }
+        } while ( remaining > 0 );
+
+        if ( readOk == false )
         {
-            toolManifest->TouchFiles();
+            job->Error( "Error reading file: '%s'", files[ i ].Get() );
+            job->OnSystemError();
+            break;
+        }
+    }
+
+    // The result follows the chunks, without any data of its own. If the
+    // stream was incomplete it's reported as a system error, so the client
+    // discards what it received and retries elsewhere.
+    if ( m_StreamCancelled.Load() == false )
+    {
+        MutexHolder mh( cs->m_Mutex );
+        SendJobResult( cs, job );
+    }
+}
+
+// TouchToolchains
+//------------------------------------------------------------------------------
+void Server::TouchToolchains()
+{
+    if ( m_TouchToolchainTimer.GetElapsed() < SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS )
+    {
+        return;
+    }
+    m_TouchToolchainTimer.Start();
+
+    #if defined( __OSX__ ) || defined( __LINUX__)
+        {
+            MutexHolder manifestMH( m_ToolManifestsMutex );
+            for ( const ToolManifest * toolManifest : m_Tools )
+            {
+                toolManifest->TouchFiles();
+            }
         }
     #else
         // TODO:C we could update Windows timestamps too
     #endif
+
+    // Remove stored files no toolchain has used for a while (files linked to
+    // toolchains in use were just touched)
+    m_ToolFileStore.Trim();
+
+    // And headers no job has used for a while
+    m_JobQueueRemote->GetHeaderFileStore().Trim();
 }
 
 // RequestMissingFiles
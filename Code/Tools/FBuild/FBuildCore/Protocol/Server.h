@@ -4,18 +4,24 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/ToolFileStore.h"
+
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
+#include "Core/Process/Semaphore.h"
 #include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
 class Job;
 class JobQueueRemote;
+class MemoryStream;
 namespace Protocol
 {
     class IMessage;
     class MsgConnection;
+    class MsgDictionary;
+    class MsgHeaders;
     class MsgJob;
     class MsgManifest;
     class MsgNoJobAvailable;
@@ -36,6 +42,33 @@ public:
 
     bool IsSynchingTool( AString & statusStr ) const;
 
+    // Jobs completed using the results of identical jobs
+    uint32_t GetNumResultsReused() const;
+
+    // Dictionaries received from clients to compress results with
+    size_t GetNumResultDictionaries() const;
+
+    // Queued jobs returned to clients when job slots were reduced
+    inline uint32_t GetNumJobsReturned() const { return m_NumJobsReturned.Load(); }
+
+    // Toolchain files received from clients
+    inline ToolFileStore & GetToolFileStore() { return m_ToolFileStore; }
+
+    // Share of the worker used by each connected client, and how long they wait for job slots
+    void GetClientStatus( AString & outStatus ) const;
+
+    // Jobs queued or in progress for all clients
+    uint32_t GetNumJobsActive() const;
+
+    // Jobs requested from clients (to run or queue) for a number of job slots
+    static uint32_t GetMaxJobs( uint32_t numSlots );
+
+    // Toolchains which are available without synchronization
+    void GetToolIds( Array< uint64_t > & outToolIds ) const;
+
+    // Results of at least this size are streamed to clients in chunks (0 = never)
+    inline void SetStreamedResultThreshold( uint32_t size ) { m_StreamedResultThreshold.Store( size ); }
+
 private:
     // TCPConnection interface
     virtual void OnConnected( const ConnectionInfo * connection ) override;
@@ -49,10 +82,16 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgFile * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgHeaders * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgDictionary * msg, const void * payload, size_t payloadSize );
 
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
+    static uint32_t StreamThreadFuncStatic( void * param );
+    void            StreamThreadFunc();
 
+    void            UpdateCapacity();
+    static bool     CanReturnJob( const Job * job );
     void            FindNeedyClients();
     void            FinalizeCompletedJobs();
     void            TouchToolchains();
@@ -60,15 +99,31 @@ private:
 
     void            RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const;
 
+    // A header bundle job waiting for headers before it can be started
+    struct HeaderWait
+    {
+        Job *               m_Job = nullptr;
+        uint64_t            m_ToolId = 0;
+        Array< uint64_t >   m_MissingHeaders;
+    };
+
+    // The dictionary a client asked for the results of a toolchain to be compressed with
+    struct ResultDictionary
+    {
+        uint64_t            m_ToolId;
+        uint32_t            m_DictionaryId;
+    };
+
     struct ClientState
     {
         explicit ClientState( const ConnectionInfo * ci )
             : m_Connection( ci )
             , m_WaitingJobs( 16, true )
+            , m_WaitingForHeaders( 0, true )
+            , m_RequestedHeaders( 0, true )
+            , m_ResultDictionaries( 0, true )
         {}
 
-        inline bool operator < ( const ClientState & other ) const { return ( m_NumJobsAvailable.Load() > other.m_NumJobsAvailable.Load() ); }
-
         Mutex                   m_Mutex;
 
         const Protocol::IMessage * m_CurrentMessage = nullptr;
@@ -78,26 +133,70 @@ private:
         Atomic<uint32_t>        m_NumJobsActive;
 
         uint8_t                 m_ProtocolVersionMinor = 0;
+        Atomic<uint8_t>         m_Priority;
         AString                 m_HostName;
 
+        // Fair share bookkeeping (protected by m_ClientListMutex)
+        double                  m_VirtualTime = 0.0;    // weighted worker time granted so far
+        float                   m_AvgJobTimeMS = 0.0f;  // 0 until a job has completed
+        float                   m_AvgWaitTime = 0.0f;   // seconds from wanting a job slot to being granted one
+        bool                    m_Waiting = false;
+        Timer                   m_WaitTimer;
+
         Array< Job * >          m_WaitingJobs; // jobs waiting for manifests/toolchains
+        Array< HeaderWait * >   m_WaitingForHeaders;
+        Array< uint64_t >       m_RequestedHeaders; // headers requested from this client, not yet received
+        Array< ResultDictionary > m_ResultDictionaries; // per toolchain, to compress Zstd results with
 
         Timer                   m_StatusTimer;
     };
 
+    // helpers to start jobs (must be called with ClientState::m_Mutex held)
+    bool            RequestMissingHeaders( const ConnectionInfo * connection, ClientState * cs, Job * job, uint64_t toolId );
+    void            QueueJobOrWaitForToolchain( const ConnectionInfo * connection, ClientState * cs, Job * job, uint64_t toolId );
+
+    // Weighted worker time used by a job slot granted to a client
+    static double   GetJobSlotCost( const ClientState & cs );
+
+    // helpers to return completed jobs (must be called with ClientState::m_Mutex held)
+    static void     SerializeJobResult( const Job * job, MemoryStream & ms );
+    static void     SendJobResult( const ClientState * cs, const Job * job );
+    static void     SendJobResults( const ClientState * cs, Job * const * jobs, size_t numJobs );
+
+    // A completed job with a large result, waiting to be streamed to its client
+    struct StreamedJob
+    {
+        Job *               m_Job;
+        ClientState *       m_Client;
+    };
+
+    // Streams a large result (called on the stream thread, takes ClientState::m_Mutex for each send)
+    void            SendStreamedJobResult( ClientState * cs, Job * job );
+
     JobQueueRemote *        m_JobQueueRemote;
 
     Atomic<bool>            m_ShouldExit;   // signal from main thread
     Thread                  m_Thread;       // the thread to manage workload
-    Mutex                   m_ClientListMutex;
+    mutable Mutex           m_ClientListMutex;
     Array< ClientState * >  m_ClientList;
+    double                  m_VirtualTime = 0.0;    // virtual time of the most recent job slot grant
+    uint32_t                m_NumSlots;             // job slots last advertised to clients
+    Atomic<uint32_t>        m_NumJobsReturned;
+    Atomic<uint32_t>        m_StreamedResultThreshold;
+
+    // Large results are read, compressed and sent on their own thread
+    Thread                  m_StreamThread;
+    Semaphore               m_StreamSemaphore;
+    Mutex                   m_StreamMutex;
+    Array< StreamedJob >    m_StreamedJobs;         // waiting to be streamed (protected by m_StreamMutex)
+    const ClientState *     m_StreamingClient = nullptr; // client being streamed to (protected by m_StreamMutex)
+    Atomic<bool>            m_StreamCancelled;      // m_StreamingClient has disconnected
 
     mutable Mutex           m_ToolManifestsMutex;
     Array< ToolManifest * > m_Tools;
+    ToolFileStore           m_ToolFileStore;
 
-    #if defined( __OSX__ ) || defined( __LINUX__ )
-        Timer                   m_TouchToolchainTimer;
-    #endif
+    Timer                   m_TouchToolchainTimer;
 };
 
 //------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 #include "Core/Env/Assert.h"
 #include "Core/FileIO/FileIO.h"
@@ -49,6 +50,15 @@ Job::~Job()
         OwnData( nullptr, 0, false );
     }
 
+    for ( const AString & streamedResultFile : m_StreamedResultFiles )
+    {
+        FileIO::FileDelete( streamedResultFile.Get() );
+    }
+    if ( m_MemoryTmpReservation )
+    {
+        WorkerThread::ReleaseMemoryTmpDir( m_MemoryTmpReservation );
+    }
+
     if ( m_IsLocal == false )
     {
         FDELETE m_Node;
@@ -174,8 +184,8 @@ void Job::Serialize( IOStream & stream )
 
     stream.Write( IsDataCompressed() );
 
+    // m_Data is sent directly by the caller, avoiding a copy
     stream.Write( m_DataSize );
-    stream.Write( m_Data, m_DataSize );
 }
 
 // Deserialize
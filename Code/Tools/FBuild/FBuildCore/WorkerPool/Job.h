@@ -53,6 +53,10 @@ public:
     inline bool     IsDataCompressed() const { return m_DataIsCompressed; }
     inline bool     IsLocal() const     { return m_IsLocal; }
 
+    // Job data is a HeaderBundle instead of preprocessed output
+    inline void     SetIsHeaderBundle( bool isHeaderBundle ) { m_IsHeaderBundle = isHeaderBundle; }
+    inline bool     IsHeaderBundle() const  { return m_IsHeaderBundle; }
+
     inline const Array< AString > & GetMessages() const { return m_Messages; }
 
     // logging interface
@@ -65,6 +69,7 @@ public:
     inline uint8_t GetSystemErrorCount() const { return m_SystemErrorCount; }
 
     // serialization for remote distribution
+    // (Serialize doesn't write the job data itself, which must immediately follow. See GetData)
     void Serialize( IOStream & stream );
     void Deserialize( IOStream & stream );
 
@@ -78,6 +83,28 @@ public:
 
     void                SetResultCompressionLevel( int16_t compressionLevel )   { m_ResultCompressionLevel = compressionLevel; }
     int16_t             GetResultCompressionLevel() const                       { return m_ResultCompressionLevel; }
+    void                SetResultCompressionZstd( bool zstd )                   { m_ResultCompressionZstd = zstd; }
+    bool                IsResultCompressionZstd() const                         { return m_ResultCompressionZstd; }
+    void                SetResultDictionaryId( uint32_t dictionaryId )          { m_ResultDictionaryId = dictionaryId; }
+    uint32_t            GetResultDictionaryId() const                           { return m_ResultDictionaryId; }
+
+    // On server, results of at least this size are streamed from disk rather than read into the job data (0 = never)
+    void                SetStreamedResultThreshold( uint32_t size )             { m_StreamedResultThreshold = size; }
+    uint32_t            GetStreamedResultThreshold() const                      { return m_StreamedResultThreshold; }
+    void                SetStreamedResultFiles( Array< AString > && files )     { m_StreamedResultFiles = Move( files ); }
+    const Array< AString > & GetStreamedResultFiles() const                     { return m_StreamedResultFiles; }
+    bool                HasStreamedResult() const                               { return ( m_StreamedResultFiles.IsEmpty() == false ); }
+
+    // On server, memory-backed scratch space used by the job (see WorkerThread::ReserveMemoryTmpDir)
+    void                SetMemoryTmpReservation( uint64_t size )                { m_MemoryTmpReservation = size; }
+
+    void                SetResultCacheKey( uint64_t key )                       { m_ResultCacheKey = key; }
+    uint64_t            GetResultCacheKey() const                               { return m_ResultCacheKey; }
+
+    void                SetRemoteSendTime( int64_t time )                       { m_RemoteSendTime = time; }
+    int64_t             GetRemoteSendTime() const                               { return m_RemoteSendTime; }
+    void                SetRemoteRelativeLatency( float latency )               { m_RemoteRelativeLatency = latency; }
+    float               GetRemoteRelativeLatency() const                        { return m_RemoteRelativeLatency; }
 
     enum DistributionState : uint8_t
     {
@@ -113,6 +140,7 @@ private:
     volatile bool       m_Abort             = false;
     bool                m_DataIsCompressed  = false;
     bool                m_IsLocal           = true;
+    bool                m_IsHeaderBundle    = false;
     uint8_t             m_SystemErrorCount  = 0; // On client, the total error count, on the worker a flag for the current attempt
     DistributionState   m_DistributionState = DIST_NONE;
     uint16_t            m_RemoteThreadIndex = 0; // On server, the thread index used to build
@@ -122,8 +150,16 @@ private:
     BuildProfilerScope * m_BuildProfilerScope = nullptr;    // Additional context when profiling a build
     ToolManifest *      m_ToolManifest      = nullptr;
     int16_t             m_ResultCompressionLevel = 0; // Compression level of returned results
+    bool                m_ResultCompressionZstd = false; // Returned results use Zstd rather than LZ4
+    uint32_t            m_ResultDictionaryId = 0; // Dictionary to compress Zstd results with (0 for none)
+    uint32_t            m_StreamedResultThreshold = 0;
+    uint64_t            m_MemoryTmpReservation = 0; // Released when the job is deleted
+    uint64_t            m_ResultCacheKey    = 0; // On server, identifies identical jobs (see JobResultCache)
+    int64_t             m_RemoteSendTime    = 0; // On client, when the job was last sent to a worker
+    float               m_RemoteRelativeLatency = 0.0f; // On client, expected latency of that worker relative to local build time (0 if unknown)
 
     Array< AString >    m_Messages;
+    Array< AString >    m_StreamedResultFiles; // On server, output files to stream to the client (deleted with the job)
 
     static Atomic<int64_t> s_TotalLocalDataMemoryUsage; // Total memory being managed by OwnData
 };
@@ -12,6 +12,7 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CPUPlacement.h"
 
 #include "Core/Time/Timer.h"
 #include "Core/FileIO/FileIO.h"
@@ -19,6 +20,11 @@
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#define RACE_MARGIN ( 1.25f )           // remote must be expected to take this much longer than local to race
+#define RACE_OVERDUE_FACTOR ( 1.5f )    // remote jobs taking this much longer than expected are stragglers
+
 // JobCostSorter
 //------------------------------------------------------------------------------
 class JobCostSorter
@@ -337,7 +343,7 @@ void JobQueue::QueueDistributableJob( Job * job )
 
 // GetDistributableJobToProcess
 //------------------------------------------------------------------------------
-Job * JobQueue::GetDistributableJobToProcess( bool remote )
+Job * JobQueue::GetDistributableJobToProcess( bool remote, bool leastExpensive, float remoteRelativeLatency, bool allowHeaderBundles, bool allowRemoteExec )
 {
     MutexHolder m( m_DistributedJobsMutex );
 
@@ -347,15 +353,55 @@ Job * JobQueue::GetDistributableJobToProcess( bool remote )
     }
 
     // Jobs are sorted from least to most expensive, so we consume
-    // from the end of the list.
-    Job * job = m_DistributableJobs_Available.Top();
-    m_DistributableJobs_Available.Pop();
+    // from the end of the list, unless the caller (a slow worker) wants to
+    // leave the expensive jobs for others
+    Job * job;
+    if ( ( allowHeaderBundles == false ) || ( allowRemoteExec == false ) )
+    {
+        // Older workers can only build preprocessed jobs (and only compile)
+        const size_t numJobs = m_DistributableJobs_Available.GetSize();
+        size_t index = numJobs;
+        for ( size_t i = 0; i < numJobs; ++i )
+        {
+            const size_t candidate = leastExpensive ? i : ( numJobs - 1 - i );
+            const Job * candidateJob = m_DistributableJobs_Available[ candidate ];
+            if ( ( allowHeaderBundles || ( candidateJob->IsHeaderBundle() == false ) ) &&
+                 ( allowRemoteExec || ( candidateJob->GetNode()->GetType() == Node::OBJECT_NODE ) ) )
+            {
+                index = candidate;
+                break;
+            }
+        }
+        if ( index == numJobs )
+        {
+            return nullptr;
+        }
+        job = m_DistributableJobs_Available[ index ];
+        m_DistributableJobs_Available.EraseIndex( index );
+    }
+    else if ( leastExpensive )
+    {
+        job = m_DistributableJobs_Available[ 0 ];
+        m_DistributableJobs_Available.Erase( m_DistributableJobs_Available.Begin() );
+    }
+    else
+    {
+        job = m_DistributableJobs_Available.Top();
+        m_DistributableJobs_Available.Pop();
+    }
 
     ASSERT( job->GetDistributionState() == Job::DIST_AVAILABLE );
 
     // Tag job as in-use
     job->SetDistributionState( remote ? Job::DIST_BUILDING_REMOTELY : Job::DIST_BUILDING_LOCALLY );
     m_DistributableJobs_InProgress.Append( job );
+
+    // Note when the job should complete remotely, to decide if it should be raced
+    if ( remote )
+    {
+        job->SetRemoteSendTime( Timer::GetNow() );
+        job->SetRemoteRelativeLatency( remoteRelativeLatency );
+    }
     return job;
 }
 
@@ -369,8 +415,16 @@ Job * JobQueue::GetDistributableJobToRace()
         return nullptr;
     }
 
-    // take newest job, which is least likely to finish first
-    // compared to older distributed jobs
+    // Racing only helps if the local build is expected to finish before the
+    // remote one. For jobs built before, we know how long they take locally
+    // and how much longer the worker they were sent to takes (if known), so
+    // we race the job which would gain most from doing so. This avoids wasting
+    // local CPU on jobs which are about to return, while still racing jobs
+    // stuck on a slow worker.
+    const int64_t now = Timer::GetNow();
+    Job * bestJob = nullptr;
+    float bestGainMS = 0.0f;
+    Job * newestUnknownJob = nullptr;
     const int32_t numJobs = (int32_t)m_DistributableJobs_InProgress.GetSize();
     for ( int32_t i = ( numJobs - 1 ); i >= 0; --i )
     {
@@ -378,14 +432,72 @@ Job * JobQueue::GetDistributableJobToRace()
 
         // Don't Race jobs already building locally
         const Job::DistributionState distState = job->GetDistributionState();
-        if ( distState == Job::DIST_BUILDING_REMOTELY )
+        if ( distState != Job::DIST_BUILDING_REMOTELY )
         {
-            job->SetDistributionState( Job::DIST_RACING );
-            return job;
+            continue;
+        }
+
+        // Never built before? (build time is only a default estimate)
+        if ( job->GetNode()->GetStatFlag( Node::STATS_FIRST_BUILD ) )
+        {
+            // take newest job, which is least likely to finish first
+            // compared to older distributed jobs
+            if ( newestUnknownJob == nullptr )
+            {
+                newestUnknownJob = job;
+            }
+            continue;
         }
+        const uint32_t expectedLocalMS = job->GetNode()->GetLastBuildTime();
+
+        // Estimate time until remote completion (assuming the same time as
+        // locally if the worker's performance is not yet known)
+        const float relativeLatency = job->GetRemoteRelativeLatency();
+        const float expectedRemoteMS = (float)expectedLocalMS * ( ( relativeLatency > 0.0f ) ? relativeLatency : 1.0f );
+        const float elapsedMS = (float)( now - job->GetRemoteSendTime() ) * Timer::GetFrequencyInvFloatMS();
+        const float remainingMS = ( elapsedMS > ( expectedRemoteMS * RACE_OVERDUE_FACTOR ) )
+                                ? elapsedMS // straggler: completion unknown, assume it will take as long again
+                                : ( expectedRemoteMS - elapsedMS );
+
+        const float gainMS = ( remainingMS - ( (float)expectedLocalMS * RACE_MARGIN ) );
+        if ( gainMS > bestGainMS )
+        {
+            bestGainMS = gainMS;
+            bestJob = job;
+        }
+    }
+
+    Job * job = bestJob ? bestJob : newestUnknownJob;
+    if ( job )
+    {
+        job->SetDistributionState( Job::DIST_RACING );
+        ++m_NumRacesStarted;
     }
+    return job; // nullptr if no job is worth racing (or all were local or races already)
+}
+
+// GetNumRacesStarted
+//------------------------------------------------------------------------------
+uint32_t JobQueue::GetNumRacesStarted() const
+{
+    MutexHolder m( m_DistributedJobsMutex );
+    return m_NumRacesStarted;
+}
+
+// GetNumRacesWonLocally
+//------------------------------------------------------------------------------
+uint32_t JobQueue::GetNumRacesWonLocally() const
+{
+    MutexHolder m( m_DistributedJobsMutex );
+    return m_NumRacesWonLocally;
+}
 
-    return nullptr; // No job found to race (all were local or races already)
+// GetNumRacesWonRemotely
+//------------------------------------------------------------------------------
+uint32_t JobQueue::GetNumRacesWonRemotely() const
+{
+    MutexHolder m( m_DistributedJobsMutex );
+    return m_NumRacesWonRemotely;
 }
 
 // OnReturnRemoteJob
@@ -471,6 +583,7 @@ Job * JobQueue::OnReturnRemoteJob( uint32_t jobId,
             // but before we finish processing the job
             if ( job->GetDistributionState() == Job::DIST_RACE_WON_REMOTELY )
             {
+                ++m_NumRacesWonRemotely;
                 return job; // Remote race won - we now own the job
             }
 
@@ -596,6 +709,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             // Local race, won locally
             ASSERTM( distState == Job::DIST_RACING, "got: %u", distState );
             job->SetDistributionState( Job::DIST_RACE_WON_LOCALLY );
+            ++m_NumRacesWonLocally;
 
             // We can't delete the job yet, because it's still in use by the remote
             // job. It will be freed when the remote job completes
@@ -633,6 +747,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             // Local race, won locally
             ASSERT( distState == Job::DIST_RACING );
             job->SetDistributionState( Job::DIST_RACE_WON_LOCALLY );
+            ++m_NumRacesWonLocally;
 
             // We can't delete the job yet, because it's still in use by the remote
             // job. It will be freed when the remote job completes
@@ -806,6 +921,10 @@ void JobQueue::FinishedProcessingJob( Job * job, bool success, bool wasARemoteJo
             PROFILE_SECTION( profilingTag );
         #endif
 
+        // Links are the memory heavy local jobs
+        const bool memoryHeavy = ( node->GetType() == Node::EXE_NODE ) || ( node->GetType() == Node::DLL_NODE );
+        const CPUPlacementScope placementScope( memoryHeavy );
+
         BuildProfilerScope profileScope( *job, WorkerThread::GetThreadIndex(), node->GetTypeName() );
         result = node->DoBuild( job );
     }
@@ -69,6 +69,11 @@ public:
                       uint32_t & numJobsDist, uint32_t & numJobsDistActive ) const;
     bool HasPendingCompletedJobs() const;
 
+    // local races of remote jobs
+    uint32_t GetNumRacesStarted() const;
+    uint32_t GetNumRacesWonLocally() const;
+    uint32_t GetNumRacesWonRemotely() const;
+
 private:
     // worker threads call these
     friend class WorkerThread;
@@ -82,7 +87,7 @@ private:
 
     // client side of protocol consumes jobs via this interface
     friend class Client;
-    Job *       GetDistributableJobToProcess( bool remote );
+    Job *       GetDistributableJobToProcess( bool remote, bool leastExpensive = false, float remoteRelativeLatency = 0.0f, bool allowHeaderBundles = true, bool allowRemoteExec = true );
     Job *       OnReturnRemoteJob( uint32_t jobId,
                                    bool systemError,
                                    bool & outRaceLost,
@@ -105,6 +110,9 @@ private:
     mutable Mutex       m_DistributedJobsMutex;
     Array< Job * >      m_DistributableJobs_Available;  // Available, not in progress anywhere
     Array< Job * >      m_DistributableJobs_InProgress; // In progress remotely, locally or both
+    uint32_t            m_NumRacesStarted       = 0;
+    uint32_t            m_NumRacesWonLocally    = 0;
+    uint32_t            m_NumRacesWonRemotely   = 0;
 
     // Semaphore to manage thread idle
     Semaphore           m_MainThreadSemaphore;
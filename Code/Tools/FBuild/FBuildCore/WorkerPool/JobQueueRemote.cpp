@@ -12,6 +12,9 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressorDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CPUPlacement.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 
 // Core
@@ -24,10 +27,21 @@
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+// Defines
+//------------------------------------------------------------------------------
+// Jobs with more input than this are considered memory heavy (see CPUPlacement)
+#define JOB_MEMORY_HEAVY_INPUT_SIZE ( 32 * MEGABYTE )
+
+// Result dictionaries are kept until the worker exits, so limit how many there can be
+#define MAX_RESULT_DICTIONARIES ( 64 )
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads ) :
     m_PendingJobs( 1024, true ),
+    m_DuplicateJobs( 0, true ),
+    m_ResultCache( 128 * 1024 * 1024 ), // 128 MiB
+    m_ResultDictionaries( 0, true ),
     m_CompletedJobs( 1024, true ),
     m_CompletedJobsFailed( 1024, true ),
     m_Workers( numWorkerThreads, false )
@@ -65,6 +79,65 @@ JobQueueRemote::~JobQueueRemote()
     }
 
     FDELETE m_ThreadPool;
+
+    for ( CompressorDictionary * dictionary : m_ResultDictionaries )
+    {
+        FDELETE dictionary;
+    }
+}
+
+// AddResultDictionary
+//------------------------------------------------------------------------------
+bool JobQueueRemote::AddResultDictionary( uint32_t dictionaryId, const void * data, size_t dataSize )
+{
+    MutexHolder mh( m_ResultDictionariesMutex );
+
+    // Already have it? (Dictionaries are identified by their contents)
+    for ( const CompressorDictionary * dictionary : m_ResultDictionaries )
+    {
+        if ( dictionary->GetId() == dictionaryId )
+        {
+            return true;
+        }
+    }
+
+    if ( m_ResultDictionaries.GetSize() >= MAX_RESULT_DICTIONARIES )
+    {
+        return false; // Results will be compressed without a dictionary
+    }
+
+    CompressorDictionary * dictionary = FNEW( CompressorDictionary );
+    if ( ( dictionary->Create( data, dataSize ) == false ) ||
+         ( dictionary->GetId() != dictionaryId ) ) // Check for corruption
+    {
+        FDELETE dictionary;
+        return false;
+    }
+    m_ResultDictionaries.Append( dictionary );
+    return true;
+}
+
+// GetResultDictionary
+//------------------------------------------------------------------------------
+const CompressorDictionary * JobQueueRemote::GetResultDictionary( uint32_t dictionaryId ) const
+{
+    MutexHolder mh( m_ResultDictionariesMutex );
+    for ( const CompressorDictionary * dictionary : m_ResultDictionaries )
+    {
+        if ( dictionary->GetId() == dictionaryId )
+        {
+            return dictionary;
+        }
+    }
+    return nullptr;
+}
+
+// GetNumResultDictionaries
+//------------------------------------------------------------------------------
+size_t JobQueueRemote::GetNumResultDictionaries() const
+{
+    MutexHolder mh( m_ResultDictionariesMutex );
+    return m_ResultDictionaries.GetSize();
 }
 
 // SignalStopWorkers (Main Thread)
@@ -106,6 +179,21 @@ void JobQueueRemote::GetWorkerStatus( size_t index, AString & hostName, AString
     ( (WorkerThreadRemote *)m_Workers[ index ] )->GetStatus( hostName, status, isIdle );
 }
 
+// GetNumQueuedJobs
+//------------------------------------------------------------------------------
+size_t JobQueueRemote::GetNumQueuedJobs() const
+{
+    MutexHolder m( m_PendingJobsMutex );
+    return m_PendingJobs.GetSize();
+}
+
+// GetNumResultsReused
+//------------------------------------------------------------------------------
+uint32_t JobQueueRemote::GetNumResultsReused() const
+{
+    return ( m_ResultCache.GetNumHits() + m_NumDuplicateJobs.Load() );
+}
+
 // MainThreadWait
 //------------------------------------------------------------------------------
 void JobQueueRemote::MainThreadWait( uint32_t timeoutMS )
@@ -141,8 +229,33 @@ void JobQueueRemote::WorkerThreadSleep()
 //------------------------------------------------------------------------------
 void JobQueueRemote::QueueJob( Job * job )
 {
+    // Identical jobs (from this or other clients) can share results
+    const uint64_t resultCacheKey = JobResultCache::ComputeKey( *job );
+    job->SetResultCacheKey( resultCacheKey );
+    if ( m_ResultCache.Retrieve( resultCacheKey, *job ) )
+    {
+        CompleteJob( job, true );
+        return;
+    }
+
+    QueuePendingJob( job );
+}
+
+// QueuePendingJob (Main Thread)
+//------------------------------------------------------------------------------
+void JobQueueRemote::QueuePendingJob( Job * job )
+{
+    const uint64_t resultCacheKey = job->GetResultCacheKey();
     {
         MutexHolder m( m_PendingJobsMutex );
+
+        // If an identical job is already being processed, wait for its results
+        if ( IsJobQueuedOrInFlight( resultCacheKey ) )
+        {
+            m_DuplicateJobs.Append( job );
+            return;
+        }
+
         m_PendingJobs.Append( job );
     }
 
@@ -181,20 +294,50 @@ Job * JobQueueRemote::GetCompletedJob()
 //------------------------------------------------------------------------------
 void JobQueueRemote::CancelJobsWithUserData( void * userData )
 {
-    // delete queued jobs
+    // delete queued jobs, and jobs waiting on identical jobs
     {
         MutexHolder m( m_PendingJobsMutex );
-        Job ** it = m_PendingJobs.Begin();
+        Job ** it = m_DuplicateJobs.Begin();
+        while ( it != m_DuplicateJobs.End() )
+        {
+            if ( ( *it )->GetUserData() == userData )
+            {
+                FDELETE *it;
+                m_DuplicateJobs.Erase( it );
+                continue;
+            }
+            ++it;
+        }
+
+        StackArray< uint64_t > cancelledKeys;
+        it = m_PendingJobs.Begin();
         while ( it != m_PendingJobs.End() )
         {
             if ( ( *it )->GetUserData() == userData )
             {
+                cancelledKeys.Append( ( *it )->GetResultCacheKey() );
                 FDELETE *it;
                 m_PendingJobs.Erase( it );
                 continue;
             }
             ++it;
         }
+
+        // Build the first job waiting on each cancelled job in its place,
+        // leaving any others waiting on it
+        for ( const uint64_t resultCacheKey : cancelledKeys )
+        {
+            for ( Job ** dupIt = m_DuplicateJobs.Begin(); dupIt != m_DuplicateJobs.End(); ++dupIt )
+            {
+                if ( ( *dupIt )->GetResultCacheKey() == resultCacheKey )
+                {
+                    m_PendingJobs.Append( *dupIt );
+                    m_WorkerThreadSemaphore.Signal( 1 );
+                    m_DuplicateJobs.Erase( dupIt );
+                    break;
+                }
+            }
+        }
     }
 
     // delete completed jobs
@@ -228,6 +371,50 @@ void JobQueueRemote::CancelJobsWithUserData( void * userData )
     }
 }
 
+// TakeExcessQueuedJobs
+//------------------------------------------------------------------------------
+void JobQueueRemote::TakeExcessQueuedJobs( size_t maxJobs, bool ( *canTake )( const Job * job ), Array< Job * > & outJobs )
+{
+    MutexHolder m( m_PendingJobsMutex );
+
+    size_t numJobs = m_PendingJobs.GetSize();
+    {
+        MutexHolder mh( m_InFlightJobsMutex );
+        numJobs += m_InFlightJobs.GetSize();
+    }
+
+    // Take the most recently queued jobs first, as they would be built last
+    size_t index = m_PendingJobs.GetSize();
+    while ( ( numJobs > maxJobs ) && ( index > 0 ) )
+    {
+        --index;
+        Job * job = m_PendingJobs[ index ];
+        if ( canTake( job ) == false )
+        {
+            continue;
+        }
+
+        // Jobs waiting for the results of this one would never complete
+        bool hasDuplicates = false;
+        for ( const Job * duplicate : m_DuplicateJobs )
+        {
+            if ( duplicate->GetResultCacheKey() == job->GetResultCacheKey() )
+            {
+                hasDuplicates = true;
+                break;
+            }
+        }
+        if ( hasDuplicates )
+        {
+            continue;
+        }
+
+        outJobs.Append( job );
+        m_PendingJobs.EraseIndex( index );
+        --numJobs;
+    }
+}
+
 // GetJobToProcess (Worker Thread)
 //------------------------------------------------------------------------------
 Job * JobQueueRemote::GetJobToProcess()
@@ -254,12 +441,58 @@ Job * JobQueueRemote::GetJobToProcess()
 //------------------------------------------------------------------------------
 void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
 {
-    // remove from in-flight
+    // Only successful results are kept, as failures can be due to problems
+    // on this worker. Streamed results aren't in memory, so can't be shared.
+    const uint64_t resultCacheKey = job->GetResultCacheKey();
+    const bool shareResults = ( success && ( job->HasStreamedResult() == false ) );
+    if ( shareResults )
     {
-        MutexHolder mh( m_InFlightJobsMutex );
-        Job ** it = m_InFlightJobs.Find( job );
-        ASSERT( it != nullptr );
-        m_InFlightJobs.Erase( it );
+        m_ResultCache.Store( resultCacheKey, *job );
+    }
+
+    // remove from in-flight, taking any jobs waiting on this one
+    StackArray< Job * > duplicateJobs;
+    {
+        MutexHolder m( m_PendingJobsMutex );
+        {
+            MutexHolder mh( m_InFlightJobsMutex );
+            Job ** it = m_InFlightJobs.Find( job );
+            ASSERT( it != nullptr );
+            m_InFlightJobs.Erase( it );
+        }
+
+        Job ** it = m_DuplicateJobs.Begin();
+        while ( it != m_DuplicateJobs.End() )
+        {
+            if ( ( *it )->GetResultCacheKey() != resultCacheKey )
+            {
+                ++it;
+                continue;
+            }
+
+            if ( shareResults )
+            {
+                duplicateJobs.Append( *it );
+            }
+            else
+            {
+                // Build the first waiting job in place of this one, leaving
+                // any others waiting on it
+                m_PendingJobs.Append( *it );
+                m_WorkerThreadSemaphore.Signal( 1 );
+                m_DuplicateJobs.Erase( it );
+                break;
+            }
+            m_DuplicateJobs.Erase( it );
+        }
+    }
+
+    // complete the waiting jobs with the same results
+    for ( Job * duplicateJob : duplicateJobs )
+    {
+        m_NumDuplicateJobs.Increment();
+        JobResultCache::CopyResults( *job, *duplicateJob );
+        CompleteJob( duplicateJob, true );
     }
 
     // handle jobs which were cancelled while in flight
@@ -269,6 +502,13 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
         return;
     }
 
+    CompleteJob( job, success );
+}
+
+// CompleteJob
+//------------------------------------------------------------------------------
+void JobQueueRemote::CompleteJob( Job * job, bool success )
+{
     // push to appropriate completion queue
     {
         MutexHolder m( m_CompletedJobsMutex );
@@ -285,6 +525,29 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     WakeMainThread();
 }
 
+// IsJobQueuedOrInFlight
+//------------------------------------------------------------------------------
+bool JobQueueRemote::IsJobQueuedOrInFlight( uint64_t resultCacheKey ) const
+{
+    for ( const Job * job : m_PendingJobs )
+    {
+        if ( job->GetResultCacheKey() == resultCacheKey )
+        {
+            return true;
+        }
+    }
+
+    MutexHolder mh( m_InFlightJobsMutex );
+    for ( const Job * job : m_InFlightJobs )
+    {
+        if ( job->GetResultCacheKey() == resultCacheKey )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 // DoBuild
 //------------------------------------------------------------------------------
 /*static*/ Node::BuildResult JobQueueRemote::DoBuild( Job * job, bool racingRemoteJob )
@@ -293,7 +556,8 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
 
     const Timer timer; // track how long the item takes
 
-    ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
+    Node * node = job->GetNode();
+    ObjectNode * objectNode = ( node->GetType() == Node::OBJECT_NODE ) ? node->CastTo< ObjectNode >() : nullptr;
 
     if ( job->IsLocal() )
     {
@@ -323,17 +587,18 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     }
 
     // Delete any left over PDB from a previous run (to be sure we have a clean pdb)
-    if ( node->IsUsingPDB() && ( job->IsLocal() == false ) )
+    if ( objectNode && objectNode->IsUsingPDB() && ( job->IsLocal() == false ) )
     {
         AStackString<> pdbName;
-        node->GetPDBName( pdbName );
+        objectNode->GetPDBName( pdbName );
         FileIO::FileDelete( pdbName.Get() );
     }
 
     Node::BuildResult result;
     {
         PROFILE_SECTION( racingRemoteJob ? "RACE" : "LOCAL" );
-        result = ((Node *)node )->DoBuild2( job, racingRemoteJob );
+        const CPUPlacementScope placementScope( IsMemoryHeavy( *job ) );
+        result = node->DoBuild2( job, racingRemoteJob );
     }
 
     // Ignore result if job was cancelled
@@ -395,10 +660,10 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
         FileIO::FileDelete( node->GetName().Get() );
 
         // Cleanup PDB file
-        if ( node->IsUsingPDB() )
+        if ( objectNode && objectNode->IsUsingPDB() )
         {
             AStackString<> pdbName;
-            node->GetPDBName( pdbName );
+            objectNode->GetPDBName( pdbName );
             FileIO::FileDelete( pdbName.Get() );
         }
     }
@@ -420,37 +685,73 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     return result;
 }
 
+// IsMemoryHeavy
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::IsMemoryHeavy( const Job & job )
+{
+    uint64_t inputSize = job.GetDataSize();
+    if ( job.IsDataCompressed() )
+    {
+        inputSize = Compressor::GetUncompressedSize( job.GetData(), job.GetDataSize() );
+    }
+    return ( inputSize >= JOB_MEMORY_HEAVY_INPUT_SIZE );
+}
+
 // ReadResults
 //------------------------------------------------------------------------------
 /*static*/ bool JobQueueRemote::ReadResults( Job * job )
 {
-    const ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
-    const bool includePDB = node->IsUsingPDB();
-    const bool usingStaticAnalysis = node->IsUsingStaticAnalysisMSVC();
+    const Node * node = job->GetNode();
 
     // Determine list of files to send
 
-    // 1. Object file
-    //---------------
+    // 1. Object file (or output of Exec/Test)
+    //----------------------------------------
     StackArray< AString > fileNames;
     fileNames.Append( node->GetName() );
 
-    // 2. PDB file (optional)
-    //-----------------------
-    if ( includePDB )
+    if ( node->GetType() == Node::OBJECT_NODE )
     {
-        AStackString<> pdbFileName;
-        node->GetPDBName( pdbFileName );
-        fileNames.Append( pdbFileName );
+        const ObjectNode * objectNode = node->CastTo< ObjectNode >();
+
+        // 2. PDB file (optional)
+        //-----------------------
+        if ( objectNode->IsUsingPDB() )
+        {
+            AStackString<> pdbFileName;
+            objectNode->GetPDBName( pdbFileName );
+            fileNames.Append( pdbFileName );
+        }
+
+        // 3. .nativecodeanalysis.xml file (optional)
+        //--------------------------------------------
+        if ( objectNode->IsUsingStaticAnalysisMSVC() )
+        {
+            AStackString<> xmlFileName;
+            objectNode->GetNativeAnalysisXMLPath( xmlFileName );
+            fileNames.Append( xmlFileName );
+        }
     }
 
-    // 3. .nativecodeanalysis.xml file (optional)
-    //--------------------------------------------
-    if ( usingStaticAnalysis )
+    // Large results are left on disk and streamed to the client by the Server
+    if ( ( job->GetStreamedResultThreshold() > 0 ) && ( fileNames.GetSize() <= 0xFF ) )
     {
-        AStackString<> xmlFileName;
-        node->GetNativeAnalysisXMLPath( xmlFileName );
-        fileNames.Append( xmlFileName );
+        uint64_t totalSize = 0;
+        bool allFilesExist = true;
+        for ( const AString & fileName : fileNames )
+        {
+            FileIO::FileInfo info;
+            if ( FileIO::GetFileInfo( fileName, info ) == false )
+            {
+                allFilesExist = false; // Report error below
+                break;
+            }
+            totalSize += info.m_Size;
+        }
+        if ( allFilesExist && ( totalSize >= job->GetStreamedResultThreshold() ) )
+        {
+            return StreamResults( job, fileNames );
+        }
     }
 
     MultiBuffer mb;
@@ -465,7 +766,17 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     const int32_t compressionLevel = job->GetResultCompressionLevel();
     if ( compressionLevel != 0 )
     {
-        mb.Compress( compressionLevel );
+        if ( job->IsResultCompressionZstd() )
+        {
+            // Dictionaries are never removed, so it's safe to use without the lock
+            const uint32_t dictionaryId = job->GetResultDictionaryId();
+            const CompressorDictionary * dictionary = dictionaryId ? JobQueueRemote::Get().GetResultDictionary( dictionaryId ) : nullptr;
+            mb.CompressZstd( compressionLevel, dictionary );
+        }
+        else
+        {
+            mb.Compress( compressionLevel );
+        }
     }
 
     // transfer data to job
@@ -476,4 +787,34 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     return true;
 }
 
+// StreamResults
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::StreamResults( Job * job, const Array< AString > & fileNames )
+{
+    // Outputs are usually deleted once read (see DoBuild), so move them
+    // somewhere unique to this job, to be deleted with it instead
+    static Atomic< uint32_t > s_StreamedResultId;
+    const uint32_t streamId = s_StreamedResultId.Increment();
+
+    Array< AString > streamedFiles( fileNames.GetSize() );
+    for ( const AString & fileName : fileNames )
+    {
+        AString & streamedFile = streamedFiles.EmplaceBack();
+        streamedFile.Format( "%s.%u.stream", fileName.Get(), streamId );
+        if ( FileIO::FileMove( fileName, streamedFile ) == false )
+        {
+            job->Error( "Error moving file: '%s'", fileName.Get() );
+            FLOG_ERROR( "Error moving file: '%s'", fileName.Get() );
+            streamedFiles.Pop();
+            for ( const AString & f : streamedFiles )
+            {
+                FileIO::FileDelete( f.Get() );
+            }
+            return false;
+        }
+    }
+    job->SetStreamedResultFiles( Move( streamedFiles ) );
+    return true;
+}
+
 //------------------------------------------------------------------------------
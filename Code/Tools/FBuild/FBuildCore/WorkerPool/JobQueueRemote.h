@@ -8,11 +8,15 @@
 #include "Core/Containers/Singleton.h"
 
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderFileStore.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobResultCache.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Mutex.h"
 #include "Core/Process/Semaphore.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CompressorDictionary;
 class Node;
 class Job;
 class ThreadPool;
@@ -30,14 +34,25 @@ public:
     void QueueJob( Job * job );
     Job * GetCompletedJob();
     void CancelJobsWithUserData( void * userData );
+    void TakeExcessQueuedJobs( size_t maxJobs, bool ( *canTake )( const Job * job ), Array< Job * > & outJobs );
 
     // handle shutting down
     void SignalStopWorkers();
     bool HaveWorkersStopped() const;
 
     inline size_t GetNumWorkers() const { return m_Workers.GetSize(); }
+    size_t        GetNumQueuedJobs() const;
+    uint32_t      GetNumResultsReused() const;
     void          GetWorkerStatus( size_t index, AString & hostName, AString & status, bool & isIdle ) const;
 
+    // Headers received from clients for header bundle jobs
+    inline HeaderFileStore & GetHeaderFileStore() { return m_HeaderFileStore; }
+
+    // Dictionaries received from clients to compress results with
+    bool AddResultDictionary( uint32_t dictionaryId, const void * data, size_t dataSize );
+    const CompressorDictionary * GetResultDictionary( uint32_t dictionaryId ) const;
+    size_t GetNumResultDictionaries() const;
+
     void MainThreadWait( uint32_t timeoutMS );
     void WakeMainThread();
 
@@ -54,12 +69,24 @@ private:
     void        FinishedProcessingJob( Job * job, bool result );
 
     // internal helpers
+    friend class TestDistributed;
+    void        QueuePendingJob( Job * job ); // Job's result cache key must be set
+    static bool IsMemoryHeavy( const Job & job );
     static bool ReadResults( Job * job );
+    static bool StreamResults( Job * job, const Array< AString > & fileNames );
+    bool        IsJobQueuedOrInFlight( uint64_t resultCacheKey ) const; // m_PendingJobsMutex must be held
+    void        CompleteJob( Job * job, bool success );
 
     mutable Mutex       m_PendingJobsMutex;
     Array< Job * >      m_PendingJobs;
     mutable Mutex       m_InFlightJobsMutex;
     Array< Job * >      m_InFlightJobs;
+    Array< Job * >      m_DuplicateJobs; // Waiting on an identical queued/in-flight job (protected by m_PendingJobsMutex)
+    Atomic<uint32_t>    m_NumDuplicateJobs;
+    JobResultCache      m_ResultCache;
+    HeaderFileStore     m_HeaderFileStore;
+    mutable Mutex       m_ResultDictionariesMutex;
+    Array< CompressorDictionary * > m_ResultDictionaries;
     Mutex               m_CompletedJobsMutex;
     Array< Job * >      m_CompletedJobs;
     Array< Job * >      m_CompletedJobsFailed;
@@ -0,0 +1,204 @@
+// JobResultCache - Results of remote jobs, reused for identical jobs
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "JobResultCache.h"
+#include "Job.h"
+
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
+
+// Core
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#include <memory.h> // for memcpy
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+JobResultCache::JobResultCache( size_t maxMemory )
+    : m_Entries( 0, true )
+    , m_MaxMemory( maxMemory )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+JobResultCache::~JobResultCache()
+{
+    for ( Entry * entry : m_Entries )
+    {
+        FreeEntry( entry );
+    }
+}
+
+// ComputeKey
+//------------------------------------------------------------------------------
+/*static*/ uint64_t JobResultCache::ComputeKey( const Job & job )
+{
+    PROFILE_FUNCTION;
+
+    const Node * node = job.GetNode();
+    ASSERT( job.GetToolManifest() );
+
+    // The output is built with the same file name as on the client (see
+    // JobQueueRemote::DoBuild) and the name can be embedded in the results
+    const AString & remoteName = job.GetRemoteName();
+    const char * lastSlash = remoteName.FindLast( NATIVE_SLASH );
+    const AStackString<> fileName( lastSlash ? ( lastSlash + 1 ) : remoteName.Get() );
+
+    // Everything that can affect the results
+    MemoryStream ms;
+    ms.Write( job.GetToolManifest()->GetToolId() );
+    ms.Write( fileName );
+    ms.Write( job.GetRemoteSourceRoot() );
+    if ( node->GetType() == Node::OBJECT_NODE )
+    {
+        const ObjectNode * objectNode = node->CastTo< ObjectNode >();
+        ms.Write( objectNode->GetSourceFile()->GetName() );
+        ms.Write( objectNode->GetCompilerFlags().m_Flags );
+        ms.Write( objectNode->GetCompilerOptions() );
+    }
+    else
+    {
+        // Exec() and Test() nodes hold only what was sent
+        Node::SaveRemote( ms, node );
+    }
+    ms.Write( job.IsDataCompressed() );
+    ms.Write( job.IsHeaderBundle() );
+    ms.Write( job.GetResultCompressionLevel() );
+    ms.Write( job.IsResultCompressionZstd() );
+    ms.Write( job.GetResultDictionaryId() );
+    ms.Write( xxHash3::Calc64( job.GetData(), job.GetDataSize() ) );
+    return xxHash3::Calc64( ms.GetData(), ms.GetSize() );
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool JobResultCache::Retrieve( uint64_t key, Job & job )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+
+    for ( Entry * entry : m_Entries )
+    {
+        if ( entry->m_Key != key )
+        {
+            continue;
+        }
+
+        entry->m_LastUse = ++m_UseCount;
+        ++m_NumHits;
+
+        void * data = ALLOC( entry->m_DataSize );
+        memcpy( data, entry->m_Data, entry->m_DataSize );
+        job.OwnData( data, entry->m_DataSize );
+        job.SetMessages( entry->m_Messages );
+        job.GetNode()->SetLastBuildTime( entry->m_BuildTime );
+        return true;
+    }
+    return false;
+}
+
+// Store
+//------------------------------------------------------------------------------
+void JobResultCache::Store( uint64_t key, const Job & job )
+{
+    PROFILE_FUNCTION;
+
+    const size_t entrySize = job.GetDataSize();
+    if ( entrySize > ( m_MaxMemory / 4 ) )
+    {
+        return; // Don't let a single large result evict everything else
+    }
+
+    MutexHolder mh( m_Mutex );
+
+    for ( const Entry * entry : m_Entries )
+    {
+        if ( entry->m_Key == key )
+        {
+            return; // Already stored (identical jobs were built at the same time)
+        }
+    }
+
+    while ( ( m_MemoryUsage + entrySize ) > m_MaxMemory )
+    {
+        EvictLeastRecentlyUsed();
+    }
+
+    Entry * entry = FNEW( Entry );
+    entry->m_Key = key;
+    entry->m_LastUse = ++m_UseCount;
+    entry->m_DataSize = (uint32_t)job.GetDataSize();
+    entry->m_Data = ALLOC( entry->m_DataSize );
+    memcpy( entry->m_Data, job.GetData(), entry->m_DataSize );
+    entry->m_BuildTime = job.GetNode()->GetLastBuildTime();
+    entry->m_Messages = job.GetMessages();
+    m_Entries.Append( entry );
+    m_MemoryUsage += entrySize;
+}
+
+// CopyResults
+//------------------------------------------------------------------------------
+/*static*/ void JobResultCache::CopyResults( const Job & src, Job & dst )
+{
+    void * data = ALLOC( src.GetDataSize() );
+    memcpy( data, src.GetData(), src.GetDataSize() );
+    dst.OwnData( data, src.GetDataSize() );
+    dst.SetMessages( src.GetMessages() );
+    dst.GetNode()->SetLastBuildTime( src.GetNode()->GetLastBuildTime() );
+}
+
+// GetMemoryUsage
+//------------------------------------------------------------------------------
+size_t JobResultCache::GetMemoryUsage() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_MemoryUsage;
+}
+
+// GetNumHits
+//------------------------------------------------------------------------------
+uint32_t JobResultCache::GetNumHits() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_NumHits;
+}
+
+// EvictLeastRecentlyUsed
+//------------------------------------------------------------------------------
+void JobResultCache::EvictLeastRecentlyUsed()
+{
+    ASSERT( m_Entries.IsEmpty() == false );
+
+    Entry ** oldest = m_Entries.Begin();
+    for ( Entry ** it = m_Entries.Begin(); it != m_Entries.End(); ++it )
+    {
+        if ( ( *it )->m_LastUse < ( *oldest )->m_LastUse )
+        {
+            oldest = it;
+        }
+    }
+
+    m_MemoryUsage -= ( *oldest )->m_DataSize;
+    FreeEntry( *oldest );
+    m_Entries.Erase( oldest );
+}
+
+// FreeEntry
+//------------------------------------------------------------------------------
+/*static*/ void JobResultCache::FreeEntry( Entry * entry )
+{
+    FREE( entry->m_Data );
+    FDELETE entry;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,63 @@
+// JobResultCache - Results of remote jobs, reused for identical jobs
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Job;
+
+// JobResultCache
+//------------------------------------------------------------------------------
+// Different clients often send the worker identical jobs (same toolchain,
+// preprocessed source and args) within a short time of each other. Successful
+// results are retained (up to a memory limit, evicting the least recently used)
+// so such jobs can be answered without building them again.
+class JobResultCache
+{
+public:
+    explicit JobResultCache( size_t maxMemory );
+    ~JobResultCache();
+
+    // Determine the key identifying equivalent jobs. Must be called before the
+    // job is built (which replaces the job data with the results).
+    static uint64_t ComputeKey( const Job & job );
+
+    // Complete a job with the results of an earlier identical job
+    bool        Retrieve( uint64_t key, Job & job );
+    void        Store( uint64_t key, const Job & job );
+    static void CopyResults( const Job & src, Job & dst );
+
+    size_t      GetMemoryUsage() const;
+    uint32_t    GetNumHits() const;
+
+private:
+    class Entry
+    {
+    public:
+        uint64_t            m_Key;
+        uint64_t            m_LastUse;
+        void *              m_Data;
+        uint32_t            m_DataSize;
+        uint32_t            m_BuildTime;
+        Array< AString >    m_Messages;
+    };
+
+    void        EvictLeastRecentlyUsed();
+    static void FreeEntry( Entry * entry );
+
+    mutable Mutex       m_Mutex;
+    Array< Entry * >    m_Entries;
+    size_t              m_MemoryUsage   = 0;
+    size_t              m_MaxMemory;
+    uint64_t            m_UseCount      = 0;
+    uint32_t            m_NumHits       = 0;
+};
+
+//------------------------------------------------------------------------------
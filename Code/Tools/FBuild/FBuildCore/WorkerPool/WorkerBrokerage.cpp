@@ -17,7 +17,8 @@
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 WorkerBrokerage::WorkerBrokerage()
-    : m_BrokerageInitialized( false )
+    : m_CoordinatorPort( Protocol::COORDINATOR_PORT )
+    , m_BrokerageInitialized( false )
 {
 }
 
@@ -88,6 +89,42 @@ void WorkerBrokerage::InitBrokerage()
         }
     }
 
+    // coordinator (preferred over the brokerage path if both are set)
+    AStackString<> coordinator;
+    if ( Env::GetEnvVariable( "FASTBUILD_COORDINATOR", coordinator ) )
+    {
+        // <host>[:<port>]
+        coordinator.TrimStart( ' ' );
+        coordinator.TrimEnd( ' ' );
+        const char * colon = coordinator.Find( ':' );
+        if ( colon )
+        {
+            uint32_t port = 0;
+            if ( ( AString::ScanS( colon + 1, "%u", &port ) == 1 ) && ( port > 0 ) && ( port <= 0xFFFF ) )
+            {
+                m_CoordinatorPort = (uint16_t)port;
+            }
+            m_CoordinatorHost.Assign( coordinator.Get(), colon );
+        }
+        else
+        {
+            m_CoordinatorHost = coordinator;
+        }
+
+        if ( !m_CoordinatorHost.IsEmpty() )
+        {
+            // report the coordinator first, as it's used first
+            AStackString<> rootPaths;
+            rootPaths.Format( "%s:%u", m_CoordinatorHost.Get(), m_CoordinatorPort );
+            if ( !m_BrokerageRootPaths.IsEmpty() )
+            {
+                rootPaths += ";";
+                rootPaths += m_BrokerageRootPaths;
+            }
+            m_BrokerageRootPaths = rootPaths;
+        }
+    }
+
     m_BrokerageInitialized = true;
 }
 
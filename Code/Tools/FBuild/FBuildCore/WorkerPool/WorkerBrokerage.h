@@ -24,6 +24,8 @@ protected:
 
     Array<AString>      m_BrokerageRoots;
     AString             m_BrokerageRootPaths;
+    AString             m_CoordinatorHost;      // See WorkerCoordinator (empty if not used)
+    uint16_t            m_CoordinatorPort;
     bool                m_BrokerageInitialized;
 };
 
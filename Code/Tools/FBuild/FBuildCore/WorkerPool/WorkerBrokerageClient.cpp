@@ -7,6 +7,7 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerCoordinator.h"
 
 // Core
 #include "Core/Env/Env.h"
@@ -25,7 +26,7 @@ WorkerBrokerageClient::~WorkerBrokerageClient() = default;
 
 // FindWorkers
 //------------------------------------------------------------------------------
-void WorkerBrokerageClient::FindWorkers( Array< AString > & outWorkerList )
+void WorkerBrokerageClient::FindWorkers( Array< AString > & outWorkerList, const Array< uint64_t > & toolIds )
 {
     PROFILE_FUNCTION;
 
@@ -46,6 +47,32 @@ void WorkerBrokerageClient::FindWorkers( Array< AString > & outWorkerList )
 
     // Init the brokerage
     InitBrokerage();
+
+    // Get addresses for the local host
+    StackArray<AString> localAddresses;
+    Network::GetIPv4Addresses( localAddresses );
+
+    // Prefer the coordinator, falling back to the brokerage path if it's unavailable
+    if ( !m_CoordinatorHost.IsEmpty() )
+    {
+        WorkerCoordinatorConnection coordinator( m_CoordinatorHost, m_CoordinatorPort );
+        Array< AString > workers;
+        if ( coordinator.FindWorkers( toolIds, workers ) )
+        {
+            FLOG_WARN( "%zu workers found through coordinator '%s:%u'", workers.GetSize(), m_CoordinatorHost.Get(), m_CoordinatorPort );
+            for ( const AString & worker : workers )
+            {
+                // Filter out local addresses
+                if ( localAddresses.Find( worker ) == nullptr )
+                {
+                    outWorkerList.Append( worker );
+                }
+            }
+            return;
+        }
+        FLOG_WARN( "Coordinator '%s:%u' unavailable", m_CoordinatorHost.Get(), m_CoordinatorPort );
+    }
+
     if ( m_BrokerageRoots.IsEmpty() )
     {
         FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH?" );
@@ -75,10 +102,6 @@ void WorkerBrokerageClient::FindWorkers( Array< AString > & outWorkerList )
         outWorkerList.SetCapacity( outWorkerList.GetSize() + results.GetSize() );
     }
 
-    // Get addresses for the local host
-    StackArray<AString> localAddresses;
-    Network::GetIPv4Addresses( localAddresses );
-
     // convert worker strings
     for (const AString & fileName : results )
     {
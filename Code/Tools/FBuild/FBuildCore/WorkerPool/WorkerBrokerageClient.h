@@ -18,7 +18,9 @@ public:
     WorkerBrokerageClient();
     ~WorkerBrokerageClient();
 
-    void FindWorkers( Array< AString > & outWorkerList );
+    // toolIds are the toolchains the build is expected to use (if known), so
+    // workers which already have them can be preferred (coordinator only)
+    void FindWorkers( Array< AString > & outWorkerList, const Array< uint64_t > & toolIds );
 };
 
 //------------------------------------------------------------------------------
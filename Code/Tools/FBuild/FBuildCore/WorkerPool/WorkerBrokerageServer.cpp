@@ -8,6 +8,7 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerCoordinator.h"
 #include "Tools/FBuild/FBuildWorker/Worker/WorkerSettings.h"
 
 // Core
@@ -24,6 +25,8 @@ static const float sBrokerageElapsedTimeBetweenClean = ( 12 * 60 * 60.0f );
 static const uint32_t sBrokerageCleanOlderThan = ( 24 * 60 * 60 );
 static const float sBrokerageAvailabilityUpdateTime = ( 10.0f );
 static const float sBrokerageIPAddressUpdateTime = ( 5 * 60.0f );
+static const float sBrokerageCoordinatorUpdateTime = ( 2.0f );
+static const float sBrokerageCoordinatorRetryTime = ( 30.0f );
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -43,6 +46,24 @@ WorkerBrokerageServer::~WorkerBrokerageServer()
     {
         FileIO::FileDelete( m_BrokerageFilePath.Get() );
     }
+
+    // Disconnecting from the coordinator removes our availability
+    FDELETE m_Coordinator;
+}
+
+// SetStatus
+//------------------------------------------------------------------------------
+void WorkerBrokerageServer::SetStatus( uint32_t numSlots, uint32_t numFreeSlots, const Array< uint64_t > & toolIds )
+{
+    if ( ( numSlots != m_NumSlots ) ||
+         ( numFreeSlots != m_NumFreeSlots ) ||
+         ( toolIds.GetSize() != m_ToolIds.GetSize() ) )
+    {
+        m_NumSlots = numSlots;
+        m_NumFreeSlots = numFreeSlots;
+        m_ToolIds = toolIds;
+        m_CoordinatorUpdated = false;
+    }
 }
 
 // SetAvailability
@@ -52,9 +73,16 @@ void WorkerBrokerageServer::SetAvailability( bool available )
     // Init the brokerage if not already
     InitBrokerage();
 
+    // report to the coordinator (if configured)
+    if ( !m_CoordinatorHost.IsEmpty() )
+    {
+        UpdateCoordinator( available );
+    }
+
     // ignore if brokerage not configured
     if ( m_BrokerageRoots.IsEmpty() )
     {
+        m_Available = available;
         return;
     }
 
@@ -220,6 +248,50 @@ void WorkerBrokerageServer::SetAvailability( bool available )
     }
 }
 
+// UpdateCoordinator
+//------------------------------------------------------------------------------
+void WorkerBrokerageServer::UpdateCoordinator( bool available )
+{
+    // Report changes promptly, and regularly otherwise so the coordinator
+    // knows we're still responsive
+    const float elapsedTime = m_TimerLastCoordinatorUpdate.GetElapsed();
+    if ( m_CoordinatorFailed )
+    {
+        // Don't stall the worker retrying a coordinator which is down
+        if ( elapsedTime < sBrokerageCoordinatorRetryTime )
+        {
+            return;
+        }
+    }
+    else if ( ( available == m_Available ) &&
+              m_CoordinatorUpdated &&
+              ( elapsedTime < sBrokerageCoordinatorUpdateTime ) )
+    {
+        return;
+    }
+
+    if ( m_Coordinator == nullptr )
+    {
+        m_Coordinator = FNEW( WorkerCoordinatorConnection( m_CoordinatorHost, m_CoordinatorPort ) );
+    }
+
+    // The address may not be known (it's resolved for the brokerage file), in
+    // which case the coordinator uses the address we connect from
+    static const uint32_t numProcessors = Env::GetNumProcessors();
+    const bool sent = m_Coordinator->SendStatus( m_IPAddress,
+                                                 numProcessors,
+                                                 available ? m_NumSlots : 0,
+                                                 available ? m_NumFreeSlots : 0,
+                                                 m_ToolIds );
+    if ( ( sent == false ) && ( m_CoordinatorFailed == false ) )
+    {
+        FLOG_WARN( "Failed to report status to coordinator '%s:%u'", m_CoordinatorHost.Get(), m_CoordinatorPort );
+    }
+    m_CoordinatorFailed = ( sent == false );
+    m_CoordinatorUpdated = sent;
+    m_TimerLastCoordinatorUpdate.Start();
+}
+
 // UpdateBrokerageFilePath
 //------------------------------------------------------------------------------
 void WorkerBrokerageServer::UpdateBrokerageFilePath()
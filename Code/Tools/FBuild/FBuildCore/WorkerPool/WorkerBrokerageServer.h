@@ -12,6 +12,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class WorkerCoordinatorConnection;
 
 // WorkerBrokerageClient
 //------------------------------------------------------------------------------
@@ -23,10 +24,14 @@ public:
 
     void SetAvailability( bool available );
 
+    // Job slots and cached toolchains, reported to the coordinator (if used)
+    void SetStatus( uint32_t numSlots, uint32_t numFreeSlots, const Array< uint64_t > & toolIds );
+
     const AString & GetHostName() const { return m_HostName; }
 
 protected:
     void UpdateBrokerageFilePath();
+    void UpdateCoordinator( bool available );
 
     Timer               m_TimerLastUpdate;      // Throttle network access
     Timer               m_TimerLastIPUpdate;    // Throttle dns access
@@ -37,6 +42,15 @@ protected:
     AString             m_IPAddress;
     AString             m_DomainName;
     AString             m_HostName;
+
+    // Coordinator
+    WorkerCoordinatorConnection * m_Coordinator = nullptr;
+    Timer               m_TimerLastCoordinatorUpdate;
+    bool                m_CoordinatorUpdated = false;   // Status reported since last changed
+    bool                m_CoordinatorFailed = false;
+    uint32_t            m_NumSlots = 0;
+    uint32_t            m_NumFreeSlots = 0;
+    Array< uint64_t >   m_ToolIds;
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,412 @@
+// WorkerCoordinator - Network service tracking available workers
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "WorkerCoordinator.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/Env/Env.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// Static Data
+//------------------------------------------------------------------------------
+static const float sCoordinatorStatusTimeout = ( 60.0f );   // Ignore workers which stop reporting (but stay connected)
+static const uint32_t sCoordinatorResponseTimeoutMS = ( 5 * 1000 );
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+WorkerCoordinator::WorkerCoordinator()
+    : m_ConnectionList( 64, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+WorkerCoordinator::~WorkerCoordinator()
+{
+    ShutdownAllConnections();
+}
+
+// GetNumWorkers
+//------------------------------------------------------------------------------
+size_t WorkerCoordinator::GetNumWorkers() const
+{
+    MutexHolder mh( m_ConnectionListMutex );
+    size_t numWorkers = 0;
+    for ( const ConnectionState * cs : m_ConnectionList )
+    {
+        numWorkers += cs->m_IsWorker ? 1 : 0;
+    }
+    return numWorkers;
+}
+
+// OnConnected
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerCoordinator::OnConnected( const ConnectionInfo * connection )
+{
+    ConnectionState * cs = FNEW( ConnectionState );
+    connection->SetUserData( cs );
+
+    MutexHolder mh( m_ConnectionListMutex );
+    m_ConnectionList.Append( cs );
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerCoordinator::OnDisconnected( const ConnectionInfo * connection )
+{
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+    ASSERT( cs );
+
+    {
+        MutexHolder mh( m_ConnectionListMutex );
+        ConnectionState ** iter = m_ConnectionList.Find( cs );
+        ASSERT( iter );
+        m_ConnectionList.Erase( iter );
+    }
+
+    FreeBuffer( (void *)( cs->m_CurrentMessage ) );
+    FDELETE cs;
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerCoordinator::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+{
+    keepMemory = true; // we'll take care of freeing the memory
+
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+    ASSERT( cs );
+
+    // are we expecting a msg, or the payload for a msg?
+    void * payload = nullptr;
+    size_t payloadSize = 0;
+    if ( cs->m_CurrentMessage == nullptr )
+    {
+        // message
+        cs->m_CurrentMessage = static_cast< const Protocol::IMessage * >( data );
+        if ( cs->m_CurrentMessage->HasPayload() )
+        {
+            return;
+        }
+    }
+    else
+    {
+        // payload
+        ASSERT( cs->m_CurrentMessage->HasPayload() );
+        payload = data;
+        payloadSize = size;
+    }
+
+    // determine message type
+    const Protocol::IMessage * imsg = cs->m_CurrentMessage;
+    const Protocol::MessageType messageType = imsg->GetType();
+
+    PROTOCOL_DEBUG( "Remote -> Coordinator : %u (%s)\n", messageType, GetProtocolMessageDebugName( messageType ) );
+
+    switch ( messageType )
+    {
+        case Protocol::MSG_WORKER_STATUS:
+        {
+            const Protocol::MsgWorkerStatus * msg = static_cast< const Protocol::MsgWorkerStatus * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_REQUEST_WORKERS:
+        {
+            const Protocol::MsgRequestWorkers * msg = static_cast< const Protocol::MsgRequestWorkers * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        default:
+        {
+            // unknown message type (not a worker or client)
+            Disconnect( connection );
+            break;
+        }
+    }
+
+    // free everything
+    FreeBuffer( (void *)( cs->m_CurrentMessage ) );
+    FreeBuffer( payload );
+    cs->m_CurrentMessage = nullptr;
+}
+
+// Process( MsgWorkerStatus )
+//------------------------------------------------------------------------------
+void WorkerCoordinator::Process( const ConnectionInfo * connection, const Protocol::MsgWorkerStatus * msg, const void * payload, size_t payloadSize )
+{
+    ConstMemoryStream ms( payload, payloadSize );
+    AStackString<> address;
+    Array< uint64_t > toolIds;
+    if ( ( ms.Read( address ) == false ) || ( ms.Read( toolIds ) == false ) )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    // Workers which can't determine their own address are reachable at
+    // the address they connected from
+    if ( address.IsEmpty() )
+    {
+        TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), address );
+    }
+
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+
+    MutexHolder mh( m_ConnectionListMutex );
+    cs->m_IsWorker = true;
+    cs->m_Address = address;
+    cs->m_ProtocolVersion = msg->GetProtocolVersion();
+    cs->m_Platform = msg->GetPlatform();
+    cs->m_NumCPUs = msg->GetNumCPUs();
+    cs->m_NumSlots = msg->GetNumSlots();
+    cs->m_NumFreeSlots = msg->GetNumFreeSlots();
+    cs->m_ToolIds.Swap( toolIds );
+    cs->m_LastStatusTimer.Start();
+}
+
+// Process( MsgRequestWorkers )
+//------------------------------------------------------------------------------
+void WorkerCoordinator::Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkers * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_FUNCTION;
+
+    ConstMemoryStream ms( payload, payloadSize );
+    Array< uint64_t > toolIds;
+    if ( ms.Read( toolIds ) == false )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    // Prefer workers which already have the toolchains (avoiding a
+    // synchronization), then those with the most free job slots
+    struct RankedWorker
+    {
+        bool operator < ( const RankedWorker & other ) const
+        {
+            if ( m_NumToolsCached != other.m_NumToolsCached )
+            {
+                return ( m_NumToolsCached > other.m_NumToolsCached );
+            }
+            if ( m_NumFreeSlots != other.m_NumFreeSlots )
+            {
+                return ( m_NumFreeSlots > other.m_NumFreeSlots );
+            }
+            return ( m_NumCPUs > other.m_NumCPUs );
+        }
+
+        const AString * m_Address;
+        uint32_t        m_NumToolsCached;
+        uint32_t        m_NumFreeSlots;
+        uint32_t        m_NumCPUs;
+    };
+
+    MemoryStream response;
+    {
+        MutexHolder mh( m_ConnectionListMutex );
+
+        Array< RankedWorker > workers( m_ConnectionList.GetSize(), false );
+        for ( const ConnectionState * cs : m_ConnectionList )
+        {
+            if ( ( cs->m_IsWorker == false ) ||
+                 ( cs->m_NumSlots == 0 ) ||
+                 ( cs->m_ProtocolVersion != msg->GetProtocolVersion() ) ||
+                 ( cs->m_Platform != msg->GetPlatform() ) ||
+                 ( cs->m_LastStatusTimer.GetElapsed() > sCoordinatorStatusTimeout ) )
+            {
+                continue;
+            }
+
+            RankedWorker rw;
+            rw.m_Address = &cs->m_Address;
+            rw.m_NumToolsCached = 0;
+            for ( const uint64_t toolId : toolIds )
+            {
+                rw.m_NumToolsCached += cs->m_ToolIds.Find( toolId ) ? 1 : 0;
+            }
+            rw.m_NumFreeSlots = cs->m_NumFreeSlots;
+            rw.m_NumCPUs = cs->m_NumCPUs;
+            workers.Append( rw );
+        }
+        workers.Sort();
+
+        response.Write( (uint32_t)workers.GetSize() );
+        for ( const RankedWorker & rw : workers )
+        {
+            response.Write( *rw.m_Address );
+        }
+    }
+
+    const Protocol::MsgWorkers reply;
+    reply.Send( connection, response );
+}
+
+// WorkerCoordinatorConnection (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+WorkerCoordinatorConnection::WorkerCoordinatorConnection( const AString & host, uint16_t port )
+    : m_Host( host )
+    , m_Port( port )
+{
+}
+
+// WorkerCoordinatorConnection (DESTRUCTOR)
+//------------------------------------------------------------------------------
+WorkerCoordinatorConnection::~WorkerCoordinatorConnection()
+{
+    ShutdownAllConnections();
+}
+
+// SendStatus
+//------------------------------------------------------------------------------
+bool WorkerCoordinatorConnection::SendStatus( const AString & address,
+                                              uint32_t numCPUs,
+                                              uint32_t numSlots,
+                                              uint32_t numFreeSlots,
+                                              const Array< uint64_t > & toolIds )
+{
+    MutexHolder mh( m_Mutex );
+    if ( EnsureConnected() == false )
+    {
+        return false;
+    }
+
+    MemoryStream ms;
+    ms.Write( address );
+    ms.Write( toolIds );
+
+    const Protocol::MsgWorkerStatus msg( (uint16_t)Math::Min( numCPUs, 0xFFFFu ),
+                                         (uint16_t)Math::Min( numSlots, 0xFFFFu ),
+                                         (uint16_t)Math::Min( numFreeSlots, 0xFFFFu ) );
+    return msg.Send( m_Connection, ms );
+}
+
+// FindWorkers
+//------------------------------------------------------------------------------
+bool WorkerCoordinatorConnection::FindWorkers( const Array< uint64_t > & toolIds, Array< AString > & outWorkers )
+{
+    PROFILE_FUNCTION;
+
+    {
+        MutexHolder mh( m_Mutex );
+        if ( EnsureConnected() == false )
+        {
+            return false;
+        }
+
+        MemoryStream ms;
+        ms.Write( toolIds );
+
+        // A response to an earlier request can arrive after it timed out,
+        // leaving the semaphore signalled
+        while ( m_ResponseSemaphore.Wait( 0 ) )
+        {
+        }
+        m_Workers.Clear();
+
+        m_ResponsePending = true;
+        m_ResponseReceived = false;
+        m_PendingRequestIndex = m_NumRequestsSent++;
+        const Protocol::MsgRequestWorkers msg;
+        if ( msg.Send( m_Connection, ms ) == false )
+        {
+            m_ResponsePending = false;
+            return false;
+        }
+    }
+
+    // Wait for the response (or disconnection)
+    m_ResponseSemaphore.Wait( sCoordinatorResponseTimeoutMS );
+
+    MutexHolder mh( m_Mutex );
+    m_ResponsePending = false;
+    if ( m_ResponseReceived == false )
+    {
+        FLOG_WARN( "No response from coordinator '%s:%u'", m_Host.Get(), m_Port );
+        return false;
+    }
+    outWorkers.Append( m_Workers );
+    m_Workers.Clear();
+    return true;
+}
+
+// EnsureConnected
+//------------------------------------------------------------------------------
+bool WorkerCoordinatorConnection::EnsureConnected()
+{
+    if ( m_Connection == nullptr )
+    {
+        m_Connection = Connect( m_Host, m_Port );
+    }
+    return ( m_Connection != nullptr );
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerCoordinatorConnection::OnDisconnected( const ConnectionInfo * /*connection*/ )
+{
+    MutexHolder mh( m_Mutex );
+    m_Connection = nullptr;
+    m_NumRequestsSent = 0;
+    m_NumResponsesReceived = 0;
+
+    FreeBuffer( (void *)m_CurrentMessage );
+    m_CurrentMessage = nullptr;
+
+    // Don't leave a request waiting for a response which won't arrive
+    if ( m_ResponsePending )
+    {
+        m_ResponsePending = false;
+        m_ResponseSemaphore.Signal();
+    }
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerCoordinatorConnection::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+{
+    // All messages from the coordinator have a payload
+    if ( m_CurrentMessage == nullptr )
+    {
+        keepMemory = true;
+        m_CurrentMessage = static_cast< const Protocol::IMessage * >( data );
+        return;
+    }
+
+    const Protocol::MessageType messageType = m_CurrentMessage->GetType();
+    FreeBuffer( (void *)m_CurrentMessage );
+    m_CurrentMessage = nullptr;
+
+    if ( messageType != Protocol::MSG_WORKERS )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    ConstMemoryStream ms( data, size );
+    Array< AString > workers;
+    const bool ok = ms.Read( workers );
+
+    // Ignore responses to earlier requests (which timed out)
+    MutexHolder mh( m_Mutex );
+    const uint32_t requestIndex = m_NumResponsesReceived++;
+    if ( ok && m_ResponsePending && ( requestIndex == m_PendingRequestIndex ) )
+    {
+        m_Workers.Swap( workers );
+        m_ResponseReceived = true;
+        m_ResponsePending = false;
+        m_ResponseSemaphore.Signal();
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,111 @@
+// WorkerCoordinator - Network service tracking available workers
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+namespace Protocol
+{
+    class IMessage;
+    class MsgRequestWorkers;
+    class MsgWorkerStatus;
+}
+
+// WorkerCoordinator
+//------------------------------------------------------------------------------
+// An alternative to finding workers through files in the brokerage path, which
+// becomes slow with many workers. Workers stay connected to the coordinator and
+// regularly report their free job slots and cached toolchains. Clients get the
+// available workers, ranked by suitability, in a single request.
+class WorkerCoordinator : public TCPConnectionPool
+{
+public:
+    WorkerCoordinator();
+    virtual ~WorkerCoordinator() override;
+
+    // Workers which have reported their status (available or not)
+    size_t GetNumWorkers() const;
+
+private:
+    // TCPConnection interface
+    virtual void OnConnected( const ConnectionInfo * connection ) override;
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    // helpers to handle messages
+    void Process( const ConnectionInfo * connection, const Protocol::MsgWorkerStatus * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkers * msg, const void * payload, size_t payloadSize );
+
+    struct ConnectionState
+    {
+        const Protocol::IMessage * m_CurrentMessage = nullptr;
+
+        // Last status reported by a worker (protected by m_ConnectionListMutex)
+        bool                m_IsWorker = false;
+        AString             m_Address;
+        uint32_t            m_ProtocolVersion = 0;
+        uint8_t             m_Platform = 0;
+        uint16_t            m_NumCPUs = 0;
+        uint16_t            m_NumSlots = 0;
+        uint16_t            m_NumFreeSlots = 0;
+        Array< uint64_t >   m_ToolIds;
+        Timer               m_LastStatusTimer;
+    };
+
+    mutable Mutex               m_ConnectionListMutex;
+    Array< ConnectionState * >  m_ConnectionList;
+};
+
+// WorkerCoordinatorConnection
+//------------------------------------------------------------------------------
+// Connection to a WorkerCoordinator, made on demand.
+class WorkerCoordinatorConnection : public TCPConnectionPool
+{
+public:
+    WorkerCoordinatorConnection( const AString & host, uint16_t port );
+    virtual ~WorkerCoordinatorConnection() override;
+
+    // Workers: report status (numSlots is 0 when not available)
+    bool SendStatus( const AString & address,
+                     uint32_t numCPUs,
+                     uint32_t numSlots,
+                     uint32_t numFreeSlots,
+                     const Array< uint64_t > & toolIds );
+
+    // Clients: get available workers, most suitable first
+    bool FindWorkers( const Array< uint64_t > & toolIds, Array< AString > & outWorkers );
+
+private:
+    // TCPConnection interface
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    // Must be called with m_Mutex held
+    bool EnsureConnected();
+
+    AString                     m_Host;
+    uint16_t                    m_Port;
+
+    Mutex                       m_Mutex;
+    const ConnectionInfo *      m_Connection = nullptr;
+    const Protocol::IMessage *  m_CurrentMessage = nullptr;
+    Semaphore                   m_ResponseSemaphore;
+    bool                        m_ResponsePending = false;
+    bool                        m_ResponseReceived = false;
+    uint32_t                    m_NumRequestsSent = 0;      // On this connection, which the coordinator
+    uint32_t                    m_NumResponsesReceived = 0; // answers in order
+    uint32_t                    m_PendingRequestIndex = 0;
+    Array< AString >            m_Workers;
+};
+
+//------------------------------------------------------------------------------
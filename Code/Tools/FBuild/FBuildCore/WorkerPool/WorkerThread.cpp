@@ -23,8 +23,12 @@
 // Static
 //------------------------------------------------------------------------------
 static THREAD_LOCAL uint16_t s_WorkerThreadThreadIndex = 0;
+static THREAD_LOCAL bool s_WorkerThreadUseMemoryTmpDir = false;
 Mutex WorkerThread::s_TmpRootMutex;
 AStackString<> WorkerThread::s_TmpRoot;
+AStackString<> WorkerThread::s_MemoryTmpRoot;
+uint64_t WorkerThread::s_MemoryTmpSize( 0 );
+Atomic<uint64_t> WorkerThread::s_MemoryTmpUsed( 0 );
 
 //------------------------------------------------------------------------------
 WorkerThread::WorkerThread( uint16_t threadIndex )
@@ -74,6 +78,68 @@ WorkerThread::~WorkerThread()
     s_TmpRoot = tmpDirPath;
 }
 
+// InitMemoryTmpDir
+//------------------------------------------------------------------------------
+/*static*/ void WorkerThread::InitMemoryTmpDir( const AString & path, uint32_t sizeMiB )
+{
+    PROFILE_FUNCTION;
+
+    AStackString<> tmpDirPath( path );
+    PathUtils::EnsureTrailingSlash( tmpDirPath );
+    #if defined( __WINDOWS__ )
+        tmpDirPath += ".fbuild.tmp\\";
+    #else
+        tmpDirPath += "_fbuild.tmp/";
+    #endif
+    if ( FileIO::EnsurePathExists( tmpDirPath ) == false )
+    {
+        FLOG_WARN( "Failed to create scratch dir '%s'", tmpDirPath.Get() );
+        return;
+    }
+
+    MutexHolder lock( s_TmpRootMutex );
+    s_MemoryTmpRoot = tmpDirPath;
+    s_MemoryTmpSize = ( (uint64_t)sizeMiB * MEGABYTE );
+}
+
+// ReserveMemoryTmpDir
+//------------------------------------------------------------------------------
+/*static*/ bool WorkerThread::ReserveMemoryTmpDir( uint64_t size )
+{
+    ASSERT( s_WorkerThreadUseMemoryTmpDir == false );
+    if ( s_MemoryTmpSize == 0 )
+    {
+        return false;
+    }
+
+    // Jobs which won't fit (alone, or alongside those already running) use
+    // the regular temp dir instead
+    if ( s_MemoryTmpUsed.Add( size ) > s_MemoryTmpSize )
+    {
+        s_MemoryTmpUsed.Sub( size );
+        return false;
+    }
+
+    s_WorkerThreadUseMemoryTmpDir = true;
+    CreateThreadLocalTmpDir();
+    return true;
+}
+
+// EndMemoryTmpDir
+//------------------------------------------------------------------------------
+/*static*/ void WorkerThread::EndMemoryTmpDir()
+{
+    s_WorkerThreadUseMemoryTmpDir = false;
+}
+
+// ReleaseMemoryTmpDir
+//------------------------------------------------------------------------------
+/*static*/ void WorkerThread::ReleaseMemoryTmpDir( uint64_t size )
+{
+    ASSERT( s_MemoryTmpUsed.Load() >= size );
+    s_MemoryTmpUsed.Sub( size );
+}
+
 // Stop
 //------------------------------------------------------------------------------
 void WorkerThread::Stop()
@@ -235,7 +301,8 @@ void WorkerThread::WaitForStop()
 
     MutexHolder lock( s_TmpRootMutex );
     ASSERT( !s_TmpRoot.IsEmpty() );
-    tmpFileDirectory.Format( "%score_%u%c", s_TmpRoot.Get(), threadIndex, NATIVE_SLASH );
+    const AString & root = s_WorkerThreadUseMemoryTmpDir ? s_MemoryTmpRoot : s_TmpRoot;
+    tmpFileDirectory.Format( "%score_%u%c", root.Get(), threadIndex, NATIVE_SLASH );
 }
 
 // CreateTempFile
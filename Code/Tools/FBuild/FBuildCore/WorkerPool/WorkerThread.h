@@ -40,6 +40,15 @@ public:
     static bool CreateTempFile( const AString & tmpFileName,
                                 FileStream & file );
     static void CreateThreadLocalTmpDir();
+
+    // Remote jobs can use scratch space on a memory-backed filesystem (such
+    // as tmpfs) instead of the temp dir, while the space they're expected to
+    // need fits within the given size (a size of 0 disables it)
+    static void     InitMemoryTmpDir( const AString & path, uint32_t sizeMiB );
+    static bool     ReserveMemoryTmpDir( uint64_t size ); // If true, used by the calling thread until EndMemoryTmpDir
+    static void     EndMemoryTmpDir();
+    static void     ReleaseMemoryTmpDir( uint64_t size ); // Once files written to it are no longer needed
+    static uint64_t GetMemoryTmpDirUsage() { return s_MemoryTmpUsed.Load(); }
 protected:
     // allow update from the main thread when in -j0 mode
     friend class FBuild;
@@ -57,6 +66,9 @@ protected:
 
     static Mutex s_TmpRootMutex; // s_TmpRoot is shared by local and remote queues in tests
     static AStackString<> s_TmpRoot;
+    static AStackString<> s_MemoryTmpRoot;      // Protected by s_TmpRootMutex
+    static uint64_t s_MemoryTmpSize;            // 0 if not in use
+    static Atomic<uint64_t> s_MemoryTmpUsed;    // Reserved by jobs
 };
 
 //------------------------------------------------------------------------------
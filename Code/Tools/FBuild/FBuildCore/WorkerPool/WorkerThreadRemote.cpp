@@ -10,6 +10,8 @@
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderBundle.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
 
@@ -17,6 +19,13 @@
 #include "Core/Process/Thread.h"
 #include "Core/Time/Timer.h"
 
+// Defines
+//------------------------------------------------------------------------------
+// Scratch space a job is expected to need, relative to its input (which is
+// written out, along with outputs such as objects with debug info)
+#define WORKER_SCRATCH_SIZE_FACTOR 4
+#define WORKER_SCRATCH_SIZE_MIN ( 4 * MEGABYTE )
+
 // Static
 //------------------------------------------------------------------------------
 /*static*/ uint32_t WorkerThreadRemote::s_NumCPUsToUse( 999 ); // no limit
@@ -55,10 +64,20 @@ WorkerThreadRemote::~WorkerThreadRemote()
                 m_CurrentJob = job;
             }
 
+            // Use memory-backed scratch space if there's room for the job (kept
+            // until the job is deleted, as results might be streamed from it)
+            const uint64_t scratchSize = EstimateScratchSize( *job );
+            if ( WorkerThread::ReserveMemoryTmpDir( scratchSize ) )
+            {
+                job->SetMemoryTmpReservation( scratchSize );
+            }
+
             // process the work
             const Node::BuildResult result = JobQueueRemote::DoBuild( job, false );
             ASSERT( ( result == Node::NODE_RESULT_OK ) || ( result == Node::NODE_RESULT_FAILED ) );
 
+            WorkerThread::EndMemoryTmpDir();
+
             {
                 MutexHolder mh( m_CurrentJobMutex );
                 m_CurrentJob = nullptr;
@@ -79,6 +98,29 @@ WorkerThreadRemote::~WorkerThreadRemote()
     m_MainThreadWaitForExit.Signal();
 }
 
+// EstimateScratchSize
+//------------------------------------------------------------------------------
+/*static*/ uint64_t WorkerThreadRemote::EstimateScratchSize( const Job & job )
+{
+    uint64_t inputSize = job.GetDataSize();
+    if ( job.IsDataCompressed() )
+    {
+        inputSize = Compressor::GetUncompressedSize( job.GetData(), job.GetDataSize() );
+    }
+
+    // Header bundles only hold the source, but the headers are copied from the
+    // store into the sandbox (in the temp dir) as well
+    if ( job.IsHeaderBundle() )
+    {
+        HeaderBundle bundle;
+        if ( bundle.Load( job ) )
+        {
+            inputSize = bundle.GetExtractedSize( JobQueueRemote::Get().GetHeaderFileStore() );
+        }
+    }
+    return Math::Max< uint64_t >( inputSize * WORKER_SCRATCH_SIZE_FACTOR, WORKER_SCRATCH_SIZE_MIN );
+}
+
 // GetStatus
 //------------------------------------------------------------------------------
 void WorkerThreadRemote::GetStatus( AString & hostName, AString & status, bool & isIdle ) const
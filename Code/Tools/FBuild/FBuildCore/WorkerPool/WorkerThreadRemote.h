@@ -28,6 +28,7 @@ private:
     virtual void Main() override;
 
     bool IsEnabled() const;
+    static uint64_t EstimateScratchSize( const Job & job );
 
     mutable Mutex m_CurrentJobMutex;
     Job * m_CurrentJob;
@@ -0,0 +1,6 @@
+#include "file.h"
+
+int Function()
+{
+    return FILE_H_VALUE;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#define FILE_H_VALUE 1
@@ -0,0 +1,7 @@
+#include <stdio.h>
+
+int main( int, char *[] )
+{
+    printf( "Output from ExecAndTest\n" );
+    return 0;
+}
@@ -0,0 +1,4 @@
+int Function()
+{
+    return 0;
+}
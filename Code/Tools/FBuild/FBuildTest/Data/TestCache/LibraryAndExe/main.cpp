@@ -0,0 +1,6 @@
+int Function();
+
+int main( int, char *[] )
+{
+    return Function();
+}
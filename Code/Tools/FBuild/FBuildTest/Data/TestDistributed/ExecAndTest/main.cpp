@@ -0,0 +1,24 @@
+// main.cpp - Print the contents of the files passed on the command line
+//------------------------------------------------------------------------------
+#include <stdio.h>
+
+int main( int argc, char ** argv )
+{
+    for ( int i = 1; i < argc; ++i )
+    {
+        FILE * f = fopen( argv[ i ], "rb" );
+        if ( f == nullptr )
+        {
+            printf( "Failed to open '%s'\n", argv[ i ] );
+            return 1;
+        }
+        char buffer[ 256 ];
+        size_t len;
+        while ( ( len = fread( buffer, 1, sizeof( buffer ), f ) ) > 0 )
+        {
+            fwrite( buffer, 1, len, stdout );
+        }
+        fclose( f );
+    }
+    return 0;
+}
@@ -0,0 +1,7 @@
+#include "File.h"
+#include <Other.h>
+
+int Function()
+{
+    return FILE_H_VALUE + OTHER_H_VALUE;
+}
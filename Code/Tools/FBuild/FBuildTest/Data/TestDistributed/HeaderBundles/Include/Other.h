@@ -0,0 +1,3 @@
+#pragma once
+
+#define OTHER_H_VALUE 2
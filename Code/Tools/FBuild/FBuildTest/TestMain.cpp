@@ -21,6 +21,7 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestCompiler )
     REGISTER_TESTGROUP( TestCompressor )
     REGISTER_TESTGROUP( TestCopy )
+    REGISTER_TESTGROUP( TestCPUPlacement )
     REGISTER_TESTGROUP( TestDependencies )
     REGISTER_TESTGROUP( TestDistributed )
     REGISTER_TESTGROUP( TestDLL )
@@ -38,6 +39,7 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestObject )
     REGISTER_TESTGROUP( TestObjectList )
     REGISTER_TESTGROUP( TestPrecompiledHeaders )
+    REGISTER_TESTGROUP( TestProcFS )
     REGISTER_TESTGROUP( TestProjectGeneration )
     REGISTER_TESTGROUP( TestRemoveDir )
     REGISTER_TESTGROUP( TestTest )
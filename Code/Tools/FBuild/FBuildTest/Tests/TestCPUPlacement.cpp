@@ -0,0 +1,175 @@
+// TestCPUPlacement.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/CPUPlacement.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Env.h"
+
+// TestCPUPlacement
+//------------------------------------------------------------------------------
+class TestCPUPlacement : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void ParseCPUList() const;
+    void DetectTopology() const;
+    void BalanceDomains() const;
+    void SpreadMemoryHeavyJobs() const;
+
+    static void MakeCPUs( uint32_t first, uint32_t count, Array<uint32_t> & outCPUs );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestCPUPlacement )
+    REGISTER_TEST( ParseCPUList )
+    REGISTER_TEST( DetectTopology )
+    REGISTER_TEST( BalanceDomains )
+    REGISTER_TEST( SpreadMemoryHeavyJobs )
+REGISTER_TESTS_END
+
+// ParseCPUList
+//------------------------------------------------------------------------------
+void TestCPUPlacement::ParseCPUList() const
+{
+    Array<uint32_t> cpus;
+
+    // Single CPU
+    TEST_ASSERT( CPUPlacement::ParseCPUList( "3\n", cpus ) );
+    TEST_ASSERT( ( cpus.GetSize() == 1 ) && ( cpus[ 0 ] == 3 ) );
+
+    // Ranges and single CPUs
+    TEST_ASSERT( CPUPlacement::ParseCPUList( "0-3,8,10-11", cpus ) );
+    TEST_ASSERT( cpus.GetSize() == 7 );
+    TEST_ASSERT( ( cpus[ 0 ] == 0 ) && ( cpus[ 3 ] == 3 ) && ( cpus[ 4 ] == 8 ) && ( cpus[ 6 ] == 11 ) );
+
+    // Empty (e.g. a memory-only node)
+    TEST_ASSERT( CPUPlacement::ParseCPUList( "\n", cpus ) );
+    TEST_ASSERT( cpus.IsEmpty() );
+
+    // Invalid
+    TEST_ASSERT( CPUPlacement::ParseCPUList( "0-", cpus ) == false );
+    TEST_ASSERT( CPUPlacement::ParseCPUList( "3-1", cpus ) == false );
+    TEST_ASSERT( CPUPlacement::ParseCPUList( "0,,1", cpus ) == false );
+    TEST_ASSERT( CPUPlacement::ParseCPUList( "a", cpus ) == false );
+}
+
+// DetectTopology
+//------------------------------------------------------------------------------
+void TestCPUPlacement::DetectTopology() const
+{
+    CPUPlacement placement;
+    placement.DetectTopology();
+
+    #if defined( __LINUX__ )
+        // Every CPU we can run on is in exactly one domain
+        TEST_ASSERT( placement.GetNumDomains() > 0 );
+        TEST_ASSERT( placement.GetNumNodes() > 0 );
+        Array<uint32_t> seen;
+        for ( uint32_t i = 0; i < placement.GetNumDomains(); ++i )
+        {
+            for ( const uint32_t cpu : placement.GetDomainCPUs( i ) )
+            {
+                TEST_ASSERT( seen.Find( cpu ) == nullptr );
+                seen.Append( cpu );
+            }
+        }
+        TEST_ASSERT( seen.GetSize() <= Env::GetNumProcessors() );
+    #endif
+}
+
+// BalanceDomains
+//------------------------------------------------------------------------------
+void TestCPUPlacement::BalanceDomains() const
+{
+    // Two nodes, the first with two L3 domains
+    Array<uint32_t> cpus;
+    CPUPlacement placement;
+    MakeCPUs( 0, 4, cpus );
+    placement.AddDomain( 0, cpus );
+    MakeCPUs( 4, 4, cpus );
+    placement.AddDomain( 0, cpus );
+    MakeCPUs( 8, 8, cpus );
+    placement.AddDomain( 1, cpus );
+    TEST_ASSERT( placement.GetNumDomains() == 3 );
+    TEST_ASSERT( placement.GetNumNodes() == 2 );
+    TEST_ASSERT( placement.GetDomainNodeId( 2 ) == 1 );
+
+    // Jobs are spread relative to the size of each domain
+    uint32_t jobsPerDomain[ 3 ] = { 0, 0, 0 };
+    Array<uint32_t> acquired;
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        const uint32_t domain = placement.Acquire( false );
+        ++jobsPerDomain[ domain ];
+        acquired.Append( domain );
+    }
+    TEST_ASSERT( jobsPerDomain[ 0 ] == 4 );
+    TEST_ASSERT( jobsPerDomain[ 1 ] == 4 );
+    TEST_ASSERT( jobsPerDomain[ 2 ] == 8 );
+
+    uint16_t utilization[ CPUPlacement::kMaxReportedNodes ];
+    TEST_ASSERT( placement.GetNodeUtilization( utilization, CPUPlacement::kMaxReportedNodes ) == 2 );
+    TEST_ASSERT( ( utilization[ 0 ] == 100 ) && ( utilization[ 1 ] == 100 ) );
+
+    // Released slots are reused
+    placement.Release( 1, false );
+    TEST_ASSERT( placement.Acquire( false ) == 1 );
+
+    for ( const uint32_t domain : acquired )
+    {
+        placement.Release( domain, false );
+    }
+    TEST_ASSERT( placement.GetNodeUtilization( utilization, CPUPlacement::kMaxReportedNodes ) == 2 );
+    TEST_ASSERT( ( utilization[ 0 ] == 0 ) && ( utilization[ 1 ] == 0 ) );
+}
+
+// SpreadMemoryHeavyJobs
+//------------------------------------------------------------------------------
+void TestCPUPlacement::SpreadMemoryHeavyJobs() const
+{
+    // Two equal nodes
+    Array<uint32_t> cpus;
+    CPUPlacement placement;
+    MakeCPUs( 0, 4, cpus );
+    placement.AddDomain( 0, cpus );
+    MakeCPUs( 4, 4, cpus );
+    placement.AddDomain( 1, cpus );
+
+    // Load the first node with more light jobs
+    const uint32_t light1 = placement.Acquire( false );
+    const uint32_t light2 = placement.Acquire( false );
+    const uint32_t light3 = placement.Acquire( false );
+    TEST_ASSERT( placement.GetDomainNodeId( light1 ) != placement.GetDomainNodeId( light2 ) );
+
+    // Heavy jobs alternate between nodes, regardless of light jobs
+    const uint32_t heavy1 = placement.Acquire( true );
+    const uint32_t heavy2 = placement.Acquire( true );
+    TEST_ASSERT( placement.GetDomainNodeId( heavy1 ) != placement.GetDomainNodeId( heavy2 ) );
+
+    placement.Release( heavy1, true );
+    placement.Release( heavy2, true );
+    placement.Release( light1, false );
+    placement.Release( light2, false );
+    placement.Release( light3, false );
+}
+
+// MakeCPUs
+//------------------------------------------------------------------------------
+/*static*/ void TestCPUPlacement::MakeCPUs( uint32_t first, uint32_t count, Array<uint32_t> & outCPUs )
+{
+    outCPUs.Clear();
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        outCPUs.Append( first + i );
+    }
+}
+
+//------------------------------------------------------------------------------
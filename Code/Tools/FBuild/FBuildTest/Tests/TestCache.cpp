@@ -6,15 +6,23 @@
 #include "FBuildTest.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheDictionaries.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 // Core
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/Random.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// system
+#include <memory.h>
 
 // TestCache
 //------------------------------------------------------------------------------
@@ -27,6 +35,13 @@ private:
     void Read() const;
     void ReadWrite() const;
     void ConsistentCacheKeysWithDist() const;
+    void Diagnostics() const;
+    void Dictionary() const;
+    void Chunked() const;
+    void ChunkedCompressed() const;
+    void Uncompressed() const;
+    void LibraryAndExe() const;
+    void ExecAndTest() const;
 
     void LightCache_IncludeUsingMacro() const;
     void LightCache_IncludeUsingMacro2() const;
@@ -54,6 +69,7 @@ private:
     void ExtraFiles_GCNO() const;
 
     // Helpers
+    static void MakeChunksOld( const AString & cachePath );
     void CheckForDependencies( const FBuildForTest & fBuild, const char * const files[], size_t numFiles ) const;
     void LightCache_IncludeUsingUndefinedMacros( const char * consfigFile,
                                                  bool expectedBuildResult,
@@ -70,6 +86,13 @@ REGISTER_TESTS_BEGIN( TestCache )
     REGISTER_TEST( Read )
     REGISTER_TEST( ReadWrite )
     REGISTER_TEST( ConsistentCacheKeysWithDist )
+    REGISTER_TEST( Diagnostics )
+    REGISTER_TEST( Dictionary )
+    REGISTER_TEST( Chunked )
+    REGISTER_TEST( ChunkedCompressed )
+    REGISTER_TEST( Uncompressed )
+    REGISTER_TEST( LibraryAndExe )
+    REGISTER_TEST( ExecAndTest )
     REGISTER_TEST( ExtraFiles_GCNO )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( ExtraFiles_NativeCodeAnalysisXML )
@@ -336,6 +359,450 @@ void TestCache::ConsistentCacheKeysWithDist() const
     TEST_ASSERT( storeKey == hitKey );
 }
 
+// Diagnostics
+//------------------------------------------------------------------------------
+void TestCache::Diagnostics() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+
+    // Write with diagnostic records
+    {
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Diagnostics/fbuild.bff";
+        options.m_UseCacheWrite = true;
+        options.m_CacheDiagnostics = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "Diagnostics" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+    }
+
+    // Build with modified args, explaining the miss
+    {
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Diagnostics/fbuild_changed.bff";
+        options.m_UseCacheWrite = false;
+        options.m_CacheDiagnostics = false;
+        options.m_UseCacheRead = true;
+        options.m_CacheDiagnose = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "Diagnostics" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 0 );
+    }
+
+    // Check the miss was attributed to the args
+    const AString & output = GetRecordedOutput();
+    TEST_ASSERT( output.Find( "Cache Miss Diagnosis" ) );
+    TEST_ASSERT( output.Find( " - Source     : Same" ) );
+    TEST_ASSERT( output.Find( " - Args       : DIFFERENT" ) );
+    TEST_ASSERT( output.Find( "   - Only Local  : -DCACHE_DIAGNOSTICS_CHANGED" ) );
+    TEST_ASSERT( output.Find( " - Toolchain  : Same" ) );
+}
+
+// Dictionary
+//------------------------------------------------------------------------------
+void TestCache::Dictionary() const
+{
+    // Generate enough objects for a dictionary to be built
+    const uint32_t numFiles = ( CacheDictionaries::kNumTrainingSamples + 8 );
+    const char * const inputPath = "../tmp/Test/Cache/Dictionary/Input/";
+    EnsureDirExists( inputPath );
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        AStackString<> fileName;
+        AStackString<> fileContents;
+        fileName.Format( "%sfile%u.cpp", inputPath, i );
+        fileContents.Format( "int Function%u() { return %u; }\n", i, i );
+        MakeFile( fileName.Get(), fileContents.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Dictionary/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_CacheDictionary = true;
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "Dictionary" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == numFiles );
+    }
+
+    // Read
+    {
+        options.m_UseCacheWrite = false;
+        options.m_UseCacheRead = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "Dictionary" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == numFiles );
+    }
+
+    // Check some entries were compressed with a dictionary (which could have
+    // been built by this test, or a previous run)
+    const AString & output = GetRecordedOutput();
+    TEST_ASSERT( output.Find( "Cache Dictionary Loaded" ) );
+    TEST_ASSERT( output.Find( " - Dictionary: " ) );
+}
+
+// Chunked
+//------------------------------------------------------------------------------
+void TestCache::Chunked() const
+{
+    // Start with an empty cache
+    const AStackString<> cachePathStr( "../tmp/Test/Cache/Chunked/Cache/" );
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( cachePathStr, nullptr, true, &files );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        EnsureFileDoesNotExist( file.m_Name.Get() );
+    }
+
+    // Two entries, the second a near-duplicate of the first
+    const size_t dataSize = ( 512 * 1024 );
+    Array< uint8_t > dataA( dataSize );
+    Random random( 1234 );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        dataA.Append( (uint8_t)random.GetRand() );
+    }
+    Array< uint8_t > dataB( dataA );
+    for ( size_t i = ( dataSize / 2 ); i < ( ( dataSize / 2 ) + 100 ); ++i )
+    {
+        dataB[ i ] = (uint8_t)~dataB[ i ];
+    }
+    const AStackString<> idA( "AAAA0001" );
+    const AStackString<> idB( "BBBB0002" );
+
+    Array< AString > chunkPattern;
+    chunkPattern.EmplaceBack( "*.chunk" );
+
+    Cache cache( true ); // Chunked
+    TEST_ASSERT( cache.Init( cachePathStr, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Store the first entry
+    TEST_ASSERT( cache.Publish( idA, dataA.Begin(), dataA.GetSize() ) );
+    files.Clear();
+    FileIO::GetFilesEx( cachePathStr, &chunkPattern, true, &files );
+    const size_t numChunksA = files.GetSize();
+    TEST_ASSERT( numChunksA > 1 );
+
+    // Store the second, which should share most chunks with the first
+    TEST_ASSERT( cache.Publish( idB, dataB.Begin(), dataB.GetSize() ) );
+    files.Clear();
+    FileIO::GetFilesEx( cachePathStr, &chunkPattern, true, &files );
+    TEST_ASSERT( files.GetSize() > numChunksA );
+    TEST_ASSERT( files.GetSize() <= ( numChunksA + 3 ) );
+
+    // Both entries can be retrieved intact, including by a non-chunked cache
+    Cache plainCache;
+    TEST_ASSERT( plainCache.Init( cachePathStr, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+    ICache * const caches[] = { &cache, &plainCache };
+    for ( ICache * c : caches )
+    {
+        void * data = nullptr;
+        size_t size = 0;
+        TEST_ASSERT( c->Retrieve( idA, data, size ) );
+        TEST_ASSERT( ( size == dataSize ) && ( memcmp( data, dataA.Begin(), dataSize ) == 0 ) );
+        c->FreeMemory( data, size );
+        TEST_ASSERT( c->Retrieve( idB, data, size ) );
+        TEST_ASSERT( ( size == dataSize ) && ( memcmp( data, dataB.Begin(), dataSize ) == 0 ) );
+        c->FreeMemory( data, size );
+    }
+
+    // Trimming removes entries along with the chunks they reference
+    MakeChunksOld( cachePathStr );
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    files.Clear();
+    FileIO::GetFilesEx( cachePathStr, nullptr, true, &files );
+    TEST_ASSERT( files.IsEmpty() );
+    void * data = nullptr;
+    size_t size = 0;
+    TEST_ASSERT( cache.Retrieve( idA, data, size ) == false );
+
+    // Recently used chunks are kept, as an entry published during the Trim may need them
+    TEST_ASSERT( cache.Publish( idA, dataA.Begin(), dataA.GetSize() ) );
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    TEST_ASSERT( cache.Retrieve( idA, data, size ) == false );
+    files.Clear();
+    FileIO::GetFilesEx( cachePathStr, &chunkPattern, true, &files );
+    TEST_ASSERT( files.GetSize() == numChunksA );
+
+    // Until they are old enough
+    MakeChunksOld( cachePathStr );
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    files.Clear();
+    FileIO::GetFilesEx( cachePathStr, nullptr, true, &files );
+    TEST_ASSERT( files.IsEmpty() );
+}
+
+// ChunkedCompressed
+//------------------------------------------------------------------------------
+void TestCache::ChunkedCompressed() const
+{
+    // Start with an empty cache
+    const AStackString<> cachePathStr( "../tmp/Test/Cache/ChunkedCompressed/Cache/" );
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( cachePathStr, nullptr, true, &files );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        EnsureFileDoesNotExist( file.m_Name.Get() );
+    }
+
+    // Two compressible payloads, the second a near-duplicate of the first
+    const char * const words[] = { "mov ", "push ", "pop ", "call ", "ret\n", "rax, ", "rbx, ", "[rsp+8] ", "lea ", "jmp " };
+    const size_t dataSize = ( 512 * 1024 );
+    Array< uint8_t > dataA( dataSize );
+    Random random( 5678 );
+    while ( dataA.GetSize() < dataSize )
+    {
+        const char * word = words[ random.GetRandIndex( (uint32_t)( sizeof( words ) / sizeof( words[ 0 ] ) ) ) ];
+        for ( const char * c = word; *c && ( dataA.GetSize() < dataSize ); ++c )
+        {
+            dataA.Append( (uint8_t)*c );
+        }
+    }
+    Array< uint8_t > dataB( dataA );
+    for ( size_t i = ( dataSize / 2 ); i < ( ( dataSize / 2 ) + 100 ); ++i )
+    {
+        dataB[ i ] = (uint8_t)~dataB[ i ];
+    }
+
+    // Entries are stored compressed, as the cache normally receives them
+    Compressor compressedA;
+    Compressor compressedB;
+    TEST_ASSERT( compressedA.Compress( dataA.Begin(), dataSize ) );
+    TEST_ASSERT( compressedB.Compress( dataB.Begin(), dataSize ) );
+    const AStackString<> idA( "CCCC0003" );
+    const AStackString<> idB( "DDDD0004" );
+
+    Array< AString > chunkPattern;
+    chunkPattern.EmplaceBack( "*.chunk" );
+
+    Cache cache( true ); // Chunked
+    TEST_ASSERT( cache.Init( cachePathStr, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Store the first entry. Chunks are compressed.
+    TEST_ASSERT( cache.Publish( idA, compressedA.GetResult(), compressedA.GetResultSize() ) );
+    files.Clear();
+    FileIO::GetFilesEx( cachePathStr, &chunkPattern, true, &files );
+    const size_t numChunksA = files.GetSize();
+    TEST_ASSERT( numChunksA > 1 );
+    uint64_t chunksSize = 0;
+    for ( const FileIO::FileInfo & file : files )
+    {
+        chunksSize += file.m_Size;
+    }
+    TEST_ASSERT( chunksSize < ( ( dataSize * 3 ) / 4 ) );
+
+    // The second shares most chunks with the first, even though the compressed
+    // data differs from the point of the change onwards
+    TEST_ASSERT( cache.Publish( idB, compressedB.GetResult(), compressedB.GetResultSize() ) );
+    files.Clear();
+    FileIO::GetFilesEx( cachePathStr, &chunkPattern, true, &files );
+    TEST_ASSERT( files.GetSize() > numChunksA );
+    TEST_ASSERT( files.GetSize() <= ( numChunksA + 3 ) );
+
+    // Both entries are retrieved as data which decompresses to the original payload
+    const Array< uint8_t > * const payloads[] = { &dataA, &dataB };
+    const AString * const ids[] = { &idA, &idB };
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        void * data = nullptr;
+        size_t size = 0;
+        TEST_ASSERT( cache.Retrieve( *ids[ i ], data, size ) );
+        TEST_ASSERT( Compressor::IsValidData( data, size ) );
+        Compressor c;
+        TEST_ASSERT( c.Decompress( data ) );
+        TEST_ASSERT( ( c.GetResultSize() == dataSize ) && ( memcmp( c.GetResult(), payloads[ i ]->Begin(), dataSize ) == 0 ) );
+        cache.FreeMemory( data, size );
+    }
+
+    MakeChunksOld( cachePathStr );
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+}
+
+// MakeChunksOld
+//------------------------------------------------------------------------------
+/*static*/ void TestCache::MakeChunksOld( const AString & cachePath )
+{
+    // Older than the time unreferenced chunks are kept for
+    #if defined( __WINDOWS__ )
+        const uint64_t twoHours = ( 2 * 60 * 60 * (uint64_t)10000000 );
+    #else
+        const uint64_t twoHours = ( 2 * 60 * 60 * (uint64_t)1000000000 );
+    #endif
+    const uint64_t oldTime = ( Time::GetCurrentFileTime() - twoHours );
+
+    Array< AString > chunkPattern;
+    chunkPattern.EmplaceBack( "*.chunk" );
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( cachePath, &chunkPattern, true, &files );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( file.m_Name, oldTime ) );
+    }
+}
+
+// Uncompressed
+//------------------------------------------------------------------------------
+void TestCache::Uncompressed() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Uncompressed/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_CacheCompressionLevel = 0; // Test objects are too small for -cacheuncompressed
+
+    const char * const objFile = "../tmp/Test/Cache/Uncompressed/file.o";
+    AString objWritten;
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "Uncompressed" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+        LoadFileContentsAsString( objFile, objWritten );
+    }
+
+    // Read
+    {
+        options.m_UseCacheWrite = false;
+        options.m_UseCacheRead = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "Uncompressed" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 1 );
+    }
+
+    // Check the object was copied directly from the cache, intact
+    TEST_ASSERT( GetRecordedOutput().Find( " - Cache Hit: " ) );
+    TEST_ASSERT( GetRecordedOutput().Find( " (Copy) " ) );
+    AString objRead;
+    LoadFileContentsAsString( objFile, objRead );
+    TEST_ASSERT( objRead.IsEmpty() == false );
+    TEST_ASSERT( ( objRead.GetLength() == objWritten.GetLength() ) && ( memcmp( objRead.Get(), objWritten.Get(), objRead.GetLength() ) == 0 ) );
+}
+
+// LibraryAndExe
+//------------------------------------------------------------------------------
+void TestCache::LibraryAndExe() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/LibraryAndExe/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+
+    const char * const exeFile = "../tmp/Test/Cache/LibraryAndExe/main.exe";
+    AString exeWritten;
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "LibraryAndExe" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::LIBRARY_NODE ).m_NumCacheStores == 1 );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::EXE_NODE ).m_NumCacheStores == 1 );
+        LoadFileContentsAsString( exeFile, exeWritten );
+    }
+
+    // Read
+    {
+        options.m_UseCacheWrite = false;
+        options.m_UseCacheRead = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "LibraryAndExe" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::LIBRARY_NODE ).m_NumCacheHits == 1 );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::EXE_NODE ).m_NumCacheHits == 1 );
+    }
+
+    // Check the executable was retrieved intact
+    AString exeRead;
+    LoadFileContentsAsString( exeFile, exeRead );
+    TEST_ASSERT( exeRead.IsEmpty() == false );
+    TEST_ASSERT( ( exeRead.GetLength() == exeWritten.GetLength() ) && ( memcmp( exeRead.Get(), exeWritten.Get(), exeRead.GetLength() ) == 0 ) );
+}
+
+// ExecAndTest
+//------------------------------------------------------------------------------
+void TestCache::ExecAndTest() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/ExecAndTest/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+
+    const char * const execOutput = "../tmp/Test/Cache/ExecAndTest/exec.stdout";
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ExecAndTest" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::EXEC_NODE ).m_NumCacheStores == 1 );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::TEST_NODE ).m_NumCacheStores == 1 );
+    }
+
+    EnsureFileDoesNotExist( execOutput );
+
+    // Read
+    {
+        options.m_UseCacheWrite = false;
+        options.m_UseCacheRead = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ExecAndTest" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::EXEC_NODE ).m_NumCacheHits == 1 );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::TEST_NODE ).m_NumCacheHits == 1 );
+
+        // Test output is shown even though the test was not run
+        TEST_ASSERT( GetRecordedOutput().Find( "Output from ExecAndTest" ) );
+    }
+
+    // Check the Exec output was retrieved
+    AString output;
+    LoadFileContentsAsString( execOutput, output );
+    TEST_ASSERT( output.Find( "Output from ExecAndTest" ) );
+}
+
 // LightCache_IncludeUsingMacro
 //------------------------------------------------------------------------------
 void TestCache::LightCache_IncludeUsingMacro() const
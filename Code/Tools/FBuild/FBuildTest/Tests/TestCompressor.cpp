@@ -5,7 +5,10 @@
 //------------------------------------------------------------------------------
 #include "FBuildTest.h"
 
+#include "Tools/FBuild/FBuildCore/Cache/CacheDictionaries.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionSelector.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressorDictionary.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
@@ -27,6 +30,9 @@ private:
     void CompressPreprocessedFile() const;
     void CompressObjFile() const;
     void TestHeaderValidity() const;
+    void CompressWithDictionary() const;
+    void CompressObjFileWithDictionary() const;
+    void SelectForLinkSpeed() const;
 
     void CompressSimpleHelper( const char * data,
                                size_t size,
@@ -43,6 +49,9 @@ REGISTER_TESTS_BEGIN( TestCompressor )
     REGISTER_TEST( CompressPreprocessedFile )
     REGISTER_TEST( CompressObjFile )
     REGISTER_TEST( TestHeaderValidity )
+    REGISTER_TEST( CompressWithDictionary )
+    REGISTER_TEST( CompressObjFileWithDictionary )
+    REGISTER_TEST( SelectForLinkSpeed )
 REGISTER_TESTS_END
 
 // CompressSimple
@@ -293,4 +302,177 @@ void TestCompressor::TestHeaderValidity() const
     TEST_ASSERT( Compressor::IsValidData( buffer.Get(), 44 ) == false );
 }
 
+// CompressWithDictionary
+//------------------------------------------------------------------------------
+void TestCompressor::CompressWithDictionary() const
+{
+    // Data which shares content with the dictionary, but has little internal redundancy
+    const char * dictionaryContent = "section .text .data .bss .rodata .debug_info .debug_abbrev .debug_line .debug_str .symtab .strtab";
+    const char * testData = "section .text .data .debug_info .debug_line .symtab .strtab";
+    const size_t testDataSize = AString::StrLen( testData );
+
+    CompressorDictionary dictionary;
+    TEST_ASSERT( dictionary.Create( dictionaryContent, AString::StrLen( dictionaryContent ) ) );
+    TEST_ASSERT( dictionary.GetId() != 0 );
+
+    // Compress without dictionary
+    Compressor c1;
+    c1.CompressZstd( testData, testDataSize, 3 );
+    TEST_ASSERT( Compressor::GetDictionaryId( c1.GetResult(), c1.GetResultSize() ) == 0 );
+
+    // Compress with dictionary
+    Compressor c2;
+    TEST_ASSERT( c2.CompressZstd( testData, testDataSize, 3, &dictionary ) );
+    TEST_ASSERT( Compressor::IsValidData( c2.GetResult(), c2.GetResultSize() ) );
+    TEST_ASSERT( Compressor::GetDictionaryId( c2.GetResult(), c2.GetResultSize() ) == dictionary.GetId() );
+    TEST_ASSERT( c2.GetResultSize() < c1.GetResultSize() );
+
+    // Decompress with dictionary (via generic and Zstd specific paths)
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( c2.GetResult(), &dictionary ) );
+        TEST_ASSERT( d.GetResultSize() == testDataSize );
+        TEST_ASSERT( memcmp( testData, d.GetResult(), testDataSize ) == 0 );
+    }
+    {
+        Compressor d;
+        TEST_ASSERT( d.DecompressZstd( c2.GetResult(), &dictionary ) );
+        TEST_ASSERT( d.GetResultSize() == testDataSize );
+    }
+
+    // Decompression fails without the dictionary, or with a different one
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( c2.GetResult() ) == false );
+    }
+    {
+        const char * otherContent = "Some other dictionary";
+        CompressorDictionary otherDictionary;
+        TEST_ASSERT( otherDictionary.Create( otherContent, AString::StrLen( otherContent ) ) );
+        Compressor d;
+        TEST_ASSERT( d.Decompress( c2.GetResult(), &otherDictionary ) == false );
+    }
+}
+
+// CompressObjFileWithDictionary
+//------------------------------------------------------------------------------
+void TestCompressor::CompressObjFileWithDictionary() const
+{
+    // Compare compression of small objects with and without a dictionary. The
+    // test object file is split into "objects", with half of them used to build
+    // the dictionary and the other half used to measure.
+    const char * fileName = "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o";
+    UniquePtr< void > data;
+    size_t dataSize;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( fileName ) );
+        dataSize = (size_t)fs.GetFileSize();
+        data = (char *)ALLOC( dataSize );
+        TEST_ASSERT( (uint32_t)fs.Read( data.Get(), dataSize ) == dataSize );
+    }
+    const char * const dataBegin = static_cast< const char * >( data.Get() );
+
+    const size_t chunkSize = ( 16 * 1024 );
+    const size_t numChunks = ( dataSize / chunkSize );
+    TEST_ASSERT( numChunks >= 4 );
+
+    // Build dictionary from even chunks
+    Array< uint8_t > content( 0, true );
+    const size_t maxBytesFromSample = ( CacheDictionaries::kMaxDictionarySize / ( ( numChunks + 1 ) / 2 ) );
+    for ( size_t i = 0; i < numChunks; i += 2 )
+    {
+        CompressorDictionary::AppendSample( dataBegin + ( i * chunkSize ), chunkSize, maxBytesFromSample, content );
+    }
+    CompressorDictionary dictionary;
+    TEST_ASSERT( dictionary.Create( content.Begin(), content.GetSize() ) );
+
+    OUTPUT( "File           : %s\n", fileName );
+    OUTPUT( "Objects        : %u x %u\n", (uint32_t)( numChunks / 2 ), (uint32_t)chunkSize );
+    OUTPUT( "Dictionary     : %u\n", (uint32_t)dictionary.GetContentSize() );
+
+    OUTPUT( "             Compression             Decompression\n" );
+    OUTPUT( "      Level | Time (ms)  MB/s  Ratio | Time (ms)  MB/s\n" );
+    OUTPUT( "------------------------------------------------------\n" );
+
+    const int32_t compressionLevels[] = { 1, 3, 6, 9 };
+    const CompressorDictionary * const dictionaries[] = { nullptr, &dictionary };
+    for ( const int32_t compressionLevel : compressionLevels )
+    {
+        for ( const CompressorDictionary * dict : dictionaries )
+        {
+            double compressTimeTaken = 0.0;
+            double decompressTimeTaken = 0.0;
+            uint64_t uncompressedSize = 0;
+            uint64_t compressedSize = 0;
+
+            // Measure on odd chunks
+            for ( size_t i = 1; i < numChunks; i += 2 )
+            {
+                const char * chunk = dataBegin + ( i * chunkSize );
+
+                const Timer t;
+                Compressor c;
+                c.CompressZstd( chunk, chunkSize, compressionLevel, dict );
+                compressTimeTaken += (double)t.GetElapsedMS();
+
+                const Timer t2;
+                Compressor d;
+                TEST_ASSERT( d.Decompress( c.GetResult(), dict ) );
+                decompressTimeTaken += (double)t2.GetElapsedMS();
+
+                TEST_ASSERT( d.GetResultSize() == chunkSize );
+                TEST_ASSERT( memcmp( chunk, d.GetResult(), chunkSize ) == 0 );
+
+                uncompressedSize += chunkSize;
+                compressedSize += c.GetResultSize();
+            }
+
+            const double compressThroughputMBs    = ( (double)uncompressedSize / ( compressTimeTaken / 1000.0 ) ) / (double)MEGABYTE;
+            const double decompressThroughputMBs  = ( (double)uncompressedSize / ( decompressTimeTaken / 1000.0 ) ) / (double)MEGABYTE;
+            const double ratio = ( (double)uncompressedSize / (double)compressedSize );
+
+            OUTPUT( "%-4s %-5i | %8.3f %7.1f %5.2f | %8.3f %7.1f\n", dict ? "Dict" : "",
+                                                                     compressionLevel,
+                                                                     compressTimeTaken, compressThroughputMBs, (double)ratio,
+                                                                     decompressTimeTaken, decompressThroughputMBs );
+        }
+    }
+    OUTPUT( "------------------------------------------------------\n" );
+}
+
+// SelectForLinkSpeed
+//------------------------------------------------------------------------------
+void TestCompressor::SelectForLinkSpeed() const
+{
+    // Calibrate with a representative result
+    FileStream fs;
+    TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o" ) );
+    const size_t dataSize = (size_t)fs.GetFileSize();
+    UniquePtr< char > data( (char *)ALLOC( dataSize ) );
+    TEST_ASSERT( fs.ReadBuffer( data.Get(), dataSize ) == dataSize );
+    TEST_ASSERT( dataSize >= CompressionSelector::kMinCalibrationSize );
+
+    CompressionSelector selector;
+    CompressionSelector::Choice choice;
+    TEST_ASSERT( selector.Select( 1024, true, choice ) == false ); // Not calibrated
+    selector.Calibrate( data.Get(), dataSize );
+    TEST_ASSERT( selector.IsCalibrated() );
+    TEST_ASSERT( selector.Select( 0, true, choice ) == false ); // Link not measured
+
+    // Loopback (~10 GiB/s): compressing costs more than it saves
+    TEST_ASSERT( selector.Select( 10 * 1024 * 1024, true, choice ) );
+    TEST_ASSERT( choice.m_Level == 0 );
+
+    // Inter-site VPN (~1 MiB/s): the best ratio wins
+    TEST_ASSERT( selector.Select( 1024, true, choice ) );
+    TEST_ASSERT( choice.m_Level != 0 );
+    TEST_ASSERT( choice.m_Zstd );
+
+    // Zstd is only chosen if the worker supports it
+    TEST_ASSERT( selector.Select( 1024, false, choice ) );
+    TEST_ASSERT( choice.m_Level != 0 );
+    TEST_ASSERT( choice.m_Zstd == false );
+}
+
 //------------------------------------------------------------------------------
@@ -6,14 +6,35 @@
 #include "Tools/FBuild/FBuildTest/Tests/FBuildTest.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheDictionaries.h"
+#include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderBundle.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolFileStore.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerageClient.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerCoordinator.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
+#include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Network/TCPConnectionPool.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+#include <memory.h>
+#include <stdlib.h>
 
 // Defines
 //------------------------------------------------------------------------------
@@ -38,6 +59,22 @@ private:
         void RemoteRaceSystemFailure();
     #endif
     void AnonymousNamespaces();
+    void SourceMapping() const;
+    void HeaderBundles() const;
+    void ExecAndTest() const;
+    void ResultCache() const;
+    void DuplicateJobs() const;
+    void StreamedResults() const;
+    void ResultDictionary() const;
+    void JobBatching() const;
+    void MemoryScratchDir() const;
+    void ToolchainFileStore() const;
+    void WorkerStats() const;
+    void BackgroundPriority() const;
+    void FairShareByPriority() const;
+    void ReducedCapacityReturnsJobs() const;
+    void CoordinatorRanksWorkers() const;
+    void CoordinatorIgnoresLateResponses() const;
     void ErrorsAreCorrectlyReported_MSVC() const;
     void ErrorsAreCorrectlyReported_Clang() const;
     void WarningsAreCorrectlyReported_MSVC() const;
@@ -68,6 +105,24 @@ REGISTER_TESTS_BEGIN( TestDistributed )
         REGISTER_TEST( RemoteRaceSystemFailure )
     #endif
     REGISTER_TEST( AnonymousNamespaces )
+    REGISTER_TEST( SourceMapping )
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        REGISTER_TEST( HeaderBundles ) // GCC and Clang only
+        REGISTER_TEST( ExecAndTest ) // TODO:B Enable for Windows
+    #endif
+    REGISTER_TEST( ResultCache )
+    REGISTER_TEST( DuplicateJobs )
+    REGISTER_TEST( StreamedResults )
+    REGISTER_TEST( ResultDictionary )
+    REGISTER_TEST( JobBatching )
+    REGISTER_TEST( MemoryScratchDir )
+    REGISTER_TEST( ToolchainFileStore )
+    REGISTER_TEST( WorkerStats )
+    REGISTER_TEST( BackgroundPriority )
+    REGISTER_TEST( FairShareByPriority )
+    REGISTER_TEST( ReducedCapacityReturnsJobs )
+    REGISTER_TEST( CoordinatorRanksWorkers )
+    REGISTER_TEST( CoordinatorIgnoresLateResponses )
     REGISTER_TEST( ShutdownMemoryLeak )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( ErrorsAreCorrectlyReported_MSVC ) // TODO:B Enable for OSX and Linux
@@ -202,6 +257,11 @@ void TestDistributed::RemoteRaceWinRemote()
     s.Listen( Protocol::PROTOCOL_TEST_PORT );
 
     TEST_ASSERT( fBuild.Build( "RemoteRaceWinRemote" ) );
+
+    // Check race was recorded
+    TEST_ASSERT( fBuild.GetStats().m_NumRacesStarted == 1 );
+    TEST_ASSERT( fBuild.GetStats().m_NumRacesWonRemotely == 1 );
+    TEST_ASSERT( fBuild.GetStats().m_NumRacesWonLocally == 0 );
 }
 
 // RemoteRaceSystemFailure
@@ -253,6 +313,1136 @@ void TestDistributed::AnonymousNamespaces()
     TestHelper( target, 1 );
 }
 
+// SourceMapping
+//------------------------------------------------------------------------------
+void TestDistributed::SourceMapping() const
+{
+    // Check that objects using source mapping are distributed, and that the
+    // result is identical to compiling locally
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/SourceMapping/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+
+    #if defined( __WINDOWS__ )
+        const char * objFile = "../tmp/Test/Distributed/SourceMapping/File.obj";
+    #else
+        const char * objFile = "../tmp/Test/Distributed/SourceMapping/File.o";
+    #endif
+
+    // Compile locally
+    AString localObj;
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "SourceMapping" ) );
+
+        LoadFileContentsAsString( objFile, localObj );
+    }
+
+    // Compile remotely
+    AString remoteObj;
+    {
+        options.m_AllowDistributed = true;
+        options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+        options.m_AllowLocalRace = false;
+        options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // start a client to emulate the other end
+        Server s( 1 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        TEST_ASSERT( fBuild.Build( "SourceMapping" ) );
+        TEST_ASSERT( fBuild.GetNode( objFile )->CastTo< ObjectNode >()->IsDistributable() );
+        LoadFileContentsAsString( objFile, remoteObj );
+    }
+
+    // Debug info should be remapped in both cases, and otherwise identical
+    TEST_ASSERT( localObj.Find( "/fastbuild-test-mapping" ) );
+    TEST_ASSERT( ( localObj.GetLength() == remoteObj.GetLength() ) && ( memcmp( localObj.Get(), remoteObj.Get(), localObj.GetLength() ) == 0 ) );
+}
+
+// HeaderBundles
+//------------------------------------------------------------------------------
+void TestDistributed::HeaderBundles() const
+{
+    // Check that objects can be distributed as source and headers instead of
+    // preprocessed output, and that the result is identical to compiling locally
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/HeaderBundles/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+
+    const char * objFile = "../tmp/Test/Distributed/HeaderBundles/File.o";
+    const AStackString<> storeRoot( "../tmp/Test/Distributed/HeaderFileStore/" );
+
+    // Start with an empty store
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( storeRoot, nullptr, true, &files );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        EnsureFileDoesNotExist( file.m_Name.Get() );
+    }
+
+    // Compile locally. Distribution is enabled (with no worker listening) so
+    // the source is compiled as it is remotely, rather than the preprocessed
+    // output (which has different debug info, such as the columns of
+    // expanded macros).
+    options.m_AllowDistributed = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+    AString localObj;
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "HeaderBundles" ) );
+
+        LoadFileContentsAsString( objFile, localObj );
+    }
+
+    // Compile remotely
+    AString remoteObj;
+    {
+        options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+        options.m_AllowLocalRace = false;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // start a client to emulate the other end
+        Server s( 1 );
+        JobQueueRemote::Get().GetHeaderFileStore().SetRoot( storeRoot );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        TEST_ASSERT( fBuild.Build( "HeaderBundles" ) );
+        TEST_ASSERT( fBuild.GetNode( objFile )->CastTo< ObjectNode >()->IsDistributable() );
+        LoadFileContentsAsString( objFile, remoteObj );
+
+        // Both headers were requested from the client
+        TEST_ASSERT( JobQueueRemote::Get().GetHeaderFileStore().GetNumFilesStored() == 2 );
+    }
+
+    // Headers are stored
+    files.Clear();
+    FileIO::GetFilesEx( storeRoot, nullptr, true, &files );
+    TEST_ASSERT( files.GetSize() == 2 );
+
+    TEST_ASSERT( ( localObj.GetLength() == remoteObj.GetLength() ) && ( memcmp( localObj.Get(), remoteObj.Get(), localObj.GetLength() ) == 0 ) );
+
+    // Headers no job has used recently are removed
+    {
+        HeaderFileStore store;
+        store.SetRoot( storeRoot );
+        TEST_ASSERT( store.Trim() == 0 );
+
+        // Sizes of stored headers are known (to estimate the scratch space jobs need)
+        const uint64_t hash = strtoull( files[ 1 ].m_Name.FindLast( NATIVE_SLASH ) + 1, nullptr, 16 );
+        TEST_ASSERT( store.GetSize( hash ) == files[ 1 ].m_Size );
+        TEST_ASSERT( store.GetSize( hash + 1 ) == 0 );
+
+        #if defined( __WINDOWS__ )
+            const uint64_t twoDays = ( 2 * 24 * 60 * 60 * (uint64_t)10000000 );
+        #else
+            const uint64_t twoDays = ( 2 * 24 * 60 * 60 * (uint64_t)1000000000 );
+        #endif
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( files[ 0 ].m_Name, Time::GetCurrentFileTime() - twoDays ) );
+        TEST_ASSERT( store.Trim() == 1 );
+        TEST_ASSERT( FileIO::FileExists( files[ 0 ].m_Name.Get() ) == false );
+        TEST_ASSERT( FileIO::FileExists( files[ 1 ].m_Name.Get() ) );
+    }
+
+    // Paths from the client can't leave the sandbox
+    {
+        AStackString<> sandboxRoot;
+        sandboxRoot.Format( "sandbox%c", NATIVE_SLASH );
+        AStackString<> expectedPath;
+        expectedPath.Format( "sandbox%csrc%cfile.h", NATIVE_SLASH, NATIVE_SLASH );
+        AStackString<> path;
+        TEST_ASSERT( HeaderBundle::GetSandboxPath( sandboxRoot, AStackString<>( "/src/inc/../file.h" ), path ) );
+        TEST_ASSERT( path == expectedPath );
+        TEST_ASSERT( HeaderBundle::GetSandboxPath( sandboxRoot, AStackString<>( "/src/..file.h" ), path ) );
+        TEST_ASSERT( HeaderBundle::GetSandboxPath( sandboxRoot, AStackString<>( "/src/../../etc/file.h" ), path ) == false );
+        TEST_ASSERT( HeaderBundle::GetSandboxPath( sandboxRoot, AStackString<>( "/.." ), path ) == false );
+    }
+}
+
+// ExecAndTest
+//------------------------------------------------------------------------------
+void TestDistributed::ExecAndTest() const
+{
+    // Check that Exec() and Test() nodes which allow it can run on a worker,
+    // with the same result as running locally
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/ExecAndTest/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+
+    const char * execOutput = "../tmp/Test/Distributed/ExecAndTest/exec.out";
+    const char * testOutput = "../tmp/Test/Distributed/ExecAndTest/test.out";
+
+    // Run locally
+    AString localExec;
+    AString localTest;
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ExecAndTest" ) );
+
+        LoadFileContentsAsString( execOutput, localExec );
+        LoadFileContentsAsString( testOutput, localTest );
+    }
+    TEST_ASSERT( localExec.Find( "Contents of input.txt" ) );
+    TEST_ASSERT( localTest.Find( "Contents of input.txt" ) );
+
+    // Run remotely
+    AString remoteExec;
+    AString remoteTest;
+    {
+        options.m_AllowDistributed = true;
+        options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+        options.m_AllowLocalRace = false;
+        options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // start a client to emulate the other end
+        Server s( 1 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        TEST_ASSERT( fBuild.Build( "ExecAndTest" ) );
+        TEST_ASSERT( fBuild.GetNode( execOutput )->GetStatFlag( Node::STATS_BUILT_REMOTE ) );
+        TEST_ASSERT( fBuild.GetNode( testOutput )->GetStatFlag( Node::STATS_BUILT_REMOTE ) );
+
+        LoadFileContentsAsString( execOutput, remoteExec );
+        LoadFileContentsAsString( testOutput, remoteTest );
+    }
+
+    TEST_ASSERT( localExec == remoteExec );
+    TEST_ASSERT( localTest == remoteTest );
+}
+
+// ResultCache
+//------------------------------------------------------------------------------
+void TestDistributed::ResultCache() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+
+    // The same worker serves both builds
+    Server s( 1 );
+    s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+    // Build everything
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetNumResultsReused() == 0 );
+    }
+
+    // Rebuild - identical jobs are completed with the results of the first build
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumBuilt > 0 );
+        TEST_ASSERT( s.GetNumResultsReused() == objStats.m_NumBuilt );
+    }
+}
+
+// DuplicateJobs
+//------------------------------------------------------------------------------
+void TestDistributed::DuplicateJobs() const
+{
+    FBuild fBuild;
+    NodeGraph ng;
+    Node * node = ng.CreateNode<FileNode>( AStackString<>( "DuplicateJobs/file.cpp" ) );
+
+    // A queue with its worker thread disabled, so jobs are processed only when
+    // taken below
+    WorkerThreadRemote::SetNumCPUsToUse( 0 );
+    JobQueueRemote jqr( 1 );
+
+    int client1 = 0;
+    int client2 = 0;
+    struct Helper
+    {
+        static Job * Queue( JobQueueRemote & queue, Node * node, uint64_t key, void * client )
+        {
+            Job * job = FNEW( Job( node ) );
+            job->OwnData( ALLOC( 4 ), 4 );
+            job->SetResultCacheKey( key );
+            job->SetUserData( client );
+            queue.QueuePendingJob( job );
+            return job;
+        }
+        static void CheckCompleted( JobQueueRemote & queue, const Job * a, const Job * b, bool success )
+        {
+            for ( size_t i = 0; i < 2; ++i )
+            {
+                Job * job = queue.GetCompletedJob();
+                TEST_ASSERT( ( job == a ) || ( job == b ) );
+                TEST_ASSERT( job->GetNode()->GetState() == ( success ? Node::UP_TO_DATE : Node::FAILED ) );
+                FDELETE job;
+            }
+            TEST_ASSERT( queue.GetCompletedJob() == nullptr );
+        }
+    };
+
+    // An identical job waits for the one in flight, and is given its results
+    {
+        Job * job1 = Helper::Queue( jqr, node, 1, &client1 );
+        Job * job2 = Helper::Queue( jqr, node, 1, &client2 );
+        TEST_ASSERT( jqr.GetNumQueuedJobs() == 1 );
+        TEST_ASSERT( jqr.GetJobToProcess() == job1 );
+        jqr.FinishedProcessingJob( job1, true );
+        TEST_ASSERT( jqr.GetNumResultsReused() == 1 );
+        Helper::CheckCompleted( jqr, job1, job2, true );
+    }
+
+    // When the job being waited on fails, the first waiting job is built in
+    // its place, and the others wait for that one
+    {
+        Job * job1 = Helper::Queue( jqr, node, 2, &client1 );
+        Job * job2 = Helper::Queue( jqr, node, 2, &client2 );
+        Job * job3 = Helper::Queue( jqr, node, 2, &client2 );
+        TEST_ASSERT( jqr.GetJobToProcess() == job1 );
+        jqr.FinishedProcessingJob( job1, false );
+        Job * failed = jqr.GetCompletedJob();
+        TEST_ASSERT( ( failed == job1 ) && ( node->GetState() == Node::FAILED ) );
+        FDELETE failed;
+
+        TEST_ASSERT( jqr.GetJobToProcess() == job2 );
+        jqr.FinishedProcessingJob( job2, true );
+        TEST_ASSERT( jqr.GetNumResultsReused() == 2 );
+        Helper::CheckCompleted( jqr, job2, job3, true );
+    }
+
+    // When a queued job is cancelled, the first job waiting on it takes its place
+    {
+        Helper::Queue( jqr, node, 3, &client1 );
+        Job * job2 = Helper::Queue( jqr, node, 3, &client2 );
+        Job * job3 = Helper::Queue( jqr, node, 3, &client2 );
+        jqr.CancelJobsWithUserData( &client1 );
+        TEST_ASSERT( jqr.GetNumQueuedJobs() == 1 );
+
+        TEST_ASSERT( jqr.GetJobToProcess() == job2 );
+        jqr.FinishedProcessingJob( job2, true );
+        TEST_ASSERT( jqr.GetNumResultsReused() == 3 );
+        Helper::CheckCompleted( jqr, job2, job3, true );
+    }
+
+    WorkerThreadRemote::SetNumCPUsToUse( 999 ); // no limit
+}
+
+// StreamedResults
+//------------------------------------------------------------------------------
+void TestDistributed::StreamedResults() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+    const AStackString<> outputPath( "../tmp/Test/Distributed/" );
+    const AStackString<> objPattern( "*_normal*" );
+
+    // Build with results returned whole
+    Array< AString > objFiles;
+    Array< AString > objContents;
+    {
+        Server s( 1 );
+        s.SetStreamedResultThreshold( 0 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+
+        FileIO::GetFiles( outputPath, objPattern, false, &objFiles );
+        TEST_ASSERT( objFiles.IsEmpty() == false );
+        for ( const AString & objFile : objFiles )
+        {
+            LoadFileContentsAsString( objFile.Get(), objContents.EmplaceBack() );
+        }
+    }
+
+    // Build with all results streamed, which should give identical outputs
+    {
+        Server s( 1 );
+        s.SetStreamedResultThreshold( 1 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt == objFiles.GetSize() );
+
+        Array< AString > streamedObjFiles;
+        FileIO::GetFiles( outputPath, objPattern, false, &streamedObjFiles );
+        TEST_ASSERT( streamedObjFiles.GetSize() == objFiles.GetSize() ); // No temp files left behind
+        for ( size_t i = 0; i < objFiles.GetSize(); ++i )
+        {
+            AString contents;
+            LoadFileContentsAsString( objFiles[ i ].Get(), contents );
+            TEST_ASSERT( ( contents.GetLength() == objContents[ i ].GetLength() ) &&
+                         ( memcmp( contents.Get(), objContents[ i ].Get(), contents.GetLength() ) == 0 ) );
+        }
+    }
+}
+
+// ResultDictionary
+//------------------------------------------------------------------------------
+void TestDistributed::ResultDictionary() const
+{
+    // Generate enough objects for a cache dictionary to be built
+    const uint32_t numFiles = ( CacheDictionaries::kNumTrainingSamples + 8 );
+    const char * const inputPath = "../tmp/Test/Distributed/ResultDictionary/Input/";
+    EnsureDirExists( inputPath );
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        AStackString<> fileName;
+        AStackString<> fileContents;
+        fileName.Format( "%sfile%u.cpp", inputPath, i );
+        fileContents.Format( "int Function%u() { return %u; }\n", i, i );
+        MakeFile( fileName.Get(), fileContents.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/ResultDictionary/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheWrite = true;
+    options.m_CacheDictionary = true;
+
+    const AStackString<> outputPath( "../tmp/Test/Distributed/ResultDictionary/Output/" );
+
+    // Build locally, which builds (or loads) the dictionary
+    Array< AString > objFiles;
+    Array< AString > objContents;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ResultDictionary" ) );
+
+        FileIO::GetFiles( outputPath, AStackString<>( "*" ), false, &objFiles );
+        TEST_ASSERT( objFiles.GetSize() == numFiles );
+        for ( const AString & objFile : objFiles )
+        {
+            LoadFileContentsAsString( objFile.Get(), objContents.EmplaceBack() );
+        }
+    }
+
+    // Build remotely. The worker is sent the dictionary to compress results with.
+    {
+        options.m_AllowDistributed = true;
+        options.m_NumWorkerThreads = 1;
+        options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+        options.m_AllowLocalRace = false;
+        options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+        Server s( 1 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ResultDictionary" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt == numFiles );
+        TEST_ASSERT( s.GetNumResultDictionaries() == 1 );
+
+        // Outputs are identical to those built locally
+        for ( size_t i = 0; i < objFiles.GetSize(); ++i )
+        {
+            AString contents;
+            LoadFileContentsAsString( objFiles[ i ].Get(), contents );
+            TEST_ASSERT( ( contents.GetLength() == objContents[ i ].GetLength() ) &&
+                         ( memcmp( contents.Get(), objContents[ i ].Get(), contents.GetLength() ) == 0 ) );
+        }
+    }
+
+    // Results were stored to the cache as received, and can be retrieved
+    {
+        options.m_AllowDistributed = false;
+        options.m_UseCacheWrite = false;
+        options.m_UseCacheRead = true;
+        options.m_CacheVerbose = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ResultDictionary" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == numFiles );
+        TEST_ASSERT( GetRecordedOutput().Find( " - Dictionary: " ) );
+    }
+}
+
+// JobBatching
+//------------------------------------------------------------------------------
+void TestDistributed::JobBatching() const
+{
+    const uint32_t numFiles = 24;
+    const char * const inputPath = "../tmp/Test/Distributed/JobBatching/Input/";
+    EnsureDirExists( inputPath );
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        AStackString<> fileName;
+        AStackString<> fileContents;
+        fileName.Format( "%sfile%u.cpp", inputPath, i );
+        fileContents.Format( "int Function%u() { return %u; }\n", i, i );
+        MakeFile( fileName.Get(), fileContents.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/JobBatching/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+
+    const AStackString<> outputPath( "../tmp/Test/Distributed/JobBatching/Output/" );
+
+    // Build locally for reference
+    Array< AString > objFiles;
+    Array< AString > objContents;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "JobBatching" ) );
+
+        FileIO::GetFiles( outputPath, AStackString<>( "*" ), false, &objFiles );
+        TEST_ASSERT( objFiles.GetSize() == numFiles );
+        for ( const AString & objFile : objFiles )
+        {
+            LoadFileContentsAsString( objFile.Get(), objContents.EmplaceBack() );
+        }
+    }
+
+    // Build remotely, with the idle local thread racing the jobs prefetched by
+    // the worker. Results for jobs won locally are discarded on arrival.
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // local thread only races
+    options.m_AllowLocalRace = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    // Withhold the worker's job slots until every job is available, so they
+    // are requested together and the local thread is left idle to race them
+    struct Helper
+    {
+        static uint32_t RestoreCapacity( void * data )
+        {
+            const size_t numJobs = *static_cast< const uint32_t * >( data );
+            const Timer t;
+            while ( ( ( JobQueue::IsValid() == false ) || ( JobQueue::Get().GetNumDistributableJobsAvailable() < numJobs ) ) &&
+                    ( t.GetElapsed() < 30.0f ) )
+            {
+                Thread::Sleep( 1 );
+            }
+            WorkerThreadRemote::SetNumCPUsToUse( 999 ); // no limit
+            return 0;
+        }
+    };
+
+    // Results are only sent together if several jobs complete before the
+    // worker sends the first of them, so the build is repeated until that
+    // happens
+    for ( uint32_t attempt = 0; ; ++attempt )
+    {
+        TEST_ASSERTM( attempt < 10, "No results were returned together" );
+
+        Server s( 4 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        WorkerThreadRemote::SetNumCPUsToUse( 0 );
+        Thread thread;
+        thread.Start( Helper::RestoreCapacity, "RestoreCapacity", const_cast< uint32_t * >( &numFiles ) );
+
+        TEST_ASSERT( fBuild.Build( "JobBatching" ) );
+        thread.Join();
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt == numFiles );
+
+        // Jobs were requested several at a time (as counted by the client)
+        const FBuildStats & stats = fBuild.GetStats();
+        TEST_ASSERT( stats.m_WorkerStats.GetSize() == 1 );
+        const FBuildStats::WorkerStats & ws = stats.m_WorkerStats[ 0 ];
+        TEST_ASSERT( ws.m_NumJobRequestBatches > 0 );
+
+        // Prefetched jobs were raced (a race can also end with the local job
+        // completing while the remote result waits to cancel it, which is neither)
+        TEST_ASSERT( stats.m_NumRacesStarted > 0 );
+        TEST_ASSERT( ( stats.m_NumRacesWonLocally + stats.m_NumRacesWonRemotely ) <= stats.m_NumRacesStarted );
+
+        // Outputs are identical to those built locally
+        for ( size_t i = 0; i < objFiles.GetSize(); ++i )
+        {
+            AString contents;
+            LoadFileContentsAsString( objFiles[ i ].Get(), contents );
+            TEST_ASSERT( ( contents.GetLength() == objContents[ i ].GetLength() ) &&
+                         ( memcmp( contents.Get(), objContents[ i ].Get(), contents.GetLength() ) == 0 ) );
+        }
+
+        // Several results were returned in one message
+        if ( ws.m_NumResultBatches > 0 )
+        {
+            break;
+        }
+    }
+}
+
+// MemoryScratchDir
+//------------------------------------------------------------------------------
+void TestDistributed::MemoryScratchDir() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+
+    // Scratch space for remote jobs (on disk here, rather than memory-backed)
+    AStackString<> scratchDir;
+    FileIO::GetCurrentDir( scratchDir );
+    scratchDir += "/../tmp/Test/Distributed/Scratch";
+    PathUtils::FixupFolderPath( scratchDir );
+    AStackString<> threadScratchDir( scratchDir );
+    threadScratchDir.AppendFormat( "_fbuild.tmp%ccore_1001", NATIVE_SLASH ); // First remote worker thread
+    FileIO::DirectoryDelete( threadScratchDir );
+
+    {
+        Server s( 1 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+        WorkerThread::InitMemoryTmpDir( scratchDir, 64 );
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt > 0 );
+    }
+
+    // Jobs used it, and released the space they reserved
+    TEST_ASSERT( FileIO::DirectoryExists( threadScratchDir ) );
+    TEST_ASSERT( WorkerThread::GetMemoryTmpDirUsage() == 0 );
+
+    // Don't affect other tests
+    WorkerThread::InitMemoryTmpDir( scratchDir, 0 );
+}
+
+// ToolchainFileStore
+//------------------------------------------------------------------------------
+void TestDistributed::ToolchainFileStore() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+    const AStackString<> storeRoot( "../tmp/Test/Distributed/ToolFileStore/" );
+
+    // Start with an empty store
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( storeRoot, nullptr, true, &files );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        EnsureFileDoesNotExist( file.m_Name.Get() );
+    }
+
+    // Build, synchronizing the toolchain
+    {
+        Server s( 1 );
+        s.GetToolFileStore().SetRoot( storeRoot );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetToolFileStore().GetNumFilesRetrieved() == 0 );
+    }
+
+    // Files are stored
+    files.Clear();
+    FileIO::GetFilesEx( storeRoot, nullptr, true, &files );
+    TEST_ASSERT( files.IsEmpty() == false );
+
+    // Remove the synchronized toolchains from the worker
+    {
+        AStackString<> workerDir;
+        VERIFY( FBuild::GetTempDir( workerDir ) );
+        #if defined( __WINDOWS__ )
+            workerDir += ".fbuild.tmp\\worker\\";
+        #else
+            workerDir += "_fbuild.tmp/worker/";
+        #endif
+        files.Clear();
+        FileIO::GetFilesEx( workerDir, nullptr, true, &files );
+        for ( const FileIO::FileInfo & file : files )
+        {
+            if ( file.m_Name.Find( "toolchain." ) )
+            {
+                EnsureFileDoesNotExist( file.m_Name.Get() );
+            }
+        }
+    }
+
+    // Rebuild - toolchain files are restored from the store
+    {
+        Server s( 1 );
+        s.GetToolFileStore().SetRoot( storeRoot );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetToolFileStore().GetNumFilesRetrieved() > 0 );
+    }
+
+    // Files not used recently are removed, then the least recently used files
+    // beyond the size limit
+    {
+        ToolFileStore store;
+        store.SetRoot( storeRoot );
+        TEST_ASSERT( store.Trim() == 0 );
+
+        files.Clear();
+        FileIO::GetFilesEx( storeRoot, nullptr, false, &files );
+        TEST_ASSERT( files.GetSize() > 1 );
+        #if defined( __WINDOWS__ )
+            const uint64_t twoWeeks = ( 14 * 24 * 60 * 60 * (uint64_t)10000000 );
+        #else
+            const uint64_t twoWeeks = ( 14 * 24 * 60 * 60 * (uint64_t)1000000000 );
+        #endif
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( files[ 0 ].m_Name, Time::GetCurrentFileTime() - twoWeeks ) );
+        TEST_ASSERT( store.Trim() == 1 );
+        TEST_ASSERT( FileIO::FileExists( files[ 0 ].m_Name.Get() ) == false );
+
+        // Make one file the most recently used, and only leave room for it
+        const uint64_t oneHour = ( twoWeeks / ( 14 * 24 ) );
+        for ( size_t i = 2; i < files.GetSize(); ++i )
+        {
+            TEST_ASSERT( FileIO::SetFileLastWriteTime( files[ i ].m_Name, Time::GetCurrentFileTime() - oneHour ) );
+        }
+        store.SetLimits( files[ 1 ].m_Size, 7 * 24 * 60 * 60 );
+        TEST_ASSERT( store.Trim() > 0 );
+        TEST_ASSERT( FileIO::FileExists( files[ 1 ].m_Name.Get() ) );
+        TEST_ASSERT( store.Trim() == 0 );
+    }
+
+    // Files are keyed by their contents, whatever their name
+    {
+        const AStackString<> sharedRoot( "../tmp/Test/Distributed/ToolFileStoreShared/" );
+        const AStackString<> srcFile( "../tmp/Test/Distributed/ToolFileStoreSrc/tool.dll" );
+        const AStackString<> dstFile( "../tmp/Test/Distributed/ToolFileStoreSrc/retrieved.dll" );
+        files.Clear();
+        FileIO::GetFilesEx( sharedRoot, nullptr, false, &files );
+        for ( const FileIO::FileInfo & file : files )
+        {
+            EnsureFileDoesNotExist( file.m_Name.Get() );
+        }
+        EnsureFileDoesNotExist( dstFile.Get() );
+
+        const char content[] = "Identical in two toolchains";
+        const uint32_t contentSize = (uint32_t)sizeof( content );
+        {
+            FileStream f;
+            TEST_ASSERT( FileIO::EnsurePathExistsForFile( srcFile ) );
+            TEST_ASSERT( f.Open( srcFile.Get(), FileStream::WRITE_ONLY ) );
+            TEST_ASSERT( f.Write( content, contentSize ) == contentSize );
+        }
+        const uint32_t hash = xxHash::Calc32( content, contentSize );
+        ToolManifestFile fileA( AStackString<>( "ToolchainA/tool.dll" ), 1, hash, contentSize );
+        ToolManifestFile fileB( AStackString<>( "ToolchainB/renamed.dll" ), 1, hash, contentSize );
+        ToolManifestFile fileNoContentHash( AStackString<>( "ToolchainC/tool.dll" ), 1, hash, contentSize );
+        fileA.SetContentHash( xxHash3::Calc64( content, contentSize ) );
+        fileB.SetContentHash( fileA.GetContentHash() );
+
+        ToolFileStore store;
+        store.SetRoot( sharedRoot );
+        store.Store( fileA, srcFile );
+        store.Store( fileB, srcFile );
+        store.Store( fileNoContentHash, srcFile ); // Not stored, from an older client
+        files.Clear();
+        FileIO::GetFilesEx( sharedRoot, nullptr, false, &files );
+        TEST_ASSERT( files.GetSize() == 1 );
+
+        TEST_ASSERT( store.Retrieve( fileB, dstFile ) );
+        TEST_ASSERT( store.Retrieve( fileNoContentHash, dstFile ) == false );
+
+        // Stored contents are checked before use (the stored file may be a
+        // hard link to the source, so it changes too)
+        {
+            FileStream f;
+            TEST_ASSERT( f.Open( files[ 0 ].m_Name.Get(), FileStream::WRITE_ONLY ) );
+            const char otherContent[ sizeof( content ) ] = "Modified after being stored";
+            TEST_ASSERT( f.Write( otherContent, contentSize ) == contentSize );
+        }
+        TEST_ASSERT( store.Retrieve( fileA, dstFile ) == false );
+        TEST_ASSERT( FileIO::FileExists( files[ 0 ].m_Name.Get() ) == false );
+    }
+}
+
+// WorkerStats
+//------------------------------------------------------------------------------
+void TestDistributed::WorkerStats() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    Server s( 1 );
+    s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( "../tmp/Test/Distributed/dist.lib" ) );
+
+    // Performance of the worker is recorded
+    const FBuildStats & stats = fBuild.GetStats();
+    TEST_ASSERT( stats.m_WorkerStats.GetSize() == 1 );
+    const FBuildStats::WorkerStats & ws = stats.m_WorkerStats[ 0 ];
+    TEST_ASSERT( ws.m_NumJobs == stats.GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt );
+    TEST_ASSERT( ws.m_NumFailures == 0 );
+    TEST_ASSERT( ws.m_BytesSent > 0 );
+    TEST_ASSERT( ws.m_BytesReceived > 0 );
+    TEST_ASSERT( ws.m_Straggler == false );
+}
+
+// BackgroundPriority
+//------------------------------------------------------------------------------
+void TestDistributed::BackgroundPriority() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_DistBackground = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    Server s( 1 );
+    s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+    // A lower priority client is still granted jobs when it has the worker to itself
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( "../tmp/Test/Distributed/dist.lib" ) );
+
+    const FBuildStats & stats = fBuild.GetStats();
+    TEST_ASSERT( stats.m_WorkerStats.GetSize() == 1 );
+    TEST_ASSERT( stats.m_WorkerStats[ 0 ].m_NumJobs == stats.GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt );
+}
+
+// FairShareByPriority
+//------------------------------------------------------------------------------
+void TestDistributed::FairShareByPriority() const
+{
+    // A client which always wants more jobs, but never has one to give, so
+    // every job slot it is granted is returned straight away
+    class EagerClient : public TCPConnectionPool
+    {
+    public:
+        explicit EagerClient( uint8_t priority ) : m_Priority( priority ) {}
+        virtual ~EagerClient() override { ShutdownAllConnections(); }
+
+        bool Start()
+        {
+            const ConnectionInfo * connection = Connect( AStackString<>( "127.0.0.1" ), Protocol::PROTOCOL_TEST_PORT );
+            const Protocol::MsgConnection msg( 1000, m_Priority );
+            return ( connection && msg.Send( connection ) );
+        }
+
+        uint32_t GetNumJobsRequested() const { return m_NumJobsRequested.Load(); }
+
+    private:
+        virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t /*size*/, bool & /*keepMemory*/ ) override
+        {
+            if ( m_ExpectPayload )
+            {
+                m_ExpectPayload = false;
+                return;
+            }
+            const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+            m_ExpectPayload = msg->HasPayload();
+            if ( msg->GetType() != Protocol::MSG_REQUEST_JOBS )
+            {
+                return;
+            }
+
+            const uint32_t numJobs = static_cast< const Protocol::MsgRequestJobs * >( msg )->GetNumJobs();
+            m_NumJobsRequested.Add( numJobs );
+            const Protocol::MsgNoJobAvailable noJob;
+            for ( uint32_t i = 0; i < numJobs; ++i )
+            {
+                noJob.Send( connection );
+            }
+            const Protocol::MsgStatus status( 1000 ); // Wakes the server
+            status.Send( connection );
+        }
+
+        uint8_t             m_Priority;
+        bool                m_ExpectPayload = false;
+        Atomic< uint32_t >  m_NumJobsRequested;
+    };
+
+    // Fewer job slots than the clients want, so they compete for them
+    WorkerThreadRemote::SetNumCPUsToUse( 4 );
+    Server s( 1 );
+    s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+    EagerClient interactive( Protocol::PRIORITY_INTERACTIVE );
+    EagerClient background( Protocol::PRIORITY_BACKGROUND );
+    TEST_ASSERT( interactive.Start() );
+    TEST_ASSERT( background.Start() );
+
+    // Once both are being granted job slots...
+    Timer t;
+    while ( ( ( interactive.GetNumJobsRequested() == 0 ) || ( background.GetNumJobsRequested() == 0 ) ) &&
+            ( t.GetElapsed() < 10.0f ) )
+    {
+        Thread::Sleep( 1 );
+    }
+    const uint32_t interactiveStart = interactive.GetNumJobsRequested();
+    const uint32_t backgroundStart = background.GetNumJobsRequested();
+    TEST_ASSERT( ( interactiveStart > 0 ) && ( backgroundStart > 0 ) );
+
+    // ...slots are split in proportion to their weights (4:1, with equal job times)
+    t.Start();
+    while ( ( ( background.GetNumJobsRequested() - backgroundStart ) < 100 ) && ( t.GetElapsed() < 30.0f ) )
+    {
+        Thread::Sleep( 1 );
+    }
+    const uint32_t numInteractive = ( interactive.GetNumJobsRequested() - interactiveStart );
+    const uint32_t numBackground = ( background.GetNumJobsRequested() - backgroundStart );
+    WorkerThreadRemote::SetNumCPUsToUse( 999 ); // no limit
+    TEST_ASSERT( numBackground >= 100 );
+    const float ratio = ( (float)numInteractive / (float)numBackground );
+    TEST_ASSERT( ( ratio > 3.0f ) && ( ratio < 5.0f ) );
+}
+
+// ReducedCapacityReturnsJobs
+//------------------------------------------------------------------------------
+void TestDistributed::ReducedCapacityReturnsJobs() const
+{
+    const uint32_t numFiles = 24;
+    const char * const inputPath = "../tmp/Test/Distributed/ReducedCapacity/Input/";
+    EnsureDirExists( inputPath );
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        AStackString<> fileName;
+        AStackString<> fileContents;
+        fileName.Format( "%sfile%u.cpp", inputPath, i );
+        fileContents.Format( "int Function%u() { return %u; }\n", i, i );
+        MakeFile( fileName.Get(), fileContents.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/ReducedCapacity/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+
+    Server s( 1 );
+    s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // Once every job is available, advertise more job slots than the worker
+    // has threads, so most of the requested jobs wait in its queue. Take the
+    // slots away while they are queued (the one thread can only start a few
+    // of them before the reduction is noticed), then give them back once the
+    // queued jobs have been returned.
+    struct Helper
+    {
+        static uint32_t ReduceCapacity( void * data )
+        {
+            const Server & server = *static_cast< const Server * >( data );
+            const Timer t;
+            while ( ( ( JobQueue::IsValid() == false ) || ( JobQueue::Get().GetNumDistributableJobsAvailable() < numFiles ) ) &&
+                    ( t.GetElapsed() < 30.0f ) )
+            {
+                Thread::Sleep( 1 );
+            }
+            WorkerThreadRemote::SetNumCPUsToUse( 8 );
+            while ( ( JobQueueRemote::Get().GetNumQueuedJobs() < 4 ) && ( t.GetElapsed() < 30.0f ) )
+            {
+                Thread::Sleep( 1 );
+            }
+            WorkerThreadRemote::SetNumCPUsToUse( 0 );
+            while ( ( server.GetNumJobsReturned() == 0 ) && ( t.GetElapsed() < 30.0f ) )
+            {
+                Thread::Sleep( 1 );
+            }
+            WorkerThreadRemote::SetNumCPUsToUse( 999 ); // no limit
+            return 0;
+        }
+    };
+    WorkerThreadRemote::SetNumCPUsToUse( 0 );
+    Thread thread;
+    thread.Start( Helper::ReduceCapacity, "ReduceCapacity", &s );
+
+    // Returned jobs are sent again when capacity is restored
+    TEST_ASSERT( fBuild.Build( "ReducedCapacity" ) );
+    thread.Join();
+    WorkerThreadRemote::SetNumCPUsToUse( 999 ); // no limit
+    TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt == numFiles );
+    TEST_ASSERT( s.GetNumJobsReturned() > 0 );
+}
+
+// CoordinatorRanksWorkers
+//------------------------------------------------------------------------------
+void TestDistributed::CoordinatorRanksWorkers() const
+{
+    WorkerCoordinator * coordinator = FNEW( WorkerCoordinator );
+    TEST_ASSERT( coordinator->Listen( Protocol::COORDINATOR_TEST_PORT ) );
+
+    const AStackString<> localHost( "127.0.0.1" );
+    Array< uint64_t > noToolIds;
+    Array< uint64_t > toolIds;
+    toolIds.Append( 0x1234 );
+
+    // Workers report their status (the addresses are only reported, not used)
+    WorkerCoordinatorConnection idleWorker( localHost, Protocol::COORDINATOR_TEST_PORT );
+    TEST_ASSERT( idleWorker.SendStatus( AStackString<>( "10.0.0.1" ), 16, 16, 16, noToolIds ) );
+    WorkerCoordinatorConnection busyWorker( localHost, Protocol::COORDINATOR_TEST_PORT );
+    TEST_ASSERT( busyWorker.SendStatus( AStackString<>( "10.0.0.2" ), 8, 8, 2, toolIds ) );
+    {
+        WorkerCoordinatorConnection unavailableWorker( localHost, Protocol::COORDINATOR_TEST_PORT );
+        TEST_ASSERT( unavailableWorker.SendStatus( AStackString<>( "10.0.0.3" ), 8, 0, 0, toolIds ) );
+
+        const Timer t;
+        while ( ( coordinator->GetNumWorkers() < 3 ) && ( t.GetElapsed() < 10.0f ) )
+        {
+            Thread::Sleep( 1 );
+        }
+        TEST_ASSERT( coordinator->GetNumWorkers() == 3 );
+
+        // Unavailable workers are excluded, and the rest are ranked by free job slots...
+        Array< AString > workers;
+        TEST_ASSERT( WorkerCoordinatorConnection( localHost, Protocol::COORDINATOR_TEST_PORT ).FindWorkers( noToolIds, workers ) );
+        TEST_ASSERT( workers.GetSize() == 2 );
+        TEST_ASSERT( workers[ 0 ] == "10.0.0.1" );
+        TEST_ASSERT( workers[ 1 ] == "10.0.0.2" );
+
+        // ...unless a worker already has the toolchain
+        workers.Clear();
+        TEST_ASSERT( WorkerCoordinatorConnection( localHost, Protocol::COORDINATOR_TEST_PORT ).FindWorkers( toolIds, workers ) );
+        TEST_ASSERT( workers.GetSize() == 2 );
+        TEST_ASSERT( workers[ 0 ] == "10.0.0.2" );
+        TEST_ASSERT( workers[ 1 ] == "10.0.0.1" );
+    }
+
+    // Disconnected workers are removed
+    {
+        const Timer t;
+        while ( ( coordinator->GetNumWorkers() > 2 ) && ( t.GetElapsed() < 10.0f ) )
+        {
+            Thread::Sleep( 1 );
+        }
+        TEST_ASSERT( coordinator->GetNumWorkers() == 2 );
+    }
+
+    // Clients find workers through the coordinator set in the environment
+    AStackString<> coordinatorEnv;
+    coordinatorEnv.Format( "%s:%u", localHost.Get(), (uint32_t)Protocol::COORDINATOR_TEST_PORT );
+    TEST_ASSERT( Env::SetEnvVariable( "FASTBUILD_COORDINATOR", coordinatorEnv ) );
+    {
+        WorkerBrokerageClient brokerage;
+        Array< AString > workers;
+        brokerage.FindWorkers( workers, toolIds );
+        TEST_ASSERT( workers.GetSize() == 2 );
+        TEST_ASSERT( workers[ 0 ] == "10.0.0.2" );
+    }
+
+    // The brokerage path is used when the coordinator is unavailable
+    FDELETE coordinator;
+    {
+        WorkerBrokerageClient brokerage;
+        Array< AString > workers;
+        brokerage.FindWorkers( workers, toolIds );
+        TEST_ASSERT( workers.Find( AStackString<>( "10.0.0.2" ) ) == nullptr );
+    }
+    TEST_ASSERT( Env::SetEnvVariable( "FASTBUILD_COORDINATOR", AString::GetEmpty() ) );
+}
+
+// CoordinatorIgnoresLateResponses
+//------------------------------------------------------------------------------
+void TestDistributed::CoordinatorIgnoresLateResponses() const
+{
+    // A coordinator which only answers the first request once the second arrives
+    class SlowCoordinator : public TCPConnectionPool
+    {
+    public:
+        virtual ~SlowCoordinator() override { ShutdownAllConnections(); }
+
+    private:
+        virtual void OnReceive( const ConnectionInfo * connection, void * /*data*/, uint32_t /*size*/, bool & /*keepMemory*/ ) override
+        {
+            // Each request is a message followed by its payload
+            if ( ++m_NumReceived % 2 )
+            {
+                return;
+            }
+            if ( m_NumReceived == 4 )
+            {
+                SendWorkers( connection, "10.0.0.1" ); // Late
+                SendWorkers( connection, "10.0.0.2" );
+            }
+        }
+
+        static void SendWorkers( const ConnectionInfo * connection, const char * worker )
+        {
+            MemoryStream ms;
+            ms.Write( (uint32_t)1 );
+            ms.Write( AStackString<>( worker ) );
+            const Protocol::MsgWorkers msg;
+            msg.Send( connection, ms );
+        }
+
+        uint32_t m_NumReceived = 0;
+    };
+
+    SlowCoordinator coordinator;
+    TEST_ASSERT( coordinator.Listen( Protocol::COORDINATOR_TEST_PORT ) );
+
+    WorkerCoordinatorConnection connection( AStackString<>( "127.0.0.1" ), Protocol::COORDINATOR_TEST_PORT );
+    const Array< uint64_t > toolIds;
+    Array< AString > workers;
+    TEST_ASSERT( connection.FindWorkers( toolIds, workers ) == false ); // Times out
+
+    // The response to the first request is not mistaken for this one
+    TEST_ASSERT( connection.FindWorkers( toolIds, workers ) );
+    TEST_ASSERT( workers.GetSize() == 1 );
+    TEST_ASSERT( workers[ 0 ] == "10.0.0.2" );
+}
+
 // TestForceInclude
 //------------------------------------------------------------------------------
 void TestDistributed::TestForceInclude() const
@@ -0,0 +1,161 @@
+// TestProcFS.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/ProcFS.h"
+
+// Core
+#include "Core/Strings/AStackString.h"
+
+// TestProcFS
+//------------------------------------------------------------------------------
+class TestProcFS : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void ParseSystemStat() const;
+    void ParseProcessStat() const;
+    void ParseCGroupPath() const;
+    void ParseCPUMax() const;
+    void ParsePressure() const;
+    void ParseKeyValue() const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestProcFS )
+    REGISTER_TEST( ParseSystemStat )
+    REGISTER_TEST( ParseProcessStat )
+    REGISTER_TEST( ParseCGroupPath )
+    REGISTER_TEST( ParseCPUMax )
+    REGISTER_TEST( ParsePressure )
+    REGISTER_TEST( ParseKeyValue )
+REGISTER_TESTS_END
+
+// ParseSystemStat
+//------------------------------------------------------------------------------
+void TestProcFS::ParseSystemStat() const
+{
+    uint64_t idle = 0;
+    uint64_t kern = 0;
+    uint64_t user = 0;
+
+    // Idle time includes iowait, irq etc
+    TEST_ASSERT( ProcFS::ParseSystemStat( AStackString<>( "cpu  100 20 30 400 5 6 7 8 0 0" ), idle, kern, user ) );
+    TEST_ASSERT( ( user == 120 ) && ( kern == 30 ) && ( idle == 426 ) );
+
+    // Old kernels have only 4 values
+    TEST_ASSERT( ProcFS::ParseSystemStat( AStackString<>( "cpu 1 2 3 4" ), idle, kern, user ) );
+    TEST_ASSERT( ( user == 3 ) && ( kern == 3 ) && ( idle == 4 ) );
+
+    // Invalid
+    TEST_ASSERT( ProcFS::ParseSystemStat( AStackString<>( "cpu0 1 2 3 4" ), idle, kern, user ) == false );
+    TEST_ASSERT( ProcFS::ParseSystemStat( AStackString<>( "cpu 1 2 3" ), idle, kern, user ) == false );
+    TEST_ASSERT( ProcFS::ParseSystemStat( AStackString<>( "intr 1 2 3 4" ), idle, kern, user ) == false );
+}
+
+// ParseProcessStat
+//------------------------------------------------------------------------------
+void TestProcFS::ParseProcessStat() const
+{
+    uint32_t parentPID = 0;
+    uint64_t user = 0;
+    uint64_t kern = 0;
+
+    // Simple exe name
+    TEST_ASSERT( ProcFS::ParseProcessStat( AStackString<>( "1234 (cc1plus) R 1000 1234 999 34816 1234 4194304 100 0 0 0 250 17 0 0 20 0 1 0 5000" ),
+                                           parentPID, user, kern ) );
+    TEST_ASSERT( ( parentPID == 1000 ) && ( user == 250 ) && ( kern == 17 ) );
+
+    // Exe names can contain spaces and ')' (tty_nr and tpgid can be negative)
+    TEST_ASSERT( ProcFS::ParseProcessStat( AStackString<>( "42 (my (odd) exe) ) S 7 42 42 -1 -1 4194304 1 2 3 4 5 6 0 0 20 0 1 0 100" ),
+                                           parentPID, user, kern ) );
+    TEST_ASSERT( ( parentPID == 7 ) && ( user == 5 ) && ( kern == 6 ) );
+
+    // Invalid
+    TEST_ASSERT( ProcFS::ParseProcessStat( AStackString<>( "42 cc1plus S 7 42" ), parentPID, user, kern ) == false );
+    TEST_ASSERT( ProcFS::ParseProcessStat( AStackString<>( "42 (cc1plus) S 7 42 42" ), parentPID, user, kern ) == false );
+    TEST_ASSERT( ProcFS::ParseProcessStat( AStackString<>( "42 (cc1plus)" ), parentPID, user, kern ) == false );
+}
+
+// ParseCGroupPath
+//------------------------------------------------------------------------------
+void TestProcFS::ParseCGroupPath() const
+{
+    AStackString<> path;
+
+    // Unified hierarchy only
+    TEST_ASSERT( ProcFS::ParseCGroupPath( AStackString<>( "0::/system.slice/docker-abc.scope\n" ), path ) );
+    TEST_ASSERT( path == "/system.slice/docker-abc.scope" );
+
+    // Hybrid, with v1 controllers listed first (and no trailing newline)
+    TEST_ASSERT( ProcFS::ParseCGroupPath( AStackString<>( "12:cpu,cpuacct:/user.slice\n1:name=systemd:/user.slice\n0::/user.slice/worker" ), path ) );
+    TEST_ASSERT( path == "/user.slice/worker" );
+
+    // Root
+    TEST_ASSERT( ProcFS::ParseCGroupPath( AStackString<>( "0::/\n" ), path ) );
+    TEST_ASSERT( path == "/" );
+
+    // cgroup v1 only
+    TEST_ASSERT( ProcFS::ParseCGroupPath( AStackString<>( "12:cpu,cpuacct:/\n10:memory:/\n" ), path ) == false );
+}
+
+// ParseCPUMax
+//------------------------------------------------------------------------------
+void TestProcFS::ParseCPUMax() const
+{
+    float numCPUs = 0.0f;
+
+    TEST_ASSERT( ProcFS::ParseCPUMax( AStackString<>( "200000 100000" ), numCPUs ) );
+    TEST_ASSERT( numCPUs == 2.0f );
+    TEST_ASSERT( ProcFS::ParseCPUMax( AStackString<>( "150000 100000" ), numCPUs ) );
+    TEST_ASSERT( numCPUs == 1.5f );
+
+    // Unlimited
+    TEST_ASSERT( ProcFS::ParseCPUMax( AStackString<>( "max 100000" ), numCPUs ) == false );
+
+    // Invalid
+    TEST_ASSERT( ProcFS::ParseCPUMax( AStackString<>( "100000 0" ), numCPUs ) == false );
+    TEST_ASSERT( ProcFS::ParseCPUMax( AStackString<>( "" ), numCPUs ) == false );
+}
+
+// ParsePressure
+//------------------------------------------------------------------------------
+void TestProcFS::ParsePressure() const
+{
+    float percent = 0.0f;
+
+    TEST_ASSERT( ProcFS::ParsePressure( AStackString<>( "some avg10=12.50 avg60=0.87 avg300=0.20 total=12345" ), percent ) );
+    TEST_ASSERT( percent == 12.5f );
+    TEST_ASSERT( ProcFS::ParsePressure( AStackString<>( "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" ), percent ) );
+    TEST_ASSERT( percent == 0.0f );
+
+    // Invalid
+    TEST_ASSERT( ProcFS::ParsePressure( AStackString<>( "full avg10=1.00 avg60=0.00 avg300=0.00 total=0" ), percent ) == false );
+    TEST_ASSERT( ProcFS::ParsePressure( AStackString<>( "" ), percent ) == false );
+}
+
+// ParseKeyValue
+//------------------------------------------------------------------------------
+void TestProcFS::ParseKeyValue() const
+{
+    const AStackString<> cpuStat( "usage_usec 123456\nuser_usec 100000\nsystem_usec 23456\nnr_periods 0\n" );
+    uint64_t value = 0;
+
+    TEST_ASSERT( ProcFS::ParseKeyValue( cpuStat, "usage_usec", value ) );
+    TEST_ASSERT( value == 123456 );
+    TEST_ASSERT( ProcFS::ParseKeyValue( cpuStat, "system_usec", value ) );
+    TEST_ASSERT( value == 23456 );
+    TEST_ASSERT( ProcFS::ParseKeyValue( cpuStat, "nr_periods", value ) );
+    TEST_ASSERT( value == 0 );
+
+    // Keys must match exactly
+    TEST_ASSERT( ProcFS::ParseKeyValue( cpuStat, "usage", value ) == false );
+    TEST_ASSERT( ProcFS::ParseKeyValue( cpuStat, "nr_throttled", value ) == false );
+}
+
+//------------------------------------------------------------------------------
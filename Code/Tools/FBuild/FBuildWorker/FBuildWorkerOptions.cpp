@@ -31,8 +31,11 @@ FBuildWorkerOptions::FBuildWorkerOptions() :
     m_OverrideWorkMode( false ),
     m_WorkMode( WorkerSettings::WHEN_IDLE ),
     m_MinimumFreeMemoryMiB( 0 ),
+    m_ScratchSizeMiB( 1024 ),
+    m_CPUPinning( false ),
     m_ConsoleMode( false ),
-    m_PeriodicRestart( false )
+    m_PeriodicRestart( false ),
+    m_Coordinator( false )
 {
     #ifdef __LINUX__
         m_ConsoleMode = true; // Only console mode supported on Linux
@@ -120,6 +123,44 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
             m_PeriodicRestart = true;
             continue;
         }
+        else if ( token == "-coordinator" )
+        {
+            m_Coordinator = true;
+            continue;
+        }
+        else if ( token == "-cpupinning" )
+        {
+            m_CPUPinning = true;
+            continue;
+        }
+        else if ( token.BeginsWith( "-scratchdir=" ) )
+        {
+            m_ScratchDir = ( token.Get() + 12 );
+            if ( m_ScratchDir.IsEmpty() == false )
+            {
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token.BeginsWith( "-toolfiles=" ) )
+        {
+            m_ToolFilesDir = ( token.Get() + 11 );
+            if ( m_ToolFilesDir.IsEmpty() == false )
+            {
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token.BeginsWith( "-scratchsize=" ) )
+        {
+            uint32_t num( 0 );
+            if ( ( AString::ScanS( token.Get() + 13, "%u", &num ) == 1 ) && ( num > 0 ) )
+            {
+                m_ScratchSizeMiB = num;
+                continue;
+            }
+            // problem... fall through
+        }
         #if defined( __WINDOWS__ )
             else if ( token.BeginsWith( "-minfreememory=" ) )
             {
@@ -165,6 +206,12 @@ void FBuildWorkerOptions::ShowUsageError()
                        "---------------------------------------------------------------------------\n"
                        " -console\n"
                        "        (Windows/OSX) Operate from console instead of GUI.\n"
+                       " -coordinator\n"
+                       "        Also track available workers for clients, as set by\n"
+                       "        FASTBUILD_COORDINATOR=<host>[:<port>] on workers and clients.\n"
+                       " -cpupinning\n"
+                       "        (Linux) Pin each job to the least loaded group of CPUs sharing\n"
+                       "        a NUMA node and L3 cache.\n"
                        " -cpus=<n|-n|n%>   Set number of CPUs to use:\n"
                        "        -  n : Explicit number.\n"
                        "        - -n : Num CPU Cores-n.\n"
@@ -183,6 +230,14 @@ void FBuildWorkerOptions::ShowUsageError()
                        "        (Windows) Don't spawn a sub-process worker copy.\n"
                        " -periodicrestart\n"
                        "        Worker will restart every 4 hours.\n"
+                       " -scratchdir=<path>\n"
+                       "        Write job files to a memory-backed filesystem (e.g. /dev/shm)\n"
+                       "        when there's room, instead of the temp dir.\n"
+                       " -scratchsize=<MiB>\n"
+                       "        Space jobs can use in the -scratchdir (default 1024).\n"
+                       " -toolfiles=<path>\n"
+                       "        Keep files shared between toolchains here (default is the\n"
+                       "        user's cache dir). Use the toolchains' volume to hard link.\n"
                        "---------------------------------------------------------------------------\n"
                        ;
 
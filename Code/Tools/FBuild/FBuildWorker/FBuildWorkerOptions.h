@@ -9,10 +9,7 @@
 
 // Core
 #include "Core/Env/Types.h"
-
-// Forward Declaration
-//------------------------------------------------------------------------------
-class AString;
+#include "Core/Strings/AString.h"
 
 // FBuildWorkerOptions
 //------------------------------------------------------------------------------
@@ -35,12 +32,17 @@ public:
     bool m_OverrideWorkMode;
     WorkerSettings::Mode m_WorkMode;
     uint32_t m_MinimumFreeMemoryMiB; // Minimum OS free memory including virtual memory to let worker do its work
+    AString m_ScratchDir;           // Memory-backed dir for job temp files (empty to use the temp dir)
+    uint32_t m_ScratchSizeMiB;      // Space jobs can use in m_ScratchDir
+    bool m_CPUPinning;              // Pin jobs to CPUs sharing a NUMA node and L3 cache
+    AString m_ToolFilesDir;         // Where toolchain files are kept (empty for the default)
 
     // Console mode
     bool m_ConsoleMode;
 
     // Other
     bool m_PeriodicRestart;
+    bool m_Coordinator;     // Also act as a WorkerCoordinator
 
 private:
     void ShowUsageError();
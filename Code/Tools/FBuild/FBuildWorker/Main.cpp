@@ -8,6 +8,10 @@
 #include "Tools/FBuild/FBuildWorker/FBuildWorkerOptions.h"
 #include "Tools/FBuild/FBuildWorker/Worker/Worker.h"
 
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/CPUPlacement.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
+
 // Core
 #include "Core/Env/Assert.h"
 #include "Core/Env/Env.h"
@@ -123,10 +127,17 @@ int Main( const AString & args )
         // TODO:LINUX SetPriorityClass equivalent
     #endif
 
+    // group CPUs for job placement before any jobs can start
+    if ( options.m_CPUPinning )
+    {
+        CPUPlacement * placement = FNEW( CPUPlacement );
+        placement->DetectTopology();
+    }
+
     // start the worker and wait for it to be closed
     int ret;
     {
-        Worker worker( args, options.m_ConsoleMode, options.m_PeriodicRestart );
+        Worker worker( args, options.m_ConsoleMode, options.m_PeriodicRestart, options.m_Coordinator );
         if ( options.m_OverrideCPUAllocation )
         {
             WorkerSettings::Get().SetNumCPUsToUse( options.m_CPUAllocation );
@@ -139,9 +150,22 @@ int Main( const AString & args )
         {
             WorkerSettings::Get().SetMinimumFreeMemoryMiB( options.m_MinimumFreeMemoryMiB );
         }
+        if ( options.m_ScratchDir.IsEmpty() == false )
+        {
+            WorkerThread::InitMemoryTmpDir( options.m_ScratchDir, options.m_ScratchSizeMiB );
+        }
+        if ( options.m_ToolFilesDir.IsEmpty() == false )
+        {
+            worker.SetToolFilesDir( options.m_ToolFilesDir );
+        }
         ret = worker.Work();
     }
 
+    if ( CPUPlacement::IsValid() )
+    {
+        FDELETE( &CPUPlacement::Get() );
+    }
+
     return ret;
 }
 
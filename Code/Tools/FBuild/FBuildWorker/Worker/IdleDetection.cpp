@@ -5,9 +5,15 @@
 //------------------------------------------------------------------------------
 #include "IdleDetection.h"
 
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/ProcFS.h"
+
 // Core
 #include "Core/Containers/Array.h"
+#include "Core/Env/Env.h"
+#include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
 #include "Core/Math/Conversions.h"
 #include "Core/Process/Process.h"
 #include "Core/Strings/AStackString.h"
@@ -19,8 +25,10 @@
 #endif
 #if defined( __LINUX__ )
     #include <dirent.h>
+    #include <math.h>
     #include <stdlib.h>
     #include <sys/stat.h>
+    #include <unistd.h>
 #endif
 #if defined( __OSX__ )
     #include <mach/mach_host.h>
@@ -29,6 +37,8 @@
 // Defines
 //------------------------------------------------------------------------------
 #define IDLE_CHECK_DELAY_SECONDS ( 0.1f )
+#define IDLE_FLOAT_SMOOTHING_UP ( 0.1f )    // Fraction of change applied per update when becoming more idle
+#define IDLE_FLOAT_SMOOTHING_DOWN ( 0.3f )  // Become less idle more quickly
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -39,10 +49,16 @@ IdleDetection::IdleDetection()
     , m_IsIdleFloat( 0.0f )
     , m_IsIdleCurrent( 0.0f )
     , m_IdleSmoother( 0 )
-    , m_IdleFloatSmoother( 0 )
     , m_ProcessesInOurHierarchy( 32, true )
     , m_LastTimeIdle( 0 )
     , m_LastTimeBusy( 0 )
+    , m_CPULimit( 0 )
+    , m_MemoryPressure( 0.0f )
+    #if defined( __LINUX__ )
+        , m_CPUCapacity( (float)Env::GetNumProcessors() )
+        , m_CPUPressure( 0.0f )
+        , m_LastUsageCheck( 0 )
+    #endif
 {
     ProcessInfo self;
     self.m_PID = Process::GetCurrentId();
@@ -52,6 +68,10 @@ IdleDetection::IdleDetection()
     #endif
     self.m_LastTime = 0;
     m_ProcessesInOurHierarchy.Append( self );
+
+    #if defined( __LINUX__ )
+        InitCGroup();
+    #endif
 }
 
 // DESTRUCTOR
@@ -83,22 +103,11 @@ void IdleDetection::Update( uint32_t idleThresholdPercent )
         m_IsIdle = false;
     }
 
-    // separate smoothing for idle float values. They behave differently.
-    if ( m_IsIdleCurrent >= m_IsIdleFloat )
-    {
-        ++m_IdleFloatSmoother;
-    }
-    else
-    {
-        m_IdleFloatSmoother -= 2; // become non-idle more quickly than we become idle
-    }
-    m_IdleFloatSmoother = Math::Clamp( m_IdleFloatSmoother, 0, 10 );
-
-    // change state only when at extreme of either end of scale
-    if ( ( m_IdleFloatSmoother == 10 ) || ( m_IdleFloatSmoother == 0 ) ) // 5 secs (called every ~500ms)
-    {
-        m_IsIdleFloat = m_IsIdleCurrent;
-    }
+    // separate smoothing for idle float values, which follow the current
+    // value continuously so capacity scales up and down gradually
+    const float smoothing = ( m_IsIdleCurrent >= m_IsIdleFloat ) ? IDLE_FLOAT_SMOOTHING_UP : IDLE_FLOAT_SMOOTHING_DOWN;
+    m_IsIdleFloat += ( m_IsIdleCurrent - m_IsIdleFloat ) * smoothing;
+    m_IsIdleFloat = Math::Clamp( m_IsIdleFloat, 0.0f, 1.0f );
 }
 
 // IsIdleInternal
@@ -107,6 +116,12 @@ bool IdleDetection::IsIdleInternal( uint32_t idleThresholdPercent, float & idleC
 {
     // determine total cpu time (including idle)
     uint64_t systemTime = 0;
+    float cpuPressure = 0.0f;
+    #if defined( __LINUX__ )
+        UpdatePressure();
+        cpuPressure = m_CPUPressure;
+        systemTime = UpdateSystemCPUUsage();
+    #else
     {
         uint64_t idleTime = 0;
         uint64_t kernTime = 0;
@@ -123,10 +138,11 @@ bool IdleDetection::IsIdleInternal( uint32_t idleThresholdPercent, float & idleC
         m_LastTimeIdle = ( idleTime );
         m_LastTimeBusy = ( userTime + kernTime );
     }
+    #endif
 
     // if the total CPU time is below the idle theshold, we don't need to
     // check to know acurately what the cpu use of FASTBuild is
-    if ( m_CPUUsageTotal < (float)idleThresholdPercent )
+    if ( Math::Max( m_CPUUsageTotal, cpuPressure ) < (float)idleThresholdPercent )
     {
         idleCurrent = 1.0f;
         return true;
@@ -166,8 +182,15 @@ bool IdleDetection::IsIdleInternal( uint32_t idleThresholdPercent, float & idleC
         m_Timer.Start();
     }
 
-    idleCurrent = ( 1.0f - ( ( m_CPUUsageTotal - m_CPUUsageFASTBuild ) * 0.01f ) );
-    return ( ( m_CPUUsageTotal - m_CPUUsageFASTBuild ) < (float)idleThresholdPercent );
+    // Tasks stalled waiting for a CPU mean the CPUs are busier than their use
+    // by other processes suggests (e.g. other containers on the same host).
+    // Our own compilers stall each other too when they fill the CPUs, so only
+    // the share of the pressure attributable to other processes is counted.
+    const float otherUsage = Math::Max( ( m_CPUUsageTotal - m_CPUUsageFASTBuild ), 0.0f );
+    const float otherShare = ( m_CPUUsageTotal > 0.0f ) ? Math::Clamp( otherUsage / m_CPUUsageTotal, 0.0f, 1.0f ) : 1.0f;
+    const float busy = Math::Max( otherUsage, cpuPressure * otherShare );
+    idleCurrent = ( 1.0f - ( busy * 0.01f ) );
+    return ( busy < (float)idleThresholdPercent );
 }
 
 // GetSystemTotalCPUUsage
@@ -196,37 +219,14 @@ bool IdleDetection::IsIdleInternal( uint32_t idleThresholdPercent, float & idleC
         VERIFY( GetProcessInfoString( "/proc/stat", procStat ) ); // Should never fail
 
         // First line should be system totals
-        if ( procStat.BeginsWithI( "cpu" ) )
+        if ( ProcFS::ParseSystemStat( procStat, outIdleTime, outKernTime, outUserTime ) )
         {
-            Array< uint32_t > values( 10, true );
-            const char * pos = procStat.Get() + 4; // skip "cpu "
-            for ( ;; )
-            {
-                char * end;
-                values.Append( strtoul( pos, &end, 10 ) );
-                pos = end;
-                if ( pos == procStat.GetEnd() )
-                {
-                    break;
-                }
-            }
-            if ( values.GetSize() > 3 )
-            {
-                // 0+1 = user/nice time, 2 = kernel time
-                outUserTime = values[ 0 ] + values[ 1 ];
-                outKernTime = values[ 2 ];
-                // idle is all times minus user/nice/kernel
-                outIdleTime = 0;
-                for ( const uint32_t v : values )
-                {
-                    outIdleTime += v;
-                }
-                outIdleTime -= outUserTime;
-                outIdleTime -= outKernTime;
-                return;
-            }
+            return;
         }
         ASSERT( false && "Unexpected /proc/stat format" );
+        outIdleTime = 0;
+        outKernTime = 0;
+        outUserTime = 0;
     #endif
 }
 
@@ -262,13 +262,13 @@ bool IdleDetection::IsIdleInternal( uint32_t idleThresholdPercent, float & idleC
         if ( GetProcessInfoString( AStackString<>().Format( "/proc/%u/stat", pi.m_PID ).Get(),
                                    processInfo ) )
         {
-            Array< AString > tokens( 32, true );
-            processInfo.Tokenize( tokens, ' ' );
-            if ( tokens.GetSize() >= 15 )
+            uint32_t parentPID = 0;
+            uint64_t userTicks = 0;
+            uint64_t kernTicks = 0;
+            if ( ProcFS::ParseProcessStat( processInfo, parentPID, userTicks, kernTicks ) )
             {
-                // Item index 13 and 14 (0-based) are the utime and stime
-                outUserTime = strtoul( tokens[ 13 ].Get(), nullptr, 10 );
-                outKernTime = strtoul( tokens[ 14 ].Get(), nullptr, 10 );
+                outUserTime = TicksToMicroseconds( userTicks );
+                outKernTime = TicksToMicroseconds( kernTicks );
                 return;
             }
             else
@@ -342,6 +342,99 @@ void IdleDetection::UpdateProcessList()
     #elif defined( __OSX__ )
         // TODO:OSX Implement FindNewProcesses
     #elif defined( __LINUX__ )
+        // Examining every process on the system is expensive, so only do so
+        // if the kernel doesn't provide lists of child processes
+        if ( FindChildProcesses( sAliveValue ) == false )
+        {
+            FindChildProcessesByScanning( sAliveValue );
+        }
+    #endif
+
+    // prune dead processes
+    {
+        // never prune first process (this process)
+        const size_t numProcesses = m_ProcessesInOurHierarchy.GetSize();
+        for ( size_t i = ( numProcesses - 1 ); i > 0; --i )
+        {
+            if ( m_ProcessesInOurHierarchy[ i ].m_AliveValue != sAliveValue )
+            {
+                // dead process
+                #if defined( __WINDOWS__ )
+                    CloseHandle( m_ProcessesInOurHierarchy[ i ].m_ProcessHandle );
+                #endif
+                m_ProcessesInOurHierarchy.EraseIndex( i );
+            }
+        }
+    }
+}
+
+#if defined( __LINUX__ )
+    // FindChildProcesses
+    //------------------------------------------------------------------------------
+    bool IdleDetection::FindChildProcesses( uint32_t aliveValue )
+    {
+        // Each thread of a process lists the children it started. Processes are
+        // appended as they are found, so their children are found too.
+        AStackString<> path;
+        for ( size_t i = 0; i < m_ProcessesInOurHierarchy.GetSize(); ++i )
+        {
+            const uint32_t pid = m_ProcessesInOurHierarchy[ i ].m_PID;
+            path.Format( "/proc/%u/task/", pid );
+            DIR * dir = opendir( path.Get() );
+            if ( dir == nullptr )
+            {
+                continue; // Process might have exited
+            }
+
+            for ( ;; )
+            {
+                const dirent * entry = readdir( dir );
+                if ( entry == nullptr )
+                {
+                    break; // no more entries
+                }
+                if ( entry->d_name[ 0 ] == '.' )
+                {
+                    continue;
+                }
+
+                path.Format( "/proc/%u/task/%s/children", pid, entry->d_name );
+                AStackString< 1024 > children;
+                if ( GetFileContents( path.Get(), children ) == false )
+                {
+                    if ( i == 0 )
+                    {
+                        // Our own list should always be available, unless the
+                        // kernel was built without support for it
+                        closedir( dir );
+                        return false;
+                    }
+                    continue; // Thread or process might have exited
+                }
+
+                // Space separated list of PIDs
+                const char * pos = children.Get();
+                for ( ;; )
+                {
+                    char * end;
+                    const uint32_t childPID = (uint32_t)strtoul( pos, &end, 10 );
+                    if ( end == pos )
+                    {
+                        break;
+                    }
+                    TrackProcess( childPID, aliveValue );
+                    pos = end;
+                }
+            }
+            closedir( dir );
+        }
+        return true;
+    }
+
+    // FindChildProcessesByScanning
+    //------------------------------------------------------------------------------
+    void IdleDetection::FindChildProcessesByScanning( uint32_t aliveValue )
+    {
         // Each process has a directory in /proc/
         // The name of the dir is the pid
         AStackString<> path( "/proc/" );
@@ -408,55 +501,47 @@ void IdleDetection::UpdateProcessList()
                     continue; // Process might have exited
                 }
 
-                // Item index 3 (0-based) is the parent PID
-                Array< AString > tokens( 32, true );
-                processInfo.Tokenize( tokens, ' ' );
-                const uint32_t parentPID = strtoul( tokens[ 3 ].Get(), nullptr, 10 );
+                uint32_t parentPID = 0;
+                uint64_t userTicks = 0;
+                uint64_t kernTicks = 0;
+                if ( ProcFS::ParseProcessStat( processInfo, parentPID, userTicks, kernTicks ) == false )
+                {
+                    ASSERT( false && "Unexpected '/proc/<pid>/stat' format" );
+                    continue;
+                }
 
                 // is process a child of one we care about?
                 if ( m_ProcessesInOurHierarchy.Find( parentPID ) )
                 {
-                    ASSERT( pid == strtoul( tokens[ 0 ].Get(), nullptr, 10 ) ); // Item index 0 (0-based) is the PID
-
-                    // Are we already tracking this process?
-                    ProcessInfo * info = m_ProcessesInOurHierarchy.Find( pid );
-                    if ( info )
-                    {
-                        // an existing process that is still alive
-                        info->m_AliveValue = sAliveValue; // still active
-                    }
-                    else
-                    {
-                        // track new process
-                        ProcessInfo newProcess;
-                        newProcess.m_PID = pid;
-                        newProcess.m_AliveValue = sAliveValue;
-                        newProcess.m_LastTime = 0;
-                        m_ProcessesInOurHierarchy.Append( newProcess );
-                    }
+                    TrackProcess( pid, aliveValue );
                 }
             }
             closedir( dir );
         }
-    #endif
+    }
 
-    // prune dead processes
+    // TrackProcess
+    //------------------------------------------------------------------------------
+    void IdleDetection::TrackProcess( uint32_t pid, uint32_t aliveValue )
     {
-        // never prune first process (this process)
-        const size_t numProcesses = m_ProcessesInOurHierarchy.GetSize();
-        for ( size_t i = ( numProcesses - 1 ); i > 0; --i )
+        // Are we already tracking this process?
+        ProcessInfo * info = m_ProcessesInOurHierarchy.Find( pid );
+        if ( info )
         {
-            if ( m_ProcessesInOurHierarchy[ i ].m_AliveValue != sAliveValue )
-            {
-                // dead process
-                #if defined( __WINDOWS__ )
-                    CloseHandle( m_ProcessesInOurHierarchy[ i ].m_ProcessHandle );
-                #endif
-                m_ProcessesInOurHierarchy.EraseIndex( i );
-            }
+            // an existing process that is still alive
+            info->m_AliveValue = aliveValue; // still active
+        }
+        else
+        {
+            // track new process
+            ProcessInfo newProcess;
+            newProcess.m_PID = pid;
+            newProcess.m_AliveValue = aliveValue;
+            newProcess.m_LastTime = 0;
+            m_ProcessesInOurHierarchy.Append( newProcess );
         }
     }
-}
+#endif
 
 // GetProcessInfoString
 //------------------------------------------------------------------------------
@@ -491,4 +576,164 @@ void IdleDetection::UpdateProcessList()
     }
 #endif
 
+#if defined( __LINUX__ )
+    // GetFileContents
+    //------------------------------------------------------------------------------
+    /*static*/ bool IdleDetection::GetFileContents( const char * fileName, AString & outContents )
+    {
+        FileStream f;
+        if ( f.Open( fileName, FileStream::READ_ONLY ) == false )
+        {
+            return false;
+        }
+
+        // The size of /proc and /sys files is not known until they are read
+        outContents.Clear();
+        char buffer[ 1024 ];
+        for ( ;; )
+        {
+            const uint64_t len = f.ReadBuffer( buffer, sizeof( buffer ) );
+            if ( ( len == 0 ) || ( len > sizeof( buffer ) ) )
+            {
+                break; // finished (or failed)
+            }
+            outContents.Append( buffer, (size_t)len );
+        }
+        return true;
+    }
+
+    // InitCGroup
+    //------------------------------------------------------------------------------
+    void IdleDetection::InitCGroup()
+    {
+        // Find the cgroup the worker belongs to in the (v2) unified hierarchy
+        AStackString< 4096 > cgroups;
+        if ( GetFileContents( "/proc/self/cgroup", cgroups ) == false )
+        {
+            return;
+        }
+        AStackString<> entry;
+        if ( ProcFS::ParseCGroupPath( cgroups, entry ) == false )
+        {
+            return; // Only cgroup v1 is available
+        }
+
+        // The unified hierarchy is mounted alongside v1 controllers on some systems
+        AStackString<> path( FileIO::FileExists( "/sys/fs/cgroup/cgroup.controllers" ) ? "/sys/fs/cgroup" : "/sys/fs/cgroup/unified" );
+        path += entry;
+        PathUtils::EnsureTrailingSlash( path );
+
+        // Limits only apply in a container (or similar)
+        AStackString< 1024 > cpuMax;
+        AStackString< 1024 > memoryMax;
+        AStackString<> fileName;
+        float numCPUs = 0.0f;
+        const bool cpuLimited = GetProcessInfoString( fileName.Format( "%scpu.max", path.Get() ).Get(), cpuMax ) &&
+                                ProcFS::ParseCPUMax( cpuMax, numCPUs );
+        const bool memoryLimited = GetProcessInfoString( fileName.Format( "%smemory.max", path.Get() ).Get(), memoryMax ) &&
+                                   ( memoryMax != "max" );
+        if ( cpuLimited )
+        {
+            m_CPUCapacity = Math::Min( numCPUs, m_CPUCapacity );
+            m_CPULimit = Math::Max( (uint32_t)ceilf( m_CPUCapacity ), 1u );
+        }
+        if ( cpuLimited || memoryLimited )
+        {
+            m_CGroupPath = path;
+        }
+    }
+
+    // UpdateSystemCPUUsage
+    //------------------------------------------------------------------------------
+    uint64_t IdleDetection::UpdateSystemCPUUsage()
+    {
+        // Determine CPU time (in microseconds) used by everything sharing the
+        // CPUs available to the worker. In a container this is the cgroup, as
+        // the system totals include the rest of the host.
+        uint64_t usedTime = 0;
+        if ( m_CGroupPath.IsEmpty() ||
+             ( GetCGroupValue( m_CGroupPath, "cpu.stat", "usage_usec", usedTime ) == false ) )
+        {
+            uint64_t idleTime = 0;
+            uint64_t kernTime = 0;
+            uint64_t userTime = 0;
+            GetSystemTotalCPUUsage( idleTime, kernTime, userTime );
+            usedTime = TicksToMicroseconds( kernTime + userTime );
+        }
+        const int64_t now = Timer::GetNow();
+
+        // Return the available CPU time since the last update
+        uint64_t systemTime = 0;
+        if ( ( m_LastUsageCheck != 0 ) && ( usedTime >= m_LastTimeBusy ) )
+        {
+            const double elapsedSecs = ( (double)( now - m_LastUsageCheck ) / (double)Timer::GetFrequency() );
+            systemTime = (uint64_t)( elapsedSecs * 1000000.0 * (double)m_CPUCapacity );
+            if ( systemTime > 0 )
+            {
+                const double usage = ( (double)( usedTime - m_LastTimeBusy ) / (double)systemTime );
+                m_CPUUsageTotal = Math::Min( (float)usage * 100.0f, 100.0f );
+            }
+        }
+        m_LastUsageCheck = now;
+        m_LastTimeBusy = usedTime;
+        return systemTime;
+    }
+
+    // UpdatePressure
+    //------------------------------------------------------------------------------
+    void IdleDetection::UpdatePressure()
+    {
+        // Pressure Stall Information for the container if there is one,
+        // otherwise for the whole system
+        AStackString<> fileName;
+        if ( m_CGroupPath.IsEmpty() ||
+             ( GetPressure( fileName.Format( "%scpu.pressure", m_CGroupPath.Get() ).Get(), m_CPUPressure ) == false ) )
+        {
+            if ( GetPressure( "/proc/pressure/cpu", m_CPUPressure ) == false )
+            {
+                m_CPUPressure = 0.0f; // Not supported by kernel
+            }
+        }
+        if ( m_CGroupPath.IsEmpty() ||
+             ( GetPressure( fileName.Format( "%smemory.pressure", m_CGroupPath.Get() ).Get(), m_MemoryPressure ) == false ) )
+        {
+            if ( GetPressure( "/proc/pressure/memory", m_MemoryPressure ) == false )
+            {
+                m_MemoryPressure = 0.0f; // Not supported by kernel
+            }
+        }
+    }
+
+    // GetPressure
+    //------------------------------------------------------------------------------
+    /*static*/ bool IdleDetection::GetPressure( const char * fileName, float & outPressure )
+    {
+        // First line is the percentage of time at least one task was stalled
+        AStackString< 1024 > pressure;
+        return GetProcessInfoString( fileName, pressure ) &&
+               ProcFS::ParsePressure( pressure, outPressure );
+    }
+
+    // GetCGroupValue
+    //------------------------------------------------------------------------------
+    /*static*/ bool IdleDetection::GetCGroupValue( const AString & cgroupPath, const char * fileName, const char * key, uint64_t & outValue )
+    {
+        // Files with several values have one "key value" pair per line
+        AStackString< 1024 > contents;
+        if ( GetFileContents( AStackString<>().Format( "%s%s", cgroupPath.Get(), fileName ).Get(), contents ) == false )
+        {
+            return false;
+        }
+        return ProcFS::ParseKeyValue( contents, key, outValue );
+    }
+
+    // TicksToMicroseconds
+    //------------------------------------------------------------------------------
+    /*static*/ uint64_t IdleDetection::TicksToMicroseconds( uint64_t ticks )
+    {
+        static const uint64_t ticksPerSecond = (uint64_t)sysconf( _SC_CLK_TCK );
+        return ( ticks * 1000000 ) / ticksPerSecond;
+    }
+#endif
+
 //------------------------------------------------------------------------------
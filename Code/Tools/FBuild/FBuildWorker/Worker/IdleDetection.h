@@ -28,6 +28,12 @@ public:
     inline bool IsIdle() const { return m_IsIdle; }
     inline float IsIdleFloat() const { return m_IsIdleFloat; }
 
+    // Limits of the container (cgroup) the worker runs in
+    inline uint32_t GetCPULimit() const { return m_CPULimit; } // 0 if not limited
+
+    // Percentage of recent time processes were stalled waiting for memory (Linux only)
+    inline float GetMemoryPressure() const { return m_MemoryPressure; }
+
 private:
     // struct to track processes with
     struct ProcessInfo
@@ -54,6 +60,17 @@ private:
     #if defined( __LINUX__ )
         static bool GetProcessInfoString( const char * fileName,
                                           AStackString< 1024 > & outProcessInfoString );
+
+        static bool GetFileContents( const char * fileName, AString & outContents );
+        void InitCGroup();
+        uint64_t UpdateSystemCPUUsage();
+        void UpdatePressure();
+        static bool GetPressure( const char * fileName, float & outPressure );
+        static bool GetCGroupValue( const AString & cgroupPath, const char * fileName, const char * key, uint64_t & outValue );
+        bool FindChildProcesses( uint32_t aliveValue );
+        void FindChildProcessesByScanning( uint32_t aliveValue );
+        void TrackProcess( uint32_t pid, uint32_t aliveValue );
+        static uint64_t TicksToMicroseconds( uint64_t ticks );
     #endif
 
     Timer   m_Timer;
@@ -63,10 +80,17 @@ private:
     float   m_IsIdleFloat;
     float   m_IsIdleCurrent;
     int32_t m_IdleSmoother;
-    int32_t m_IdleFloatSmoother;
     Array< ProcessInfo > m_ProcessesInOurHierarchy;
     uint64_t m_LastTimeIdle;
     uint64_t m_LastTimeBusy;
+    uint32_t m_CPULimit;
+    float   m_MemoryPressure;
+    #if defined( __LINUX__ )
+        AString m_CGroupPath;       // set if CPU or memory is limited by a cgroup (i.e. in a container)
+        float   m_CPUCapacity;      // CPUs available to the worker
+        float   m_CPUPressure;
+        int64_t m_LastUsageCheck;
+    #endif
 };
 
 //------------------------------------------------------------------------------
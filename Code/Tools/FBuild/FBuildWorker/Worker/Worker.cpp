@@ -19,6 +19,7 @@
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerCoordinator.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
 // Core
@@ -39,18 +40,25 @@
 #endif
 #include <stdio.h>
 
+// Defines
+//------------------------------------------------------------------------------
+#define WORKER_MIN_MEMORY_PRESSURE ( 5.0f )  // Start accepting less work when tasks are stalled on memory this % of the time
+#define WORKER_MAX_MEMORY_PRESSURE ( 20.0f ) // Stop accepting work when tasks are stalled on memory this % of the time
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Worker::Worker( const AString & args, bool consoleMode, bool periodicRestart )
+Worker::Worker( const AString & args, bool consoleMode, bool periodicRestart, bool coordinator )
     : m_ConsoleMode( consoleMode )
     , m_PeriodicRestart( periodicRestart )
     , m_MainWindow( nullptr )
     , m_ConnectionPool( nullptr )
+    , m_Coordinator( nullptr )
     , m_NetworkStartupHelper( nullptr )
     , m_BaseArgs( args )
     , m_LastWriteTime( 0 )
     , m_WantToQuit( false )
     , m_RestartNeeded( false )
+    , m_NumSlots( 0 )
     #if defined( __WINDOWS__ )
         , m_LastDiskSpaceResult( -1 )
         , m_LastMemoryCheckResult( -1 )
@@ -59,6 +67,10 @@ Worker::Worker( const AString & args, bool consoleMode, bool periodicRestart )
     m_WorkerSettings = FNEW( WorkerSettings );
     m_NetworkStartupHelper = FNEW( NetworkStartupHelper );
     m_ConnectionPool = FNEW( Server );
+    if ( coordinator )
+    {
+        m_Coordinator = FNEW( WorkerCoordinator );
+    }
 
     Env::GetExePath( m_BaseExeName );
     #if defined( __WINDOWS__ )
@@ -75,6 +87,7 @@ Worker::Worker( const AString & args, bool consoleMode, bool periodicRestart )
 Worker::~Worker()
 {
     FDELETE m_NetworkStartupHelper;
+    FDELETE m_Coordinator;
     FDELETE m_ConnectionPool;
     FDELETE m_MainWindow;
     FDELETE m_WorkerSettings;
@@ -106,6 +119,13 @@ Worker::~Worker()
     }
 }
 
+// SetToolFilesDir
+//------------------------------------------------------------------------------
+void Worker::SetToolFilesDir( const AString & dir )
+{
+    m_ConnectionPool->GetToolFileStore().SetRoot( dir );
+}
+
 // Work
 //------------------------------------------------------------------------------
 int32_t Worker::Work()
@@ -173,6 +193,15 @@ uint32_t Worker::WorkThread()
         ErrorMessage( "Failed to listen on port %u.  Check port is not in use.", Protocol::PROTOCOL_PORT );
         return (uint32_t)-1;
     }
+    if ( m_Coordinator )
+    {
+        StatusMessage( "Coordinating workers on port %u\n", Protocol::COORDINATOR_PORT );
+        if ( m_Coordinator->Listen( Protocol::COORDINATOR_PORT ) == false )
+        {
+            ErrorMessage( "Failed to listen on port %u.  Check port is not in use.", Protocol::COORDINATOR_PORT );
+            return (uint32_t)-1;
+        }
+    }
 
     // Special folder for Orbis Clang
     // We just create this folder whether it's needed or not
@@ -354,14 +383,44 @@ void Worker::UpdateAvailability()
         }
     }
 
+    // Respect the CPU limit of the container the worker runs in
+    if ( m_IdleDetection.GetCPULimit() > 0 )
+    {
+        numCPUsToUse = Math::Min( numCPUsToUse, m_IdleDetection.GetCPULimit() );
+    }
+
+    // Back off before memory pressure causes swapping
+    const float memoryPressure = m_IdleDetection.GetMemoryPressure();
+    if ( memoryPressure > WORKER_MIN_MEMORY_PRESSURE )
+    {
+        const float scale = Math::Clamp( 1.0f - ( ( memoryPressure - WORKER_MIN_MEMORY_PRESSURE ) / ( WORKER_MAX_MEMORY_PRESSURE - WORKER_MIN_MEMORY_PRESSURE ) ), 0.0f, 1.0f );
+        numCPUsToUse = uint32_t( ( (float)numCPUsToUse * scale ) + 0.5f ); // round, so light pressure doesn't stop a 1 CPU worker
+    }
+
     // don't accept any new work while waiting for a restart
     if ( m_RestartNeeded || ( hasEnoughDiskSpace == false ) || ( hasEnoughMemory == false ) )
     {
         numCPUsToUse = 0;
     }
 
+    // Give CPUs back immediately when the host needs them, but take them
+    // gradually so a brief lull doesn't pull in a burst of work. When
+    // shrinking, jobs in progress are finished and excess queued jobs are
+    // returned to clients (see Server::UpdateCapacity).
+    if ( ( numCPUsToUse > m_NumSlots ) && ( ws.GetMode() != WorkerSettings::DEDICATED ) )
+    {
+        numCPUsToUse = m_NumSlots + Math::Max( 1u, ( ( numCPUsToUse - m_NumSlots ) / 2 ) );
+    }
+    m_NumSlots = numCPUsToUse;
+
     WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
 
+    // Report load and cached toolchains (used by the coordinator)
+    const uint32_t numJobsActive = m_ConnectionPool->GetNumJobsActive();
+    Array< uint64_t > toolIds;
+    m_ConnectionPool->GetToolIds( toolIds );
+    m_WorkerBrokerage.SetStatus( numCPUsToUse, ( numCPUsToUse > numJobsActive ) ? ( numCPUsToUse - numJobsActive ) : 0, toolIds );
+
     m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0 );
 }
 
@@ -391,6 +450,16 @@ void Worker::UpdateUI()
             status += " (Low Disk Space)";
         }
     #endif
+
+    // share of the worker used by each client
+    AStackString<> clientStatus;
+    m_ConnectionPool->GetClientStatus( clientStatus );
+    if ( clientStatus.IsEmpty() == false )
+    {
+        status += " - ";
+        status += clientStatus;
+    }
+
     if ( InConsoleMode() )
     {
         status += '\n';
@@ -20,6 +20,7 @@ class Server;
 class WorkerWindow;
 class JobQueueRemote;
 class NetworkStartupHelper;
+class WorkerCoordinator;
 class WorkerSettings;
 
 // Worker
@@ -27,12 +28,13 @@ class WorkerSettings;
 class Worker : public Singleton<Worker>
 {
 public:
-    explicit Worker( const AString & args, bool consoleMode, bool periodicRestart );
+    explicit Worker( const AString & args, bool consoleMode, bool periodicRestart, bool coordinator );
     ~Worker();
 
     int32_t Work();
 
     void SetWantToQuit() { m_WantToQuit = true; }
+    void SetToolFilesDir( const AString & dir );
 
 private:
     static uint32_t WorkThreadWrapper( void * userData );
@@ -53,6 +55,7 @@ private:
     bool                m_PeriodicRestart;
     WorkerWindow        * m_MainWindow;
     Server              * m_ConnectionPool;
+    WorkerCoordinator   * m_Coordinator;
     NetworkStartupHelper * m_NetworkStartupHelper;
     WorkerSettings      * m_WorkerSettings;
     IdleDetection       m_IdleDetection;
@@ -62,6 +65,7 @@ private:
     uint64_t            m_LastWriteTime;
     bool                m_WantToQuit;
     bool                m_RestartNeeded;
+    uint32_t            m_NumSlots;                 // Job slots currently in use (see UpdateAvailability)
     Timer               m_PeriodicRestartTimer;
     Timer               m_UIUpdateTimer;
     FileStream          m_TargetIncludeFolderLock;
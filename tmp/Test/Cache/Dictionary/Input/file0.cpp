@@ -0,0 +1 @@
+int Function0() { return 0; }
@@ -0,0 +1 @@
+int Function10() { return 10; }
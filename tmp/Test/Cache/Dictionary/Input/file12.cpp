@@ -0,0 +1 @@
+int Function12() { return 12; }
@@ -0,0 +1 @@
+int Function16() { return 16; }
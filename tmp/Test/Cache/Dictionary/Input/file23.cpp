@@ -0,0 +1 @@
+int Function23() { return 23; }
@@ -0,0 +1 @@
+int Function24() { return 24; }
@@ -0,0 +1 @@
+int Function25() { return 25; }
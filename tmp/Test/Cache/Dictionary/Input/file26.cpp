@@ -0,0 +1 @@
+int Function26() { return 26; }
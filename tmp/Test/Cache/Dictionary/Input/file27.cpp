@@ -0,0 +1 @@
+int Function27() { return 27; }
@@ -0,0 +1 @@
+int Function28() { return 28; }
@@ -0,0 +1 @@
+int Function32() { return 32; }
@@ -0,0 +1 @@
+int Function34() { return 34; }
@@ -0,0 +1 @@
+int Function37() { return 37; }
@@ -0,0 +1 @@
+int Function38() { return 38; }
@@ -0,0 +1 @@
+int Function39() { return 39; }
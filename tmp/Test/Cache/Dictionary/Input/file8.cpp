@@ -0,0 +1 @@
+int Function8() { return 8; }
@@ -0,0 +1 @@
+int Function9() { return 9; }
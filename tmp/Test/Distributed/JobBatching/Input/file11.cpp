@@ -0,0 +1 @@
+int Function11() { return 11; }
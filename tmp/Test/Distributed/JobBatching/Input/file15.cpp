@@ -0,0 +1 @@
+int Function15() { return 15; }
@@ -0,0 +1 @@
+int Function17() { return 17; }
@@ -0,0 +1 @@
+int Function2() { return 2; }
@@ -0,0 +1 @@
+int Function22() { return 22; }
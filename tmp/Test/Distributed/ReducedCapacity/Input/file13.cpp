@@ -0,0 +1 @@
+int Function13() { return 13; }
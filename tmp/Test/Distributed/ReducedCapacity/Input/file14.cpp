@@ -0,0 +1 @@
+int Function14() { return 14; }
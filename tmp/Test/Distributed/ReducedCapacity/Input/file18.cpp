@@ -0,0 +1 @@
+int Function18() { return 18; }
@@ -0,0 +1 @@
+int Function19() { return 19; }
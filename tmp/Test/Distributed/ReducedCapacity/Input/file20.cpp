@@ -0,0 +1 @@
+int Function20() { return 20; }
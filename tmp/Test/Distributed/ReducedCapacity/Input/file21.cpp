@@ -0,0 +1 @@
+int Function21() { return 21; }
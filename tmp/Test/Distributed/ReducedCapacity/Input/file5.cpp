@@ -0,0 +1 @@
+int Function5() { return 5; }
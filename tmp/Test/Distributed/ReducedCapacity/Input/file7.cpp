@@ -0,0 +1 @@
+int Function7() { return 7; }
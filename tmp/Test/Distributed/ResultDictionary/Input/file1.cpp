@@ -0,0 +1 @@
+int Function1() { return 1; }
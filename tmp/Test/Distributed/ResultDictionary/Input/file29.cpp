@@ -0,0 +1 @@
+int Function29() { return 29; }
@@ -0,0 +1 @@
+int Function3() { return 3; }
@@ -0,0 +1 @@
+int Function30() { return 30; }
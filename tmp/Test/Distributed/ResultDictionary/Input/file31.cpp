@@ -0,0 +1 @@
+int Function31() { return 31; }
@@ -0,0 +1 @@
+int Function33() { return 33; }
@@ -0,0 +1 @@
+int Function35() { return 35; }
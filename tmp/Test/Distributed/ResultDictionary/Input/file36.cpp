@@ -0,0 +1 @@
+int Function36() { return 36; }
@@ -0,0 +1 @@
+int Function4() { return 4; }
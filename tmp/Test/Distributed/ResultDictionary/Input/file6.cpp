@@ -0,0 +1 @@
+int Function6() { return 6; }
@@ -0,0 +1,9 @@
+
+// This cpp file uses the precompiled header
+
+#include <PrecompiledHeader.h>
+
+int main(int, char *[])
+{
+    return SPECIAL_DEFINE;
+}
@@ -0,0 +1,3 @@
+
+// The cpp file is used to create the precompiled header
+#include "PrecompiledHeader.h"
@@ -0,0 +1,6 @@
+// Auto-generated Unity file - do not modify
+
+//#pragma message( "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/ClangStaticAnalysis/file.1.cpp" )
+#include "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/ClangStaticAnalysis/file.1.cpp"
+
+
@@ -0,0 +1,12 @@
+// Auto-generated Unity file - do not modify
+
+//#pragma message( "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/a.cpp" )
+#include "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/a.cpp"
+
+//#pragma message( "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/b.cpp" )
+#include "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/b.cpp"
+
+//#pragma message( "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/c.cpp" )
+#include "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/c.cpp"
+
+
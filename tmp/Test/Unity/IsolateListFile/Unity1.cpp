@@ -0,0 +1,9 @@
+// Auto-generated Unity file - do not modify
+
+//#pragma message( "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/IsolateListFile/file.1.cpp" )
+//#include "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/IsolateListFile/file.1.cpp"
+
+//#pragma message( "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/IsolateListFile/file.2.cpp" )
+#include "/root/repo/Code/Tools/FBuild/FBuildTest/Data/TestUnity/IsolateListFile/file.2.cpp"
+
+
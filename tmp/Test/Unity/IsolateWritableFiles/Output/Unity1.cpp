@@ -0,0 +1,9 @@
+// Auto-generated Unity file - do not modify
+
+//#pragma message( "/root/repo/tmp/Test/Unity/IsolateWritableFiles/Input/a.cpp" )
+//#include "/root/repo/tmp/Test/Unity/IsolateWritableFiles/Input/a.cpp"
+
+//#pragma message( "/root/repo/tmp/Test/Unity/IsolateWritableFiles/Input/b.cpp" )
+//#include "/root/repo/tmp/Test/Unity/IsolateWritableFiles/Input/b.cpp"
+
+